@@ -0,0 +1,532 @@
+/*
+gcc -Wall -O2 netflood.c -o netflood
+
+loopback load generator for the datagram server.
+
+client mode connects -c synthetic clients, each from its own address in
+127.0.0.0/8 since the server keeps one connection per host.  they walk
+through the signon, then send a clc_move at -r per second each while
+acking the server's reliable messages.  the traffic both ways is printed
+once a second.
+
+flood mode (-f) sprays CCREQ_SERVER_INFO and CCREQ_CONNECT requests at -r
+per second from each of -c addresses in 127.1.0.0/16 and counts what
+comes back, for the connect/info rate limiter and the connection hash.
+run it next to a client mode run to see the real clients still get in.
+
+	netflood [-s server] [-p port] [-c count] [-r rate] [-t seconds] [-f]
+
+the server needs a map running and enough slots, e.g.
+	quakespasm-server -dedicated 16 +map start
+
+Linux only: it relies on the whole of 127.0.0.0/8 reaching loopback.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* net_defs.h */
+#define	NETFLAG_LENGTH_MASK	0x0000ffff
+#define	NETFLAG_DATA		0x00010000
+#define	NETFLAG_ACK		0x00020000
+#define	NETFLAG_EOM		0x00080000
+#define	NETFLAG_UNRELIABLE	0x00100000
+#define	NETFLAG_CTL		0x80000000
+
+#define	NET_PROTOCOL_VERSION	3
+
+#define	CCREQ_CONNECT		0x01
+#define	CCREQ_SERVER_INFO	0x02
+#define	CCREP_ACCEPT		0x81
+#define	CCREP_REJECT		0x82
+#define	CCREP_SERVER_INFO	0x83
+
+/* protocol.h */
+#define	clc_disconnect	2
+#define	clc_move	3
+#define	clc_stringcmd	4
+
+#define	MAX_PACKET	1500
+
+enum { CS_CONNECTING, CS_SIGNON, CS_ACTIVE, CS_REJECTED };
+
+typedef struct
+{
+	int		id;
+	int		sock;
+	struct sockaddr_in	to;	/* the accept socket, then the client's own */
+	int		state;
+	int		signon;		/* next signon command */
+	unsigned int	sendseq;
+	unsigned int	unreliableseq;
+	int		waitack;	/* a reliable message is in flight */
+	unsigned char	reliable[64];
+	int		reliablelen;
+	double		lastsend;
+	double		nextmove;
+	double		connecttime;
+} fclient_t;
+
+static const char *signoncmds[] = { "name", "prespawn", "spawn", "begin" };
+#define	NUMSIGNONCMDS	4
+
+static struct sockaddr_in	server;
+static int	numclients = 8;
+static double	rate = 20;
+static double	duration = 10;
+static int	flood;
+
+/* totals and the per second counts */
+static long	moves, updates, reliables, acks;
+static long	infos, accepts, rejects, requests;
+static long	lastmoves, lastupdates, lastreliables;
+static long	lastinfos, lastaccepts, lastrejects, lastrequests;
+
+static double FloatTime (void)
+{
+	struct timeval	tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void PutLong (unsigned char *p, unsigned int l)
+{
+	p[0] = l >> 24;
+	p[1] = l >> 16;
+	p[2] = l >> 8;
+	p[3] = l;
+}
+
+static unsigned int GetLong (const unsigned char *p)
+{
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int OpenSocket (unsigned int host)
+{
+	struct sockaddr_in	addr;
+	int	s;
+
+	s = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0)
+	{
+		perror ("socket");
+		exit (1);
+	}
+	memset (&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl (host);
+	if (bind (s, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		perror ("bind");
+		exit (1);
+	}
+	fcntl (s, F_SETFL, O_NONBLOCK);
+	return s;
+}
+
+static void SendTo (int s, const struct sockaddr_in *to, unsigned char *buf, int len)
+{
+	if (sendto (s, buf, len, 0, (const struct sockaddr *)to, sizeof(*to)) < 0 && errno != EAGAIN)
+		perror ("sendto");
+}
+
+/* connection request, "QUAKE" and the version for connect and info */
+static void SendControl (int s, const struct sockaddr_in *to, int command)
+{
+	unsigned char	buf[16];
+	int	len = 4;
+
+	buf[len++] = command;
+	memcpy (buf + len, "QUAKE", 6);
+	len += 6;
+	if (command == CCREQ_CONNECT)
+		buf[len++] = NET_PROTOCOL_VERSION;
+	PutLong (buf, NETFLAG_CTL | len);
+	SendTo (s, to, buf, len);
+	requests++;
+}
+
+/*
+==============================================================================
+
+CLIENT MODE
+
+==============================================================================
+*/
+
+static void SendReliable (fclient_t *c, double now)
+{
+	unsigned char	buf[MAX_PACKET];
+
+	PutLong (buf, NETFLAG_DATA | NETFLAG_EOM | (c->reliablelen + 8));
+	PutLong (buf + 4, c->sendseq);
+	memcpy (buf + 8, c->reliable, c->reliablelen);
+	SendTo (c->sock, &c->to, buf, c->reliablelen + 8);
+	c->lastsend = now;
+}
+
+static void QueueSignonCmd (fclient_t *c, double now)
+{
+	const char	*cmd = signoncmds[c->signon++];
+
+	c->reliable[0] = clc_stringcmd;
+	if (!strcmp (cmd, "name"))
+		sprintf ((char *)c->reliable + 1, "name client%d", c->id);
+	else
+		strcpy ((char *)c->reliable + 1, cmd);
+	c->reliablelen = strlen ((char *)c->reliable + 1) + 2;
+	c->waitack = 1;
+	SendReliable (c, now);
+}
+
+/* clc_move as SV_ReadClientMove takes it from a FitzQuake protocol server */
+static void SendMove (fclient_t *c, double now)
+{
+	unsigned char	buf[32];
+	float	t = (float)now;
+	int	i, len = 8;
+
+	buf[len++] = clc_move;
+	memcpy (buf + len, &t, 4);	/* little endian hosts only */
+	len += 4;
+	for (i = 0; i < 3; i++)
+	{
+		short	angle = (short)(c->unreliableseq * 64 * (i + 1));
+		buf[len++] = angle & 0xff;
+		buf[len++] = angle >> 8;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		buf[len++] = 0;
+		buf[len++] = 0;
+	}
+	buf[len++] = 0;	/* buttons */
+	buf[len++] = 0;	/* impulse */
+	PutLong (buf, NETFLAG_UNRELIABLE | len);
+	PutLong (buf + 4, c->unreliableseq++);
+	SendTo (c->sock, &c->to, buf, len);
+	moves++;
+}
+
+static void ClientReadPackets (fclient_t *c, double now)
+{
+	unsigned char	buf[MAX_PACKET], ack[8];
+	struct sockaddr_in	from;
+	socklen_t	fromlen;
+	unsigned int	control, seq;
+	int	len;
+
+	for (;;)
+	{
+		fromlen = sizeof(from);
+		len = recvfrom (c->sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromlen);
+		if (len < 0)
+			return;
+		if (len < 5)
+			continue;
+		control = GetLong (buf);
+
+		if (control & NETFLAG_CTL)
+		{
+			if (c->state != CS_CONNECTING)
+				continue;
+			if (buf[4] == CCREP_ACCEPT && len >= 9)
+			{
+				/* the port is a little endian long */
+				c->to.sin_port = htons (buf[5] | (buf[6] << 8));
+				c->state = CS_SIGNON;
+				QueueSignonCmd (c, now);
+			}
+			else if (buf[4] == CCREP_REJECT)
+			{
+				printf ("rejected: %.*s", len - 5, (char *)buf + 5);
+				c->state = CS_REJECTED;
+			}
+			continue;
+		}
+
+		if (len < 8)
+			continue;
+		seq = GetLong (buf + 4);
+		if (control & NETFLAG_UNRELIABLE)
+			updates++;
+		else if (control & NETFLAG_ACK)
+		{
+			if (c->waitack && seq == c->sendseq)
+			{
+				acks++;
+				c->waitack = 0;
+				c->sendseq++;
+				if (c->state == CS_SIGNON)
+				{
+					if (c->signon < NUMSIGNONCMDS)
+						QueueSignonCmd (c, now);
+					else
+					{
+						c->state = CS_ACTIVE;
+						c->nextmove = now;
+						c->connecttime = now - c->connecttime;
+					}
+				}
+			}
+		}
+		else if (control & NETFLAG_DATA)
+		{
+			/* ack every fragment, duplicates too, like the engine does */
+			PutLong (ack, NETFLAG_ACK | 8);
+			PutLong (ack + 4, seq);
+			SendTo (c->sock, &c->to, ack, 8);
+			reliables++;
+		}
+	}
+}
+
+static void RunClients (void)
+{
+	fclient_t	*clients, *c;
+	double	start, now, nextreport;
+	int	i, active;
+	double	connectsum;
+
+	clients = calloc (numclients, sizeof(*clients));
+	start = FloatTime ();
+	for (i = 0, c = clients; i < numclients; i++, c++)
+	{
+		/* 127.0.1.1 onwards */
+		c->id = i;
+		c->sock = OpenSocket (0x7f000101 + (i / 254) * 256 + i % 254);
+		c->to = server;
+		c->state = CS_CONNECTING;
+		c->connecttime = start;
+		c->lastsend = -1;
+	}
+
+	nextreport = start + 1;
+	for (;;)
+	{
+		now = FloatTime ();
+		if (now - start >= duration)
+			break;
+
+		active = 0;
+		for (i = 0, c = clients; i < numclients; i++, c++)
+		{
+			ClientReadPackets (c, now);
+			switch (c->state)
+			{
+			case CS_CONNECTING:
+				if (now - c->lastsend >= 1)
+				{
+					SendControl (c->sock, &c->to, CCREQ_CONNECT);
+					c->lastsend = now;
+				}
+				break;
+			case CS_SIGNON:
+				if (c->waitack && now - c->lastsend >= 1)
+					SendReliable (c, now);
+				break;
+			case CS_ACTIVE:
+				active++;
+				if (c->waitack && now - c->lastsend >= 1)
+					SendReliable (c, now);
+				while (c->nextmove <= now)
+				{
+					SendMove (c, now);
+					c->nextmove += 1.0 / rate;
+				}
+				break;
+			}
+		}
+
+		if (now >= nextreport)
+		{
+			printf ("%3.0fs  %d/%d active  %ld moves/s  %ld updates/s  %ld reliable/s\n",
+				now - start, active, numclients, moves - lastmoves,
+				updates - lastupdates, reliables - lastreliables);
+			lastmoves = moves;
+			lastupdates = updates;
+			lastreliables = reliables;
+			nextreport += 1;
+		}
+		usleep (1000);
+	}
+
+	now = FloatTime ();
+	active = 0;
+	connectsum = 0;
+	for (i = 0, c = clients; i < numclients; i++, c++)
+	{
+		if (c->state == CS_ACTIVE)
+		{
+			active++;
+			connectsum += c->connecttime;
+		}
+		if (c->state == CS_SIGNON || c->state == CS_ACTIVE)
+		{
+			/* unreliable, so a lost one just leaves the server to time it out */
+			unsigned char	buf[9];
+			PutLong (buf, NETFLAG_UNRELIABLE | 9);
+			PutLong (buf + 4, c->unreliableseq++);
+			buf[8] = clc_disconnect;
+			SendTo (c->sock, &c->to, buf, 9);
+		}
+		close (c->sock);
+	}
+
+	printf ("\n%d of %d clients active", active, numclients);
+	if (active)
+		printf (", %.0f ms average from connect to begin", 1000 * connectsum / active);
+	printf ("\n%.0f moves/s sent, %.0f updates/s and %.0f reliable/s received, %ld signon acks\n",
+		moves / (now - start), updates / (now - start), reliables / (now - start), acks);
+	free (clients);
+}
+
+/*
+==============================================================================
+
+FLOOD MODE
+
+==============================================================================
+*/
+
+static void FloodReadPackets (int s)
+{
+	unsigned char	buf[MAX_PACKET];
+	int	len;
+
+	while ((len = recv (s, buf, sizeof(buf), 0)) >= 5)
+	{
+		if (!(GetLong (buf) & NETFLAG_CTL))
+			continue;
+		if (buf[4] == CCREP_SERVER_INFO)
+			infos++;
+		else if (buf[4] == CCREP_ACCEPT)
+			accepts++;
+		else if (buf[4] == CCREP_REJECT)
+			rejects++;
+	}
+}
+
+static void RunFlood (void)
+{
+	int	*socks;
+	double	start, now, next, nextreport;
+	long	sent;
+	int	i;
+
+	socks = malloc (numclients * sizeof(*socks));
+	for (i = 0; i < numclients; i++)
+		socks[i] = OpenSocket (0x7f010001 + i);	/* 127.1.0.1 onwards */
+
+	start = next = FloatTime ();
+	nextreport = start + 1;
+	sent = 0;
+	for (;;)
+	{
+		now = FloatTime ();
+		if (now - start >= duration)
+			break;
+
+		/* every host sends rate requests a second, info and connect in turn */
+		while (next <= now)
+		{
+			i = sent % numclients;
+			SendControl (socks[i], &server, ((sent / numclients) & 1) ? CCREQ_CONNECT : CCREQ_SERVER_INFO);
+			sent++;
+			next = start + sent / (rate * numclients);
+		}
+		for (i = 0; i < numclients; i++)
+			FloodReadPackets (socks[i]);
+
+		if (now >= nextreport)
+		{
+			printf ("%3.0fs  %ld requests/s  %ld info  %ld accept  %ld reject\n",
+				now - start, requests - lastrequests, infos - lastinfos,
+				accepts - lastaccepts, rejects - lastrejects);
+			lastrequests = requests;
+			lastinfos = infos;
+			lastaccepts = accepts;
+			lastrejects = rejects;
+			nextreport += 1;
+		}
+		usleep (1000);
+	}
+
+	now = FloatTime ();
+	printf ("\n%ld requests from %d hosts, %ld answered (%.1f/s): %ld info, %ld accept, %ld reject\n",
+		requests, numclients, infos + accepts + rejects, (infos + accepts + rejects) / (now - start),
+		infos, accepts, rejects);
+	for (i = 0; i < numclients; i++)
+		close (socks[i]);
+	free (socks);
+}
+
+static void Usage (void)
+{
+	printf ("Usage: netflood [-s server] [-p port] [-c count] [-r rate] [-t seconds] [-f]\n"
+		"  -s  server address, default 127.0.0.1\n"
+		"  -p  server port, default 26000\n"
+		"  -c  clients, or flooding hosts with -f, default 8\n"
+		"  -r  moves or requests a second each, default 20\n"
+		"  -t  seconds to run, default 10\n"
+		"  -f  flood connect/info requests instead of playing\n");
+	exit (1);
+}
+
+int main (int argc, char **argv)
+{
+	int	i;
+
+	memset (&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_addr.s_addr = htonl (0x7f000001);
+	server.sin_port = htons (26000);
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp (argv[i], "-f"))
+			flood = 1;
+		else if (i + 1 == argc || argv[i][0] != '-' || argv[i][2])
+			Usage ();
+		else switch (argv[i++][1])
+		{
+		case 's':
+			if (inet_pton (AF_INET, argv[i], &server.sin_addr) != 1)
+				Usage ();
+			break;
+		case 'p':
+			server.sin_port = htons (atoi (argv[i]));
+			break;
+		case 'c':
+			numclients = atoi (argv[i]);
+			break;
+		case 'r':
+			rate = atof (argv[i]);
+			break;
+		case 't':
+			duration = atof (argv[i]);
+			break;
+		default:
+			Usage ();
+		}
+	}
+	if (numclients < 1 || numclients > 65000 || rate <= 0)
+		Usage ();
+
+	if (flood)
+		RunFlood ();
+	else
+		RunClients ();
+	return 0;
+}
@@ -74,6 +74,239 @@ static music_handler_t *music_handlers = NULL;
 
 static snd_stream_t *bgmstream = NULL;
 
+#if defined(USE_SDL2)
+/* Streams are decoded ahead by a dedicated thread into a PCM ring per
+ * stream. The ring is single producer (decoder thread) / single consumer
+ * (main thread) and lock-free: the producer only advances head, the
+ * consumer only advances tail. bgm_mutex guards which stream a ring
+ * decodes: the decoder thread takes it to pick a chunk and to publish
+ * it, but decodes without it, and the main thread takes it to swap or
+ * reset rings, never while copying samples out. A stream is only closed
+ * once the decoder is done with it, see BGM_DetachRing. */
+#define BGM_THREADED	1
+
+#define BGM_RINGSIZE	(1 << 18)	/* 256 KB: ~1.5s of 44.1 kHz 16 bit stereo */
+
+typedef enum
+{
+	BGMRING_DECODING,
+	BGMRING_EOF,		/* stream ended, ring drains then stops */
+	BGMRING_ERROR		/* read or rewind error, see error */
+} bgmring_state_t;
+
+typedef struct
+{
+	snd_stream_t	*stream;
+	int		track;		/* cd track being prefetched, or -1 */
+	int		error;
+	int		generation;	/* bumped by each reset */
+	qboolean	did_rewind;	/* nothing decoded since the last rewind */
+	SDL_atomic_t	state;		/* bgmring_state_t */
+	SDL_atomic_t	head;		/* bytes written, free running */
+	SDL_atomic_t	tail;		/* bytes consumed, free running */
+	byte		data[BGM_RINGSIZE];
+} bgmring_t;
+
+static bgmring_t	bgmrings[2];
+static bgmring_t	*bgmplay = &bgmrings[0];	/* feeds bgmstream */
+static bgmring_t	*bgmnext = &bgmrings[1];	/* prefetched track */
+
+static SDL_Thread	*bgm_thread;
+static SDL_mutex	*bgm_mutex;
+static SDL_cond		*bgm_idle;	/* signalled when bgm_busystream is done */
+static snd_stream_t	*bgm_busystream;	/* being decoded outside bgm_mutex */
+static SDL_sem		*bgm_wake;
+static SDL_atomic_t	bgm_quit;
+
+static void BGM_ResetRing (bgmring_t *ring, snd_stream_t *stream, int track)
+{
+	ring->stream = stream;
+	ring->track = track;
+	ring->error = 0;
+	ring->generation++;
+	ring->did_rewind = false;
+	SDL_AtomicSet (&ring->state, BGMRING_DECODING);
+	SDL_AtomicSet (&ring->head, 0);
+	SDL_AtomicSet (&ring->tail, 0);
+}
+
+/*
+ * BGM_FillRing: decoder thread only, called with bgm_mutex held. Decodes
+ * one chunk with the mutex released, then copies it into the free part
+ * of the ring unless the ring was reset meanwhile. Returns false if
+ * there is nothing more to do now.
+ */
+static qboolean BGM_FillRing (bgmring_t *ring)
+{
+	byte		raw[16384];
+	snd_stream_t	*stream;
+	unsigned int	head, used, ofs;
+	int		frame, bytes, res, generation;
+	qboolean	loop, did_rewind, rewound = false;
+
+	if (!ring->stream || SDL_AtomicGet(&ring->state) != BGMRING_DECODING)
+		return false;
+
+	stream = ring->stream;
+	generation = ring->generation;
+	did_rewind = ring->did_rewind;
+	loop = bgmloop;
+	head = (unsigned int) SDL_AtomicGet (&ring->head);
+	used = head - (unsigned int) SDL_AtomicGet (&ring->tail);
+	frame = stream->info.width * stream->info.channels;
+	bytes = (int) q_min(BGM_RINGSIZE - used, sizeof(raw));
+	bytes -= bytes % frame;
+	if (bytes <= 0)
+		return false;
+
+	bgm_busystream = stream;
+	SDL_UnlockMutex (bgm_mutex);
+	res = S_CodecReadStream (stream, bytes, raw);
+	if (res == 0 && loop && !did_rewind)
+	{
+		res = S_CodecRewindStream (stream);
+		rewound = true;
+	}
+	SDL_LockMutex (bgm_mutex);
+	bgm_busystream = NULL;
+	SDL_CondBroadcast (bgm_idle);
+
+	if (ring->generation != generation)
+		return true;	/* reset while decoding, drop the chunk */
+
+	if (rewound)
+	{
+		if (res != 0)
+		{
+			ring->error = res;
+			SDL_AtomicSet (&ring->state, BGMRING_ERROR);
+			return false;
+		}
+		ring->did_rewind = true;
+		return true;
+	}
+
+	if (res > 0)
+	{
+		res -= res % frame;
+		ofs = head & (BGM_RINGSIZE - 1);
+		if (ofs + res > BGM_RINGSIZE)
+		{
+			memcpy (ring->data + ofs, raw, BGM_RINGSIZE - ofs);
+			memcpy (ring->data, raw + (BGM_RINGSIZE - ofs), res - (BGM_RINGSIZE - ofs));
+		}
+		else
+			memcpy (ring->data + ofs, raw, res);
+	/* publish the samples only after they are in place */
+		SDL_MemoryBarrierRelease ();
+		SDL_AtomicSet (&ring->head, (int)(head + res));
+		ring->did_rewind = false;
+		return true;
+	}
+	else if (res == 0)	/* EOF */
+	{
+		if (!loop)
+		{
+			SDL_AtomicSet (&ring->state, BGMRING_EOF);
+			return false;
+		}
+		/* a stream which keeps returning EOF is treated as a read error */
+		ring->error = -1;
+		SDL_AtomicSet (&ring->state, BGMRING_ERROR);
+		return false;
+	}
+
+	/* res < 0: some read error */
+	ring->error = res;
+	SDL_AtomicSet (&ring->state, BGMRING_ERROR);
+	return false;
+}
+
+static int BGM_DecodeThread (void *unused)
+{
+	qboolean busy;
+
+	while (!SDL_AtomicGet(&bgm_quit))
+	{
+	/* keep the playing stream topped up first, then the prefetch */
+		do
+		{
+			SDL_LockMutex (bgm_mutex);
+			busy = BGM_FillRing (bgmplay);
+			if (!busy)
+				busy = BGM_FillRing (bgmnext);
+			SDL_UnlockMutex (bgm_mutex);
+		} while (busy && !SDL_AtomicGet(&bgm_quit));
+
+		SDL_SemWaitTimeout (bgm_wake, 50);
+	}
+
+	return 0;
+}
+
+static void BGM_StartThread (void)
+{
+	bgm_mutex = SDL_CreateMutex ();
+	bgm_idle = SDL_CreateCond ();
+	bgm_wake = SDL_CreateSemaphore (0);
+	SDL_AtomicSet (&bgm_quit, 0);
+	if (bgm_mutex && bgm_idle && bgm_wake)
+		bgm_thread = SDL_CreateThread (BGM_DecodeThread, "bgmdecode", NULL);
+	if (!bgm_thread)
+		Sys_Error ("Couldn't create music decoder thread: %s", SDL_GetError());
+}
+
+static void BGM_StopThread (void)
+{
+	if (!bgm_thread)
+		return;
+	SDL_AtomicSet (&bgm_quit, 1);
+	SDL_SemPost (bgm_wake);
+	SDL_WaitThread (bgm_thread, NULL);
+	SDL_DestroySemaphore (bgm_wake);
+	SDL_DestroyCond (bgm_idle);
+	SDL_DestroyMutex (bgm_mutex);
+	bgm_thread = NULL;
+	bgm_wake = NULL;
+	bgm_idle = NULL;
+	bgm_mutex = NULL;
+}
+
+/* takes a ring's stream away from the decoder thread, so it can be closed */
+static snd_stream_t *BGM_DetachRing (bgmring_t *ring)
+{
+	snd_stream_t *stream;
+
+	SDL_LockMutex (bgm_mutex);
+	stream = ring->stream;
+	BGM_ResetRing (ring, NULL, -1);
+	while (stream && bgm_busystream == stream)
+		SDL_CondWait (bgm_idle, bgm_mutex);
+	SDL_UnlockMutex (bgm_mutex);
+	return stream;
+}
+
+/* hands a freshly opened stream over to the decoder thread */
+static void BGM_StartStream (snd_stream_t *stream)
+{
+	SDL_LockMutex (bgm_mutex);
+	BGM_ResetRing (bgmplay, stream, -1);
+	SDL_UnlockMutex (bgm_mutex);
+	SDL_SemPost (bgm_wake);
+}
+
+static void BGM_StopPrefetch (void)
+{
+	snd_stream_t *stream;
+
+	stream = BGM_DetachRing (bgmnext);
+	if (stream)
+		S_CodecCloseStream (stream);
+}
+#else
+#define BGM_StartStream(stream)	((void)0)
+#endif	/* USE_SDL2 */
+
 static void BGM_Play_f (void)
 {
 	if (Cmd_Argc() == 2)
@@ -139,6 +372,10 @@ qboolean BGM_Init (void)
 
 	bgmloop = true;
 
+#if defined(BGM_THREADED)
+	BGM_StartThread ();
+#endif
+
 	for (i = 0; wanted_handlers[i].type != CODECTYPE_NONE; i++)
 	{
 		switch (wanted_handlers[i].player)
@@ -175,6 +412,10 @@ qboolean BGM_Init (void)
 void BGM_Shutdown (void)
 {
 	BGM_Stop();
+#if defined(BGM_THREADED)
+	BGM_StopPrefetch ();
+	BGM_StopThread ();
+#endif
 /* sever our connections to
  * midi_drv and snd_codec */
 	music_handlers = NULL;
@@ -208,7 +449,10 @@ static void BGM_Play_noext (const char *filename, unsigned int allowed_types)
 		case BGM_STREAMER:
 			bgmstream = S_CodecOpenStreamType(tmp, handler->type);
 			if (bgmstream)
+			{
+				BGM_StartStream (bgmstream);
 				return;		/* success */
+			}
 			break;
 		case BGM_NONE:
 		default:
@@ -266,7 +510,10 @@ void BGM_Play (const char *filename)
 	case BGM_STREAMER:
 		bgmstream = S_CodecOpenStreamType(tmp, handler->type);
 		if (bgmstream)
+		{
+			BGM_StartStream (bgmstream);
 			return;		/* success */
+		}
 		break;
 	case BGM_NONE:
 	default:
@@ -276,32 +523,22 @@ void BGM_Play (const char *filename)
 	Con_Printf("Couldn't handle music file %s\n", filename);
 }
 
-void BGM_PlayCDtrack (byte track, qboolean looping)
-{
-/* instead of searching by the order of music_handlers, do so by
- * the order of searchpath priority: the file from the searchpath
- * with the highest path_id is most likely from our own gamedir
- * itself. This way, if a mod has track02 as a *.mp3 file, which
- * is below *.ogg in the music_handler order, the mp3 will still
- * have priority over track02.ogg from, say, id1.
+/*
+ * BGM_FindCDtrack: instead of searching by the order of music_handlers,
+ * do so by the order of searchpath priority: the file from the searchpath
+ * with the highest path_id is most likely from our own gamedir itself.
+ * This way, if a mod has track02 as a *.mp3 file, which is below *.ogg in
+ * the music_handler order, the mp3 will still have priority over
+ * track02.ogg from, say, id1.
  */
-	char tmp[MAX_QPATH];
+static qboolean BGM_FindCDtrack (byte track, char *path, size_t pathsize, unsigned int *type)
+{
 	const char *ext;
-	unsigned int path_id, prev_id, type;
+	unsigned int path_id, prev_id;
 	music_handler_t *handler;
 
-	BGM_Stop();
-	if (CDAudio_Play(track, looping) == 0)
-		return;			/* success */
-
-	if (music_handlers == NULL)
-		return;
-
-	if (no_extmusic || !bgm_extmusic.value)
-		return;
-
 	prev_id = 0;
-	type = 0;
+	*type = 0;
 	ext  = NULL;
 	handler = music_handlers;
 	while (handler)
@@ -310,36 +547,115 @@ void BGM_PlayCDtrack (byte track, qboolean looping)
 			goto _next;
 		if (! CDRIPTYPE(handler->type))
 			goto _next;
-		q_snprintf(tmp, sizeof(tmp), "%s/track%02d.%s",
+		q_snprintf(path, pathsize, "%s/track%02d.%s",
 				MUSIC_DIRNAME, (int)track, handler->ext);
-		if (! COM_FileExists(tmp, &path_id))
+		if (! COM_FileExists(path, &path_id))
 			goto _next;
 		if (path_id > prev_id)
 		{
 			prev_id = path_id;
-			type = handler->type;
+			*type = handler->type;
 			ext = handler->ext;
 		}
 	_next:
 		handler = handler->next;
 	}
 	if (ext == NULL)
+		return false;
+
+	q_snprintf(path, pathsize, "%s/track%02d.%s",
+			MUSIC_DIRNAME, (int)track, ext);
+	return true;
+}
+
+void BGM_PlayCDtrack (byte track, qboolean looping)
+{
+	char tmp[MAX_QPATH];
+	unsigned int type;
+
+	BGM_Stop();
+	if (CDAudio_Play(track, looping) == 0)
+		return;			/* success */
+
+	if (music_handlers == NULL)
+		return;
+
+	if (no_extmusic || !bgm_extmusic.value)
+		return;
+
+#if defined(BGM_THREADED)
+	if (bgmnext->stream && bgmnext->track == track)
+	{	/* already decoding ahead: just swap it in */
+		bgmring_t *ring;
+
+		SDL_LockMutex (bgm_mutex);
+		ring = bgmplay;
+		bgmplay = bgmnext;
+		bgmnext = ring;
+		bgmplay->track = -1;
+		bgmstream = bgmplay->stream;
+		SDL_UnlockMutex (bgm_mutex);
+		return;
+	}
+#endif
+
+	if (!BGM_FindCDtrack(track, tmp, sizeof(tmp), &type))
 		Con_Printf("Couldn't find a cdrip for track %d\n", (int)track);
 	else
 	{
-		q_snprintf(tmp, sizeof(tmp), "%s/track%02d.%s",
-				MUSIC_DIRNAME, (int)track, ext);
 		bgmstream = S_CodecOpenStreamType(tmp, type);
 		if (! bgmstream)
 			Con_Printf("Couldn't handle music file %s\n", tmp);
+		else
+			BGM_StartStream (bgmstream);
 	}
 }
 
+/*
+ * BGM_PrefetchCDtrack: opens the cdrip for track and starts decoding it
+ * in the background, so that a following BGM_PlayCDtrack for the same
+ * track (e.g. from svc_cdtrack once the client is signed on to a new
+ * map) starts playing without touching the decoder on the main thread.
+ */
+void BGM_PrefetchCDtrack (byte track)
+{
+#if defined(BGM_THREADED)
+	char tmp[MAX_QPATH];
+	unsigned int type;
+	snd_stream_t *stream;
+
+	if (music_handlers == NULL)
+		return;
+
+	if (no_extmusic || !bgm_extmusic.value)
+		return;
+
+	if (bgmnext->stream && bgmnext->track == track)
+		return;
+
+	BGM_StopPrefetch ();
+
+	if (!BGM_FindCDtrack(track, tmp, sizeof(tmp), &type))
+		return;
+	stream = S_CodecOpenStreamType(tmp, type);
+	if (!stream)
+		return;
+
+	SDL_LockMutex (bgm_mutex);
+	BGM_ResetRing (bgmnext, stream, track);
+	SDL_UnlockMutex (bgm_mutex);
+	SDL_SemPost (bgm_wake);
+#endif
+}
+
 void BGM_Stop (void)
 {
 	if (bgmstream)
 	{
 		bgmstream->status = STREAM_NONE;
+#if defined(BGM_THREADED)
+		BGM_DetachRing (bgmplay);
+#endif
 		S_CodecCloseStream(bgmstream);
 		bgmstream = NULL;
 		s_rawend = 0;
@@ -364,6 +680,89 @@ void BGM_Resume (void)
 	}
 }
 
+#if defined(BGM_THREADED)
+/* main thread side: only copies what the decoder thread produced */
+static void BGM_UpdateStream (void)
+{
+	unsigned int	tail, avail, ofs;
+	int	bufferSamples;
+	int	fileSamples;
+	int	fileBytes;
+	int	frame;
+	byte	raw[16384];
+
+	if (bgmstream->status != STREAM_PLAY)
+		return;
+
+	/* don't bother playing anything if musicvolume is 0 */
+	if (bgmvolume.value <= 0)
+		return;
+
+	/* see how many samples should be copied into the raw buffer */
+	if (s_rawend < paintedtime)
+		s_rawend = paintedtime;
+
+	frame = bgmstream->info.width * bgmstream->info.channels;
+
+	while (s_rawend < paintedtime + MAX_RAW_SAMPLES)
+	{
+		tail = (unsigned int) SDL_AtomicGet (&bgmplay->tail);
+		avail = (unsigned int) SDL_AtomicGet (&bgmplay->head) - tail;
+		SDL_MemoryBarrierAcquire ();
+
+		if (!avail)
+		{
+			switch (SDL_AtomicGet(&bgmplay->state))
+			{
+			case BGMRING_EOF:
+				BGM_Stop();
+				break;
+			case BGMRING_ERROR:
+				Con_Printf("Stream read error (%i), stopping.\n", bgmplay->error);
+				BGM_Stop();
+				break;
+			default:	/* decoder is behind, try again next frame */
+				break;
+			}
+			return;
+		}
+
+		bufferSamples = MAX_RAW_SAMPLES - (s_rawend - paintedtime);
+
+		/* decide how much data needs to be copied from the ring */
+		fileSamples = bufferSamples * bgmstream->info.rate / shm->speed;
+		if (!fileSamples)
+			return;
+
+		fileBytes = fileSamples * frame;
+		if (fileBytes > (int) sizeof(raw))
+			fileBytes = (int) sizeof(raw);
+		if (fileBytes > (int) avail)
+			fileBytes = (int) avail;
+		fileBytes -= fileBytes % frame;
+		fileSamples = fileBytes / frame;
+		if (!fileSamples)
+			return;
+
+		ofs = tail & (BGM_RINGSIZE - 1);
+		if (ofs + fileBytes > BGM_RINGSIZE)
+		{
+			memcpy (raw, bgmplay->data + ofs, BGM_RINGSIZE - ofs);
+			memcpy (raw + (BGM_RINGSIZE - ofs), bgmplay->data, fileBytes - (BGM_RINGSIZE - ofs));
+		}
+		else
+			memcpy (raw, bgmplay->data + ofs, fileBytes);
+
+		SDL_AtomicSet (&bgmplay->tail, (int)(tail + fileBytes));
+		SDL_SemPost (bgm_wake);
+
+		S_RawSamples(fileSamples, bgmstream->info.rate,
+						bgmstream->info.width,
+						bgmstream->info.channels,
+						raw, bgmvolume.value);
+	}
+}
+#else
 static void BGM_UpdateStream (void)
 {
 	qboolean did_rewind = false;
@@ -452,6 +851,7 @@ static void BGM_UpdateStream (void)
 		}
 	}
 }
+#endif	/* BGM_THREADED */
 
 void BGM_Update (void)
 {
@@ -38,6 +38,7 @@ void BGM_Pause (void);
 void BGM_Resume (void);
 
 void BGM_PlayCDtrack (byte track, qboolean looping);
+void BGM_PrefetchCDtrack (byte track);
 
 #endif	/* _BGMUSIC_H_ */
 
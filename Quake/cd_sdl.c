@@ -499,7 +499,7 @@ int CDAudio_Init(void)
 {
 	int	i, sdl_num_drives;
 
-	if (safemode || COM_CheckParm("-nocdaudio"))
+	if (safemode || isHeadless || COM_CheckParm("-nocdaudio"))
 		return -1;
 
 	export_cddev_arg();
@@ -66,6 +66,90 @@ void TraceLineToEntity(vec3_t start, vec3_t end, vec3_t impact, edict_t *ent)
 	VectorCopy(trace.endpos, impact);
 }
 
+/*
+==============
+CL_TraceLine
+
+traces against the world and the entities of the last server message,
+using only client data, so it also works when connected to a remote
+server. brush entities are clipped with their hull, all other entities
+with their model's bounding box. ignoreent is skipped. returns the number
+of the entity hit, 0 for the world or nothing.
+==============
+*/
+int CL_TraceLine (vec3_t start, vec3_t end, vec3_t impact, int ignoreent)
+{
+	trace_t		trace;
+	vec3_t		start_l, end_l, dir;
+	entity_t	*ent;
+	hull_t		*hull;
+	float		frac, enter, leave, t0, t1;
+	int		i, j, hit;
+
+	memset (&trace, 0, sizeof(trace));
+	trace.fraction = 1;
+	trace.allsolid = true;
+	VectorCopy (end, trace.endpos);
+	SV_RecursiveHullCheck (cl.worldmodel->hulls, 0, 0, 1, start, end, &trace);
+	frac = trace.fraction;
+	hit = 0;
+
+	VectorSubtract (end, start, dir);
+	for (i = 1, ent = cl_entities + 1; i < cl.num_entities; i++, ent++)
+	{
+		if (!ent->model || ent->msgtime != cl.mtime[0] || i == ignoreent)
+			continue;
+
+		if (ent->model->type == mod_brush)
+		{
+			hull = &ent->model->hulls[0];
+			VectorSubtract (start, ent->origin, start_l);
+			VectorSubtract (end, ent->origin, end_l);
+			memset (&trace, 0, sizeof(trace));
+			trace.fraction = 1;
+			trace.allsolid = true;
+			SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+			if (trace.fraction < frac)
+			{
+				frac = trace.fraction;
+				hit = i;
+			}
+			continue;
+		}
+
+		// slab test against the model's box
+		enter = 0;
+		leave = frac;
+		for (j = 0; j < 3 && enter <= leave; j++)
+		{
+			if (dir[j] == 0)
+			{
+				if (start[j] < ent->origin[j] + ent->model->mins[j] || start[j] > ent->origin[j] + ent->model->maxs[j])
+					leave = -1;
+				continue;
+			}
+			t0 = (ent->origin[j] + ent->model->mins[j] - start[j]) / dir[j];
+			t1 = (ent->origin[j] + ent->model->maxs[j] - start[j]) / dir[j];
+			if (t0 > t1)
+			{
+				float tmp = t0;
+				t0 = t1;
+				t1 = tmp;
+			}
+			enter = q_max(enter, t0);
+			leave = q_min(leave, t1);
+		}
+		if (enter <= leave && enter < frac)
+		{
+			frac = enter;
+			hit = i;
+		}
+	}
+
+	VectorMA (start, frac, dir, impact);
+	return hit;
+}
+
 /*
 ==============
 Chase_UpdateForClient -- johnfitz -- orient client based on camera. called after input
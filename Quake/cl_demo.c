@@ -21,7 +21,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+#define LODEPNG_NO_COMPILE_CPP
+#include "lodepng.h"
+
 static void CL_FinishTimeDemo (void);
+static void CL_TimeDemoFrame (void);
+static void CL_DemoClock (void);
+static void CL_DemoFreeKeys (void);
+static void CL_WriteDemoIndex (void);
+static void CL_LoadDemoIndex (void);
+
+static qboolean	td_complete;	// the timedemo reached the end of the demo
 
 /*
 ==============================================================================
@@ -40,6 +50,441 @@ read from the demo file.
 static byte	demo_head[3][MAX_MSGLEN];
 static int	demo_head_size[2];
 
+// playback position, for seeking
+static char	demo_name[MAX_OSPATH];
+static long	demo_start;		// file position of the demo, it may be inside a pak
+static int	demo_length;
+static int	demo_first;		// offset of the first message
+static int	demo_msgoffset;		// offset of the message being parsed
+static int	demo_segment;		// offset of the message with the current map's serverinfo
+static double	demo_time;		// seconds of demo played, summed over map changes
+static double	demo_lastmtime;		// cl.mtime[0] already counted in demo_time
+static qboolean	demo_indexing;		// demoindex: write the keyframes when the demo ends
+
+cvar_t	cl_demospeed = {"cl_demospeed", "1", CVAR_NONE};
+
+/*
+==============================================================================
+
+DEMO FILE I/O
+
+Recording appends to a block in memory, and a full block (or one a second
+old) is handed to a worker task to write while the next one fills, so a
+slow disk never holds up a frame. With cl_democompress the blocks are
+written as zlib frames:
+
+	"QDZ1" { int size, int packedsize, packedsize bytes } ...
+
+a packedsize of 0 meaning stored. Unpacked, the frames are exactly a plain
+demo. Playback reads either kind through CL_DemoRead, and every offset
+(keyframes, the index) is an offset into the plain demo.
+==============================================================================
+*/
+
+#define	DEMO_BLOCKSIZE		0x10000
+#define	DEMO_MAXBLOCK		(DEMO_BLOCKSIZE + MAX_MSGLEN + 16)	// a block can overrun by one message
+#define	DEMO_FLUSHTIME		1.0		// seconds before a partial block is written
+#define	DEMO_MAGIC		"QDZ1"
+
+typedef struct
+{
+	byte		*data;
+	int		size;
+	int		maxsize;	// grows while the other block is still being written
+	FILE		*file;
+	qboolean	compress;
+	qboolean	failed;		// set by the task
+} demoblock_t;
+
+static demoblock_t	*demo_blocks[2];	// one filling, the other maybe being written
+static int		demo_curblock;
+static taskgroup_t	demo_writegroup;
+static double		demo_flushtime;
+
+cvar_t	cl_democompress = {"cl_democompress", "0", CVAR_ARCHIVE};
+
+typedef struct
+{
+	int	start;		// plain offset
+	int	size;
+	long	filepos;
+	int	packedsize;	// 0 if stored
+} demoframe_t;
+
+static qboolean		demo_compressed;
+static demoframe_t	*demo_frames;
+static int		demo_numframes, demo_maxframes;
+static int		demo_curframe;
+static byte		*demo_frame;		// unpacked demo_curframe
+static int		demo_framepos;
+
+/*
+====================
+CL_DemoWriteTask
+
+Runs on a worker: writes one block, compressing it first if asked to.
+A block that grew is compressed as several frames, as playback only
+takes frames up to DEMO_MAXBLOCK.
+====================
+*/
+static void CL_DemoWriteTask (void *data)
+{
+	demoblock_t		*b = (demoblock_t *) data;
+	LodePNGCompressSettings	settings;
+	unsigned char		*packed;
+	size_t			packedsize;
+	int			header[2];
+	int			pos, size;
+
+	if (!b->compress)
+	{
+		if (fwrite (b->data, b->size, 1, b->file) != 1)
+			b->failed = true;
+		fflush (b->file);
+		return;
+	}
+
+	settings = lodepng_default_compress_settings;
+	settings.windowsize = 32768;
+	for (pos = 0; pos < b->size && !b->failed; pos += size)
+	{
+		size = q_min (b->size - pos, DEMO_BLOCKSIZE);
+		packed = NULL;
+		packedsize = 0;
+		if (lodepng_zlib_compress (&packed, &packedsize, b->data + pos, size, &settings) || packedsize >= (size_t)size)
+			packedsize = 0;	// store it
+
+		header[0] = LittleLong (size);
+		header[1] = LittleLong ((int)packedsize);
+		if (fwrite (header, sizeof(header), 1, b->file) != 1 ||
+		    fwrite (packedsize ? packed : b->data + pos, packedsize ? packedsize : (size_t)size, 1, b->file) != 1)
+			b->failed = true;
+		free (packed);
+	}
+	fflush (b->file);
+}
+
+/*
+====================
+CL_DemoSubmitBlock
+
+Hands the filling block to the writer and switches to the other one.
+If the writer is still busy with the other block, this one just keeps
+filling and is handed over on a later call.
+====================
+*/
+static void CL_DemoSubmitBlock (void)
+{
+	demoblock_t	*b = demo_blocks[demo_curblock];
+
+	if (!b->size || demo_writegroup.pending)
+		return;
+	demo_flushtime = realtime + DEMO_FLUSHTIME;
+
+	Task_Wait (&demo_writegroup);	// nothing pending, only syncs with the writer
+	if (demo_blocks[demo_curblock ^ 1]->failed)
+	{
+		Con_Printf ("ERROR: couldn't write to the demo file\n");
+		demo_blocks[demo_curblock ^ 1]->failed = false;
+	}
+
+	Task_Add (&demo_writegroup, CL_DemoWriteTask, b);
+	demo_curblock ^= 1;
+	demo_blocks[demo_curblock]->size = 0;
+}
+
+/*
+====================
+CL_DemoWrite
+====================
+*/
+static void CL_DemoWrite (const void *data, int size)
+{
+	demoblock_t	*b = demo_blocks[demo_curblock];
+	byte		*grown;
+	int		maxsize;
+
+	if (b->size + size > b->maxsize)
+		CL_DemoSubmitBlock ();
+	b = demo_blocks[demo_curblock];
+	if (b->size + size > b->maxsize)
+	{	// the writer is behind, buffer more rather than stall the frame
+		maxsize = q_max (b->maxsize * 2, b->size + size);
+		grown = (byte *) realloc (b->data, maxsize);
+		if (!grown)
+		{
+			Task_Wait (&demo_writegroup);
+			CL_DemoSubmitBlock ();
+			b = demo_blocks[demo_curblock];
+		}
+		else
+		{
+			b->data = grown;
+			b->maxsize = maxsize;
+		}
+	}
+	memcpy (b->data + b->size, data, size);
+	b->size += size;
+}
+
+/*
+====================
+CL_DemoOpenWrite
+
+Sets up the writer for a demo file that was just created
+====================
+*/
+static qboolean CL_DemoOpenWrite (void)
+{
+	int	i;
+
+	for (i = 0; i < 2; i++)
+	{
+		demo_blocks[i] = (demoblock_t *) calloc (1, sizeof(demoblock_t));
+		if (demo_blocks[i])
+			demo_blocks[i]->data = (byte *) malloc (DEMO_MAXBLOCK);
+		if (!demo_blocks[i] || !demo_blocks[i]->data)
+		{
+			for ( ; i >= 0; i--)
+			{
+				if (demo_blocks[i])
+					free (demo_blocks[i]->data);
+				free (demo_blocks[i]);
+				demo_blocks[i] = NULL;
+			}
+			return false;
+		}
+		demo_blocks[i]->size = 0;
+		demo_blocks[i]->maxsize = DEMO_MAXBLOCK;
+		demo_blocks[i]->file = cls.demofile;
+		demo_blocks[i]->compress = (cl_democompress.value != 0);
+		demo_blocks[i]->failed = false;
+	}
+	demo_curblock = 0;
+	demo_flushtime = realtime + DEMO_FLUSHTIME;
+
+	if (demo_blocks[0]->compress)
+		fwrite (DEMO_MAGIC, 4, 1, cls.demofile);
+	return true;
+}
+
+/*
+====================
+CL_DemoCloseWrite
+
+Writes out what's left and closes the file
+====================
+*/
+static void CL_DemoCloseWrite (void)
+{
+	int	i;
+
+	Task_Wait (&demo_writegroup);
+	CL_DemoSubmitBlock ();
+	Task_Wait (&demo_writegroup);
+	fclose (cls.demofile);
+
+	for (i = 0; i < 2; i++)
+	{
+		if (demo_blocks[i]->failed)
+			Con_Printf ("ERROR: couldn't write to the demo file\n");
+		free (demo_blocks[i]->data);
+		free (demo_blocks[i]);
+		demo_blocks[i] = NULL;
+	}
+}
+
+/*
+====================
+CL_DemoScanFrames
+
+Reads the frame headers of a compressed demo, the file is positioned
+after the magic. Returns the plain length.
+====================
+*/
+static int CL_DemoScanFrames (int filesize)
+{
+	demoframe_t	*fr;
+	long		pos, end;
+	int		header[2], start;
+
+	pos = ftell (cls.demofile);
+	end = demo_start + filesize;
+	start = 0;
+	while (pos + (long)sizeof(header) <= end && fread (header, sizeof(header), 1, cls.demofile) == 1)
+	{
+		header[0] = LittleLong (header[0]);
+		header[1] = LittleLong (header[1]);
+		if (header[0] <= 0 || header[0] > DEMO_MAXBLOCK || header[1] < 0 || header[1] > DEMO_MAXBLOCK * 2)
+			break;
+
+		if (demo_numframes == demo_maxframes)
+		{
+			demo_maxframes = q_max (64, demo_maxframes * 2);
+			demo_frames = (demoframe_t *) realloc (demo_frames, demo_maxframes * sizeof(demoframe_t));
+			if (!demo_frames)
+				Sys_Error ("CL_DemoScanFrames: out of memory");
+		}
+		fr = &demo_frames[demo_numframes++];
+		fr->start = start;
+		fr->size = header[0];
+		fr->filepos = pos + sizeof(header);
+		fr->packedsize = header[1];
+
+		start += fr->size;
+		pos = fr->filepos + (fr->packedsize ? fr->packedsize : fr->size);
+		fseek (cls.demofile, pos, SEEK_SET);
+	}
+	return start;
+}
+
+/*
+====================
+CL_DemoLoadFrame
+====================
+*/
+static qboolean CL_DemoLoadFrame (int frame)
+{
+	demoframe_t	*fr;
+	byte		*packed;
+	size_t		size;
+	unsigned	error;
+
+	free (demo_frame);
+	demo_frame = NULL;
+	demo_curframe = demo_numframes;	// at the end until this works
+	demo_framepos = 0;
+	if (frame < 0 || frame >= demo_numframes)
+		return false;
+
+	fr = &demo_frames[frame];
+	fseek (cls.demofile, fr->filepos, SEEK_SET);
+	if (!fr->packedsize)
+	{
+		demo_frame = (byte *) malloc (fr->size);
+		if (!demo_frame || fread (demo_frame, fr->size, 1, cls.demofile) != 1)
+		{
+			free (demo_frame);	// cut short, like a plain demo
+			demo_frame = NULL;
+			return false;
+		}
+	}
+	else
+	{
+		packed = (byte *) malloc (fr->packedsize);
+		if (!packed || fread (packed, fr->packedsize, 1, cls.demofile) != 1)
+		{
+			free (packed);
+			return false;
+		}
+		size = 0;
+		error = lodepng_zlib_decompress (&demo_frame, &size, packed, fr->packedsize, &lodepng_default_decompress_settings);
+		free (packed);
+		if (error || size != (size_t)fr->size)
+		{
+			free (demo_frame);
+			demo_frame = NULL;
+			Con_Printf ("demo frame %i is corrupt\n", frame);
+			return false;
+		}
+	}
+	demo_curframe = frame;
+	return true;
+}
+
+/*
+====================
+CL_DemoRead
+
+Reads from the plain demo, returns how many bytes it got
+====================
+*/
+static int CL_DemoRead (void *buf, int size)
+{
+	byte	*out = (byte *) buf;
+	int	n, total;
+
+	if (!demo_compressed)
+		return (int) fread (buf, 1, size, cls.demofile);
+
+	for (total = 0; size > 0; total += n, out += n, size -= n)
+	{
+		if (!demo_frame || demo_framepos == demo_frames[demo_curframe].size)
+		{
+			if (!CL_DemoLoadFrame (demo_curframe + 1))
+				break;
+		}
+		n = q_min (size, demo_frames[demo_curframe].size - demo_framepos);
+		memcpy (out, demo_frame + demo_framepos, n);
+		demo_framepos += n;
+	}
+	return total;
+}
+
+/*
+====================
+CL_DemoTell / CL_DemoSetPos
+
+Offsets into the plain demo
+====================
+*/
+static int CL_DemoTell (void)
+{
+	if (!demo_compressed)
+		return ftell (cls.demofile) - demo_start;
+	if (!demo_frame)
+		return demo_curframe + 1 < demo_numframes ? demo_frames[demo_curframe + 1].start : demo_length;
+	return demo_frames[demo_curframe].start + demo_framepos;
+}
+
+static void CL_DemoSetPos (int offset)
+{
+	int	lo, hi, mid;
+
+	if (!demo_compressed)
+	{
+		fseek (cls.demofile, demo_start + offset, SEEK_SET);
+		return;
+	}
+
+	// last frame starting at or before offset
+	lo = 0;
+	hi = demo_numframes - 1;
+	while (lo < hi)
+	{
+		mid = (lo + hi + 1) / 2;
+		if (demo_frames[mid].start <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	if (lo != demo_curframe || !demo_frame)
+	{
+		if (!CL_DemoLoadFrame (lo))
+			return;
+	}
+	demo_framepos = CLAMP (0, offset - demo_frames[lo].start, demo_frames[lo].size);
+}
+
+/*
+====================
+CL_DemoCloseRead
+====================
+*/
+static void CL_DemoCloseRead (void)
+{
+	fclose (cls.demofile);
+
+	free (demo_frame);
+	demo_frame = NULL;
+	free (demo_frames);
+	demo_frames = NULL;
+	demo_numframes = demo_maxframes = 0;
+	demo_curframe = -1;
+	demo_framepos = 0;
+	demo_compressed = false;
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -50,11 +495,23 @@ Called when a demo file runs out, or the user starts a game
 void CL_StopPlayback (void)
 {
 	if (!cls.demoplayback)
+	{
+		if (cls.timedemo)	// aborted before playback got going
+			CL_FinishTimeDemo ();
 		return;
+	}
 
-	fclose (cls.demofile);
+	if (demo_indexing)
+	{
+		demo_indexing = false;
+		CL_WriteDemoIndex ();
+	}
+	CL_DemoFreeKeys ();
+
+	CL_DemoCloseRead ();
 	cls.demoplayback = false;
 	cls.demopaused = false;
+	cls.demoseeking = false;
 	cls.demofile = NULL;
 	cls.state = ca_disconnected;
 
@@ -76,21 +533,58 @@ static void CL_WriteDemoMessage (void)
 	float	f;
 
 	len = LittleLong (net_message.cursize);
-	fwrite (&len, 4, 1, cls.demofile);
+	CL_DemoWrite (&len, 4);
 	for (i = 0; i < 3; i++)
 	{
 		f = LittleFloat (cl.viewangles[i]);
-		fwrite (&f, 4, 1, cls.demofile);
+		CL_DemoWrite (&f, 4);
 	}
-	fwrite (net_message.data, net_message.cursize, 1, cls.demofile);
-	fflush (cls.demofile);
+	CL_DemoWrite (net_message.data, net_message.cursize);
+
+	if (demo_blocks[demo_curblock]->size >= DEMO_BLOCKSIZE || realtime >= demo_flushtime)
+		CL_DemoSubmitBlock ();
 }
 
-static int CL_GetDemoMessage (void)
+/*
+====================
+CL_ReadDemoMessage
+
+Reads the next message into net_message, returns 0 at the end of the demo
+====================
+*/
+static int CL_ReadDemoMessage (void)
 {
 	int	r, i;
 	float	f;
 
+	CL_DemoClock ();
+
+// get the next message
+	demo_msgoffset = CL_DemoTell ();
+	CL_DemoRead (&net_message.cursize, 4);
+	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
+	for (i = 0 ; i < 3 ; i++)
+	{
+		CL_DemoRead (&f, 4);
+		cl.mviewangles[0][i] = LittleFloat (f);
+	}
+
+	net_message.cursize = LittleLong (net_message.cursize);
+	if (net_message.cursize > MAX_MSGLEN)
+		Sys_Error ("Demo message > MAX_MSGLEN");
+	r = CL_DemoRead (net_message.data, net_message.cursize);
+	if (r != net_message.cursize)
+	{
+		td_complete = cls.timedemo;
+		CL_StopPlayback ();
+		return 0;
+	}
+
+	return 1;
+}
+
+static int CL_GetDemoMessage (void)
+{
 	if (cls.demopaused)
 		return 0;
 
@@ -102,6 +596,7 @@ static int CL_GetDemoMessage (void)
 			if (host_framecount == cls.td_lastframe)
 				return 0;	// already read this frame's message
 			cls.td_lastframe = host_framecount;
+			CL_TimeDemoFrame ();
 		// if this is the second frame, grab the real td_starttime
 		// so the bogus time on the first frame doesn't count
 			if (host_framecount == cls.td_startframe + 1)
@@ -113,26 +608,7 @@ static int CL_GetDemoMessage (void)
 		}
 	}
 
-// get the next message
-	fread (&net_message.cursize, 4, 1, cls.demofile);
-	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
-	for (i = 0 ; i < 3 ; i++)
-	{
-		r = fread (&f, 4, 1, cls.demofile);
-		cl.mviewangles[0][i] = LittleFloat (f);
-	}
-
-	net_message.cursize = LittleLong (net_message.cursize);
-	if (net_message.cursize > MAX_MSGLEN)
-		Sys_Error ("Demo message > MAX_MSGLEN");
-	r = fread (net_message.data, net_message.cursize, 1, cls.demofile);
-	if (r != 1)
-	{
-		CL_StopPlayback ();
-		return 0;
-	}
-
-	return 1;
+	return CL_ReadDemoMessage ();
 }
 
 /*
@@ -202,7 +678,7 @@ void CL_Stop_f (void)
 	CL_WriteDemoMessage ();
 
 // finish up
-	fclose (cls.demofile);
+	CL_DemoCloseWrite ();
 	cls.demofile = NULL;
 	cls.demorecording = false;
 	Con_Printf ("Completed demo\n");
@@ -211,6 +687,71 @@ void CL_Stop_f (void)
 	DemoList_Rebuild ();
 }
 
+/*
+====================
+CL_WriteClientState
+
+Writes the client state a connection picked up along the way and that the
+server won't send again: scoreboard, lightstyles, stats and the view
+entity, plus fog and sky on the FitzQuake protocols. Used to start a
+demo recording mid-game and for the seek keyframes.
+====================
+*/
+static void CL_WriteClientState (sizebuf_t *msg)
+{
+	float	*color;
+	int	i;
+
+	// current names, colors, and frag counts
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		MSG_WriteByte (msg, svc_updatename);
+		MSG_WriteByte (msg, i);
+		MSG_WriteString (msg, cl.scores[i].name);
+		MSG_WriteByte (msg, svc_updatefrags);
+		MSG_WriteByte (msg, i);
+		MSG_WriteShort (msg, cl.scores[i].frags);
+		MSG_WriteByte (msg, svc_updatecolors);
+		MSG_WriteByte (msg, i);
+		MSG_WriteByte (msg, cl.scores[i].colors);
+	}
+
+	// send all current light styles
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		MSG_WriteByte (msg, svc_lightstyle);
+		MSG_WriteByte (msg, i);
+		MSG_WriteString (msg, cl_lightstyle[i].map);
+	}
+
+	// all the stats, the server only sends the changes
+	for (i = 0; i < MAX_CL_STATS; i++)
+	{
+		MSG_WriteByte (msg, svc_updatestat);
+		MSG_WriteByte (msg, i);
+		MSG_WriteLong (msg, cl.stats[i]);
+	}
+
+	// view entity
+	MSG_WriteByte (msg, svc_setview);
+	MSG_WriteShort (msg, cl.viewentity);
+
+	// what about the CD track... future consideration.
+	if (cl.protocol != PROTOCOL_NETQUAKE)
+	{
+		color = Fog_GetColor ();
+		MSG_WriteByte (msg, svc_fog);
+		MSG_WriteByte (msg, (int)(CLAMP (0.0, Fog_GetDensity (), 1.0) * 255));
+		MSG_WriteByte (msg, (int)(color[0] * 255));
+		MSG_WriteByte (msg, (int)(color[1] * 255));
+		MSG_WriteByte (msg, (int)(color[2] * 255));
+		MSG_WriteShort (msg, 0);
+
+		MSG_WriteByte (msg, svc_skybox);
+		MSG_WriteString (msg, skybox_name);
+	}
+}
+
 /*
 ====================
 CL_Record_f
@@ -222,6 +763,7 @@ void CL_Record_f (void)
 {
 	int		c;
 	char	name[MAX_OSPATH];
+	char	header[16];
 	int		track;
 
 	if (cmd_source != src_command)
@@ -294,8 +836,17 @@ void CL_Record_f (void)
 		return;
 	}
 
+	if (!CL_DemoOpenWrite ())
+	{
+		fclose (cls.demofile);
+		cls.demofile = NULL;
+		Con_Printf ("ERROR: out of memory for %s\n", name);
+		return;
+	}
+
 	cls.forcetrack = track;
-	fprintf (cls.demofile, "%i\n", cls.forcetrack);
+	q_snprintf (header, sizeof(header), "%i\n", cls.forcetrack);
+	CL_DemoWrite (header, strlen(header));
 
 	cls.demorecording = true;
 
@@ -316,48 +867,8 @@ void CL_Record_f (void)
 		net_message.data = demo_head[2];
 		SZ_Clear (&net_message);
 
-		// current names, colors, and frag counts
-		for (i = 0; i < cl.maxclients; i++)
-		{
-			MSG_WriteByte (&net_message, svc_updatename);
-			MSG_WriteByte (&net_message, i);
-			MSG_WriteString (&net_message, cl.scores[i].name);
-			MSG_WriteByte (&net_message, svc_updatefrags);
-			MSG_WriteByte (&net_message, i);
-			MSG_WriteShort (&net_message, cl.scores[i].frags);
-			MSG_WriteByte (&net_message, svc_updatecolors);
-			MSG_WriteByte (&net_message, i);
-			MSG_WriteByte (&net_message, cl.scores[i].colors);
-		}
-
-		// send all current light styles
-		for (i = 0; i < MAX_LIGHTSTYLES; i++)
-		{
-			MSG_WriteByte (&net_message, svc_lightstyle);
-			MSG_WriteByte (&net_message, i);
-			MSG_WriteString (&net_message, cl_lightstyle[i].map);
-		}
-
-		// what about the CD track or SVC fog... future consideration.
-		MSG_WriteByte (&net_message, svc_updatestat);
-		MSG_WriteByte (&net_message, STAT_TOTALSECRETS);
-		MSG_WriteLong (&net_message, cl.stats[STAT_TOTALSECRETS]);
-
-		MSG_WriteByte (&net_message, svc_updatestat);
-		MSG_WriteByte (&net_message, STAT_TOTALMONSTERS);
-		MSG_WriteLong (&net_message, cl.stats[STAT_TOTALMONSTERS]);
-
-		MSG_WriteByte (&net_message, svc_updatestat);
-		MSG_WriteByte (&net_message, STAT_SECRETS);
-		MSG_WriteLong (&net_message, cl.stats[STAT_SECRETS]);
-
-		MSG_WriteByte (&net_message, svc_updatestat);
-		MSG_WriteByte (&net_message, STAT_MONSTERS);
-		MSG_WriteLong (&net_message, cl.stats[STAT_MONSTERS]);
-
-		// view entity
-		MSG_WriteByte (&net_message, svc_setview);
-		MSG_WriteShort (&net_message, cl.viewentity);
+		// names, frags, lightstyles, stats, view entity
+		CL_WriteClientState (&net_message);
 
 		// signon
 		MSG_WriteByte (&net_message, svc_signonnum);
@@ -374,42 +885,44 @@ void CL_Record_f (void)
 
 /*
 ====================
-CL_PlayDemo_f
-
-play [demoname]
+CL_PlayDemo
 ====================
 */
-void CL_PlayDemo_f (void)
+static void CL_PlayDemo (const char *demoname)
 {
 	char	name[MAX_OSPATH];
 	int	i, c;
+	byte	b, magic[4];
 	qboolean neg;
 
-	if (cmd_source != src_command)
-		return;
-
-	if (Cmd_Argc() != 2)
-	{
-		Con_Printf ("playdemo <demoname> : plays a demo\n");
-		return;
-	}
-
 // disconnect from server
 	CL_Disconnect ();
 
 // open the demo file
-	q_strlcpy (name, Cmd_Argv(1), sizeof(name));
+	q_strlcpy (name, demoname, sizeof(name));
 	COM_AddExtension (name, ".dem", sizeof(name));
 
 	Con_Printf ("Playing demo from %s.\n", name);
 
-	COM_FOpenFile (name, &cls.demofile, NULL);
+	demo_length = COM_FOpenFile (name, &cls.demofile, NULL);
 	if (!cls.demofile)
 	{
 		Con_Printf ("ERROR: couldn't open %s\n", name);
 		cls.demonum = -1;	// stop demo loop
 		return;
 	}
+	demo_start = ftell (cls.demofile);
+
+	// compressed demos start with a magic the text header never does
+	demo_compressed = false;
+	demo_curframe = -1;
+	if (demo_length >= 4 && fread (magic, 4, 1, cls.demofile) == 1 && !memcmp (magic, DEMO_MAGIC, 4))
+	{
+		demo_compressed = true;
+		demo_length = CL_DemoScanFrames (demo_length);
+	}
+	else
+		fseek (cls.demofile, demo_start, SEEK_SET);
 
 // ZOID, fscanf is evil
 // O.S.: if a space character e.g. 0x20 (' ') follows '\n',
@@ -422,7 +935,7 @@ void CL_PlayDemo_f (void)
 	// followed by a '\n':
 	for (i = 0; i < 13; i++)
 	{
-		c = getc(cls.demofile);
+		c = CL_DemoRead (&b, 1) == 1 ? b : EOF;
 		if (c == '\n')
 			break;
 		if (c == '-') {
@@ -434,7 +947,7 @@ void CL_PlayDemo_f (void)
 	}
 	if (c != '\n')
 	{
-		fclose (cls.demofile);
+		CL_DemoCloseRead ();
 		cls.demofile = NULL;
 		cls.demonum = -1;	// stop demo loop
 		Con_Printf ("ERROR: demo \"%s\" is invalid\n", name);
@@ -443,6 +956,11 @@ void CL_PlayDemo_f (void)
 	if (neg)
 		cls.forcetrack = -cls.forcetrack;
 
+	q_strlcpy (demo_name, name, sizeof(demo_name));
+	demo_first = demo_segment = CL_DemoTell ();
+	demo_time = demo_lastmtime = 0;
+	CL_LoadDemoIndex ();
+
 	cls.demoplayback = true;
 	cls.demopaused = false;
 	cls.state = ca_connected;
@@ -451,6 +969,575 @@ void CL_PlayDemo_f (void)
 	key_dest = key_game;
 }
 
+/*
+====================
+CL_PlayDemo_f
+
+play [demoname]
+====================
+*/
+void CL_PlayDemo_f (void)
+{
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("playdemo <demoname> : plays a demo\n");
+		return;
+	}
+
+	CL_PlayDemo (Cmd_Argv(1));
+}
+
+/*
+==============================================================================
+
+DEMO SEEKING
+
+Playback keeps a keyframe every DEMO_KEYINTERVAL seconds of demo time: the
+offset of the next message and a message with the client state that a
+server doesn't send again (CL_WriteClientState). Entities need nothing, the
+server sends every visible entity in full each frame.
+
+To seek, playback jumps to the last keyframe before the target, reloading
+the keyframe's map from its serverinfo first if it's another one, and
+parses forward from there without rendering. Keyframes are collected as a
+demo plays, so going back works right away; "demoindex" runs through a
+whole demo and saves them next to it, so playback can also jump ahead.
+==============================================================================
+*/
+
+#define	DEMO_KEYINTERVAL	10.0	// seconds of demo time
+#define	DEMOINDEX_VERSION	1
+
+typedef struct
+{
+	float	time;			// demo_time
+	float	mtime;			// cl.mtime[0]
+	int	offset;			// of the next message
+	int	segment;		// demo_segment
+	int	size;
+	byte	*data;			// CL_WriteClientState
+} demokey_t;
+
+static demokey_t	*demo_keys;
+static int		demo_numkeys, demo_maxkeys;
+
+/*
+====================
+CL_DemoFreeKeys
+====================
+*/
+static void CL_DemoFreeKeys (void)
+{
+	int	i;
+
+	for (i = 0; i < demo_numkeys; i++)
+		free (demo_keys[i].data);
+	free (demo_keys);
+	demo_keys = NULL;
+	demo_numkeys = demo_maxkeys = 0;
+}
+
+/*
+====================
+CL_DemoAllocKey
+====================
+*/
+static demokey_t *CL_DemoAllocKey (int size)
+{
+	demokey_t	*key;
+
+	if (demo_numkeys == demo_maxkeys)
+	{
+		demo_maxkeys = q_max (64, demo_maxkeys * 2);
+		demo_keys = (demokey_t *) realloc (demo_keys, demo_maxkeys * sizeof(demokey_t));
+		if (!demo_keys)
+			Sys_Error ("CL_DemoAllocKey: out of memory");
+	}
+	key = &demo_keys[demo_numkeys];
+	key->size = size;
+	key->data = (byte *) malloc (size);
+	if (!key->data)
+		Sys_Error ("CL_DemoAllocKey: out of memory");
+	demo_numkeys++;
+	return key;
+}
+
+/*
+====================
+CL_DemoClock
+
+Called before each message is read: counts the last one's time and takes
+a keyframe if one is due
+====================
+*/
+static void CL_DemoClock (void)
+{
+	static byte	buf[MAX_MSGLEN];
+	sizebuf_t	msg;
+	demokey_t	*key, *last;
+
+	if (demo_lastmtime && cl.mtime[0] > demo_lastmtime)
+		demo_time += cl.mtime[0] - demo_lastmtime;
+	demo_lastmtime = cl.mtime[0];
+
+	if (cls.signon < SIGNONS)
+		return;
+
+	// keyframes stay sorted: after going back, the ones ahead are still good
+	last = demo_numkeys ? &demo_keys[demo_numkeys - 1] : NULL;
+	if (last && demo_time < last->time + (last->segment == demo_segment ? DEMO_KEYINTERVAL : 0))
+		return;
+
+	msg.data = buf;
+	msg.maxsize = sizeof(buf);
+	msg.cursize = 0;
+	msg.allowoverflow = true;
+	msg.overflowed = false;
+	CL_WriteClientState (&msg);
+	if (cl.intermission == 1)
+		MSG_WriteByte (&msg, svc_intermission);
+	if (msg.overflowed)
+		return;
+
+	key = CL_DemoAllocKey (msg.cursize);
+	memcpy (key->data, msg.data, msg.cursize);
+	key->time = demo_time;
+	key->mtime = cl.mtime[0];
+	key->offset = CL_DemoTell ();
+	key->segment = demo_segment;
+}
+
+/*
+====================
+CL_DemoServerInfo
+
+A new map starts at the message being parsed
+====================
+*/
+void CL_DemoServerInfo (void)
+{
+	demo_segment = demo_msgoffset;
+	demo_lastmtime = 0;
+}
+
+/*
+====================
+CL_DemoFastForward
+
+Parses messages without rendering until the map is signed on and demo
+time reaches target
+====================
+*/
+static void CL_DemoFastForward (double target)
+{
+	cls.demoseeking = true;
+	while (cls.demoplayback && (cls.signon < SIGNONS || demo_time < target))
+	{
+		if (!CL_ReadDemoMessage ())
+			break;
+		cl.last_received_message = realtime;
+		CL_ParseServerMessage ();
+	}
+	cls.demoseeking = false;
+}
+
+/*
+====================
+CL_DemoSeek
+====================
+*/
+static void CL_DemoSeek (double target)
+{
+	demokey_t	*key;
+	int		i;
+
+	target = q_max (0.0, target);
+
+	key = NULL;
+	for (i = demo_numkeys - 1; i >= 0; i--)
+	{
+		if (demo_keys[i].time <= target)
+		{
+			key = &demo_keys[i];
+			break;
+		}
+	}
+
+	// a keyframe only helps going back or past it
+	if (key && (target < demo_time || key->time > demo_time))
+	{
+		if (key->segment != demo_segment)
+		{
+			// load the keyframe's map
+			CL_DemoSetPos (key->segment);
+			cls.signon = 0;
+			demo_time = key->time;
+			demo_lastmtime = 0;
+			CL_DemoFastForward (0);
+			if (!cls.demoplayback)
+				return;
+		}
+
+		// don't lerp across the jump
+		cl.intermission = 0;
+		for (i = 0; i < cl.num_entities; i++)
+			cl_entities[i].msgtime = 0;
+
+		memcpy (net_message.data, key->data, key->size);
+		net_message.cursize = key->size;
+		CL_ParseServerMessage ();
+
+		CL_DemoSetPos (key->offset);
+		demo_time = key->time;
+		demo_lastmtime = key->mtime;
+	}
+	else if (target < demo_time)
+	{
+		// nothing to go back to, start over
+		CL_DemoSetPos (demo_first);
+		cls.signon = 0;
+		demo_time = demo_lastmtime = 0;
+	}
+
+	CL_DemoFastForward (target);
+	if (!cls.demoplayback)
+		return;
+
+	R_ClearParticles ();
+	memset (cl_dlights, 0, sizeof(cl_dlights));
+	memset (cl_beams, 0, sizeof(cl_beams));
+	cl.mtime[1] = cl.mtime[0];
+	cl.time = cl.oldtime = cl.mtime[0];
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demoseek <seconds> jumps to a time in the demo being played, demoseek
++<seconds> or -<seconds> skips forward or back
+====================
+*/
+void CL_DemoSeek_f (void)
+{
+	const char	*arg;
+	double		target;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!cls.demoplayback || cls.timedemo)
+	{
+		Con_Printf ("Not playing a demo.\n");
+		return;
+	}
+
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("demoseek <seconds|+seconds|-seconds> : at %.1f, %i keyframes\n", demo_time, demo_numkeys);
+		return;
+	}
+
+	arg = Cmd_Argv (1);
+	target = atof (arg);
+	if (arg[0] == '+' || arg[0] == '-')
+		target += demo_time;
+
+	CL_DemoSeek (target);
+	if (cls.demoplayback)
+		Con_Printf ("demo time %.1f\n", demo_time);
+}
+
+/*
+====================
+CL_DemoIndexName
+
+<demo>.dmi, relative to the game directory
+====================
+*/
+static void CL_DemoIndexName (char *out, size_t outsize)
+{
+	COM_StripExtension (demo_name, out, outsize);
+	q_strlcat (out, ".dmi", outsize);
+}
+
+static void CL_DemoWriteLong (FILE *f, int l)
+{
+	l = LittleLong (l);
+	fwrite (&l, 4, 1, f);
+}
+
+static void CL_DemoWriteFloat (FILE *f, float v)
+{
+	v = LittleFloat (v);
+	fwrite (&v, 4, 1, f);
+}
+
+static qboolean CL_DemoReadLong (FILE *f, int *l)
+{
+	if (fread (l, 4, 1, f) != 1)
+		return false;
+	*l = LittleLong (*l);
+	return true;
+}
+
+static qboolean CL_DemoReadFloat (FILE *f, float *v)
+{
+	if (fread (v, 4, 1, f) != 1)
+		return false;
+	*v = LittleFloat (*v);
+	return true;
+}
+
+/*
+====================
+CL_WriteDemoIndex
+====================
+*/
+static void CL_WriteDemoIndex (void)
+{
+	char		relname[MAX_OSPATH], name[MAX_OSPATH];
+	demokey_t	*key;
+	FILE		*f;
+	int		i;
+
+	CL_DemoIndexName (relname, sizeof(relname));
+	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, relname);
+	f = fopen (name, "wb");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't create %s\n", name);
+		return;
+	}
+
+	fwrite ("QDMI", 4, 1, f);
+	CL_DemoWriteLong (f, DEMOINDEX_VERSION);
+	CL_DemoWriteLong (f, demo_length);
+	CL_DemoWriteLong (f, demo_numkeys);
+	for (i = 0, key = demo_keys; i < demo_numkeys; i++, key++)
+	{
+		CL_DemoWriteFloat (f, key->time);
+		CL_DemoWriteFloat (f, key->mtime);
+		CL_DemoWriteLong (f, key->offset);
+		CL_DemoWriteLong (f, key->segment);
+		CL_DemoWriteLong (f, key->size);
+		fwrite (key->data, key->size, 1, f);
+	}
+	fclose (f);
+
+	Con_Printf ("wrote %i keyframes, %.1f seconds, to %s\n", demo_numkeys, demo_time, name);
+}
+
+/*
+====================
+CL_LoadDemoIndex
+
+Picks up the keyframes demoindex wrote for this demo, if they are there
+and still match it
+====================
+*/
+static void CL_LoadDemoIndex (void)
+{
+	char		name[MAX_OSPATH], magic[4];
+	demokey_t	*key;
+	FILE		*f;
+	int		i, version, length, count, size;
+	float		time, mtime;
+	int		offset, segment;
+
+	CL_DemoFreeKeys ();
+
+	CL_DemoIndexName (name, sizeof(name));
+	COM_FOpenFile (name, &f, NULL);
+	if (!f)
+		return;
+
+	if (fread (magic, 4, 1, f) != 1 || memcmp (magic, "QDMI", 4) ||
+	    !CL_DemoReadLong (f, &version) || version != DEMOINDEX_VERSION ||
+	    !CL_DemoReadLong (f, &length) || !CL_DemoReadLong (f, &count))
+	{
+		Con_Printf ("%s is not a demo index\n", name);
+		fclose (f);
+		return;
+	}
+	if (length != demo_length)
+	{
+		Con_Printf ("%s is out of date, run demoindex again\n", name);
+		fclose (f);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (!CL_DemoReadFloat (f, &time) || !CL_DemoReadFloat (f, &mtime) ||
+		    !CL_DemoReadLong (f, &offset) || !CL_DemoReadLong (f, &segment) ||
+		    !CL_DemoReadLong (f, &size) || size <= 0 || size > MAX_MSGLEN ||
+		    offset < demo_first || offset > demo_length || segment < demo_first || segment > demo_length)
+			break;
+		key = CL_DemoAllocKey (size);
+		key->time = time;
+		key->mtime = mtime;
+		key->offset = offset;
+		key->segment = segment;
+		if (fread (key->data, size, 1, f) != 1)
+			break;
+	}
+	fclose (f);
+
+	if (i < count)
+	{
+		Con_Printf ("%s is truncated\n", name);
+		CL_DemoFreeKeys ();
+		return;
+	}
+	Con_DPrintf ("%i keyframes from %s\n", demo_numkeys, name);
+}
+
+/*
+====================
+CL_DemoIndex_f
+
+demoindex <demoname> : plays a demo through without rendering and saves
+its keyframes as <demoname>.dmi, so playback can seek anywhere in it
+====================
+*/
+void CL_DemoIndex_f (void)
+{
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("demoindex <demoname> : builds a seek index for a demo\n");
+		return;
+	}
+
+	cls.demonum = -1;	// stop demo loop
+	CL_PlayDemo (Cmd_Argv(1));
+	if (!cls.demofile)
+		return;
+
+	// start from nothing, an old index may not match
+	CL_DemoFreeKeys ();
+	demo_indexing = true;
+
+	// runs to the end, where CL_StopPlayback writes the index
+	CL_DemoFastForward (1e30);
+	if (cls.demoplayback)
+		CL_Disconnect ();
+}
+
+/*
+==============================================================================
+
+TIMEDEMO STATISTICS
+
+Every frame's duration is recorded, together with the client, render and
+sound phases from the profiler, so timedemo can report percentiles and
+stutters instead of just an average.
+==============================================================================
+*/
+
+typedef struct
+{
+	float	total, client, render, sound;	// ms
+} tdframe_t;
+
+static tdframe_t	*td_frames;
+static int		td_numframes, td_maxframes;
+static double		td_framestart;		// Sys_ProfileTime at the start of the current frame
+static int		td_prevframe;		// host_framecount when td_framestart was taken
+static char		td_outfile[MAX_OSPATH];	// results file, if any
+static qboolean		td_benchmark;		// -timedemo: quit when done
+
+/*
+====================
+CL_TimeDemoFrame
+
+Called once per timedemo frame; records the frame before it. The profiler
+scopes were closed at the end of that frame, so they belong to it too.
+====================
+*/
+static void CL_TimeDemoFrame (void)
+{
+	tdframe_t	*f;
+	double		now = Sys_ProfileTime ();	// realtime only has whole ms
+
+	if (host_framecount > cls.td_startframe + 1 && td_prevframe == host_framecount - 1)
+	{
+		if (td_numframes == td_maxframes)
+		{
+			td_maxframes = q_max (1024, td_maxframes * 2);
+			td_frames = (tdframe_t *) realloc (td_frames, td_maxframes * sizeof(tdframe_t));
+			if (!td_frames)
+				Sys_Error ("CL_TimeDemoFrame: out of memory");
+		}
+		f = &td_frames[td_numframes++];
+		f->total = (now - td_framestart) * 1000.0;
+		f->client = Prof_LastFrame ("client");
+		f->render = Prof_LastFrame ("render");
+		f->sound = Prof_LastFrame ("sound");
+	}
+	td_framestart = now;
+	td_prevframe = host_framecount;
+}
+
+static int CL_CompareFloats (const void *a, const void *b)
+{
+	float	fa = *(const float *)a, fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+====================
+CL_WriteTimeDemo
+
+CSV with one row per frame, or with a .json name a summary plus the
+per-frame arrays
+====================
+*/
+static void CL_WriteTimeDemo (const float *sorted, float avg, int stutter2, int stutter4)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	tdframe_t	*fr;
+	int		i, n = td_numframes;
+	qboolean	json;
+
+	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, td_outfile);
+	json = !q_strcasecmp (COM_FileGetExtension (name), "json");
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("couldn't write %s\n", name);
+		return;
+	}
+
+	if (json)
+	{
+		fprintf (f, "{\n\"frames\": %i,\n", n);
+		fprintf (f, "\"ms\": {\"min\": %.3f, \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+			sorted[0], avg, sorted[n*50/100], sorted[n*95/100], sorted[n*99/100], sorted[n-1]);
+		fprintf (f, "\"stutters\": {\"over2xmedian\": %i, \"over4xmedian\": %i},\n", stutter2, stutter4);
+		fprintf (f, "\"frametimes\": [");
+		for (i = 0, fr = td_frames; i < n; i++, fr++)
+			fprintf (f, "%s[%.3f,%.3f,%.3f,%.3f]", i ? "," : "", fr->total, fr->client, fr->render, fr->sound);
+		fprintf (f, "],\n\"columns\": [\"total\", \"client\", \"render\", \"sound\"]\n}\n");
+	}
+	else
+	{
+		fprintf (f, "frame,total_ms,client_ms,render_ms,sound_ms\n");
+		for (i = 0, fr = td_frames; i < n; i++, fr++)
+			fprintf (f, "%i,%.3f,%.3f,%.3f,%.3f\n", i, fr->total, fr->client, fr->render, fr->sound);
+	}
+	fclose (f);
+	Con_Printf ("wrote %s\n", name);
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -461,8 +1548,13 @@ static void CL_FinishTimeDemo (void)
 {
 	int	frames;
 	float	time;
+	float	*sorted;
+	double	sum, client, render, sound;
+	int	i, n, stutter2, stutter4;
 
 	cls.timedemo = false;
+	if (!td_complete)
+		Con_Printf ("timedemo aborted\n");
 
 // the first frame didn't count
 	frames = (host_framecount - cls.td_startframe) - 1;
@@ -470,29 +1562,80 @@ static void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames/time);
+
+	n = td_numframes;
+	sorted = n ? (float *) malloc (n * sizeof(float)) : NULL;
+	if (sorted)
+	{
+		sum = client = render = sound = 0;
+		for (i = 0; i < n; i++)
+		{
+			sorted[i] = td_frames[i].total;
+			sum += td_frames[i].total;
+			client += td_frames[i].client;
+			render += td_frames[i].render;
+			sound += td_frames[i].sound;
+		}
+		qsort (sorted, n, sizeof(float), CL_CompareFloats);
+
+		// a stutter is a frame well over the typical one
+		stutter2 = stutter4 = 0;
+		for (i = 0; i < n; i++)
+		{
+			if (sorted[i] > 2 * sorted[n/2])
+				stutter2++;
+			if (sorted[i] > 4 * sorted[n/2])
+				stutter4++;
+		}
+
+		Con_Printf ("frame ms: min %.2f avg %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n",
+			sorted[0], sum/n, sorted[n*50/100], sorted[n*95/100], sorted[n*99/100], sorted[n-1]);
+		Con_Printf ("stutters: %i over 2x median, %i over 4x median\n", stutter2, stutter4);
+		Con_Printf ("avg ms: client %.2f render %.2f sound %.2f\n", client/n, render/n, sound/n);
+
+		if (td_outfile[0])
+			CL_WriteTimeDemo (sorted, sum/n, stutter2, stutter4);
+		free (sorted);
+	}
+
+	free (td_frames);
+	td_frames = NULL;
+	td_numframes = td_maxframes = 0;
+
+	if (td_benchmark)
+	{
+		if (!td_complete)
+			Sys_Error ("timedemo aborted before the end of the demo");
+		Host_ShutdownServer (false);
+		Sys_Quit ();
+	}
 }
 
 /*
 ====================
-CL_TimeDemo_f
+CL_TimeDemo
 
-timedemo [demoname]
+Starts a timedemo, with the results also written to outfile if not NULL
 ====================
 */
-void CL_TimeDemo_f (void)
+static void CL_TimeDemo (const char *demoname, const char *outfile)
 {
-	if (cmd_source != src_command)
-		return;
-
-	if (Cmd_Argc() != 2)
+	// the results go under the game directory, like record's demos
+	if (outfile && (strstr(outfile, "..") || outfile[0] == '/' || outfile[0] == '\\' || strchr(outfile, ':')))
 	{
-		Con_Printf ("timedemo <demoname> : gets demo speeds\n");
+		if (td_benchmark)
+			Sys_Error ("timedemo: %s is outside the game directory", outfile);
+		Con_Printf ("Relative pathnames are not allowed.\n");
 		return;
 	}
 
-	CL_PlayDemo_f ();
+	CL_PlayDemo (demoname);
 	if (!cls.demofile)
+	{
+		if (td_benchmark)
+			Sys_Error ("couldn't play timedemo %s", demoname);
 		return;
+	}
 
 // cls.td_starttime will be grabbed at the second frame of the demo, so
 // all the loading time doesn't get counted
@@ -500,5 +1643,53 @@ void CL_TimeDemo_f (void)
 	cls.timedemo = true;
 	cls.td_startframe = host_framecount;
 	cls.td_lastframe = -1;	// get a new message this frame
+	td_complete = false;
+
+	td_numframes = 0;
+	q_strlcpy (td_outfile, outfile ? outfile : "", sizeof(td_outfile));
 }
 
+/*
+====================
+CL_TimeDemo_f
+
+timedemo [demoname] [outfile]
+====================
+*/
+void CL_TimeDemo_f (void)
+{
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc() < 2 || Cmd_Argc() > 3)
+	{
+		Con_Printf ("timedemo <demoname> [file.csv|file.json] : gets demo speeds\n");
+		return;
+	}
+
+	CL_TimeDemo (Cmd_Argv(1), Cmd_Argc() == 3 ? Cmd_Argv(2) : NULL);
+}
+
+/*
+====================
+CL_TimeDemoCmdline
+
+-timedemo <demoname> [-benchmark-out <file>] runs a timedemo after startup
+and quits when it's done
+====================
+*/
+void CL_TimeDemoCmdline (void)
+{
+	int	i, j;
+
+	i = COM_CheckParm ("-timedemo");
+	if (!i || i >= com_argc-1)
+		return;
+
+	td_benchmark = true;
+	j = COM_CheckParm ("-benchmark-out");
+	if (j && j < com_argc-1)
+		Cbuf_AddText (va("timedemo \"%s\" \"%s\"\n", com_argv[i+1], com_argv[j+1]));
+	else
+		Cbuf_AddText (va("timedemo \"%s\"\n", com_argv[i+1]));
+}
@@ -110,7 +110,7 @@ void CL_Disconnect (void)
 	CDAudio_Stop();
 
 // if running a local server, shut it down
-	if (cls.demoplayback)
+	if (cls.demoplayback || cls.timedemo)
 		CL_StopPlayback ();
 	else if (cls.state == ca_connected)
 	{
@@ -363,6 +363,17 @@ float	CL_LerpPoint (void)
 
 	f = cl.mtime[0] - cl.mtime[1];
 
+	// local server on a fixed tick: interpolate between the last two ticks
+	// by how much of the next one has already elapsed
+	if (sv.active && host_fixedtick && f > 0 && !cls.timedemo)
+	{
+		frac = Host_TickFraction ();
+		cl.time = cl.mtime[1] + frac*f;
+		if (cl_nolerp.value)
+			return 1;
+		return frac;
+	}
+
 	if (!f || cls.timedemo || sv.active)
 	{
 		cl.time = cl.mtime[0];
@@ -607,7 +618,10 @@ int CL_ReadFromServer (void)
 
 
 	cl.oldtime = cl.time;
-	cl.time += host_frametime;
+	if (cls.demoplayback && !cls.timedemo && cl_demospeed.value > 0)
+		cl.time += host_frametime * cl_demospeed.value;	// fast or slow motion
+	else
+		cl.time += host_frametime;
 
 	do
 	{
@@ -816,6 +830,10 @@ void CL_Init (void)
 	Cmd_AddCommand ("stop", CL_Stop_f);
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f);
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f);
+	Cmd_AddCommand ("demoseek", CL_DemoSeek_f);
+	Cmd_AddCommand ("demoindex", CL_DemoIndex_f);
+	Cvar_RegisterVariable (&cl_demospeed);
+	Cvar_RegisterVariable (&cl_democompress);
 
 	Cmd_AddCommand ("tracepos", CL_Tracepos_f); //johnfitz
 	Cmd_AddCommand ("viewpos", CL_Viewpos_f); //johnfitz
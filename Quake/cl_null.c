@@ -0,0 +1,164 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_null.c -- client, menu and key stubs for the dedicated server build
+
+#include "quakedef.h"
+
+client_static_t	cls;
+client_state_t	cl;
+
+cvar_t	cl_name = {"_cl_name", "player", CVAR_ARCHIVE};
+cvar_t	cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
+kbutton_t	in_mlook, in_klook;
+
+keydest_t	key_dest;
+char		key_lines[CMDLINES][MAXCMDLINE];
+int		key_linepos;
+int		key_insert;
+double		key_blinktime;
+int		edit_line;
+int		history_line;
+qboolean	keydown[MAX_KEYS];
+qboolean	chat_team;
+
+enum m_state_e	m_state;
+enum m_state_e	m_return_state;
+qboolean	m_return_onerror;
+char		m_return_reason[32];
+
+/*
+==============================================================================
+
+CLIENT
+
+==============================================================================
+*/
+
+void CL_Init (void)
+{
+}
+
+void CL_EstablishConnection (const char *host)
+{
+}
+
+void CL_Disconnect (void)
+{
+}
+
+void CL_Disconnect_f (void)
+{
+}
+
+void CL_NextDemo (void)
+{
+}
+
+void CL_StopPlayback (void)
+{
+}
+
+void CL_TimeDemoCmdline (void)
+{
+}
+
+void CL_SendCmd (void)
+{
+}
+
+int CL_ReadFromServer (void)
+{
+	return 0;
+}
+
+void CL_DecayLights (void)
+{
+}
+
+void CL_RunParticles (void)
+{
+}
+
+void Chase_Init (void)
+{
+}
+
+void Sbar_Init (void)
+{
+}
+
+/*
+==============================================================================
+
+KEYS AND MENU
+
+==============================================================================
+*/
+
+void Key_Init (void)
+{
+}
+
+void Key_UpdateForDest (void)
+{
+}
+
+void Key_WriteBindings (FILE *f)
+{
+}
+
+void Key_BeginInputGrab (void)
+{
+}
+
+void Key_EndInputGrab (void)
+{
+}
+
+void Key_GetGrabbedInput (int *lastkey, int *lastchar)
+{
+	*lastkey = *lastchar = 0;
+}
+
+const char *Key_GetChatBuffer (void)
+{
+	return "";
+}
+
+int Key_GetChatMsgLen (void)
+{
+	return 0;
+}
+
+void History_Shutdown (void)
+{
+}
+
+void M_Init (void)
+{
+}
+
+void M_Menu_Main_f (void)
+{
+}
+
+void M_Menu_Quit_f (void)
+{
+}
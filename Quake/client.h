@@ -119,6 +119,9 @@ typedef struct
 // want a svc_setpause inside the demo to actually pause demo playback).
 	qboolean	demopaused;
 
+// demoseek is parsing ahead without rendering
+	qboolean	demoseeking;
+
 	qboolean	timedemo;
 	int		forcetrack;		// -1 = use normal cd track
 	FILE		*demofile;
@@ -343,6 +346,13 @@ void CL_Stop_f (void);
 void CL_Record_f (void);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
+void CL_TimeDemoCmdline (void);
+void CL_DemoSeek_f (void);
+void CL_DemoIndex_f (void);
+void CL_DemoServerInfo (void);
+
+extern	cvar_t	cl_demospeed;
+extern	cvar_t	cl_democompress;
 
 //
 // cl_parse.c
@@ -376,6 +386,7 @@ extern	cvar_t	chase_active;
 void Chase_Init (void);
 void TraceLine (vec3_t start, vec3_t end, vec3_t impact);
 void TraceLineToEntity(vec3_t start, vec3_t end, vec3_t impact, edict_t *ent);
+int CL_TraceLine (vec3_t start, vec3_t end, vec3_t impact, int ignoreent);
 void Chase_UpdateForClient (void);	//johnfitz
 void Chase_UpdateForDrawing (void);	//johnfitz
 
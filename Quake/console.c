@@ -64,6 +64,8 @@ qboolean	con_debuglog = false;
 
 qboolean	con_initialized;
 
+static SDL_mutex	*con_defermutex;	// Con_Defer, any worker may print
+
 
 /*
 ================
@@ -314,6 +316,8 @@ void Con_Init (void)
 		con_buffersize = CON_TEXTSIZE;
 	//johnfitz
 
+	con_defermutex = SDL_CreateMutex ();
+
 	con_text = (char *) Hunk_AllocName (con_buffersize, "context");//johnfitz -- con_buffersize replaces CON_TEXTSIZE
 	Q_memset (con_text, ' ', con_buffersize);//johnfitz -- con_buffersize replaces CON_TEXTSIZE
 	con_linewidth = -1;
@@ -471,6 +475,55 @@ void Con_DebugLog(const char *msg)
 }
 
 
+/*
+================
+Con_Defer
+
+Messages printed by the local server while it runs on a worker thread
+(host_serverthread) are queued here and printed by the main thread once
+the server frame is done, so only the main thread touches the console.
+================
+*/
+#define	MAXDEFERRED	16384
+
+static char	con_deferred[MAXDEFERRED];	// NUL-separated messages
+static int	con_deferredlen;
+
+static void Con_Defer (const char *msg)
+{
+	int	len = strlen (msg) + 1;
+
+	SDL_LockMutex (con_defermutex);
+	if (con_deferredlen + len <= MAXDEFERRED)	// else drop rather than block the server
+	{
+		memcpy (con_deferred + con_deferredlen, msg, len);
+		con_deferredlen += len;
+	}
+	SDL_UnlockMutex (con_defermutex);
+}
+
+/*
+================
+Con_FlushDeferred
+
+Main thread only, while no server frame is running
+================
+*/
+void Con_FlushDeferred (void)
+{
+	static char	msgs[MAXDEFERRED];
+	int	i, len;
+
+	SDL_LockMutex (con_defermutex);
+	len = con_deferredlen;
+	memcpy (msgs, con_deferred, len);
+	con_deferredlen = 0;
+	SDL_UnlockMutex (con_defermutex);
+
+	for (i = 0; i < len; i += strlen (msgs + i) + 1)
+		Con_SafePrintf ("%s", msgs + i);
+}
+
 /*
 ================
 Con_Printf
@@ -489,6 +542,12 @@ void Con_Printf (const char *fmt, ...)
 	q_vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	if (Tasks_IsWorker () || Host_InServerTask ())
+	{
+		Con_Defer (msg);
+		return;
+	}
+
 // also echo to debugging console
 	Sys_Printf ("%s", msg);
 
@@ -623,6 +682,12 @@ void Con_SafePrintf (const char *fmt, ...)
 	q_vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	if (Tasks_IsWorker () || Host_InServerTask ())
+	{
+		Con_Defer (msg);
+		return;
+	}
+
 	temp = scr_disabled_for_loading;
 	scr_disabled_for_loading = true;
 	Con_Printf ("%s", msg);
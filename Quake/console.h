@@ -45,6 +45,7 @@ void Con_Warning (const char *fmt, ...) FUNC_PRINTF(1,2); //johnfitz
 void Con_DPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 void Con_DPrintf2 (const char *fmt, ...) FUNC_PRINTF(1,2); //johnfitz
 void Con_SafePrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
+void Con_FlushDeferred (void);
 void Con_DrawNotify (void);
 void Con_ClearNotify (void);
 void Con_ToggleConsole_f (void);
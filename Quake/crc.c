@@ -92,3 +92,21 @@ unsigned short CRC_Block (const byte *start, int count)
 
 	return crc;
 }
+
+/*
+ * 32-bit FNV-1a, for keying on-disk caches on file contents where a
+ * 16-bit crc would collide too easily.  Pass 0 to start a new hash, or
+ * a previous result to continue it over another block.
+ */
+unsigned int Hash_Block (const byte *start, int count, unsigned int hash)
+{
+	if (!hash)
+		hash = 2166136261u;
+	while (count--)
+	{
+		hash ^= *start++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
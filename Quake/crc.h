@@ -28,6 +28,7 @@ void CRC_Init(unsigned short *crcvalue);
 void CRC_ProcessByte(unsigned short *crcvalue, byte data);
 unsigned short CRC_Value(unsigned short crcvalue);
 unsigned short CRC_Block (const byte *start, int count); //johnfitz -- texture crc
+unsigned int Hash_Block (const byte *start, int count, unsigned int hash); // for cache keys
 
 #endif	/* _QUAKE_CRC_H */
 
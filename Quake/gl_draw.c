@@ -418,6 +418,107 @@ void Draw_Init (void)
 	Draw_LoadPics ();
 }
 
+//==============================================================================
+//
+//  2D BATCHING
+//
+//  Characters, pics, tiles and fills are appended to a vertex array and
+//  drawn with one glDrawArrays per run of quads sharing a texture, instead
+//  of a glBegin/glEnd pair per glyph. Quads are kept in submission order so
+//  overlapping elements still layer correctly. Anything that changes GL
+//  state between 2D calls (colour, blending, scissor, matrices) must call
+//  Draw_Flush first.
+//
+//==============================================================================
+
+#define	MAX_BATCH_QUADS		2048
+
+typedef struct
+{
+	float		xy[2];
+	float		st[2];
+	byte		rgba[4];
+} drawvert_t;
+
+static drawvert_t	draw_verts[MAX_BATCH_QUADS * 4];
+static int			draw_numverts;
+static gltexture_t	*draw_texture;	// NULL for a batch of untextured fills
+
+/*
+================
+Draw_Flush -- submits the pending 2D quads
+================
+*/
+void Draw_Flush (void)
+{
+	if (!draw_numverts)
+		return;
+
+	GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glVertexPointer (2, GL_FLOAT, sizeof(drawvert_t), draw_verts[0].xy);
+
+	if (draw_texture)
+	{
+		GL_Bind (draw_texture);
+		glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer (2, GL_FLOAT, sizeof(drawvert_t), draw_verts[0].st);
+		glDrawArrays (GL_QUADS, 0, draw_numverts);
+		glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	}
+	else
+	{
+		glDisable (GL_TEXTURE_2D);
+		glEnable (GL_BLEND); //johnfitz -- for alpha
+		glDisable (GL_ALPHA_TEST); //johnfitz -- for alpha
+		glEnableClientState (GL_COLOR_ARRAY);
+		glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(drawvert_t), draw_verts[0].rgba);
+		glDrawArrays (GL_QUADS, 0, draw_numverts);
+		glDisableClientState (GL_COLOR_ARRAY);
+		glColor3f (1,1,1);
+		glDisable (GL_BLEND); //johnfitz -- for alpha
+		glEnable (GL_ALPHA_TEST); //johnfitz -- for alpha
+		glEnable (GL_TEXTURE_2D);
+	}
+
+	glDisableClientState (GL_VERTEX_ARRAY);
+	draw_numverts = 0;
+}
+
+/*
+================
+Draw_BatchQuad -- returns room for one quad in the batch for texture, or
+fills if texture is NULL
+================
+*/
+static drawvert_t *Draw_BatchQuad (gltexture_t *texture)
+{
+	drawvert_t *v;
+
+	if (texture != draw_texture || draw_numverts + 4 > MAX_BATCH_QUADS * 4)
+	{
+		Draw_Flush ();
+		draw_texture = texture;
+	}
+
+	v = &draw_verts[draw_numverts];
+	draw_numverts += 4;
+	return v;
+}
+
+/*
+================
+Draw_SetQuad -- fills in the corners of an axial quad
+================
+*/
+static void Draw_SetQuad (drawvert_t *v, float x, float y, float w, float h, float sl, float tl, float sh, float th)
+{
+	v[0].xy[0] = x;		v[0].xy[1] = y;		v[0].st[0] = sl;	v[0].st[1] = tl;
+	v[1].xy[0] = x+w;	v[1].xy[1] = y;		v[1].st[0] = sh;	v[1].st[1] = tl;
+	v[2].xy[0] = x+w;	v[2].xy[1] = y+h;	v[2].st[0] = sh;	v[2].st[1] = th;
+	v[3].xy[0] = x;		v[3].xy[1] = y+h;	v[3].st[0] = sl;	v[3].st[1] = th;
+}
+
 //==============================================================================
 //
 //  2D DRAWING
@@ -441,14 +542,7 @@ void Draw_CharacterQuad (int x, int y, char num)
 	fcol = col*0.0625;
 	size = 0.0625;
 
-	glTexCoord2f (fcol, frow);
-	glVertex2f (x, y);
-	glTexCoord2f (fcol + size, frow);
-	glVertex2f (x+8, y);
-	glTexCoord2f (fcol + size, frow + size);
-	glVertex2f (x+8, y+8);
-	glTexCoord2f (fcol, frow + size);
-	glVertex2f (x, y+8);
+	Draw_SetQuad (Draw_BatchQuad (char_texture), x, y, 8, 8, fcol, frow, fcol + size, frow + size);
 }
 
 /*
@@ -466,12 +560,7 @@ void Draw_Character (int x, int y, int num)
 	if (num == 32)
 		return; //don't waste verts on spaces
 
-	GL_Bind (char_texture);
-	glBegin (GL_QUADS);
-
 	Draw_CharacterQuad (x, y, (char) num);
-
-	glEnd ();
 }
 
 /*
@@ -484,9 +573,6 @@ void Draw_String (int x, int y, const char *str)
 	if (y <= -8)
 		return;			// totally off screen
 
-	GL_Bind (char_texture);
-	glBegin (GL_QUADS);
-
 	while (*str)
 	{
 		if (*str != 32) //don't waste verts on spaces
@@ -494,8 +580,6 @@ void Draw_String (int x, int y, const char *str)
 		str++;
 		x += 8;
 	}
-
-	glEnd ();
 }
 
 /*
@@ -510,17 +594,7 @@ void Draw_Pic (int x, int y, qpic_t *pic)
 	if (scrap_dirty)
 		Scrap_Upload ();
 	gl = (glpic_t *)pic->data;
-	GL_Bind (gl->gltexture);
-	glBegin (GL_QUADS);
-	glTexCoord2f (gl->sl, gl->tl);
-	glVertex2f (x, y);
-	glTexCoord2f (gl->sh, gl->tl);
-	glVertex2f (x+pic->width, y);
-	glTexCoord2f (gl->sh, gl->th);
-	glVertex2f (x+pic->width, y+pic->height);
-	glTexCoord2f (gl->sl, gl->th);
-	glVertex2f (x, y+pic->height);
-	glEnd ();
+	Draw_SetQuad (Draw_BatchQuad (gl->gltexture), x, y, pic->width, pic->height, gl->sl, gl->tl, gl->sh, gl->th);
 }
 
 /*
@@ -541,6 +615,7 @@ void Draw_TransPicTranslate (int x, int y, qpic_t *pic, int top, int bottom)
 		gltexture_t *glt = p->gltexture;
 		oldtop = top;
 		oldbottom = bottom;
+		Draw_Flush (); // pending quads may still use the old translation
 		TexMgr_ReloadImage (glt, top, bottom);
 	}
 	Draw_Pic (x, y, pic);
@@ -568,6 +643,7 @@ void Draw_ConsoleBackground (void)
 	{
 		if (alpha < 1.0)
 		{
+			Draw_Flush ();
 			glEnable (GL_BLEND);
 			glColor4f (1,1,1,alpha);
 			glDisable (GL_ALPHA_TEST);
@@ -578,6 +654,7 @@ void Draw_ConsoleBackground (void)
 
 		if (alpha < 1.0)
 		{
+			Draw_Flush ();
 			glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 			glEnable (GL_ALPHA_TEST);
 			glDisable (GL_BLEND);
@@ -601,18 +678,7 @@ void Draw_TileClear (int x, int y, int w, int h)
 
 	gl = (glpic_t *)draw_backtile->data;
 
-	glColor3f (1,1,1);
-	GL_Bind (gl->gltexture);
-	glBegin (GL_QUADS);
-	glTexCoord2f (x/64.0, y/64.0);
-	glVertex2f (x, y);
-	glTexCoord2f ( (x+w)/64.0, y/64.0);
-	glVertex2f (x+w, y);
-	glTexCoord2f ( (x+w)/64.0, (y+h)/64.0);
-	glVertex2f (x+w, y+h);
-	glTexCoord2f ( x/64.0, (y+h)/64.0 );
-	glVertex2f (x, y+h);
-	glEnd ();
+	Draw_SetQuad (Draw_BatchQuad (gl->gltexture), x, y, w, h, x/64.0, y/64.0, (x+w)/64.0, (y+h)/64.0);
 }
 
 /*
@@ -625,23 +691,18 @@ Fills a box of pixels with a single color
 void Draw_Fill (int x, int y, int w, int h, int c, float alpha) //johnfitz -- added alpha
 {
 	byte *pal = (byte *)d_8to24table; //johnfitz -- use d_8to24table instead of host_basepal
+	drawvert_t *v;
+	int i;
 
-	glDisable (GL_TEXTURE_2D);
-	glEnable (GL_BLEND); //johnfitz -- for alpha
-	glDisable (GL_ALPHA_TEST); //johnfitz -- for alpha
-	glColor4f (pal[c*4]/255.0, pal[c*4+1]/255.0, pal[c*4+2]/255.0, alpha); //johnfitz -- added alpha
-
-	glBegin (GL_QUADS);
-	glVertex2f (x,y);
-	glVertex2f (x+w, y);
-	glVertex2f (x+w, y+h);
-	glVertex2f (x, y+h);
-	glEnd ();
-
-	glColor3f (1,1,1);
-	glDisable (GL_BLEND); //johnfitz -- for alpha
-	glEnable (GL_ALPHA_TEST); //johnfitz -- for alpha
-	glEnable (GL_TEXTURE_2D);
+	v = Draw_BatchQuad (NULL);
+	Draw_SetQuad (v, x, y, w, h, 0, 0, 0, 0);
+	for (i = 0; i < 4; i++)
+	{
+		v[i].rgba[0] = pal[c*4];
+		v[i].rgba[1] = pal[c*4+1];
+		v[i].rgba[2] = pal[c*4+2];
+		v[i].rgba[3] = (byte) CLAMP (0, (int)(alpha * 255.0 + 0.5), 255); //johnfitz -- added alpha
+	}
 }
 
 /*
@@ -655,6 +716,7 @@ void Draw_FadeScreen (void)
 		return;
 
 	GL_SetCanvas (CANVAS_DEFAULT);
+	Draw_Flush ();
 
 	glEnable (GL_BLEND);
 	glDisable (GL_ALPHA_TEST);
@@ -690,6 +752,7 @@ void GL_SetCanvas (canvastype newcanvas)
 	if (newcanvas == currentcanvas)
 		return;
 
+	Draw_Flush ();
 	currentcanvas = newcanvas;
 
 	if (vr_enabled.value && !con_forcedup)
@@ -768,6 +831,7 @@ GL_Set2D -- johnfitz -- rewritten
 */
 void GL_Set2D (void)
 {
+	Draw_Flush ();
 	currentcanvas = CANVAS_INVALID;
 	GL_SetCanvas (CANVAS_DEFAULT);
 
@@ -394,7 +394,8 @@ void Fog_Init (void)
 	fog_green = DEFAULT_GRAY;
 	fog_blue = DEFAULT_GRAY;
 
-	Fog_SetupState ();
+	if (!isHeadless)
+		Fog_SetupState ();
 }
 
 /*
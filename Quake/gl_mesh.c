@@ -356,6 +356,291 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *hdr)
 unsigned int r_meshindexbuffer = 0;
 unsigned int r_meshvertexbuffer = 0;
 
+/*
+=================================================================
+
+VERTEX CACHE OPTIMISATION
+
+The triangle order of the VBO index list is rearranged with Tom
+Forsyth's linear-speed vertex cache optimisation, and the vertexes are
+then renumbered in the order they are first used, so both the post
+transform cache and the vertex fetches see mostly local accesses.
+
+=================================================================
+*/
+
+#define	VCACHE_SIZE	32
+
+/*
+================
+GLMesh_CacheMisses -- simulates an LRU post transform cache, returns misses per triangle
+================
+*/
+static float GLMesh_CacheMisses (const unsigned short *indexes, int numindexes)
+{
+	int		cache[VCACHE_SIZE];
+	int		i, j, k, misses;
+
+	if (numindexes < 3)
+		return 0;
+
+	for (i = 0; i < VCACHE_SIZE; i++)
+		cache[i] = -1;
+
+	misses = 0;
+	for (i = 0; i < numindexes; i++)
+	{
+		for (j = 0; j < VCACHE_SIZE; j++)
+		{
+			if (cache[j] == indexes[i])
+				break;
+		}
+		if (j == VCACHE_SIZE)
+		{
+			misses++;
+			j = VCACHE_SIZE - 1;
+		}
+		// move to the front
+		for (k = j; k > 0; k--)
+			cache[k] = cache[k-1];
+		cache[0] = indexes[i];
+	}
+
+	return (float)misses / (numindexes / 3);
+}
+
+/*
+================
+GLMesh_VertexScore -- Forsyth's scoring, favours cached vertexes and ones with few triangles left
+================
+*/
+static float GLMesh_VertexScore (int cachepos, int remaining)
+{
+	float	score;
+
+	if (!remaining)
+		return -1.0f;	// no triangles left, never pick it
+
+	if (cachepos < 0)
+		score = 0.0f;
+	else if (cachepos < 3)
+		score = 0.75f;	// used by the last triangle, don't favour it over the rest of the cache
+	else
+		score = pow (1.0 - (double)(cachepos - 3) / (VCACHE_SIZE - 3), 1.5);
+
+	return score + 2.0 / sqrt ((double)remaining);
+}
+
+/*
+================
+GLMesh_OptimizeIndexes -- reorders the triangles of an indexed mesh in place
+================
+*/
+static void GLMesh_OptimizeIndexes (unsigned short *indexes, int numindexes, int numverts)
+{
+	int		numtris = numindexes / 3;
+	int		*trioffset, *tricount, *vtris, *cachepos;
+	float	*vscore, *tscore;
+	byte	*added;
+	unsigned short	*out;
+	int		cache[VCACHE_SIZE + 3], newcache[VCACHE_SIZE + 3];
+	int		cachesize, newcachesize;
+	int		i, j, k, v, t, best, scan, emitted;
+	float	bestscore;
+
+	if (numtris < 2)
+		return;
+
+	trioffset = (int *) malloc ((numverts + 1) * sizeof(int));
+	tricount = (int *) calloc (numverts, sizeof(int));
+	cachepos = (int *) malloc (numverts * sizeof(int));
+	vscore = (float *) malloc (numverts * sizeof(float));
+	vtris = (int *) malloc (numindexes * sizeof(int));
+	tscore = (float *) malloc (numtris * sizeof(float));
+	added = (byte *) calloc (numtris, 1);
+	out = (unsigned short *) malloc (numindexes * sizeof(unsigned short));
+
+	// triangle lists for every vertex
+	for (i = 0; i < numindexes; i++)
+		tricount[indexes[i]]++;
+	trioffset[0] = 0;
+	for (v = 0; v < numverts; v++)
+		trioffset[v+1] = trioffset[v] + tricount[v];
+	for (v = 0; v < numverts; v++)
+		tricount[v] = 0;
+	for (i = 0; i < numindexes; i++)
+	{
+		v = indexes[i];
+		vtris[trioffset[v] + tricount[v]++] = i / 3;
+	}
+
+	for (v = 0; v < numverts; v++)
+	{
+		cachepos[v] = -1;
+		vscore[v] = GLMesh_VertexScore (-1, tricount[v]);
+	}
+
+	best = 0;
+	for (t = 0; t < numtris; t++)
+	{
+		tscore[t] = vscore[indexes[t*3]] + vscore[indexes[t*3+1]] + vscore[indexes[t*3+2]];
+		if (tscore[t] > tscore[best])
+			best = t;
+	}
+
+	cachesize = 0;
+	scan = 0;
+	for (emitted = 0; emitted < numtris; emitted++)
+	{
+		if (best < 0)
+		{
+			// nothing in the cache has triangles left, take the next unused one
+			while (added[scan])
+				scan++;
+			best = scan;
+		}
+
+		t = best;
+		added[t] = true;
+		memcpy (out + emitted*3, indexes + t*3, 3 * sizeof(unsigned short));
+
+		// the triangle's vertexes go to the front of the cache
+		newcachesize = 0;
+		for (j = 0; j < 3; j++)
+		{
+			v = indexes[t*3+j];
+			newcache[newcachesize++] = v;
+
+			// drop t from the vertex's list of remaining triangles
+			for (k = trioffset[v]; vtris[k] != t; k++)
+				;
+			vtris[k] = vtris[trioffset[v] + tricount[v] - 1];
+			tricount[v]--;
+		}
+		for (j = 0; j < cachesize; j++)
+		{
+			v = cache[j];
+			if (v != newcache[0] && v != newcache[1] && v != newcache[2])
+				newcache[newcachesize++] = v;
+		}
+
+		// rescore everything that was or is in the cache, and pick the best triangle around it
+		best = -1;
+		bestscore = -1.0f;
+		for (j = 0; j < newcachesize; j++)
+		{
+			v = newcache[j];
+			cachepos[v] = (j < VCACHE_SIZE) ? j : -1;
+			vscore[v] = GLMesh_VertexScore (cachepos[v], tricount[v]);
+		}
+		for (j = 0; j < newcachesize; j++)
+		{
+			v = newcache[j];
+			for (k = trioffset[v]; k < trioffset[v] + tricount[v]; k++)
+			{
+				i = vtris[k];
+				tscore[i] = vscore[indexes[i*3]] + vscore[indexes[i*3+1]] + vscore[indexes[i*3+2]];
+				if (tscore[i] > bestscore)
+				{
+					bestscore = tscore[i];
+					best = i;
+				}
+			}
+		}
+
+		cachesize = q_min (newcachesize, VCACHE_SIZE);
+		memcpy (cache, newcache, cachesize * sizeof(int));
+	}
+
+	memcpy (indexes, out, numindexes * sizeof(unsigned short));
+
+	free (trioffset);
+	free (tricount);
+	free (cachepos);
+	free (vscore);
+	free (vtris);
+	free (tscore);
+	free (added);
+	free (out);
+}
+
+/*
+================
+GLMesh_MergePoseVerts -- maps every mdl vertex to the first one that matches it in every pose
+
+Different mdl vertexes often sit in the same place for the whole model
+(split by the modeller, or welded by a converter), so the VBO can share them.
+================
+*/
+static unsigned short *GLMesh_MergePoseVerts (void)
+{
+	unsigned short	*remap;
+	int		*hash, hashmask;
+	unsigned int	h;
+	int		v, p, other;
+
+	remap = (unsigned short *) malloc (pheader->numverts * sizeof(unsigned short));
+	for (hashmask = 1; hashmask < pheader->numverts * 2; hashmask <<= 1)
+		;
+	hash = (int *) malloc (hashmask * sizeof(int));
+	memset (hash, -1, hashmask * sizeof(int));
+	hashmask--;
+
+	for (v = 0; v < pheader->numverts; v++)
+	{
+		h = 0;
+		for (p = 0; p < pheader->numposes; p++)
+			h = Hash_Block ((byte *)&poseverts[p][v], sizeof(trivertx_t), h);
+
+		for (h &= hashmask; (other = hash[h]) != -1; h = (h + 1) & hashmask)
+		{
+			for (p = 0; p < pheader->numposes; p++)
+			{
+				if (memcmp (&poseverts[p][v], &poseverts[p][other], sizeof(trivertx_t)))
+					break;
+			}
+			if (p == pheader->numposes)
+				break;
+		}
+		if (other == -1)
+		{
+			hash[h] = v;
+			remap[v] = v;
+		}
+		else
+			remap[v] = other;
+	}
+
+	free (hash);
+	return remap;
+}
+
+/*
+================
+GLMesh_AddVert -- returns the vbo vertex with these values, adding it if it is new
+================
+*/
+static int GLMesh_AddVert (aliasmesh_t *desc, int *numverts, int *hash, int hashmask, unsigned short vertindex, int s, int t)
+{
+	unsigned int	h;
+	int		v;
+
+	h = (vertindex * 73856093u) ^ (s * 19349663u) ^ (t * 83492791u);
+	for (h &= hashmask; (v = hash[h]) != -1; h = (h + 1) & hashmask)
+	{
+		// it could use the same xyz but have different s and t
+		if (desc[v].vertindex == vertindex && (int) desc[v].st[0] == s && (int) desc[v].st[1] == t)
+			return v;
+	}
+
+	v = (*numverts)++;
+	hash[h] = v;
+	desc[v].vertindex = vertindex;
+	desc[v].st[0] = s;
+	desc[v].st[1] = t;
+	return v;
+}
+
 /*
 ================
 GL_MakeAliasModelDisplayLists_VBO
@@ -372,7 +657,10 @@ void GL_MakeAliasModelDisplayLists_VBO (void)
 	int maxverts_vbo;
 	trivertx_t *verts;
 	unsigned short *indexes;
-	aliasmesh_t *desc;
+	aliasmesh_t *desc, *newdesc;
+	unsigned short *remap;
+	int *hash, hashmask, *newindex;
+	int numverts;
 
 	if (!gl_glsl_alias_able)
 		return;
@@ -396,12 +684,17 @@ void GL_MakeAliasModelDisplayLists_VBO (void)
 	pheader->numindexes = 0;
 	pheader->numverts_vbo = 0;
 
+	for (hashmask = 1; hashmask < maxverts_vbo * 2; hashmask <<= 1)
+		;
+	hash = (int *) malloc (hashmask * sizeof(int));
+	hashmask--;
+
+	// the plain layout, one vert per unique mdl vertex and s/t
+	memset (hash, -1, (hashmask + 1) * sizeof(int));
 	for (i = 0; i < pheader->numtris; i++)
 	{
 		for (j = 0; j < 3; j++)
 		{
-			int v;
-
 			// index into hdr->vertexes
 			unsigned short vertindex = triangles[i].vertindex[j];
 
@@ -412,32 +705,48 @@ void GL_MakeAliasModelDisplayLists_VBO (void)
 			// check for back side and adjust texcoord s
 			if (!triangles[i].facesfront && stverts[vertindex].onseam) s += pheader->skinwidth / 2;
 
-			// see does this vert already exist
-			for (v = 0; v < pheader->numverts_vbo; v++)
-			{
-				// it could use the same xyz but have different s and t
-				if (desc[v].vertindex == vertindex && (int) desc[v].st[0] == s && (int) desc[v].st[1] == t)
-				{
-					// exists; emit an index for it
-					indexes[pheader->numindexes++] = v;
-
-					// no need to check any more
-					break;
-				}
-			}
-
-			if (v == pheader->numverts_vbo)
-			{
-				// doesn't exist; emit a new vert and index
-				indexes[pheader->numindexes++] = pheader->numverts_vbo;
-
-				desc[pheader->numverts_vbo].vertindex = vertindex;
-				desc[pheader->numverts_vbo].st[0] = s;
-				desc[pheader->numverts_vbo++].st[1] = t;
-			}
+			indexes[pheader->numindexes++] = GLMesh_AddVert (desc, &pheader->numverts_vbo, hash, hashmask, vertindex, s, t);
 		}
 	}
-	
+	aliasmodel->meshverts[0] = pheader->numverts_vbo;
+	aliasmodel->meshacmr[0] = GLMesh_CacheMisses (indexes, pheader->numindexes);
+
+	// merge the verts that are identical in every pose
+	remap = GLMesh_MergePoseVerts ();
+	newdesc = (aliasmesh_t *) malloc (sizeof (aliasmesh_t) * maxverts_vbo);
+	newindex = (int *) malloc (sizeof (int) * maxverts_vbo);
+	memset (hash, -1, (hashmask + 1) * sizeof(int));
+	numverts = 0;
+	for (i = 0; i < pheader->numverts_vbo; i++)
+		newindex[i] = GLMesh_AddVert (newdesc, &numverts, hash, hashmask, remap[desc[i].vertindex], (int) desc[i].st[0], (int) desc[i].st[1]);
+	for (i = 0; i < pheader->numindexes; i++)
+		indexes[i] = newindex[indexes[i]];
+	pheader->numverts_vbo = numverts;
+	free (remap);
+	free (hash);
+
+	// reorder the triangles for the vertex cache
+	GLMesh_OptimizeIndexes (indexes, pheader->numindexes, pheader->numverts_vbo);
+
+	// and number the verts in the order the triangles first use them
+	for (i = 0; i < pheader->numverts_vbo; i++)
+		newindex[i] = -1;
+	numverts = 0;
+	for (i = 0; i < pheader->numindexes; i++)
+	{
+		if (newindex[indexes[i]] == -1)
+		{
+			desc[numverts] = newdesc[indexes[i]];
+			newindex[indexes[i]] = numverts++;
+		}
+		indexes[i] = newindex[indexes[i]];
+	}
+	free (newdesc);
+	free (newindex);
+
+	aliasmodel->meshverts[1] = pheader->numverts_vbo;
+	aliasmodel->meshacmr[1] = GLMesh_CacheMisses (indexes, pheader->numindexes);
+
 	// upload immediately
 	GLMesh_LoadVertexBuffer (aliasmodel, pheader);
 }
@@ -462,6 +771,7 @@ static void GLMesh_LoadVertexBuffer (qmodel_t *m, const aliashdr_t *hdr)
 	const trivertx_t *trivertexes;
 	byte *vbodata;
 	int f;
+	float hscale, vscale;
 
 	if (!gl_glsl_alias_able)
 		return;
@@ -476,15 +786,35 @@ static void GLMesh_LoadVertexBuffer (qmodel_t *m, const aliashdr_t *hdr)
 	m->vboxyzofs = 0;
 	totalvbosize += (hdr->numposes * hdr->numverts_vbo * sizeof (meshxyz_t)); // ericw -- what RMQEngine called nummeshframes is called numposes in QuakeSpasm
 	
-	m->vbostofs = totalvbosize;
-	totalvbosize += (hdr->numverts_vbo * sizeof (meshst_t));
-	
-	if (!hdr->numindexes) return;
-	if (!totalvbosize) return;
-	
 // grab the pointers to data in the extradata
 
 	desc = (aliasmesh_t *) ((byte *) hdr + hdr->meshdesc);
+
+	//johnfitz -- padded skins
+	hscale = (float)hdr->skinwidth/(float)TexMgr_PadConditional(hdr->skinwidth);
+	vscale = (float)hdr->skinheight/(float)TexMgr_PadConditional(hdr->skinheight);
+	//johnfitz
+
+	// texcoords fit in normalized shorts unless a seam vert wraps past the skin edge
+	m->vboshortst = true;
+	for (f = 0; f < hdr->numverts_vbo; f++)
+	{
+		if (desc[f].st[0] + 0.5f > hdr->skinwidth || desc[f].st[1] + 0.5f > hdr->skinheight ||
+		    desc[f].st[0] < 0 || desc[f].st[1] < 0)
+		{
+			m->vboshortst = false;
+			break;
+		}
+	}
+
+	m->vbostofs = totalvbosize;
+	totalvbosize += (hdr->numverts_vbo * (m->vboshortst ? sizeof (meshst16_t) : sizeof (meshst_t)));
+
+	m->meshvbosize[0] = m->meshverts[0] * (hdr->numposes * sizeof (meshxyz_t) + sizeof (meshst_t));
+	m->meshvbosize[1] = totalvbosize;
+
+	if (!hdr->numindexes) return;
+	if (!totalvbosize) return;
 	indexes = (short *) ((byte *) hdr + hdr->indexes);
 	trivertexes = (trivertx_t *) ((byte *)hdr + hdr->vertexes);
 
@@ -527,16 +857,20 @@ static void GLMesh_LoadVertexBuffer (qmodel_t *m, const aliashdr_t *hdr)
 	}
 
 // fill in the ST coords at the end of the buffer
+	if (m->vboshortst)
 	{
-		meshst_t *st;
-		float hscale, vscale;
+		meshst16_t *st = (meshst16_t *) (vbodata + m->vbostofs);
 
-		//johnfitz -- padded skins
-		hscale = (float)hdr->skinwidth/(float)TexMgr_PadConditional(hdr->skinwidth);
-		vscale = (float)hdr->skinheight/(float)TexMgr_PadConditional(hdr->skinheight);
-		//johnfitz
+		for (f = 0; f < hdr->numverts_vbo; f++)
+		{
+			st[f].st[0] = 65535.0f * hscale * ((float) desc[f].st[0] + 0.5f) / (float) hdr->skinwidth + 0.5f;
+			st[f].st[1] = 65535.0f * vscale * ((float) desc[f].st[1] + 0.5f) / (float) hdr->skinheight + 0.5f;
+		}
+	}
+	else
+	{
+		meshst_t *st = (meshst_t *) (vbodata + m->vbostofs);
 
-		st = (meshst_t *) (vbodata + m->vbostofs);
 		for (f = 0; f < hdr->numverts_vbo; f++)
 		{
 			st[f].st[0] = hscale * ((float) desc[f].st[0] + 0.5f) / (float) hdr->skinwidth;
@@ -36,12 +36,6 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
 
 cvar_t	external_ents = {"external_ents", "1", CVAR_ARCHIVE};
 
-static byte	*mod_novis;
-static int	mod_novis_capacity;
-
-static byte	*mod_decompressed;
-static int	mod_decompressed_capacity;
-
 #define	MAX_MOD_KNOWN	2048 /*johnfitz -- was 512 */
 qmodel_t	mod_known[MAX_MOD_KNOWN];
 int		mod_numknown;
@@ -49,6 +43,18 @@ int		mod_numknown;
 texture_t	*r_notexture_mip; //johnfitz -- moved here from r_main.c
 texture_t	*r_notexture_mip2; //johnfitz -- used for non-lightmapped surfs with a missing texture
 
+// load-time breakdown for "maptimings", summed by stage name until reset
+#define	MAX_LOADSTAGES	32
+static struct
+{
+	const char	*name;
+	double		time;
+} loadstages[MAX_LOADSTAGES];
+static int	numloadstages;
+static int	numbrushloads;
+
+static void Mod_Maptimings_f (void);
+
 /*
 ===============
 Mod_Init
@@ -59,6 +65,8 @@ void Mod_Init (void)
 	Cvar_RegisterVariable (&gl_subdivide_size);
 	Cvar_RegisterVariable (&external_ents);
 
+	Cmd_AddCommand ("maptimings", &Mod_Maptimings_f);
+
 	//johnfitz -- create notexture miptex
 	r_notexture_mip = (texture_t *) Hunk_AllocName (sizeof(texture_t), "r_notexture_mip");
 	strcpy (r_notexture_mip->name, "notexture");
@@ -123,28 +131,46 @@ mleaf_t *Mod_PointInLeaf (vec3_t p, qmodel_t *model)
 }
 
 
+/*
+===================
+Mod_PVSBuffer
+
+Grows the caller's buffer to hold a PVS of the model. The server and the
+renderer keep their own buffers, as the server frame can run on a worker
+while the main thread renders (host_serverthread).
+===================
+*/
+byte *Mod_PVSBuffer (pvsbuffer_t *buf, qmodel_t *model)
+{
+	int	pvsbytes = (model->numleafs+7)>>3;
+
+	if (buf->bits == NULL || pvsbytes > buf->capacity)
+	{
+		buf->capacity = pvsbytes;
+		buf->bits = (byte *) realloc (buf->bits, buf->capacity);
+		if (!buf->bits)
+			Sys_Error ("Mod_PVSBuffer: realloc() failed on %d bytes", buf->capacity);
+	}
+	return buf->bits;
+}
+
 /*
 ===================
 Mod_DecompressVis
 ===================
 */
-byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+static byte *Mod_DecompressVis (byte *in, qmodel_t *model, pvsbuffer_t *buf)
 {
 	int		c;
 	byte	*out;
 	byte	*outend;
+	byte	*decompressed;
 	int		row;
 
 	row = (model->numleafs+7)>>3;
-	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
-	{
-		mod_decompressed_capacity = row;
-		mod_decompressed = (byte *) realloc (mod_decompressed, mod_decompressed_capacity);
-		if (!mod_decompressed)
-			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
-	}
-	out = mod_decompressed;
-	outend = mod_decompressed + row;
+	decompressed = Mod_PVSBuffer (buf, model);
+	out = decompressed;
+	outend = decompressed + row;
 
 	if (!in)
 	{	// no vis info, so make all visible
@@ -153,7 +179,7 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 			*out++ = 0xff;
 			row--;
 		}
-		return mod_decompressed;
+		return decompressed;
 	}
 
 	do
@@ -174,38 +200,29 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 					model->viswarn = true;
 					Con_Warning("Mod_DecompressVis: output overrun on model \"%s\"\n", model->name);
 				}
-				return mod_decompressed;
+				return decompressed;
 			}
 			*out++ = 0;
 			c--;
 		}
-	} while (out - mod_decompressed < row);
+	} while (out - decompressed < row);
 
-	return mod_decompressed;
+	return decompressed;
 }
 
-byte *Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model)
+byte *Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model, pvsbuffer_t *buf)
 {
 	if (leaf == model->leafs)
-		return Mod_NoVisPVS (model);
-	return Mod_DecompressVis (leaf->compressed_vis, model);
+		return Mod_NoVisPVS (model, buf);
+	return Mod_DecompressVis (leaf->compressed_vis, model, buf);
 }
 
-byte *Mod_NoVisPVS (qmodel_t *model)
+byte *Mod_NoVisPVS (qmodel_t *model, pvsbuffer_t *buf)
 {
-	int pvsbytes;
- 
-	pvsbytes = (model->numleafs+7)>>3;
-	if (mod_novis == NULL || pvsbytes > mod_novis_capacity)
-	{
-		mod_novis_capacity = pvsbytes;
-		mod_novis = (byte *) realloc (mod_novis, mod_novis_capacity);
-		if (!mod_novis)
-			Sys_Error ("Mod_NoVisPVS: realloc() failed on %d bytes", mod_novis_capacity);
-		
-		memset(mod_novis, 0xff, mod_novis_capacity);
-	}
-	return mod_novis;
+	byte	*pvs = Mod_PVSBuffer (buf, model);
+
+	memset (pvs, 0xff, (model->numleafs+7)>>3);
+	return pvs;
 }
 
 /*
@@ -353,6 +370,7 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	mod->needload = false;
 
 	mod_type = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
+	TexMgr_BeginBatch ();
 	switch (mod_type)
 	{
 	case IDPOLYHEADER:
@@ -367,6 +385,7 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 		Mod_LoadBrushModel (mod, buf);
 		break;
 	}
+	TexMgr_EndBatch ();
 
 	return mod;
 }
@@ -733,6 +752,7 @@ void Mod_LoadLighting (lump_t *l)
 			{
 				Con_DPrintf2("%s loaded\n", litfilename);
 				loadmodel->lightdata = data + 8;
+				loadmodel->filehash = Hash_Block (data, com_filesize, loadmodel->filehash);
 				return;
 			}
 			else
@@ -987,6 +1007,7 @@ void Mod_LoadTexinfo (lump_t *l)
 CalcSurfaceExtents
 
 Fills in s->texturemins[] and s->extents[]
+Runs on worker threads, so bad extents are checked later by Mod_FinishFaces
 ================
 */
 void CalcSurfaceExtents (msurface_t *s)
@@ -1046,9 +1067,6 @@ void CalcSurfaceExtents (msurface_t *s)
 
 		s->texturemins[i] = bmins[i] * 16;
 		s->extents[i] = (bmaxs[i] - bmins[i]) * 16;
-
-		if ( !(tex->flags & TEX_SPECIAL) && s->extents[i] > 2000) //johnfitz -- was 512 in glquake, 256 in winquake
-			Sys_Error ("Bad surface extents");
 	}
 }
 
@@ -1136,9 +1154,42 @@ void Mod_CalcSurfaceBounds (msurface_t *s)
 	}
 }
 
+/*
+=================
+Mod_FaceExtentsTask -- per-face derived data, run on the worker threads
+
+Only reads the vertex/edge/texinfo lumps and writes its own faces.
+=================
+*/
+#define	FACES_PER_TASK	1024
+
+typedef struct
+{
+	msurface_t	*surfaces;
+	int			count;
+} facetask_t;
+
+static taskgroup_t	facetasks;
+static facetask_t	*facetask_data;
+
+static void Mod_FaceExtentsTask (void *data)
+{
+	facetask_t	*task = (facetask_t *) data;
+	int			i;
+
+	for (i = 0; i < task->count; i++)
+	{
+		CalcSurfaceExtents (task->surfaces + i);
+		Mod_CalcSurfaceBounds (task->surfaces + i); //johnfitz -- for per-surface frustum culling
+	}
+}
+
 /*
 =================
 Mod_LoadFaces
+
+Decodes the face lump and queues the extents and bounds on the worker
+threads; Mod_FinishFaces must be called before the faces are used.
 =================
 */
 void Mod_LoadFaces (lump_t *l, qboolean bsp2)
@@ -1211,21 +1262,57 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 
 		out->texinfo = loadmodel->texinfo + texinfon;
 
-		CalcSurfaceExtents (out);
-
-		Mod_CalcSurfaceBounds (out); //johnfitz -- for per-surface frustum culling
-
 	// lighting info
 		if (lofs == -1)
 			out->samples = NULL;
 		else
 			out->samples = loadmodel->lightdata + (lofs * 3); //johnfitz -- lit support via lordhavoc (was "+ i")
+	}
+
+	// the rest of the lumps don't look at the faces, so the workers can
+	// chew on them while the main thread carries on
+	facetask_data = (facetask_t *) malloc (q_max((count + FACES_PER_TASK - 1) / FACES_PER_TASK, 1) * sizeof(facetask_t));
+	if (!facetask_data)
+		Sys_Error ("Mod_LoadFaces: out of memory");
+	for (surfnum = 0, i = 0; surfnum < count; surfnum += FACES_PER_TASK, i++)
+	{
+		facetask_data[i].surfaces = loadmodel->surfaces + surfnum;
+		facetask_data[i].count = q_min(FACES_PER_TASK, count - surfnum);
+		Task_Add (&facetasks, Mod_FaceExtentsTask, &facetask_data[i]);
+	}
+}
+
+/*
+=================
+Mod_FinishFaces -- waits for Mod_LoadFaces' tasks and does the hunk work
+=================
+*/
+void Mod_FinishFaces (void)
+{
+	msurface_t	*out;
+	int			i, surfnum;
+
+	Task_Wait (&facetasks);
+	free (facetask_data);
+	facetask_data = NULL;
+
+	for (surfnum=0, out=loadmodel->surfaces ; surfnum<loadmodel->numsurfaces ; surfnum++, out++)
+	{
+		if (!(out->texinfo->flags & TEX_SPECIAL))
+		{
+			for (i=0 ; i<2 ; i++)
+			{
+				if (out->extents[i] > 2000) //johnfitz -- was 512 in glquake, 256 in winquake
+					Sys_Error ("Bad surface extents");
+			}
+		}
 
 		//johnfitz -- this section rewritten
 		if (!q_strncasecmp(out->texinfo->texture->name,"sky",3)) // sky surface //also note -- was Q_strncmp, changed to match qbsp
 		{
 			out->flags |= (SURF_DRAWSKY | SURF_DRAWTILED);
-			Mod_PolyForUnlitSurface (out); //no more subdivision
+			if (!isDedicated)
+				Mod_PolyForUnlitSurface (out); //no more subdivision
 		}
 		else if (out->texinfo->texture->name[0] == '*') // warp surface
 		{
@@ -1240,8 +1327,12 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 				out->flags |= SURF_DRAWTELE;
 			else out->flags |= SURF_DRAWWATER;
 
-			Mod_PolyForUnlitSurface (out);
-			GL_SubdivideSurface (out);
+			if (!isDedicated) //no draw polys for dedicated server
+			{
+				Mod_PolyForUnlitSurface (out);
+				if (GLWarp_SubdivideAtLoad ())
+					GL_SubdivideSurface (out);
+			}
 		}
 		else if (out->texinfo->texture->name[0] == '{') // ericw -- fence textures
 		{
@@ -1256,7 +1347,8 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 			else // not lightmapped
 			{
 				out->flags |= (SURF_NOTEXTURE | SURF_DRAWTILED);
-				Mod_PolyForUnlitSurface (out);
+				if (!isDedicated)
+					Mod_PolyForUnlitSurface (out);
 			}
 		}
 		//johnfitz
@@ -1982,6 +2074,61 @@ void Mod_BoundsFromClipNode (qmodel_t *mod, int hull, int nodenum)
 	Mod_BoundsFromClipNode (mod, hull, node->children[1]);
 }
 
+/*
+=================
+Mod_AddLoadStage -- adds the time since start to the named stage, returns the current time
+=================
+*/
+double Mod_AddLoadStage (const char *name, double start)
+{
+	double	now = Sys_ProfileTime ();
+	int		i;
+
+	for (i = 0; i < numloadstages; i++)
+	{
+		if (!strcmp (loadstages[i].name, name))
+			break;
+	}
+	if (i == numloadstages)
+	{
+		if (numloadstages == MAX_LOADSTAGES)
+			return now;
+		loadstages[numloadstages].name = name;
+		loadstages[numloadstages].time = 0;
+		numloadstages++;
+	}
+	loadstages[i].time += now - start;
+	return now;
+}
+
+/*
+=================
+Mod_Maptimings_f -- report where brush model loading time went
+=================
+*/
+static void Mod_Maptimings_f (void)
+{
+	int		i;
+	double	total;
+
+	if (Cmd_Argc() == 2 && !q_strcasecmp(Cmd_Argv(1), "reset"))
+	{
+		numloadstages = 0;
+		numbrushloads = 0;
+		return;
+	}
+
+	Con_Printf ("%i brush models, faces processed on %i worker threads\n", numbrushloads, Tasks_NumWorkers());
+	total = 0;
+	for (i = 0; i < numloadstages; i++)
+	{
+		Con_Printf ("%10s: %8.2f ms\n", loadstages[i].name, loadstages[i].time * 1000.0);
+		total += loadstages[i].time;
+	}
+	Con_Printf ("%10s: %8.2f ms\n", "total", total * 1000.0);
+	Con_Printf ("use \"maptimings reset\" before loading a map to time it\n");
+}
+
 /*
 =================
 Mod_LoadBrushModel
@@ -1994,6 +2141,7 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 	dheader_t	*header;
 	dmodel_t 	*bm;
 	float		radius; //johnfitz
+	double		start;
 
 	loadmodel->type = mod_brush;
 
@@ -2017,6 +2165,8 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 		break;
 	}
 
+	mod->filehash = Hash_Block ((byte *)buffer, com_filesize, 0);
+
 // swap all the lumps
 	mod_base = (byte *)header;
 
@@ -2025,23 +2175,45 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 
 // load into heap
 
+	numbrushloads++;
+	start = Sys_ProfileTime ();
+
 	Mod_LoadVertexes (&header->lumps[LUMP_VERTEXES]);
+	start = Mod_AddLoadStage ("vertexes", start);
 	Mod_LoadEdges (&header->lumps[LUMP_EDGES], bsp2);
+	start = Mod_AddLoadStage ("edges", start);
 	Mod_LoadSurfedges (&header->lumps[LUMP_SURFEDGES]);
+	start = Mod_AddLoadStage ("surfedges", start);
 	Mod_LoadTextures (&header->lumps[LUMP_TEXTURES]);
+	start = Mod_AddLoadStage ("textures", start);
 	Mod_LoadLighting (&header->lumps[LUMP_LIGHTING]);
+	start = Mod_AddLoadStage ("lighting", start);
 	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
+	start = Mod_AddLoadStage ("planes", start);
 	Mod_LoadTexinfo (&header->lumps[LUMP_TEXINFO]);
+	start = Mod_AddLoadStage ("texinfo", start);
 	Mod_LoadFaces (&header->lumps[LUMP_FACES], bsp2);
+	start = Mod_AddLoadStage ("faces", start);
+	// these overlap with the face extents running on the workers
 	Mod_LoadMarksurfaces (&header->lumps[LUMP_MARKSURFACES], bsp2);
+	start = Mod_AddLoadStage ("marksurfs", start);
 	Mod_LoadVisibility (&header->lumps[LUMP_VISIBILITY]);
+	start = Mod_AddLoadStage ("visibility", start);
 	Mod_LoadLeafs (&header->lumps[LUMP_LEAFS], bsp2);
+	start = Mod_AddLoadStage ("leafs", start);
 	Mod_LoadNodes (&header->lumps[LUMP_NODES], bsp2);
+	start = Mod_AddLoadStage ("nodes", start);
 	Mod_LoadClipnodes (&header->lumps[LUMP_CLIPNODES], bsp2);
+	start = Mod_AddLoadStage ("clipnodes", start);
 	Mod_LoadEntities (&header->lumps[LUMP_ENTITIES]);
+	start = Mod_AddLoadStage ("entities", start);
 	Mod_LoadSubmodels (&header->lumps[LUMP_MODELS]);
+	start = Mod_AddLoadStage ("submodels", start);
+	Mod_FinishFaces ();
+	start = Mod_AddLoadStage ("face polys", start);
 
 	Mod_MakeHull0 ();
+	Mod_AddLoadStage ("hull0", start);
 
 	mod->numframes = 2;		// regular and alternate animation
 
@@ -2652,7 +2824,8 @@ void Mod_LoadAliasModel (qmodel_t *mod, void *buffer)
 	//
 	// build the draw lists
 	//
-	GL_MakeAliasModelDisplayLists (mod, pheader);
+	if (!isDedicated) //only the bounds are used by a dedicated server
+		GL_MakeAliasModelDisplayLists (mod, pheader);
 
 //
 // move the complete, relocatable alias model to the cache
@@ -2861,6 +3034,10 @@ void Mod_Print (void)
 	for (i=0, mod=mod_known ; i < mod_numknown ; i++, mod++)
 	{
 		Con_SafePrintf ("%8p : %s\n", mod->cache.data, mod->name); //johnfitz -- safeprint instead of print
+		if (mod->type == mod_alias && mod->meshverts[0])
+			Con_SafePrintf ("           %i->%i verts, %i->%i vbo bytes, acmr %.2f->%.2f\n",
+				mod->meshverts[0], mod->meshverts[1], mod->meshvbosize[0], mod->meshvbosize[1],
+				mod->meshacmr[0], mod->meshacmr[1]);
 	}
 	Con_Printf ("%i models\n",mod_numknown); //johnfitz -- print the total too
 }
@@ -304,6 +304,11 @@ typedef struct meshst_s
 {
 	float st[2];
 } meshst_t;
+
+typedef struct meshst16_s
+{
+	unsigned short st[2];	// normalized, used when every coord of the model is in [0..1]
+} meshst16_t;
 //--
 
 typedef struct
@@ -487,6 +492,7 @@ typedef struct qmodel_s
 	qboolean	viswarn; // for Mod_DecompressVis()
 
 	int			bspversion;
+	unsigned int	filehash;	// bsp (and .lit) contents, keys the lightmap cache
 
 //
 // alias model
@@ -496,7 +502,13 @@ typedef struct qmodel_s
 	GLuint		meshindexesvbo;
 	int			vboindexofs;    // offset in vbo of the hdr->numindexes unsigned shorts
 	int			vboxyzofs;      // offset in vbo of hdr->numposes*hdr->numverts_vbo meshxyz_t
-	int			vbostofs;       // offset in vbo of hdr->numverts_vbo meshst_t
+	int			vbostofs;       // offset in vbo of hdr->numverts_vbo meshst_t or meshst16_t
+	qboolean	vboshortst;     // texcoords are meshst16_t
+
+	// mesh optimisation results for Mod_Print, [0] is the plain RMQEngine layout
+	int			meshverts[2];
+	int			meshvbosize[2];
+	float		meshacmr[2];    // vertex cache misses per triangle
 
 //
 // additional model data
@@ -515,9 +527,19 @@ void	*Mod_Extradata (qmodel_t *mod);	// handles caching
 void	Mod_TouchModel (const char *name);
 
 mleaf_t *Mod_PointInLeaf (float *p, qmodel_t *model);
-byte	*Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model);
-byte	*Mod_NoVisPVS (qmodel_t *model);
+
+typedef struct
+{
+	byte	*bits;
+	int		capacity;
+} pvsbuffer_t;
+
+byte	*Mod_PVSBuffer (pvsbuffer_t *buf, qmodel_t *model);
+byte	*Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model, pvsbuffer_t *buf);
+byte	*Mod_NoVisPVS (qmodel_t *model, pvsbuffer_t *buf);
 
 void Mod_SetExtraFlags (qmodel_t *mod);
 
+double Mod_AddLoadStage (const char *name, double start); // for "maptimings"
+
 #endif	// __MODEL__
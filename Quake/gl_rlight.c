@@ -267,6 +267,45 @@ mplane_t		*lightplane;
 vec3_t			lightspot;
 vec3_t			lightcolor; //johnfitz -- lit support via lordhavoc
 
+cvar_t	r_lightpoint_exact = {"r_lightpoint_exact", "0", CVAR_NONE};
+
+static msurface_t	*lightsurf;		// surface and lightmap coords of the last RecursiveLightPoint hit
+static int			lightds, lightdt;
+
+/*
+=============
+R_SampleLightmap -- bilinear sample of all styles of surf at ds,dt (relative to texturemins)
+=============
+*/
+static void R_SampleLightmap (vec3_t color, msurface_t *surf, int ds, int dt)
+{
+	// LordHavoc: enhanced to interpolate lighting
+	byte *lightmap;
+	int maps, line3, dsfrac = ds & 15, dtfrac = dt & 15, r00 = 0, g00 = 0, b00 = 0, r01 = 0, g01 = 0, b01 = 0, r10 = 0, g10 = 0, b10 = 0, r11 = 0, g11 = 0, b11 = 0;
+	float scale;
+
+	if (!surf->samples)
+		return;
+
+	line3 = ((surf->extents[0]>>4)+1)*3;
+
+	lightmap = surf->samples + ((dt>>4) * ((surf->extents[0]>>4)+1) + (ds>>4))*3; // LordHavoc: *3 for color
+
+	for (maps = 0;maps < MAXLIGHTMAPS && surf->styles[maps] != 255;maps++)
+	{
+		scale = (float) d_lightstylevalue[surf->styles[maps]] * 1.0 / 256.0;
+		r00 += (float) lightmap[      0] * scale;g00 += (float) lightmap[      1] * scale;b00 += (float) lightmap[2] * scale;
+		r01 += (float) lightmap[      3] * scale;g01 += (float) lightmap[      4] * scale;b01 += (float) lightmap[5] * scale;
+		r10 += (float) lightmap[line3+0] * scale;g10 += (float) lightmap[line3+1] * scale;b10 += (float) lightmap[line3+2] * scale;
+		r11 += (float) lightmap[line3+3] * scale;g11 += (float) lightmap[line3+4] * scale;b11 += (float) lightmap[line3+5] * scale;
+		lightmap += ((surf->extents[0]>>4)+1) * ((surf->extents[1]>>4)+1)*3; // LordHavoc: *3 for colored lighting
+	}
+
+	color[0] += (float) ((int) ((((((((r11-r10) * dsfrac) >> 4) + r10)-((((r01-r00) * dsfrac) >> 4) + r00)) * dtfrac) >> 4) + ((((r01-r00) * dsfrac) >> 4) + r00)));
+	color[1] += (float) ((int) ((((((((g11-g10) * dsfrac) >> 4) + g10)-((((g01-g00) * dsfrac) >> 4) + g00)) * dtfrac) >> 4) + ((((g01-g00) * dsfrac) >> 4) + g00)));
+	color[2] += (float) ((int) ((((((((b11-b10) * dsfrac) >> 4) + b10)-((((b01-b00) * dsfrac) >> 4) + b00)) * dtfrac) >> 4) + ((((b01-b00) * dsfrac) >> 4) + b00)));
+}
+
 /*
 =============
 RecursiveLightPoint -- johnfitz -- replaced entire function for lit support via lordhavoc
@@ -338,30 +377,10 @@ loc0:
 			if (ds > surf->extents[0] || dt > surf->extents[1])
 				continue;
 
-			if (surf->samples)
-			{
-				// LordHavoc: enhanced to interpolate lighting
-				byte *lightmap;
-				int maps, line3, dsfrac = ds & 15, dtfrac = dt & 15, r00 = 0, g00 = 0, b00 = 0, r01 = 0, g01 = 0, b01 = 0, r10 = 0, g10 = 0, b10 = 0, r11 = 0, g11 = 0, b11 = 0;
-				float scale;
-				line3 = ((surf->extents[0]>>4)+1)*3;
-
-				lightmap = surf->samples + ((dt>>4) * ((surf->extents[0]>>4)+1) + (ds>>4))*3; // LordHavoc: *3 for color
-
-				for (maps = 0;maps < MAXLIGHTMAPS && surf->styles[maps] != 255;maps++)
-				{
-					scale = (float) d_lightstylevalue[surf->styles[maps]] * 1.0 / 256.0;
-					r00 += (float) lightmap[      0] * scale;g00 += (float) lightmap[      1] * scale;b00 += (float) lightmap[2] * scale;
-					r01 += (float) lightmap[      3] * scale;g01 += (float) lightmap[      4] * scale;b01 += (float) lightmap[5] * scale;
-					r10 += (float) lightmap[line3+0] * scale;g10 += (float) lightmap[line3+1] * scale;b10 += (float) lightmap[line3+2] * scale;
-					r11 += (float) lightmap[line3+3] * scale;g11 += (float) lightmap[line3+4] * scale;b11 += (float) lightmap[line3+5] * scale;
-					lightmap += ((surf->extents[0]>>4)+1) * ((surf->extents[1]>>4)+1)*3; // LordHavoc: *3 for colored lighting
-				}
-
-				color[0] += (float) ((int) ((((((((r11-r10) * dsfrac) >> 4) + r10)-((((r01-r00) * dsfrac) >> 4) + r00)) * dtfrac) >> 4) + ((((r01-r00) * dsfrac) >> 4) + r00)));
-				color[1] += (float) ((int) ((((((((g11-g10) * dsfrac) >> 4) + g10)-((((g01-g00) * dsfrac) >> 4) + g00)) * dtfrac) >> 4) + ((((g01-g00) * dsfrac) >> 4) + g00)));
-				color[2] += (float) ((int) ((((((((b11-b10) * dsfrac) >> 4) + b10)-((((b01-b00) * dsfrac) >> 4) + b00)) * dtfrac) >> 4) + ((((b01-b00) * dsfrac) >> 4) + b00)));
-			}
+			lightsurf = surf;
+			lightds = ds;
+			lightdt = dt;
+			R_SampleLightmap (color, surf, ds, dt);
 			return true; // success
 		}
 
@@ -370,26 +389,209 @@ loc0:
 	}
 }
 
+/*
+=============================================================================
+
+LIGHT POINT CACHE
+
+The world trace under a point only depends on the point, so its result (the
+lightmap texel it lands on, plus lightspot/lightplane for shadows) is cached
+by exact origin. Lightstyles are applied on every lookup, so stationary
+entities and the second VR eye get the same answer as the full trace
+without walking the BSP again.
+
+=============================================================================
+*/
+
+#define	LIGHTCACHE_SIZE	1024	// must be a power of two
+
+typedef struct
+{
+	qboolean	valid;
+	vec3_t		origin;
+	msurface_t	*surf;		// NULL if the trace hit nothing
+	int			ds, dt;
+	vec3_t		spot;
+	mplane_t	*plane;
+} lightcache_t;
+
+static lightcache_t	r_lightcache[LIGHTCACHE_SIZE];
+static int			r_lightcache_hits, r_lightcache_misses;
+
 /*
 =============
-R_LightPoint -- johnfitz -- replaced entire function for lit support via lordhavoc
+R_ClearLightCache -- called for every new map
 =============
 */
-int R_LightPoint (vec3_t p)
+void R_ClearLightCache (void)
+{
+	memset (r_lightcache, 0, sizeof(r_lightcache));
+	r_lightcache_hits = r_lightcache_misses = 0;
+}
+
+static lightcache_t *R_LightCacheSlot (vec3_t p)
+{
+	unsigned int	bits[3], h;
+
+	memcpy (bits, p, sizeof(bits));
+	h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+	h ^= h >> 16;
+	return &r_lightcache[h & (LIGHTCACHE_SIZE - 1)];
+}
+
+/*
+=============
+R_LightPointExact -- the full trace, no cache
+=============
+*/
+static void R_LightPointExact (vec3_t p)
 {
 	vec3_t		end;
 
+	end[0] = p[0];
+	end[1] = p[1];
+	end[2] = p[2] - 8192; //johnfitz -- was 2048
+
+	lightcolor[0] = lightcolor[1] = lightcolor[2] = 0;
+	lightsurf = NULL;
+	RecursiveLightPoint (lightcolor, cl.worldmodel->nodes, p, end);
+}
+
+/*
+=============
+R_LightPointCached -- R_LightPointExact through the cache
+=============
+*/
+static void R_LightPointCached (vec3_t p)
+{
+	lightcache_t	*c;
+
+	c = R_LightCacheSlot (p);
+	if (c->valid && VectorCompare (c->origin, p))
+	{
+		r_lightcache_hits++;
+		VectorCopy (c->spot, lightspot);
+		lightplane = c->plane;
+		lightcolor[0] = lightcolor[1] = lightcolor[2] = 0;
+		if (c->surf)
+			R_SampleLightmap (lightcolor, c->surf, c->ds, c->dt);
+		return;
+	}
+
+	r_lightcache_misses++;
+	R_LightPointExact (p);
+	c->valid = true;
+	VectorCopy (p, c->origin);
+	c->surf = lightsurf;
+	c->ds = lightds;
+	c->dt = lightdt;
+	VectorCopy (lightspot, c->spot);
+	c->plane = lightplane;
+}
+
+/*
+=============
+R_LightPoint -- johnfitz -- replaced entire function for lit support via lordhavoc
+=============
+*/
+int R_LightPoint (vec3_t p)
+{
 	if (!cl.worldmodel->lightdata)
 	{
 		lightcolor[0] = lightcolor[1] = lightcolor[2] = 255;
 		return 255;
 	}
 
-	end[0] = p[0];
-	end[1] = p[1];
-	end[2] = p[2] - 8192; //johnfitz -- was 2048
+	if (r_lightpoint_exact.value)
+		R_LightPointExact (p);
+	else
+		R_LightPointCached (p);
 
-	lightcolor[0] = lightcolor[1] = lightcolor[2] = 0;
-	RecursiveLightPoint (lightcolor, cl.worldmodel->nodes, p, end);
 	return ((lightcolor[0] + lightcolor[1] + lightcolor[2]) * (1.0f / 3.0f));
 }
+
+/*
+=============
+R_LightPointTest_f
+
+Checks the cached R_LightPoint against the full trace at every entity in the
+current map and at random points inside the world bounds, and times both.
+=============
+*/
+void R_LightPointTest_f (void)
+{
+	int			i, n, count, mismatches;
+	vec3_t		p, exactcolor, exactspot;
+	vec3_t		*points;
+	double		start, exacttime, cachedtime;
+
+	if (cls.state != ca_connected || !cl.worldmodel || !cl.worldmodel->lightdata)
+	{
+		Con_Printf ("lightpointtest: no lit map loaded\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? q_max (1, atoi (Cmd_Argv (1))) : 10000;
+	points = (vec3_t *) malloc ((cl.num_entities + count) * sizeof(vec3_t));
+	if (!points)
+	{
+		Con_Printf ("lightpointtest: out of memory\n");
+		return;
+	}
+
+	n = 0;
+	for (i = 1; i < cl.num_entities; i++)
+		if (cl_entities[i].model)
+			VectorCopy (cl_entities[i].origin, points[n++]);
+	srand (1);
+	for (i = 0; i < count; i++, n++)
+	{
+		points[n][0] = cl.worldmodel->mins[0] + (cl.worldmodel->maxs[0] - cl.worldmodel->mins[0]) * (rand() / (float)RAND_MAX);
+		points[n][1] = cl.worldmodel->mins[1] + (cl.worldmodel->maxs[1] - cl.worldmodel->mins[1]) * (rand() / (float)RAND_MAX);
+		points[n][2] = cl.worldmodel->mins[2] + (cl.worldmodel->maxs[2] - cl.worldmodel->mins[2]) * (rand() / (float)RAND_MAX);
+	}
+	srand ((int) (cl.time * 1000)); //restore randomness
+
+	// correctness: each point is looked up twice so the second one comes from the cache
+	mismatches = 0;
+	for (i = 0; i < n; i++)
+	{
+		VectorCopy (points[i], p);
+		R_LightPointExact (p);
+		VectorCopy (lightcolor, exactcolor);
+		VectorCopy (lightspot, exactspot);
+
+		R_LightPointCached (p);
+		R_LightPointCached (p);
+		if (!VectorCompare (lightcolor, exactcolor) || !VectorCompare (lightspot, exactspot))
+		{
+			if (mismatches < 8)
+				Con_Printf ("mismatch at %.1f %.1f %.1f: exact %.0f %.0f %.0f, cached %.0f %.0f %.0f\n",
+					p[0], p[1], p[2], exactcolor[0], exactcolor[1], exactcolor[2], lightcolor[0], lightcolor[1], lightcolor[2]);
+			mismatches++;
+		}
+	}
+
+	// speed: two lookups per point, as for the two eyes in VR
+	start = Sys_ProfileTime ();
+	for (i = 0; i < n; i++)
+	{
+		R_LightPointExact (points[i]);
+		R_LightPointExact (points[i]);
+	}
+	exacttime = Sys_ProfileTime () - start;
+
+	start = Sys_ProfileTime ();
+	for (i = 0; i < n; i++)
+	{
+		R_LightPointCached (points[i]);
+		R_LightPointCached (points[i]);
+	}
+	cachedtime = Sys_ProfileTime () - start;
+
+	free (points);
+
+	Con_Printf ("%i points, %i mismatches\n", n, mismatches);
+	Con_Printf ("exact %.3f ms, cached %.3f ms (%i hits, %i misses since map load)\n",
+		exacttime * 1000.0, cachedtime * 1000.0, r_lightcache_hits, r_lightcache_misses);
+}
@@ -97,6 +97,7 @@ cvar_t	r_showtris = {"r_showtris", "0", CVAR_NONE};
 cvar_t	r_showbboxes = {"r_showbboxes", "0", CVAR_NONE};
 cvar_t	r_lerpmodels = {"r_lerpmodels", "1", CVAR_NONE};
 cvar_t	r_lerpmove = {"r_lerpmove", "1", CVAR_NONE};
+cvar_t	r_instancing = {"r_instancing", "1", CVAR_NONE};
 cvar_t	r_nolerp_list = {"r_nolerp_list", "progs/flame.mdl,progs/flame2.mdl,progs/braztall.mdl,progs/brazshrt.mdl,progs/longtrch.mdl,progs/flame_pyre.mdl,progs/v_saw.mdl,progs/v_xfist.mdl,progs/h2stuff/newfire.mdl", CVAR_NONE};
 cvar_t	r_noshadow_list = {"r_noshadow_list", "progs/flame2.mdl,progs/flame.mdl,progs/bolt1.mdl,progs/bolt2.mdl,progs/bolt3.mdl,progs/laser.mdl", CVAR_NONE};
 
@@ -569,7 +570,8 @@ R_SetupView -- johnfitz -- this is the stuff that needs to be done once per fram
 */
 void R_SetupView (void)
 {
-	Fog_SetupFrame (); //johnfitz
+	if (!isHeadless)
+		Fog_SetupFrame (); //johnfitz
 
 // build the transformation matrix for the given view angles
 	VectorCopy (r_refdef.vieworg, r_origin);
@@ -605,9 +607,12 @@ void R_SetupView (void)
 
 	R_CullSurfaces (); //johnfitz -- do after R_SetFrustum and R_MarkSurfaces
 
-	R_UpdateWarpTextures (); //johnfitz -- do this before R_Clear
+	if (!isHeadless)
+	{
+		R_UpdateWarpTextures (); //johnfitz -- do this before R_Clear
 
-	R_Clear ();
+		R_Clear ();
+	}
 
 	//johnfitz -- cheat-protect some draw modes
 	r_drawflat_cheatsafe = r_fullbright_cheatsafe = r_lightmap_cheatsafe = false;
@@ -660,7 +665,8 @@ void R_DrawEntitiesOnList (qboolean alphapass) //johnfitz -- added parameter
 		switch (currententity->model->type)
 		{
 			case mod_alias:
-				R_DrawAliasModel (currententity);
+				if (!R_BatchAliasModel (currententity))
+					R_DrawAliasModel (currententity);
 				break;
 			case mod_brush:
 				R_DrawBrushModel (currententity);
@@ -670,6 +676,8 @@ void R_DrawEntitiesOnList (qboolean alphapass) //johnfitz -- added parameter
 				break;
 		}
 	}
+
+	R_FlushAliasBatches ();
 }
 
 /*
@@ -942,21 +950,31 @@ void R_RenderScene (void)
 
 	Sky_DrawSky (); //johnfitz
 
+	Prof_Begin ("r_world");
 	R_DrawWorld ();
+	Prof_End ();
 
 	S_ExtraUpdate (); // don't let sound get messed up if going slow
 
 	R_DrawShadows (); //johnfitz -- render entity shadows
 
+	Prof_Begin ("r_entities");
 	R_DrawEntitiesOnList (false); //johnfitz -- false means this is the pass for nonalpha entities
+	Prof_End ();
 
+	Prof_Begin ("r_water");
 	R_DrawWorld_Water (); //johnfitz -- drawn here since they might have transparency
+	Prof_End ();
 
+	Prof_Begin ("r_entities");
 	R_DrawEntitiesOnList (true); //johnfitz -- true means this is the pass for alpha entities
+	Prof_End ();
 
 	R_RenderDlights (); //triangle fan dlights -- johnfitz -- moved after water
 
+	Prof_Begin ("r_particles");
 	R_DrawParticles ();
+	Prof_End ();
 
 	Fog_DisableGFog (); //johnfitz
 
@@ -1074,6 +1092,28 @@ void R_ScaleView (void)
 	GL_ClearBindings ();
 }
 
+/*
+================
+R_RenderViewHeadless
+
+-headless has no GL context: run the CPU side of the world refresh --
+PVS marking, culling, texture chains and dynamic lightmaps -- and stop
+short of drawing anything
+================
+*/
+static void R_RenderViewHeadless (void)
+{
+	R_SetupView ();
+
+	Prof_Begin ("r_world");
+	R_PushDlights ();
+	R_AnimateLight ();
+	r_framecount++;
+	if (r_drawworld_cheatsafe)
+		R_BuildLightmapChains (cl.worldmodel, chain_world);
+	Prof_End ();
+}
+
 /*
 ================
 R_RenderView
@@ -1089,6 +1129,12 @@ void R_RenderView (void)
 	if (!cl.worldmodel)
 		Sys_Error ("R_RenderView: NULL worldmodel");
 
+	if (isHeadless)
+	{
+		R_RenderViewHeadless ();
+		return;
+	}
+
 	time1 = 0; /* avoid compiler warning */
 	if (r_speeds.value)
 	{
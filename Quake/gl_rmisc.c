@@ -36,12 +36,16 @@ extern cvar_t gl_overbright;
 extern cvar_t gl_overbright_models;
 extern cvar_t r_waterquality;
 extern cvar_t r_oldwater;
+extern cvar_t r_watershader;
 extern cvar_t r_waterwarp;
 extern cvar_t r_oldskyleaf;
 extern cvar_t r_drawworld;
 extern cvar_t r_showtris;
 extern cvar_t r_showbboxes;
 extern cvar_t r_lerpmodels;
+extern cvar_t r_instancing;
+extern cvar_t r_lightpoint_exact;
+extern cvar_t r_lightmapcache;
 extern cvar_t r_lerpmove;
 extern cvar_t r_nolerp_list;
 extern cvar_t r_noshadow_list;
@@ -81,6 +85,9 @@ static void R_SetClearColor_f (cvar_t *var)
 	byte	*rgb;
 	int		s;
 
+	if (isHeadless)
+		return;
+
 	s = (int)r_clearcolor.value & 0xFF;
 	rgb = (byte*)(d_8to24table + s);
 	glClearColor (rgb[0]/255.0,rgb[1]/255.0,rgb[2]/255.0,0);
@@ -178,6 +185,7 @@ void R_Init (void)
 
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);
+	Cmd_AddCommand ("lightpointtest", R_LightPointTest_f);
 
 	Cvar_RegisterVariable (&r_norefresh);
 	Cvar_RegisterVariable (&r_lightmap);
@@ -210,6 +218,7 @@ void R_Init (void)
 	Cvar_SetCallback (&r_clearcolor, R_SetClearColor_f);
 	Cvar_RegisterVariable (&r_waterquality);
 	Cvar_RegisterVariable (&r_oldwater);
+	Cvar_RegisterVariable (&r_watershader);
 	Cvar_RegisterVariable (&r_waterwarp);
 	Cvar_RegisterVariable (&r_drawflat);
 	Cvar_RegisterVariable (&r_flatlightstyles);
@@ -226,6 +235,9 @@ void R_Init (void)
 	Cvar_RegisterVariable (&gl_overbright_models);
 	Cvar_RegisterVariable (&r_lerpmodels);
 	Cvar_RegisterVariable (&r_lerpmove);
+	Cvar_RegisterVariable (&r_instancing);
+	Cvar_RegisterVariable (&r_lightpoint_exact);
+	Cvar_RegisterVariable (&r_lightmapcache);
 	Cvar_RegisterVariable (&r_nolerp_list);
 	Cvar_SetCallback (&r_nolerp_list, R_Model_ExtraFlags_List_f);
 	Cvar_RegisterVariable (&r_noshadow_list);
@@ -386,6 +398,7 @@ R_NewMap
 void R_NewMap (void)
 {
 	int		i;
+	double	start;
 
 	for (i=0 ; i<256 ; i++)
 		d_lightstylevalue[i] = 264;		// normal light value
@@ -397,9 +410,12 @@ void R_NewMap (void)
 
 	r_viewleaf = NULL;
 	R_ClearParticles ();
+	R_ClearLightCache ();
 
 	GL_BuildLightmaps ();
+	start = Sys_ProfileTime ();
 	GL_BuildBModelVertexBuffer ();
+	Mod_AddLoadStage ("bmodel vbo", start);
 	//ericw -- no longer load alias models into a VBO here, it's done in Mod_LoadAliasModel
 
 	r_framecount = 0; //johnfitz -- paranoid?
@@ -422,7 +438,7 @@ For program optimization
 void R_TimeRefresh_f (void)
 {
 	int		i;
-	float		start, stop, time;
+	double		start, stop, time;
 
 	if (cls.state != ca_connected)
 	{
@@ -430,7 +446,7 @@ void R_TimeRefresh_f (void)
 		return;
 	}
 
-	start = Sys_DoubleTime ();
+	start = Sys_ProfileTime ();
 	for (i = 0; i < 128; i++)
 	{
 		GL_BeginRendering(&glx, &gly, &glwidth, &glheight);
@@ -440,7 +456,7 @@ void R_TimeRefresh_f (void)
 	}
 
 	glFinish ();
-	stop = Sys_DoubleTime ();
+	stop = Sys_ProfileTime ();
 	time = stop-start;
 	Con_Printf ("%f seconds (%f fps)\n", time, 128/time);
 }
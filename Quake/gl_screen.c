@@ -434,6 +434,56 @@ void SCR_Init (void)
 
 //============================================================================
 
+/*
+==============
+SCR_DrawProfile
+
+"host_profile 1" overlay: ms per frame for the slowest profiler scopes, last
+frame and rolling percentiles. Fits above the devstats box.
+==============
+*/
+#define	MAX_PROFLINES	13
+
+static int SCR_CompareProfStats (const void *a, const void *b)
+{
+	float	pa = ((const profstat_t *)a)->p95, pb = ((const profstat_t *)b)->p95;
+
+	return (pa < pb) - (pa > pb);
+}
+
+void SCR_DrawProfile (void)
+{
+	extern cvar_t	host_profile;
+	profstat_t	stats[64];
+	char		str[40];
+	int		i, n, y;
+
+	if (!host_profile.value)
+		return;
+
+	n = Prof_GetStats (stats, sizeof(stats)/sizeof(stats[0]));
+	if (!n)
+		return;
+	qsort (stats, n, sizeof(stats[0]), SCR_CompareProfStats);
+	n = q_min (n, MAX_PROFLINES);
+
+	GL_SetCanvas (CANVAS_BOTTOMLEFT);
+
+	Draw_Fill (0, 0, 36*8, (n+2)*8, 0, 0.5); //dark rectangle
+
+	y = 0;
+	Draw_String (0, y, "scope       | last  p50  p95  p99");
+	y += 8;
+	Draw_String (0, y, "------------+--------------------");
+	y += 8;
+	for (i = 0; i < n; i++, y += 8)
+	{
+		q_snprintf (str, sizeof(str), "%-12.12s|%5.1f%5.1f%5.1f%5.1f",
+			stats[i].name, stats[i].last, stats[i].p50, stats[i].p95, stats[i].p99);
+		Draw_String (0, y, str);
+	}
+}
+
 /*
 ==============
 SCR_DrawFPS -- johnfitz
@@ -1084,11 +1134,14 @@ void SCR_UpdateScreenContent(void)
 			SCR_CheckDrawCenterString();
 			Sbar_Draw();
 			SCR_DrawDevStats(); //johnfitz
+			SCR_DrawProfile ();
 			SCR_DrawFPS(); //johnfitz
 			SCR_DrawClock(); //johnfitz
 			SCR_DrawConsole();
 			M_Draw();
 		}
+
+		Draw_Flush ();
 	}
 
 	V_UpdateBlend(); //johnfitz -- V_UpdatePalette cleaned up and renamed
@@ -1139,7 +1192,16 @@ void SCR_UpdateScreen (void)
 //
 	SCR_SetUpToDrawConsole ();
 
-	if (vr_enabled.value && !con_forcedup)
+	if (isHeadless)
+	{
+		// nothing to draw into, but run the CPU side of the 3D refresh
+		VectorCopy(cl.aimangles, cl.viewangles);
+		VectorCopy(cl.aimangles, r_refdef.viewangles);
+		VectorCopy(cl.aimangles, r_refdef.aimangles);
+
+		V_RenderView ();
+	}
+	else if (vr_enabled.value && !con_forcedup)
 	{
 		VR_UpdateScreenContent(); // phoboslab
 	}
@@ -45,6 +45,7 @@ cvar_t r_fastsky = {"r_fastsky", "0", CVAR_NONE};
 cvar_t r_sky_quality = {"r_sky_quality", "12", CVAR_NONE};
 cvar_t r_skyalpha = {"r_skyalpha", "1", CVAR_NONE};
 cvar_t r_skyfog = {"r_skyfog","0.5",CVAR_NONE};
+cvar_t r_skyshader = {"r_skyshader","1",CVAR_NONE};
 
 int		skytexorder[6] = {0,2,1,3,4,5}; //for skybox
 
@@ -79,6 +80,12 @@ int	vec_to_st[6][3] =
 
 float	skyfog; // ericw
 
+static qboolean	sky_clip;		// Sky_ProcessPoly updates the sky bounds
+static qboolean	sky_testing;	// skytest: mark the slow sky passes in the stencil buffer
+static qboolean	sky_test_pending;
+
+static void Sky_Skytest_f (void);
+
 //==============================================================================
 //
 //  INIT
@@ -318,8 +325,10 @@ void Sky_Init (void)
 	Cvar_RegisterVariable (&r_skyalpha);
 	Cvar_RegisterVariable (&r_skyfog);
 	Cvar_SetCallback (&r_skyfog, R_SetSkyfog_f);
+	Cvar_RegisterVariable (&r_skyshader);
 
 	Cmd_AddCommand ("sky",Sky_SkyCommand_f);
+	Cmd_AddCommand ("skytest",Sky_Skytest_f);
 
 	for (i=0; i<6; i++)
 		skybox_textures[i] = NULL;
@@ -519,7 +528,7 @@ void Sky_ProcessPoly (glpoly_t	*p)
 	rs_brushpasses++;
 
 	//update sky bounds
-	if (!r_fastsky.value)
+	if (sky_clip)
 	{
 		for (i=0 ; i<p->numverts ; i++)
 			VectorSubtract (p->verts[i], r_origin, verts[i]);
@@ -970,20 +979,218 @@ void Sky_DrawSkyLayers (void)
 		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 }
 
+//==============================================================================
+//
+//  SHADER SKY
+//
+//==============================================================================
+
+/*
+The sky polys are drawn once with a shader that works out the skybox or
+cloud layer texcoords per pixel from the view direction, so nothing is
+clipped on the CPU and the sky writes its own depth. The skybox takes one
+pass per face, each discarding the pixels that belong to another face.
+*/
+
+static GLuint r_sky_program;
+
+// uniforms used in vert shader
+static GLuint eyeOriginLoc;
+
+// uniforms used in frag shader
+static GLuint solidTexLoc;
+static GLuint alphaTexLoc;
+static GLuint useSkyBoxLoc;
+static GLuint faceLoc;
+static GLuint boxSTLoc;
+static GLuint layerParamsLoc;
+static GLuint skyFogLoc;
+
+/*
+=============
+GLSky_CreateShaders
+=============
+*/
+void GLSky_CreateShaders (void)
+{
+	const GLchar *vertSource = \
+		"#version 110\n"
+		"\n"
+		"uniform vec3 EyeOrigin;\n"
+		"\n"
+		"varying vec3 Dir;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	Dir = gl_Vertex.xyz - EyeOrigin;\n"
+		"	gl_Position = ftransform();\n" // same depth as the fixed function sky polys
+		"}\n";
+
+	const GLchar *fragSource = \
+		"#version 110\n"
+		"\n"
+		"uniform sampler2D SolidTex;\n"
+		"uniform sampler2D AlphaTex;\n"
+		"uniform bool UseSkyBox;\n"
+		"uniform int Face;\n"
+		"uniform vec4 BoxST;\n"			// xy scale, zw offset to avoid the bilerp seam
+		"uniform vec4 LayerParams;\n"	// x solid scroll, y alpha scroll, z r_skyalpha
+		"uniform vec4 SkyFog;\n"		// rgb fog color, a skyfog
+		"\n"
+		"varying vec3 Dir;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 result;\n"
+		"	if (UseSkyBox)\n"
+		"	{\n"
+		"		vec3 a = abs(Dir);\n"
+		"		vec2 st;\n"
+		"		int face;\n"
+		// same face choice and projection as Sky_ProjectPoly / vec_to_st
+		"		if (a.x > a.y && a.x > a.z)\n"
+		"		{\n"
+		"			if (Dir.x < 0.0) { face = 1; st = vec2(Dir.y, Dir.z) / -Dir.x; }\n"
+		"			else { face = 0; st = vec2(-Dir.y, Dir.z) / Dir.x; }\n"
+		"		}\n"
+		"		else if (a.y > a.z && a.y > a.x)\n"
+		"		{\n"
+		"			if (Dir.y < 0.0) { face = 3; st = vec2(-Dir.x, Dir.z) / -Dir.y; }\n"
+		"			else { face = 2; st = vec2(Dir.x, Dir.z) / Dir.y; }\n"
+		"		}\n"
+		"		else\n"
+		"		{\n"
+		"			if (Dir.z < 0.0) { face = 5; st = vec2(-Dir.y, Dir.x) / -Dir.z; }\n"
+		"			else { face = 4; st = vec2(-Dir.y, -Dir.x) / Dir.z; }\n"
+		"		}\n"
+		"		if (face != Face)\n"
+		"			discard;\n"
+		"		st = (st + 1.0) * 0.5 * BoxST.xy + BoxST.zw;\n"
+		"		result = texture2D(SolidTex, vec2(st.x, 1.0 - st.y));\n"
+		"	}\n"
+		"	else\n"
+		"	{\n"
+		"		vec3 dir = vec3(Dir.xy, Dir.z * 3.0);\n" // flatten the sphere
+		"		vec2 st = dir.xy * (6.0 * 63.0 / length(dir));\n"
+		"		vec4 solid = texture2D(SolidTex, (LayerParams.x + st) * (1.0 / 128.0));\n"
+		"		vec4 alpha = texture2D(AlphaTex, (LayerParams.y + st) * (1.0 / 128.0));\n"
+		"		result = mix(solid, alpha, alpha.a * LayerParams.z);\n"
+		"	}\n"
+		"	gl_FragColor = vec4(mix(result.rgb, SkyFog.rgb, SkyFog.a), 1.0);\n"
+		"}\n";
+
+	if (!gl_glsl_able)
+		return;
+
+	r_sky_program = GL_CreateProgram (vertSource, fragSource, 0, NULL);
+
+	if (r_sky_program != 0)
+	{
+		// get uniform locations
+		eyeOriginLoc = GL_GetUniformLocation (&r_sky_program, "EyeOrigin");
+		solidTexLoc = GL_GetUniformLocation (&r_sky_program, "SolidTex");
+		alphaTexLoc = GL_GetUniformLocation (&r_sky_program, "AlphaTex");
+		useSkyBoxLoc = GL_GetUniformLocation (&r_sky_program, "UseSkyBox");
+		faceLoc = GL_GetUniformLocation (&r_sky_program, "Face");
+		boxSTLoc = GL_GetUniformLocation (&r_sky_program, "BoxST");
+		layerParamsLoc = GL_GetUniformLocation (&r_sky_program, "LayerParams");
+		skyFogLoc = GL_GetUniformLocation (&r_sky_program, "SkyFog");
+	}
+}
+
+/*
+=============
+Sky_LayerScroll -- the scroll part of Sky_GetTexCoord
+=============
+*/
+static float Sky_LayerScroll (float speed)
+{
+	float	scroll;
+
+	scroll = cl.time*speed;
+	scroll -= (int)scroll & ~127;
+	return scroll;
+}
+
 /*
 ==============
-Sky_DrawSky
+Sky_DrawSkyShader
+==============
+*/
+static void Sky_DrawSkyShader (void)
+{
+	float	*c;
+	float	w, h;
+	int		i;
 
-called once per frame before drawing anything else
+	GL_UseProgramFunc (r_sky_program);
+
+	GL_Uniform3fFunc (eyeOriginLoc, r_origin[0], r_origin[1], r_origin[2]);
+	GL_Uniform1iFunc (solidTexLoc, 0);
+	GL_Uniform1iFunc (alphaTexLoc, 1);
+	GL_Uniform4fFunc (layerParamsLoc, Sky_LayerScroll (8), Sky_LayerScroll (16), CLAMP(0.0, r_skyalpha.value, 1.0), 0);
+	if (Fog_GetDensity() > 0 && skyfog > 0)
+	{
+		c = Fog_GetColor();
+		GL_Uniform4fFunc (skyFogLoc, c[0], c[1], c[2], CLAMP(0.0, skyfog, 1.0));
+	}
+	else
+		GL_Uniform4fFunc (skyFogLoc, 0, 0, 0, 0);
+
+	if (skybox_name[0])
+	{
+		GL_Uniform1iFunc (useSkyBoxLoc, 1);
+		for (i=0 ; i<6 ; i++)
+		{
+			GL_Bind (skybox_textures[skytexorder[i]]);
+			w = skybox_textures[skytexorder[i]]->width;
+			h = skybox_textures[skytexorder[i]]->height;
+			GL_Uniform4fFunc (boxSTLoc, (w-1)/w, (h-1)/h, 0.5/w, 0.5/h);
+			GL_Uniform1iFunc (faceLoc, i);
+			Sky_ProcessTextureChains ();
+			Sky_ProcessEntities ();
+			rs_skypasses++;
+		}
+	}
+	else
+	{
+		GL_Uniform1iFunc (useSkyBoxLoc, 0);
+		GL_SelectTexture (GL_TEXTURE1);
+		GL_Bind (alphaskytexture);
+		GL_SelectTexture (GL_TEXTURE0);
+		GL_Bind (solidskytexture);
+		Sky_ProcessTextureChains ();
+		Sky_ProcessEntities ();
+		rs_skypasses++;
+	}
+
+	GL_UseProgramFunc (0);
+}
+
+/*
+==============
+Sky_UseShader
 ==============
 */
-void Sky_DrawSky (void)
+static qboolean Sky_UseShader (void)
 {
-	int				i;
+	return r_sky_program != 0 && r_skyshader.value && !r_fastsky.value && !(Fog_GetDensity() > 0 && skyfog >= 1);
+}
 
-	//in these special render modes, the sky faces are handled in the normal world/brush renderer
-	if (r_drawflat_cheatsafe || r_lightmap_cheatsafe )
-		return;
+//==============================================================================
+//
+//  SKY DRAWING
+//
+//==============================================================================
+
+/*
+==============
+Sky_DrawSkyClipped -- draws the flat sky polys, then the clipped skybox or cloud layers behind them
+==============
+*/
+static void Sky_DrawSkyClipped (void)
+{
+	int				i;
 
 	//
 	// reset sky bounds
@@ -997,7 +1204,7 @@ void Sky_DrawSky (void)
 	//
 	// process world and bmodels: draw flat-shaded sky surfs, and update skybounds
 	//
-	Fog_DisableGFog ();
+	sky_clip = !r_fastsky.value;
 	glDisable (GL_TEXTURE_2D);
 	if (Fog_GetDensity() > 0)
 		glColor3fv (Fog_GetColor());
@@ -1007,6 +1214,7 @@ void Sky_DrawSky (void)
 	Sky_ProcessEntities ();
 	glColor3f (1, 1, 1);
 	glEnable (GL_TEXTURE_2D);
+	sky_clip = false;
 
 	//
 	// render slow sky: cloud layers or skybox
@@ -1015,15 +1223,134 @@ void Sky_DrawSky (void)
 	{
 		glDepthFunc(GL_GEQUAL);
 		glDepthMask(0);
+		if (sky_testing)
+			glEnable (GL_STENCIL_TEST);
 
 		if (skybox_name[0])
 			Sky_DrawSkyBox ();
 		else
 			Sky_DrawSkyLayers();
 
+		if (sky_testing)
+			glDisable (GL_STENCIL_TEST);
 		glDepthMask(1);
 		glDepthFunc(GL_LEQUAL);
 	}
+}
+
+/*
+==============
+Sky_CoverageMask -- draws the sky one way and reads back which pixels it covered
+==============
+*/
+static void Sky_CoverageMask (qboolean shader, const GLint *viewport, byte *mask)
+{
+	glClear (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	glStencilFunc (GL_ALWAYS, 1, 1);
+	glStencilOp (GL_KEEP, GL_KEEP, GL_REPLACE);
+
+	sky_testing = true;
+	if (shader)
+	{
+		glEnable (GL_STENCIL_TEST);
+		Sky_DrawSkyShader ();
+		glDisable (GL_STENCIL_TEST);
+	}
+	else
+		Sky_DrawSkyClipped ();
+	sky_testing = false;
+
+	glReadPixels (viewport[0], viewport[1], viewport[2], viewport[3], GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, mask);
+}
+
+/*
+==============
+Sky_CoverageTest -- compares the sky coverage of the clipped and shader paths for this view
+==============
+*/
+static void Sky_CoverageTest (void)
+{
+	GLint	viewport[4], stencilbits;
+	byte	*clipped, *shader;
+	int		i, size, numclipped, numshader, numdiff;
+
+	sky_test_pending = false;
+
+	glGetIntegerv (GL_STENCIL_BITS, &stencilbits);
+	if (!stencilbits)
+	{
+		Con_Printf ("skytest: no stencil buffer on this framebuffer\n");
+		return;
+	}
+	if (!Sky_UseShader ())
+	{
+		Con_Printf ("skytest: the shader sky is not in use (no GLSL, r_skyshader 0, r_fastsky or full skyfog)\n");
+		return;
+	}
+
+	glGetIntegerv (GL_VIEWPORT, viewport);
+	size = viewport[2] * viewport[3];
+	clipped = (byte *) malloc (size * 2);
+	shader = clipped + size;
+
+	glPixelStorei (GL_PACK_ALIGNMENT, 1);
+	Sky_CoverageMask (false, viewport, clipped);
+	Sky_CoverageMask (true, viewport, shader);
+	glPixelStorei (GL_PACK_ALIGNMENT, 4);
+
+	numclipped = numshader = numdiff = 0;
+	for (i = 0; i < size; i++)
+	{
+		numclipped += clipped[i] & 1;
+		numshader += shader[i] & 1;
+		numdiff += (clipped[i] ^ shader[i]) & 1;
+	}
+	free (clipped);
+
+	Con_Printf ("skytest: %i sky pixels clipped, %i shader, %i differ (%.3f%%) -- %s\n",
+		numclipped, numshader, numdiff, size ? 100.0 * numdiff / size : 0.0, numdiff ? "MISMATCH" : "ok");
+
+	// leave things as R_Clear did for the real sky
+	glClear (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+/*
+==============
+Sky_Skytest_f
+==============
+*/
+static void Sky_Skytest_f (void)
+{
+	if (cls.state != ca_connected)
+	{
+		Con_Printf ("Not connected to a server\n");
+		return;
+	}
+	sky_test_pending = true;
+}
+
+/*
+==============
+Sky_DrawSky
+
+called once per frame before drawing anything else
+==============
+*/
+void Sky_DrawSky (void)
+{
+	//in these special render modes, the sky faces are handled in the normal world/brush renderer
+	if (r_drawflat_cheatsafe || r_lightmap_cheatsafe )
+		return;
+
+	Fog_DisableGFog ();
+
+	if (sky_test_pending)
+		Sky_CoverageTest ();
+
+	if (Sky_UseShader ())
+		Sky_DrawSkyShader ();
+	else
+		Sky_DrawSkyClipped ();
 
 	Fog_EnableGFog ();
 }
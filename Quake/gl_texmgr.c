@@ -31,7 +31,9 @@ static cvar_t	gl_texturemode = {"gl_texturemode", "", CVAR_ARCHIVE};
 static cvar_t	gl_texture_anisotropy = {"gl_texture_anisotropy", "1", CVAR_ARCHIVE};
 static cvar_t	gl_max_size = {"gl_max_size", "0", CVAR_NONE};
 static cvar_t	gl_picmip = {"gl_picmip", "0", CVAR_NONE};
+static cvar_t	gl_texture_async = {"gl_texture_async", "1", CVAR_ARCHIVE};
 static GLint	gl_hardware_maxsize;
+static qboolean	texmgr_sse2;	// use the SSE2 image kernels
 
 #define	MAX_GLTEXTURES	2048
 static int numgltextures;
@@ -94,6 +96,9 @@ TexMgr_SetFilterModes
 */
 static void TexMgr_SetFilterModes (gltexture_t *glt)
 {
+	if (isHeadless)
+		return;
+
 	GL_Bind (glt);
 
 	if (glt->flags & TEXPREF_NEAREST)
@@ -180,7 +185,7 @@ static void TexMgr_Anisotropy_f (cvar_t *var)
 	{
 		Cvar_SetValueQuick (&gl_texture_anisotropy, gl_max_anisotropy);
 	}
-	else
+	else if (!isHeadless)
 	{
 		gltexture_t	*glt;
 		for (glt = active_gltextures; glt; glt = glt->next)
@@ -232,6 +237,12 @@ static void TexMgr_Imagedump_f (void)
 	byte *buffer;
 	char *c;
 
+	if (isHeadless)
+	{
+		Con_Printf ("no texture images in headless mode\n");
+		return;
+	}
+
 	//create directory
 	q_snprintf(dirname, sizeof(dirname), "%s/imagedump", com_gamedir);
 	Sys_mkdir (dirname);
@@ -338,12 +349,16 @@ gltexture_t *TexMgr_NewTexture (void)
 	glt->next = active_gltextures;
 	active_gltextures = glt;
 
-	glGenTextures(1, &glt->texnum);
+	if (!isHeadless)
+		glGenTextures(1, &glt->texnum);
 	numgltextures++;
 	return glt;
 }
 
 static void GL_DeleteTexture (gltexture_t *texture);
+static void TexMgr_CancelJobs (gltexture_t *glt);
+static void TexMgr_Imagetimings_f (void);
+static void TexMgr_Imagebench_f (void);
 
 //ericw -- workaround for preventing TexMgr_FreeTexture during TexMgr_ReloadImages
 static qboolean in_reload_images;
@@ -366,6 +381,8 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 		return;
 	}
 
+	TexMgr_CancelJobs (kill);
+
 	if (active_gltextures == kill)
 	{
 		active_gltextures = kill->next;
@@ -569,6 +586,9 @@ void TexMgr_RecalcWarpImageSize (void)
 	while (gl_warpimagesize > vid.height)
 		gl_warpimagesize >>= 1;
 
+	if (isHeadless)
+		return;
+
 	// ericw -- removed early exit if (gl_warpimagesize == oldsize).
 	// after vid_restart TexMgr_ReloadImage reloads textures
 	// to tx->source_width/source_height, which might not match oldsize.
@@ -607,6 +627,10 @@ void TexMgr_Init (void)
 	static byte nulltexture_data[16] = {127,191,255,255,0,0,0,255,0,0,0,255,127,191,255,255}; //black and blue checker
 	extern texture_t *r_notexture_mip, *r_notexture_mip2;
 
+#ifdef USE_SSE2
+	texmgr_sse2 = (host_parms->cpufeatures & CPU_SSE2) != 0;
+#endif
+
 	// init texture list
 	free_gltextures = (gltexture_t *) Hunk_AllocName (MAX_GLTEXTURES * sizeof(gltexture_t), "gltextures");
 	active_gltextures = NULL;
@@ -620,6 +644,7 @@ void TexMgr_Init (void)
 
 	Cvar_RegisterVariable (&gl_max_size);
 	Cvar_RegisterVariable (&gl_picmip);
+	Cvar_RegisterVariable (&gl_texture_async);
 	Cvar_RegisterVariable (&gl_texture_anisotropy);
 	Cvar_SetCallback (&gl_texture_anisotropy, &TexMgr_Anisotropy_f);
 	gl_texturemode.string = glmodes[glmode_idx].name;
@@ -628,9 +653,14 @@ void TexMgr_Init (void)
 	Cmd_AddCommand ("gl_describetexturemodes", &TexMgr_DescribeTextureModes_f);
 	Cmd_AddCommand ("imagelist", &TexMgr_Imagelist_f);
 	Cmd_AddCommand ("imagedump", &TexMgr_Imagedump_f);
+	Cmd_AddCommand ("imagetimings", &TexMgr_Imagetimings_f);
+	Cmd_AddCommand ("imagebench", &TexMgr_Imagebench_f);
 
 	// poll max size from hardware
-	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &gl_hardware_maxsize);
+	if (isHeadless)
+		gl_hardware_maxsize = 4096;
+	else
+		glGetIntegerv (GL_MAX_TEXTURE_SIZE, &gl_hardware_maxsize);
 
 	// load notexture images
 	notexture = TexMgr_LoadImage (NULL, "notexture", 2, 2, SRC_RGBA, notexture_data, "", (src_offset_t)notexture_data, TEXPREF_NEAREST | TEXPREF_PERSIST | TEXPREF_NOPICMIP);
@@ -693,12 +723,128 @@ int TexMgr_PadConditional (int s)
 		return s;
 }
 
+/*
+================================================================================
+
+	TEXTURE JOBS
+
+	All CPU side image processing (palette conversion, padding, edge fixes,
+	resampling and mipmapping) works on a texjob_t and only on memory owned
+	by it, so it can run on a worker thread. Only TexMgr_UploadJob talks to
+	GL. Outside of a batch jobs are processed and uploaded immediately.
+	Inside TexMgr_BeginBatch/TexMgr_EndBatch, mipmapped textures are
+	processed by the worker threads and uploaded in order by TexMgr_EndBatch.
+
+================================================================================
+*/
+
+enum
+{
+	TEXSTAGE_CONVERT,	// padding, palette conversion, edge fixes
+	TEXSTAGE_RESAMPLE,	// power of two resampling
+	TEXSTAGE_MIPMAP,	// picmip and mipmap generation
+	TEXSTAGE_UPLOAD,
+	NUM_TEXSTAGES
+};
+
+static const char *texstage_names[NUM_TEXSTAGES] = {"convert", "resample", "mipmap", "upload"};
+
+#define	MAX_TEXJOB_ALLOCS	8
+
+typedef struct texjob_s
+{
+	gltexture_t	*glt;		// NULL if the texture was freed before upload
+	byte		*data;		// source pixels
+	qboolean	owndata;	// data is a private copy
+	unsigned int	width, height, flags;	// copied to glt when uploaded
+	unsigned int	source_width, source_height;
+	qboolean	indexed;	// data is 8bit palettized
+	int		picmip;
+	qboolean	nobright;	// gl_fullbrights at submission time
+	byte		*mipdata;	// all mip levels, back to back
+	int		nummips;
+	void		*allocs[MAX_TEXJOB_ALLOCS];
+	int		numallocs;
+	double		stagetime[NUM_TEXSTAGES];
+	struct texjob_s	*next;
+} texjob_t;
+
+static int		texbatch_depth;
+static taskgroup_t	texbatch_tasks;
+static texjob_t		*texbatch_jobs, *texbatch_lastjob;
+
+static struct
+{
+	int	textures;
+	int	batched;
+	double	stagetime[NUM_TEXSTAGES];
+	double	waittime;	// main thread blocked on workers in TexMgr_EndBatch
+} texstats;
+
 /*
 ================
-TexMgr_MipMapW
+TexMgr_JobAlloc -- scratch memory which lives as long as the job
 ================
 */
-static unsigned *TexMgr_MipMapW (unsigned *data, int width, int height)
+static void *TexMgr_JobAlloc (texjob_t *job, size_t size)
+{
+	void *buf;
+
+	if (job->numallocs == MAX_TEXJOB_ALLOCS)
+		Sys_Error ("TexMgr_JobAlloc: too many allocations");
+	buf = malloc (size);
+	if (!buf)
+		Sys_Error ("TexMgr_JobAlloc: failed on allocation of %lu bytes", (unsigned long)size);
+	job->allocs[job->numallocs++] = buf;
+	return buf;
+}
+
+static void TexMgr_FreeJob (texjob_t *job)
+{
+	int i;
+
+	for (i = 0; i < job->numallocs; i++)
+		free (job->allocs[i]);
+	if (job->owndata)
+		free (job->data);
+	free (job);
+}
+
+/*
+================
+TexMgr_CancelJobs -- called when a texture is freed with uploads still pending
+================
+*/
+static void TexMgr_CancelJobs (gltexture_t *glt)
+{
+	texjob_t *job;
+
+	for (job = texbatch_jobs; job; job = job->next)
+	{
+		if (job->glt == glt)
+			job->glt = NULL;
+	}
+}
+
+/*
+================================================================================
+
+	IMAGE KERNELS
+
+	the hot loops of image processing. each has a plain C version, which
+	defines the exact output, and where it pays an SSE2 version which must
+	match it bit for bit ("imagebench" checks this). the SSE2 versions are
+	used when host_parms->cpufeatures has CPU_SSE2.
+
+================================================================================
+*/
+
+/*
+================
+TexMgr_MipMapW_C
+================
+*/
+static void TexMgr_MipMapW_C (unsigned *data, int width, int height)
 {
 	int	i, size;
 	byte	*out, *in;
@@ -713,16 +859,14 @@ static unsigned *TexMgr_MipMapW (unsigned *data, int width, int height)
 		out[2] = (in[2] + in[6])>>1;
 		out[3] = (in[3] + in[7])>>1;
 	}
-
-	return data;
 }
 
 /*
 ================
-TexMgr_MipMapH
+TexMgr_MipMapH_C
 ================
 */
-static unsigned *TexMgr_MipMapH (unsigned *data, int width, int height)
+static void TexMgr_MipMapH_C (unsigned *data, int width, int height)
 {
 	int	i, j;
 	byte	*out, *in;
@@ -741,28 +885,18 @@ static unsigned *TexMgr_MipMapH (unsigned *data, int width, int height)
 			out[3] = (in[3] + in[width+3])>>1;
 		}
 	}
-
-	return data;
 }
 
 /*
 ================
-TexMgr_ResampleTexture -- bilinear resample
+TexMgr_Resample_C -- bilinear resample of in into out
 ================
 */
-static unsigned *TexMgr_ResampleTexture (unsigned *in, int inwidth, int inheight, qboolean alpha)
+static void TexMgr_Resample_C (unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight, qboolean alpha)
 {
 	byte *nwpx, *nepx, *swpx, *sepx, *dest;
 	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump, outjump;
-	unsigned *out;
-	int i, j, outwidth, outheight;
-
-	if (inwidth == TexMgr_Pad(inwidth) && inheight == TexMgr_Pad(inheight))
-		return in;
-
-	outwidth = TexMgr_Pad(inwidth);
-	outheight = TexMgr_Pad(inheight);
-	out = (unsigned *) Hunk_Alloc(outwidth*outheight*4);
+	int i, j;
 
 	xfrac = ((inwidth-1) << 16) / (outwidth-1);
 	yfrac = ((inheight-1) << 16) / (outheight-1);
@@ -800,6 +934,241 @@ static unsigned *TexMgr_ResampleTexture (unsigned *in, int inwidth, int inheight
 		outjump += outwidth;
 		y += yfrac;
 	}
+}
+
+/*
+================
+TexMgr_8to32_C
+================
+*/
+static void TexMgr_8to32_C (byte *in, unsigned *out, int pixels, unsigned int *usepal)
+{
+	int i;
+
+	for (i = 0; i < pixels; i++)
+		*out++ = usepal[*in++];
+}
+
+/*
+================
+TexMgr_8to32_Unrolled -- SSE2 has no gather, but four independent loads per iteration still help
+================
+*/
+static void TexMgr_8to32_Unrolled (byte *in, unsigned *out, int pixels, unsigned int *usepal)
+{
+	int i;
+
+	for (i = 0; i + 4 <= pixels; i += 4, in += 4, out += 4)
+	{
+		unsigned a = usepal[in[0]];
+		unsigned b = usepal[in[1]];
+		unsigned c = usepal[in[2]];
+		unsigned d = usepal[in[3]];
+		out[0] = a;
+		out[1] = b;
+		out[2] = c;
+		out[3] = d;
+	}
+	for ( ; i < pixels; i++)
+		*out++ = usepal[*in++];
+}
+
+#ifdef USE_SSE2
+/*
+================
+TexMgr_Average_SSE2 -- (a + b) >> 1 per byte, without the rounding _mm_avg_epu8 does
+================
+*/
+static inline __m128i TexMgr_Average_SSE2 (__m128i a, __m128i b)
+{
+	return _mm_add_epi8 (_mm_and_si128 (a, b), _mm_and_si128 (_mm_srli_epi16 (_mm_xor_si128 (a, b), 1), _mm_set1_epi8 (0x7f)));
+}
+
+/*
+================
+TexMgr_MipMapW_SSE2 -- eight pixels in, four out. in place is safe, out never passes in
+================
+*/
+static void TexMgr_MipMapW_SSE2 (unsigned *data, int width, int height)
+{
+	int	i, size;
+	unsigned *out, *in;
+	__m128i	a, b, even, odd;
+
+	out = in = data;
+	size = (width*height)>>1;
+
+	for (i = 0; i + 4 <= size; i += 4, out += 4, in += 8)
+	{
+		a = _mm_loadu_si128 ((const __m128i *)in);
+		b = _mm_loadu_si128 ((const __m128i *)(in + 4));
+		even = _mm_unpacklo_epi64 (_mm_shuffle_epi32 (a, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_epi32 (b, _MM_SHUFFLE(2,0,2,0)));
+		odd = _mm_unpacklo_epi64 (_mm_shuffle_epi32 (a, _MM_SHUFFLE(3,1,3,1)), _mm_shuffle_epi32 (b, _MM_SHUFFLE(3,1,3,1)));
+		_mm_storeu_si128 ((__m128i *)out, TexMgr_Average_SSE2 (even, odd));
+	}
+	for ( ; i < size; i++, out++, in += 2)
+	{
+		byte *o = (byte *)out, *p = (byte *)in;
+		o[0] = (p[0] + p[4])>>1;
+		o[1] = (p[1] + p[5])>>1;
+		o[2] = (p[2] + p[6])>>1;
+		o[3] = (p[3] + p[7])>>1;
+	}
+}
+
+/*
+================
+TexMgr_MipMapH_SSE2
+================
+*/
+static void TexMgr_MipMapH_SSE2 (unsigned *data, int width, int height)
+{
+	int	i, j;
+	unsigned *out, *in;
+
+	out = in = data;
+	height>>=1;
+
+	for (i = 0; i < height; i++, in += width)
+	{
+		for (j = 0; j + 4 <= width; j += 4, out += 4, in += 4)
+		{
+			__m128i a = _mm_loadu_si128 ((const __m128i *)in);
+			__m128i b = _mm_loadu_si128 ((const __m128i *)(in + width));
+			_mm_storeu_si128 ((__m128i *)out, TexMgr_Average_SSE2 (a, b));
+		}
+		for ( ; j < width; j++, out++, in++)
+		{
+			byte *o = (byte *)out, *p = (byte *)in, *q = (byte *)(in + width);
+			o[0] = (p[0] + q[0])>>1;
+			o[1] = (p[1] + q[1])>>1;
+			o[2] = (p[2] + q[2])>>1;
+			o[3] = (p[3] + q[3])>>1;
+		}
+	}
+}
+
+/*
+================
+TexMgr_Resample_SSE2
+
+one pixel per iteration, all four channels at once. done in float, which
+is exact here: every product and partial sum is an integer below 2^24.
+================
+*/
+static void TexMgr_Resample_SSE2 (unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight, qboolean alpha)
+{
+	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump;
+	unsigned *nwpx, *dest;
+	int i, j;
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i alphamask = _mm_set_epi32 (0, 0, 0, alpha ? 0 : (int)0xff000000);
+	__m128i nw, ne, sw, se, pix;
+	__m128 fmody, fimody, sum;
+
+	xfrac = ((inwidth-1) << 16) / (outwidth-1);
+	yfrac = ((inheight-1) << 16) / (outheight-1);
+	y = 0;
+	dest = out;
+
+	for (i = 0; i < outheight; i++)
+	{
+		mody = (y>>8) & 0xFF;
+		imody = 256 - mody;
+		injump = (y>>16) * inwidth;
+		fmody = _mm_set1_ps ((float)mody);
+		fimody = _mm_set1_ps ((float)imody);
+		x = 0;
+
+		for (j = 0; j < outwidth; j++, dest++)
+		{
+			modx = (x>>8) & 0xFF;
+			imodx = 256 - modx;
+
+			nwpx = in + (x>>16) + injump;
+			nw = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)nwpx), zero);	// nw and ne
+			sw = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(nwpx + inwidth)), zero);	// sw and se
+			ne = _mm_unpackhi_epi16 (nw, zero);
+			nw = _mm_unpacklo_epi16 (nw, zero);
+			se = _mm_unpackhi_epi16 (sw, zero);
+			sw = _mm_unpacklo_epi16 (sw, zero);
+
+			sum = _mm_mul_ps (_mm_cvtepi32_ps (nw), _mm_mul_ps (_mm_set1_ps ((float)imodx), fimody));
+			sum = _mm_add_ps (sum, _mm_mul_ps (_mm_cvtepi32_ps (ne), _mm_mul_ps (_mm_set1_ps ((float)modx), fimody)));
+			sum = _mm_add_ps (sum, _mm_mul_ps (_mm_cvtepi32_ps (sw), _mm_mul_ps (_mm_set1_ps ((float)imodx), fmody)));
+			sum = _mm_add_ps (sum, _mm_mul_ps (_mm_cvtepi32_ps (se), _mm_mul_ps (_mm_set1_ps ((float)modx), fmody)));
+
+			pix = _mm_srli_epi32 (_mm_cvttps_epi32 (sum), 16);
+			pix = _mm_packs_epi32 (pix, pix);
+			pix = _mm_packus_epi16 (pix, pix);
+			if (!alpha)
+				pix = _mm_or_si128 (_mm_and_si128 (pix, _mm_set_epi32 (0, 0, 0, 0x00ffffff)), alphamask);
+			*dest = (unsigned) _mm_cvtsi128_si32 (pix);
+
+			x += xfrac;
+		}
+		y += yfrac;
+	}
+}
+#endif /* USE_SSE2 */
+
+/*
+================
+TexMgr_MipMapW
+================
+*/
+static unsigned *TexMgr_MipMapW (unsigned *data, int width, int height)
+{
+#ifdef USE_SSE2
+	if (texmgr_sse2)
+		TexMgr_MipMapW_SSE2 (data, width, height);
+	else
+#endif
+	TexMgr_MipMapW_C (data, width, height);
+
+	return data;
+}
+
+/*
+================
+TexMgr_MipMapH
+================
+*/
+static unsigned *TexMgr_MipMapH (unsigned *data, int width, int height)
+{
+#ifdef USE_SSE2
+	if (texmgr_sse2)
+		TexMgr_MipMapH_SSE2 (data, width, height);
+	else
+#endif
+	TexMgr_MipMapH_C (data, width, height);
+
+	return data;
+}
+
+/*
+================
+TexMgr_ResampleTexture -- bilinear resample
+================
+*/
+static unsigned *TexMgr_ResampleTexture (texjob_t *job, unsigned *in, int inwidth, int inheight, qboolean alpha)
+{
+	unsigned *out;
+	int outwidth, outheight;
+
+	if (inwidth == TexMgr_Pad(inwidth) && inheight == TexMgr_Pad(inheight))
+		return in;
+
+	outwidth = TexMgr_Pad(inwidth);
+	outheight = TexMgr_Pad(inheight);
+	out = (unsigned *) TexMgr_JobAlloc(job, outwidth*outheight*4);
+
+#ifdef USE_SSE2
+	if (texmgr_sse2)
+		TexMgr_Resample_SSE2 (in, inwidth, inheight, out, outwidth, outheight, alpha);
+	else
+#endif
+	TexMgr_Resample_C (in, inwidth, inheight, out, outwidth, outheight, alpha);
 
 	return out;
 }
@@ -939,15 +1308,12 @@ static void TexMgr_PadEdgeFixH (byte *data, int width, int height)
 TexMgr_8to32
 ================
 */
-static unsigned *TexMgr_8to32 (byte *in, int pixels, unsigned int *usepal)
+static unsigned *TexMgr_8to32 (texjob_t *job, byte *in, int pixels, unsigned int *usepal)
 {
-	int i;
-	unsigned *out, *data;
+	unsigned *data;
 
-	out = data = (unsigned *) Hunk_Alloc(pixels*4);
-
-	for (i = 0; i < pixels; i++)
-		*out++ = usepal[*in++];
+	data = (unsigned *) TexMgr_JobAlloc(job, pixels*4);
+	TexMgr_8to32_Unrolled (in, data, pixels, usepal);
 
 	return data;
 }
@@ -957,7 +1323,7 @@ static unsigned *TexMgr_8to32 (byte *in, int pixels, unsigned int *usepal)
 TexMgr_PadImageW -- return image with width padded up to power-of-two dimentions
 ================
 */
-static byte *TexMgr_PadImageW (byte *in, int width, int height, byte padbyte)
+static byte *TexMgr_PadImageW (texjob_t *job, byte *in, int width, int height, byte padbyte)
 {
 	int i, j, outwidth;
 	byte *out, *data;
@@ -967,7 +1333,7 @@ static byte *TexMgr_PadImageW (byte *in, int width, int height, byte padbyte)
 
 	outwidth = TexMgr_Pad(width);
 
-	out = data = (byte *) Hunk_Alloc(outwidth*height);
+	out = data = (byte *) TexMgr_JobAlloc(job, outwidth*height);
 
 	for (i = 0; i < height; i++)
 	{
@@ -985,7 +1351,7 @@ static byte *TexMgr_PadImageW (byte *in, int width, int height, byte padbyte)
 TexMgr_PadImageH -- return image with height padded up to power-of-two dimentions
 ================
 */
-static byte *TexMgr_PadImageH (byte *in, int width, int height, byte padbyte)
+static byte *TexMgr_PadImageH (texjob_t *job, byte *in, int width, int height, byte padbyte)
 {
 	int i, srcpix, dstpix;
 	byte *data, *out;
@@ -996,7 +1362,7 @@ static byte *TexMgr_PadImageH (byte *in, int width, int height, byte padbyte)
 	srcpix = width * height;
 	dstpix = width * TexMgr_Pad(height);
 
-	out = data = (byte *) Hunk_Alloc(dstpix);
+	out = data = (byte *) TexMgr_JobAlloc(job, dstpix);
 
 	for (i = 0; i < srcpix; i++)
 		*out++ = *in++;
@@ -1008,123 +1374,142 @@ static byte *TexMgr_PadImageH (byte *in, int width, int height, byte padbyte)
 
 /*
 ================
-TexMgr_LoadImage32 -- handles 32bit source data
+TexMgr_BuildMips -- handles 32bit data: resamples, applies picmip and builds the mip chain
 ================
 */
-static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
+static void TexMgr_BuildMips (texjob_t *job, unsigned *data)
 {
-	int	internalformat,	miplevel, mipwidth, mipheight, picmip;
+	int	mipwidth, mipheight, size, level;
+	byte	*in, *out;
+	double	time;
 
 	if (!gl_texture_NPOT)
 	{
 		// resample up
-		data = TexMgr_ResampleTexture (data, glt->width, glt->height, glt->flags & TEXPREF_ALPHA);
-		glt->width = TexMgr_Pad(glt->width);
-		glt->height = TexMgr_Pad(glt->height);
+		time = Sys_ProfileTime ();
+		data = TexMgr_ResampleTexture (job, data, job->width, job->height, job->flags & TEXPREF_ALPHA);
+		job->width = TexMgr_Pad(job->width);
+		job->height = TexMgr_Pad(job->height);
+		job->stagetime[TEXSTAGE_RESAMPLE] += Sys_ProfileTime () - time;
 	}
 
+	time = Sys_ProfileTime ();
+
 	// mipmap down
-	picmip = (glt->flags & TEXPREF_NOPICMIP) ? 0 : q_max((int)gl_picmip.value, 0);
-	mipwidth = TexMgr_SafeTextureSize (glt->width >> picmip);
-	mipheight = TexMgr_SafeTextureSize (glt->height >> picmip);
-	while ((int) glt->width > mipwidth)
+	mipwidth = TexMgr_SafeTextureSize (job->width >> job->picmip);
+	mipheight = TexMgr_SafeTextureSize (job->height >> job->picmip);
+	if ((int) job->width > mipwidth || (int) job->height > mipheight)
 	{
-		TexMgr_MipMapW (data, glt->width, glt->height);
-		glt->width >>= 1;
-		if (glt->flags & TEXPREF_ALPHA)
-			TexMgr_AlphaEdgeFix ((byte *)data, glt->width, glt->height);
+		// don't scribble over the caller's pixels
+		if ((byte *)data == job->data && !job->owndata)
+		{
+			data = (unsigned *) memcpy (TexMgr_JobAlloc(job, job->width*job->height*4), data, job->width*job->height*4);
+		}
+		while ((int) job->width > mipwidth)
+		{
+			TexMgr_MipMapW (data, job->width, job->height);
+			job->width >>= 1;
+			if (job->flags & TEXPREF_ALPHA)
+				TexMgr_AlphaEdgeFix ((byte *)data, job->width, job->height);
+		}
+		while ((int) job->height > mipheight)
+		{
+			TexMgr_MipMapH (data, job->width, job->height);
+			job->height >>= 1;
+			if (job->flags & TEXPREF_ALPHA)
+				TexMgr_AlphaEdgeFix ((byte *)data, job->width, job->height);
+		}
 	}
-	while ((int) glt->height > mipheight)
+
+	if (!(job->flags & TEXPREF_MIPMAP))
 	{
-		TexMgr_MipMapH (data, glt->width, glt->height);
-		glt->height >>= 1;
-		if (glt->flags & TEXPREF_ALPHA)
-			TexMgr_AlphaEdgeFix ((byte *)data, glt->width, glt->height);
+		job->mipdata = (byte *)data;
+		job->nummips = 1;
+		job->stagetime[TEXSTAGE_MIPMAP] += Sys_ProfileTime () - time;
+		return;
 	}
 
-	// upload
-	GL_Bind (glt);
-	internalformat = (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
-	glTexImage2D (GL_TEXTURE_2D, 0, internalformat, glt->width, glt->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-	// upload mipmaps
-	if (glt->flags & TEXPREF_MIPMAP)
+	// size the mip chain
+	mipwidth = job->width;
+	mipheight = job->height;
+	size = mipwidth * mipheight * 4;
+	for (job->nummips = 1; mipwidth > 1 || mipheight > 1; job->nummips++)
 	{
-		mipwidth = glt->width;
-		mipheight = glt->height;
+		mipwidth = q_max(mipwidth >> 1, 1);
+		mipheight = q_max(mipheight >> 1, 1);
+		size += mipwidth * mipheight * 4;
+	}
 
-		for (miplevel=1; mipwidth > 1 || mipheight > 1; miplevel++)
+	// each level is mipped in place from a copy of the one above it
+	job->mipdata = (byte *) TexMgr_JobAlloc (job, size);
+	memcpy (job->mipdata, data, job->width * job->height * 4);
+	mipwidth = job->width;
+	mipheight = job->height;
+	in = job->mipdata;
+	for (level = 1; level < job->nummips; level++)
+	{
+		out = in + mipwidth * mipheight * 4;
+		memcpy (out, in, mipwidth * mipheight * 4);
+		if (mipwidth > 1)
 		{
-			if (mipwidth > 1)
-			{
-				TexMgr_MipMapW (data, mipwidth, mipheight);
-				mipwidth >>= 1;
-			}
-			if (mipheight > 1)
-			{
-				TexMgr_MipMapH (data, mipwidth, mipheight);
-				mipheight >>= 1;
-			}
-			glTexImage2D (GL_TEXTURE_2D, miplevel, internalformat, mipwidth, mipheight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+			TexMgr_MipMapW ((unsigned *)out, mipwidth, mipheight);
+			mipwidth >>= 1;
+		}
+		if (mipheight > 1)
+		{
+			TexMgr_MipMapH ((unsigned *)out, mipwidth, mipheight);
+			mipheight >>= 1;
 		}
+		in = out;
 	}
 
-	// set filter modes
-	TexMgr_SetFilterModes (glt);
+	job->stagetime[TEXSTAGE_MIPMAP] += Sys_ProfileTime () - time;
 }
 
 /*
 ================
-TexMgr_LoadImage8 -- handles 8bit source data, then passes it to LoadImage32
+TexMgr_ConvertImage8 -- handles 8bit source data, then passes it to BuildMips
 ================
 */
-static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
+static void TexMgr_ConvertImage8 (texjob_t *job)
 {
-	extern cvar_t gl_fullbrights;
 	qboolean padw = false, padh = false;
-	byte padbyte;
+	byte padbyte, *data;
 	unsigned int *usepal;
 	int i;
+	double time;
 
-	// HACK HACK HACK -- taken from tomazquake
-	if (strstr(glt->name, "shot1sid") &&
-	    glt->width == 32 && glt->height == 32 &&
-	    CRC_Block(data, 1024) == 65393)
-	{
-		// This texture in b_shell1.bsp has some of the first 32 pixels painted white.
-		// They are invisible in software, but look really ugly in GL. So we just copy
-		// 32 pixels from the bottom to make it look nice.
-		memcpy (data, data + 32*31, 32);
-	}
+	time = Sys_ProfileTime ();
+	data = job->data;
 
 	// detect false alpha cases
-	if (glt->flags & TEXPREF_ALPHA && !(glt->flags & TEXPREF_CONCHARS))
+	if (job->flags & TEXPREF_ALPHA && !(job->flags & TEXPREF_CONCHARS))
 	{
-		for (i = 0; i < (int) (glt->width * glt->height); i++)
+		for (i = 0; i < (int) (job->width * job->height); i++)
 			if (data[i] == 255) //transparent index
 				break;
-		if (i == (int) (glt->width * glt->height))
-			glt->flags -= TEXPREF_ALPHA;
+		if (i == (int) (job->width * job->height))
+			job->flags -= TEXPREF_ALPHA;
 	}
 
 	// choose palette and padbyte
-	if (glt->flags & TEXPREF_FULLBRIGHT)
+	if (job->flags & TEXPREF_FULLBRIGHT)
 	{
-		if (glt->flags & TEXPREF_ALPHA)
+		if (job->flags & TEXPREF_ALPHA)
 			usepal = d_8to24table_fbright_fence;
 		else
 			usepal = d_8to24table_fbright;
 		padbyte = 0;
 	}
-	else if (glt->flags & TEXPREF_NOBRIGHT && gl_fullbrights.value)
+	else if (job->flags & TEXPREF_NOBRIGHT && job->nobright)
 	{
-		if (glt->flags & TEXPREF_ALPHA)
+		if (job->flags & TEXPREF_ALPHA)
 			usepal = d_8to24table_nobright_fence;
 		else
 			usepal = d_8to24table_nobright;
 		padbyte = 0;
 	}
-	else if (glt->flags & TEXPREF_CONCHARS)
+	else if (job->flags & TEXPREF_CONCHARS)
 	{
 		usepal = d_8to24table_conchars;
 		padbyte = 0;
@@ -1136,38 +1521,396 @@ static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
 	}
 
 	// pad each dimention, but only if it's not going to be downsampled later
-	if (glt->flags & TEXPREF_PAD)
+	if (job->flags & TEXPREF_PAD)
 	{
-		if ((int) glt->width < TexMgr_SafeTextureSize(glt->width))
+		if ((int) job->width < TexMgr_SafeTextureSize(job->width))
 		{
-			data = TexMgr_PadImageW (data, glt->width, glt->height, padbyte);
-			glt->width = TexMgr_Pad(glt->width);
+			data = TexMgr_PadImageW (job, data, job->width, job->height, padbyte);
+			job->width = TexMgr_Pad(job->width);
 			padw = true;
 		}
-		if ((int) glt->height < TexMgr_SafeTextureSize(glt->height))
+		if ((int) job->height < TexMgr_SafeTextureSize(job->height))
 		{
-			data = TexMgr_PadImageH (data, glt->width, glt->height, padbyte);
-			glt->height = TexMgr_Pad(glt->height);
+			data = TexMgr_PadImageH (job, data, job->width, job->height, padbyte);
+			job->height = TexMgr_Pad(job->height);
 			padh = true;
 		}
 	}
 
 	// convert to 32bit
-	data = (byte *)TexMgr_8to32(data, glt->width * glt->height, usepal);
+	data = (byte *)TexMgr_8to32(job, data, job->width * job->height, usepal);
 
 	// fix edges
-	if (glt->flags & TEXPREF_ALPHA)
-		TexMgr_AlphaEdgeFix (data, glt->width, glt->height);
+	if (job->flags & TEXPREF_ALPHA)
+		TexMgr_AlphaEdgeFix (data, job->width, job->height);
 	else
 	{
 		if (padw)
-			TexMgr_PadEdgeFixW (data, glt->source_width, glt->source_height);
+			TexMgr_PadEdgeFixW (data, job->source_width, job->source_height);
 		if (padh)
-			TexMgr_PadEdgeFixH (data, glt->source_width, glt->source_height);
+			TexMgr_PadEdgeFixH (data, job->source_width, job->source_height);
 	}
 
-	// upload it
-	TexMgr_LoadImage32 (glt, (unsigned *)data);
+	job->stagetime[TEXSTAGE_CONVERT] += Sys_ProfileTime () - time;
+
+	TexMgr_BuildMips (job, (unsigned *)data);
+}
+
+/*
+================
+TexMgr_ProcessJob -- all CPU side work, safe to run on a worker thread
+================
+*/
+static void TexMgr_ProcessJob (void *data)
+{
+	texjob_t *job = (texjob_t *) data;
+
+	if (job->indexed)
+		TexMgr_ConvertImage8 (job);
+	else
+		TexMgr_BuildMips (job, (unsigned *)job->data);
+}
+
+/*
+================
+TexMgr_UploadJob -- GL side of a job, main thread only
+================
+*/
+static void TexMgr_UploadJob (texjob_t *job)
+{
+	gltexture_t *glt = job->glt;
+	int internalformat, level, mipwidth, mipheight;
+	byte *data;
+	double time;
+
+	if (!glt)
+		return;	// freed while the job was pending
+
+	time = Sys_ProfileTime ();
+
+	glt->width = job->width;
+	glt->height = job->height;
+	glt->flags = job->flags;
+
+	GL_Bind (glt);
+	internalformat = (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
+
+	data = job->mipdata;
+	mipwidth = glt->width;
+	mipheight = glt->height;
+	for (level = 0; level < job->nummips; level++)
+	{
+		glTexImage2D (GL_TEXTURE_2D, level, internalformat, mipwidth, mipheight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		data += mipwidth * mipheight * 4;
+		mipwidth = q_max(mipwidth >> 1, 1);
+		mipheight = q_max(mipheight >> 1, 1);
+	}
+
+	// set filter modes
+	TexMgr_SetFilterModes (glt);
+
+	job->stagetime[TEXSTAGE_UPLOAD] += Sys_ProfileTime () - time;
+}
+
+static void TexMgr_AccumulateStats (texjob_t *job)
+{
+	int i;
+
+	texstats.textures++;
+	for (i = 0; i < NUM_TEXSTAGES; i++)
+		texstats.stagetime[i] += job->stagetime[i];
+}
+
+/*
+================
+TexMgr_LoadImageData -- processes and uploads 8 or 32 bit data for glt, possibly deferred
+================
+*/
+static void TexMgr_LoadImageData (gltexture_t *glt, byte *data)
+{
+	extern cvar_t gl_fullbrights;
+	texjob_t *job;
+	size_t size;
+
+	job = (texjob_t *) calloc (1, sizeof(texjob_t));
+	if (!job)
+		Sys_Error ("TexMgr_LoadImageData: out of memory");
+	job->glt = glt;
+	job->data = data;
+	job->width = glt->width;
+	job->height = glt->height;
+	job->flags = glt->flags;
+	job->source_width = glt->source_width;
+	job->source_height = glt->source_height;
+	job->picmip = (glt->flags & TEXPREF_NOPICMIP) ? 0 : q_max((int)gl_picmip.value, 0);
+	job->nobright = (gl_fullbrights.value != 0);
+
+	if (glt->source_format == SRC_INDEXED)
+	{
+		job->indexed = true;
+
+		// HACK HACK HACK -- taken from tomazquake
+		if (strstr(glt->name, "shot1sid") &&
+		    glt->width == 32 && glt->height == 32 &&
+		    CRC_Block(data, 1024) == 65393)
+		{
+			// This texture in b_shell1.bsp has some of the first 32 pixels painted white.
+			// They are invisible in software, but look really ugly in GL. So we just copy
+			// 32 pixels from the bottom to make it look nice.
+			memcpy (data, data + 32*31, 32);
+		}
+	}
+
+	if (texbatch_depth && (glt->flags & TEXPREF_MIPMAP) && gl_texture_async.value)
+	{
+		// the caller's buffer is usually gone by the time the batch ends
+		size = glt->width * glt->height;
+		if (glt->source_format == SRC_RGBA)
+			size *= 4;
+		job->data = (byte *) malloc (size);
+		if (!job->data)
+			Sys_Error ("TexMgr_LoadImageData: out of memory");
+		memcpy (job->data, data, size);
+		job->owndata = true;
+
+		if (texbatch_lastjob)
+			texbatch_lastjob->next = job;
+		else
+			texbatch_jobs = job;
+		texbatch_lastjob = job;
+		texstats.batched++;
+
+		Task_Add (&texbatch_tasks, TexMgr_ProcessJob, job);
+		return;
+	}
+
+	TexMgr_ProcessJob (job);
+	TexMgr_UploadJob (job);
+	TexMgr_AccumulateStats (job);
+	TexMgr_FreeJob (job);
+}
+
+/*
+================
+TexMgr_BeginBatch
+
+textures loaded until the matching TexMgr_EndBatch may be processed on
+worker threads; their gltexture_t can be handed out, but must not be drawn
+with until the batch ends. batches nest.
+================
+*/
+void TexMgr_BeginBatch (void)
+{
+	texbatch_depth++;
+}
+
+/*
+================
+TexMgr_EndBatch -- waits for the workers and uploads everything in the batch
+================
+*/
+void TexMgr_EndBatch (void)
+{
+	texjob_t *job, *next;
+	double time;
+
+	if (texbatch_depth <= 0)
+		Sys_Error ("TexMgr_EndBatch without TexMgr_BeginBatch");
+	if (--texbatch_depth)
+		return;
+
+	time = Sys_ProfileTime ();
+	Task_Wait (&texbatch_tasks);
+	texstats.waittime += Sys_ProfileTime () - time;
+
+	for (job = texbatch_jobs; job; job = next)
+	{
+		next = job->next;
+		TexMgr_UploadJob (job);
+		TexMgr_AccumulateStats (job);
+		TexMgr_FreeJob (job);
+	}
+	texbatch_jobs = texbatch_lastjob = NULL;
+}
+
+/*
+===============
+TexMgr_BenchKernel -- runs kernel over copies of src until a quarter second passes, returns MPixels/s
+===============
+*/
+typedef void (*imagekernel_t) (unsigned *src, unsigned *dst, int width, int height);
+
+static double TexMgr_BenchKernel (imagekernel_t kernel, unsigned *src, unsigned *dst, int width, int height, int pixels)
+{
+	double start, elapsed;
+	int runs = 0;
+
+	start = Sys_ProfileTime ();
+	do
+	{
+		kernel (src, dst, width, height);
+		runs++;
+		elapsed = Sys_ProfileTime () - start;
+	} while (elapsed < 0.25);
+
+	return (double)pixels * runs / elapsed / 1000000.0;
+}
+
+#define	BENCH_W	509	// odd and NPOT on purpose, to hit the tails and the resampler
+#define	BENCH_H	251
+#define	BENCH_RW	512
+#define	BENCH_RH	256
+
+static unsigned int bench_pal[256];
+
+static void Bench_MipMapW_C (unsigned *src, unsigned *dst, int w, int h) {memcpy (dst, src, w*h*4); TexMgr_MipMapW_C (dst, w-1, h);}
+static void Bench_MipMapH_C (unsigned *src, unsigned *dst, int w, int h) {memcpy (dst, src, w*h*4); TexMgr_MipMapH_C (dst, w, h-1);}
+static void Bench_Resample_C (unsigned *src, unsigned *dst, int w, int h) {TexMgr_Resample_C (src, w, h, dst, BENCH_RW, BENCH_RH, true);}
+static void Bench_ResampleNoAlpha_C (unsigned *src, unsigned *dst, int w, int h) {TexMgr_Resample_C (src, w, h, dst, BENCH_RW, BENCH_RH, false);}
+static void Bench_8to32_C (unsigned *src, unsigned *dst, int w, int h) {TexMgr_8to32_C ((byte *)src, dst, w*h, bench_pal);}
+static void Bench_8to32 (unsigned *src, unsigned *dst, int w, int h) {TexMgr_8to32_Unrolled ((byte *)src, dst, w*h, bench_pal);}
+#ifdef USE_SSE2
+#define	SSE2_KERNEL(k)	k
+static void Bench_MipMapW_SSE2 (unsigned *src, unsigned *dst, int w, int h) {memcpy (dst, src, w*h*4); TexMgr_MipMapW_SSE2 (dst, w-1, h);}
+static void Bench_MipMapH_SSE2 (unsigned *src, unsigned *dst, int w, int h) {memcpy (dst, src, w*h*4); TexMgr_MipMapH_SSE2 (dst, w, h-1);}
+static void Bench_Resample_SSE2 (unsigned *src, unsigned *dst, int w, int h) {TexMgr_Resample_SSE2 (src, w, h, dst, BENCH_RW, BENCH_RH, true);}
+static void Bench_ResampleNoAlpha_SSE2 (unsigned *src, unsigned *dst, int w, int h) {TexMgr_Resample_SSE2 (src, w, h, dst, BENCH_RW, BENCH_RH, false);}
+#else
+#define	SSE2_KERNEL(k)	NULL
+#endif
+
+static void Bench_TGA_C (unsigned *src, unsigned *dst, int w, int h) {Image_BGRAtoRGBA ((byte *)dst, (byte *)src, w*h, 32, false);}
+static void Bench_TGA24_C (unsigned *src, unsigned *dst, int w, int h) {Image_BGRAtoRGBA ((byte *)dst, (byte *)src, w*h, 24, false);}
+static void Bench_TGA (unsigned *src, unsigned *dst, int w, int h) {Image_BGRAtoRGBA ((byte *)dst, (byte *)src, w*h, 32, true);}
+static void Bench_TGA24 (unsigned *src, unsigned *dst, int w, int h) {Image_BGRAtoRGBA ((byte *)dst, (byte *)src, w*h, 24, true);}
+
+/*
+===============
+TexMgr_Imagebench_f -- checks the fast image kernels against the C ones and times both
+===============
+*/
+static void TexMgr_Imagebench_f (void)
+{
+	static const struct
+	{
+		const char	*name;
+		imagekernel_t	reference, fast;
+		qboolean	sse2;
+		int		outpixels;	// compared output size; also the rate's pixel count
+	} kernels[] =
+	{
+		{"mipmapw",	Bench_MipMapW_C,	SSE2_KERNEL(Bench_MipMapW_SSE2),	true,	BENCH_W * BENCH_H},
+		{"mipmaph",	Bench_MipMapH_C,	SSE2_KERNEL(Bench_MipMapH_SSE2),	true,	BENCH_W * BENCH_H},
+		{"resample",	Bench_Resample_C,	SSE2_KERNEL(Bench_Resample_SSE2),	true,	BENCH_RW * BENCH_RH},
+		{"resample_na",	Bench_ResampleNoAlpha_C,	SSE2_KERNEL(Bench_ResampleNoAlpha_SSE2),	true,	BENCH_RW * BENCH_RH},
+		{"8to32",	Bench_8to32_C,		Bench_8to32,	false,	BENCH_W * BENCH_H},
+		{"tga32",	Bench_TGA_C,		Bench_TGA,	false,	BENCH_W * BENCH_H},
+		{"tga24",	Bench_TGA24_C,		Bench_TGA24,	false,	BENCH_W * BENCH_H},
+	};
+	imagekernel_t fast;
+	unsigned *src, *ref, *out;
+	int i, k, trial, size, mismatches;
+	double reftime, fasttime;
+
+	// the resampler reads one row and pixel past the source, like it always has
+	size = (BENCH_W * (BENCH_H + 1) + 1) * 4;
+	src = (unsigned *) malloc (size);
+	size = q_max(BENCH_W * BENCH_H, BENCH_RW * BENCH_RH) * 4;
+	ref = (unsigned *) malloc (size);
+	out = (unsigned *) malloc (size);
+	if (!src || !ref || !out)
+	{
+		Con_Printf ("imagebench: out of memory\n");
+		free (src); free (ref); free (out);
+		return;
+	}
+
+	srand (1234);
+	for (i = 0; i < 256; i++)
+		bench_pal[i] = (unsigned)rand() ^ ((unsigned)rand() << 16);
+
+	Con_Printf ("SSE2 %s\n", texmgr_sse2 ? "enabled" : "disabled");
+	Con_Printf ("kernel        C MP/s  fast MP/s  result\n");
+	for (k = 0; k < (int)(sizeof(kernels)/sizeof(kernels[0])); k++)
+	{
+		fast = kernels[k].fast;
+		if (kernels[k].sse2 && !texmgr_sse2)
+			fast = NULL;
+		if (!fast)
+		{
+			Con_Printf ("%-12s  (no fast version on this CPU)\n", kernels[k].name);
+			continue;
+		}
+
+		// bit exactness over a few random images, including fully random alpha
+		mismatches = 0;
+		for (trial = 0; trial < 8; trial++)
+		{
+			for (i = 0; i < BENCH_W * (BENCH_H + 1) + 1; i++)
+				src[i] = (unsigned)rand() ^ ((unsigned)rand() << 16);
+			if (trial == 1)	// extremes
+				for (i = 0; i < BENCH_W * (BENCH_H + 1) + 1; i++)
+					src[i] = (i & 1) ? 0xffffffff : 0;
+			memset (ref, 0, size);
+			memset (out, 0xcd, size);
+			kernels[k].reference (src, ref, BENCH_W, BENCH_H);
+			fast (src, out, BENCH_W, BENCH_H);
+			if (memcmp (ref, out, kernels[k].outpixels * 4))
+				mismatches++;
+		}
+
+		reftime = TexMgr_BenchKernel (kernels[k].reference, src, ref, BENCH_W, BENCH_H, kernels[k].outpixels);
+		fasttime = TexMgr_BenchKernel (fast, src, out, BENCH_W, BENCH_H, kernels[k].outpixels);
+		Con_Printf ("%-12s %8.1f   %8.1f  %s\n", kernels[k].name, reftime, fasttime,
+			mismatches ? va("MISMATCH in %i/8", mismatches) : "ok");
+	}
+
+	free (src);
+	free (ref);
+	free (out);
+}
+
+/*
+================
+TexMgr_AbortBatch -- closes all open batches when an error unwinds past TexMgr_EndBatch
+================
+*/
+void TexMgr_AbortBatch (void)
+{
+	if (texbatch_depth)
+	{
+		texbatch_depth = 1;
+		TexMgr_EndBatch ();
+	}
+}
+
+/*
+===============
+TexMgr_Imagetimings_f -- report where texture loading time went
+===============
+*/
+static void TexMgr_Imagetimings_f (void)
+{
+	int i;
+	double cpu;
+
+	if (Cmd_Argc() == 2 && !q_strcasecmp(Cmd_Argv(1), "reset"))
+	{
+		memset (&texstats, 0, sizeof(texstats));
+		return;
+	}
+
+	Con_Printf ("%i textures, %i processed on %i worker threads\n", texstats.textures, texstats.batched, Tasks_NumWorkers());
+	cpu = 0;
+	for (i = 0; i < NUM_TEXSTAGES; i++)
+	{
+		Con_Printf ("%10s: %8.2f ms\n", texstage_names[i], texstats.stagetime[i] * 1000.0);
+		if (i != TEXSTAGE_UPLOAD)
+			cpu += texstats.stagetime[i];
+	}
+	Con_Printf ("%10s: %8.2f ms (all threads)\n", "cpu total", cpu * 1000.0);
+	Con_Printf ("%10s: %8.2f ms (main thread waiting on workers)\n", "wait", texstats.waittime * 1000.0);
+	Con_Printf ("use \"imagetimings reset\" before loading a map to time it\n");
 }
 
 /*
@@ -1195,7 +1938,6 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 {
 	unsigned short crc;
 	gltexture_t *glt;
-	int mark;
 
 	if (isDedicated)
 		return NULL;
@@ -1238,23 +1980,15 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 	glt->source_height = height;
 	glt->source_crc = crc;
 
-	//upload it
-	mark = Hunk_LowMark();
+	// headless: keep the record for the renderer, there is nothing to upload to
+	if (isHeadless)
+		return glt;
 
-	switch (glt->source_format)
-	{
-	case SRC_INDEXED:
-		TexMgr_LoadImage8 (glt, data);
-		break;
-	case SRC_LIGHTMAP:
+	//upload it
+	if (glt->source_format == SRC_LIGHTMAP)
 		TexMgr_LoadLightmap (glt, data);
-		break;
-	case SRC_RGBA:
-		TexMgr_LoadImage32 (glt, (unsigned *)data);
-		break;
-	}
-
-	Hunk_FreeToLowMark(mark);
+	else
+		TexMgr_LoadImageData (glt, data);
 
 	return glt;
 }
@@ -1277,6 +2011,9 @@ void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants)
 	byte	translation[256];
 	byte	*src, *dst, *data = NULL, *translated;
 	int	mark, size, i;
+
+	if (isHeadless)
+		return;
 //
 // get source data
 //
@@ -1374,18 +2111,10 @@ invalid:
 //
 // upload it
 //
-	switch (glt->source_format)
-	{
-	case SRC_INDEXED:
-		TexMgr_LoadImage8 (glt, data);
-		break;
-	case SRC_LIGHTMAP:
+	if (glt->source_format == SRC_LIGHTMAP)
 		TexMgr_LoadLightmap (glt, data);
-		break;
-	case SRC_RGBA:
-		TexMgr_LoadImage32 (glt, (unsigned *)data);
-		break;
-	}
+	else
+		TexMgr_LoadImageData (glt, data);
 
 	Hunk_FreeToLowMark(mark);
 }
@@ -1409,11 +2138,13 @@ void TexMgr_ReloadImages (void)
 // switching to a boolean flag.
 	in_reload_images = true;
 
+	TexMgr_BeginBatch ();
 	for (glt = active_gltextures; glt; glt = glt->next)
 	{
 		glGenTextures(1, &glt->texnum);
 		TexMgr_ReloadImage (glt, -1, -1);
 	}
+	TexMgr_EndBatch ();
 	
 	in_reload_images = false;
 }
@@ -1516,7 +2247,8 @@ from our per-TMU cached texture binding table.
 */
 static void GL_DeleteTexture (gltexture_t *texture)
 {
-	glDeleteTextures (1, &texture->texnum);
+	if (!isHeadless)
+		glDeleteTextures (1, &texture->texnum);
 
 	if (texture->texnum == currenttexture[0]) currenttexture[0] = GL_UNUSED_TEXTURE;
 	if (texture->texnum == currenttexture[1]) currenttexture[1] = GL_UNUSED_TEXTURE;
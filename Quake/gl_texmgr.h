@@ -93,6 +93,9 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants);
 void TexMgr_ReloadImages (void);
 void TexMgr_ReloadNobrightImages (void);
+void TexMgr_BeginBatch (void); //mipmapped images are processed on worker threads...
+void TexMgr_EndBatch (void); //...and uploaded here
+void TexMgr_AbortBatch (void);
 
 int TexMgr_Pad(int s);
 int TexMgr_SafeTextureSize (int s);
@@ -109,6 +109,7 @@ qboolean gl_glsl_able = false; //ericw
 GLint gl_max_texture_units = 0; //ericw
 qboolean gl_glsl_gamma_able = false; //ericw
 qboolean gl_glsl_alias_able = false; //ericw
+qboolean gl_instanced_arrays_able = false;
 int gl_stencilbits;
 
 PFNGLMULTITEXCOORD2FARBPROC GL_MTexCoord2fFunc = NULL; //johnfitz
@@ -143,6 +144,8 @@ QS_PFNGLUNIFORM1IPROC GL_Uniform1iFunc = NULL; //ericw
 QS_PFNGLUNIFORM1FPROC GL_Uniform1fFunc = NULL; //ericw
 QS_PFNGLUNIFORM3FPROC GL_Uniform3fFunc = NULL; //ericw
 QS_PFNGLUNIFORM4FPROC GL_Uniform4fFunc = NULL; //ericw
+QS_PFNGLVERTEXATTRIBDIVISORPROC GL_VertexAttribDivisorFunc = NULL;
+QS_PFNGLDRAWELEMENTSINSTANCEDPROC GL_DrawElementsInstancedFunc = NULL;
 
 //====================================
 
@@ -467,6 +470,8 @@ VID_HasMouseOrInputFocus
 */
 qboolean VID_HasMouseOrInputFocus (void)
 {
+	if (isHeadless)
+		return true;	// don't throttle the main loop
 #if defined(USE_SDL2)
 	return (SDL_GetWindowFlags(draw_context) & (SDL_WINDOW_MOUSE_FOCUS | SDL_WINDOW_INPUT_FOCUS)) != 0;
 #else
@@ -481,6 +486,8 @@ VID_IsMinimized
 */
 qboolean VID_IsMinimized (void)
 {
+	if (isHeadless)
+		return false;	// keep running the refresh
 #if defined(USE_SDL2)
 	return !(SDL_GetWindowFlags(draw_context) & SDL_WINDOW_SHOWN);
 #else
@@ -779,7 +786,7 @@ static void VID_Restart (void)
 	int width, height, refreshrate, bpp;
 	qboolean fullscreen;
 
-	if (vid_locked || !vid_changed)
+	if (vid_locked || !vid_changed || isHeadless)
 		return;
 
 	if (vr_enabled.value)
@@ -814,6 +821,8 @@ static void VID_Restart (void)
 	R_DeleteShaders ();
 	GL_DeleteBModelVertexBuffer ();
 	GLMesh_DeleteVertexBuffers ();
+	R_DeleteParticleBuffer ();
+	R_DeleteAliasInstanceBuffer ();
 
 //
 // set new mode
@@ -863,7 +872,7 @@ static void VID_Test (void)
 {
 	int old_width, old_height, old_refreshrate, old_bpp, old_fullscreen;
 
-	if (vid_locked || !vid_changed)
+	if (vid_locked || !vid_changed || isHeadless)
 		return;
 //
 // now try the switch
@@ -1275,6 +1284,35 @@ static void GL_CheckExtensions (void)
 	{
 		Con_Warning ("GLSL alias model rendering not available, using Fitz renderer\n");
 	}
+
+	// ARB_instanced_arrays, for drawing many copies of an alias model at once
+	//
+	if (COM_CheckParm("-noinstancing"))
+		Con_Warning ("Instanced alias models disabled at command line\n");
+	else if (gl_glsl_alias_able && ((gl_version_major == 3 && gl_version_minor >= 3) || gl_version_major > 3 ||
+		GL_ParseExtensionList(gl_extensions, "GL_ARB_instanced_arrays")))
+	{
+		GL_VertexAttribDivisorFunc = (QS_PFNGLVERTEXATTRIBDIVISORPROC) SDL_GL_GetProcAddress("glVertexAttribDivisorARB");
+		GL_DrawElementsInstancedFunc = (QS_PFNGLDRAWELEMENTSINSTANCEDPROC) SDL_GL_GetProcAddress("glDrawElementsInstancedARB");
+		if (!GL_VertexAttribDivisorFunc || !GL_DrawElementsInstancedFunc)
+		{
+			GL_VertexAttribDivisorFunc = (QS_PFNGLVERTEXATTRIBDIVISORPROC) SDL_GL_GetProcAddress("glVertexAttribDivisor");
+			GL_DrawElementsInstancedFunc = (QS_PFNGLDRAWELEMENTSINSTANCEDPROC) SDL_GL_GetProcAddress("glDrawElementsInstanced");
+		}
+		if (GL_VertexAttribDivisorFunc && GL_DrawElementsInstancedFunc)
+		{
+			Con_Printf("FOUND: ARB_instanced_arrays\n");
+			gl_instanced_arrays_able = true;
+		}
+		else
+		{
+			Con_Warning ("ARB_instanced_arrays not available\n");
+		}
+	}
+	else
+	{
+		Con_Warning ("ARB_instanced_arrays not available\n");
+	}
 }
 
 /*
@@ -1353,6 +1391,8 @@ static void GL_Init (void)
 
 	GLAlias_CreateShaders ();
 	GLWorld_CreateShaders ();
+	GLSky_CreateShaders ();
+	GLWarp_CreateShaders ();
 	GL_ClearBufferBindings ();	
 }
 
@@ -1375,7 +1415,7 @@ GL_EndRendering
 */
 void GL_EndRendering (void)
 {
-	if (!scr_skipupdate)
+	if (!scr_skipupdate && !isHeadless)
 	{
 #if defined(USE_SDL2)
 		SDL_GL_SwapWindow(draw_context);
@@ -1572,6 +1612,44 @@ static void VID_InitModelist (void)
 #endif /* !defined(USE_SDL2) */
 }
 
+/*
+===================
+VID_InitHeadless
+
+-headless: no window and no GL context, the GL capability flags all stay
+off. vid is sized from -width/-height so the refresh culls as it would in
+a window of that size.
+===================
+*/
+static void VID_InitHeadless (void)
+{
+	int		p;
+
+	vid.width = 640;
+	vid.height = 480;
+
+	p = COM_CheckParm("-width");
+	if (p && p < com_argc-1)
+		vid.width = q_max (320, Q_atoi(com_argv[p+1]));
+	p = COM_CheckParm("-height");
+	if (p && p < com_argc-1)
+		vid.height = q_max (200, Q_atoi(com_argv[p+1]));
+
+	vid.conwidth = vid.width & 0xFFFFFFF8;
+	vid.conheight = vid.conwidth * vid.height / vid.width;
+	vid.numpages = 2;
+	vid.maxwarpwidth = WARP_WIDTH;
+	vid.maxwarpheight = WARP_HEIGHT;
+	vid.colormap = host_colormap;
+	vid.fullbright = 256 - LittleLong (*((int *)vid.colormap + 2048));
+	vid.recalc_refdef = 1;
+
+	modestate = MS_WINDOWED;
+	vid_changed = false;
+
+	Con_SafePrintf ("Headless, no video (%dx%d)\n", vid.width, vid.height);
+}
+
 /*
 ===================
 VID_Init
@@ -1619,6 +1697,12 @@ void	VID_Init (void)
 	Cmd_AddCommand ("vid_describecurrentmode", VID_DescribeCurrentMode_f);
 	Cmd_AddCommand ("vid_describemodes", VID_DescribeModes_f);
 
+	if (isHeadless)
+	{
+		VID_InitHeadless ();
+		return;
+	}
+
 	putenv (vid_center);	/* SDL_putenv is problematic in versions <= 1.2.9 */
 
 	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
@@ -27,6 +27,7 @@ extern cvar_t r_drawflat;
 cvar_t r_oldwater = {"r_oldwater", "1", CVAR_ARCHIVE};
 cvar_t r_waterquality = {"r_waterquality", "8", CVAR_NONE};
 cvar_t r_waterwarp = {"r_waterwarp", "1", CVAR_NONE};
+cvar_t r_watershader = {"r_watershader", "1", CVAR_NONE};
 
 int gl_warpimagesize;
 float load_subdivide_size; //johnfitz -- remember what subdivide_size value was when this map was loaded
@@ -270,3 +271,122 @@ void R_UpdateWarpTextures (void)
 	//if viewsize is less than 100, we need to redraw the frame around the viewport
 	scr_tileclear_updates = 0;
 }
+
+//==============================================================================
+//
+//  SHADER WATER
+//
+//==============================================================================
+
+/*
+The fragment shader applies the WARPCALC turbulence per pixel to the
+undivided poly, so the surface needs no subdivision and no warpimage.
+turbsin[] is 8*sin(), indexed so that the angle is t*pi/64 + time.
+*/
+
+static GLuint r_water_program;
+
+// uniforms used in frag shader
+static GLuint waterTexLoc;
+static GLuint waterTimeLoc;
+static GLuint waterAlphaLoc;
+
+/*
+=============
+GLWarp_CreateShaders
+=============
+*/
+void GLWarp_CreateShaders (void)
+{
+	const GLchar *vertSource = \
+		"#version 110\n"
+		"\n"
+		"varying float FogFragCoord;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	gl_TexCoord[0] = gl_MultiTexCoord0 * 128.0;\n" // undo the 1/128 from Mod_PolyForUnlitSurface
+		"	gl_Position = ftransform();\n"
+		"	FogFragCoord = gl_Position.w;\n"
+		"}\n";
+
+	const GLchar *fragSource = \
+		"#version 110\n"
+		"\n"
+		"uniform sampler2D Tex;\n"
+		"uniform float Time;\n"
+		"uniform float Alpha;\n"
+		"\n"
+		"varying float FogFragCoord;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 st = gl_TexCoord[0].xy;\n"
+		"	st = (st + 8.0 * sin(st.yx * (3.14159265 / 64.0) + Time)) * (1.0 / 64.0);\n"
+		"	vec4 result = texture2D(Tex, st);\n"
+		"	float fog = exp(-gl_Fog.density * gl_Fog.density * FogFragCoord * FogFragCoord);\n"
+		"	fog = clamp(fog, 0.0, 1.0);\n"
+		"	result = mix(gl_Fog.color, result, fog);\n"
+		"	result.a = Alpha;\n"
+		"	gl_FragColor = result;\n"
+		"}\n";
+
+	if (!gl_glsl_able)
+		return;
+
+	r_water_program = GL_CreateProgram (vertSource, fragSource, 0, NULL);
+
+	if (r_water_program != 0)
+	{
+		// get uniform locations
+		waterTexLoc = GL_GetUniformLocation (&r_water_program, "Tex");
+		waterTimeLoc = GL_GetUniformLocation (&r_water_program, "Time");
+		waterAlphaLoc = GL_GetUniformLocation (&r_water_program, "Alpha");
+	}
+}
+
+/*
+=============
+GLWarp_SubdivideAtLoad -- false if the water shader will draw the surfaces being loaded
+=============
+*/
+qboolean GLWarp_SubdivideAtLoad (void)
+{
+	return !(r_water_program != 0 && r_watershader.value);
+}
+
+/*
+=============
+GLWarp_UseShader
+
+Surfaces loaded without subdivision can only be drawn with the shader,
+so they keep using it even if r_watershader is turned off afterwards.
+=============
+*/
+qboolean GLWarp_UseShader (msurface_t *s)
+{
+	return r_water_program != 0 && (r_watershader.value || !s->polys->next);
+}
+
+/*
+=============
+GLWarp_BeginShader
+=============
+*/
+void GLWarp_BeginShader (float alpha)
+{
+	GL_UseProgramFunc (r_water_program);
+	GL_Uniform1iFunc (waterTexLoc, 0);
+	GL_Uniform1fFunc (waterTimeLoc, fmod (cl.time, 2 * M_PI));
+	GL_Uniform1fFunc (waterAlphaLoc, CLAMP(0.0, alpha, 1.0));
+}
+
+/*
+=============
+GLWarp_EndShader
+=============
+*/
+void GLWarp_EndShader (void)
+{
+	GL_UseProgramFunc (0);
+}
@@ -85,19 +85,6 @@ typedef enum {
 	pt_static, pt_grav, pt_slowgrav, pt_fire, pt_explode, pt_explode2, pt_blob, pt_blob2
 } ptype_t;
 
-// !!! if this is changed, it must be changed in d_ifacea.h too !!!
-typedef struct particle_s
-{
-// driver-usable fields
-	vec3_t		org;
-	float		color;
-// drivers never touch the following fields
-	struct particle_s	*next;
-	vec3_t		vel;
-	float		ramp;
-	float		die;
-	ptype_t		type;
-} particle_t;
 
 
 //====================================================
@@ -235,6 +222,13 @@ extern	qboolean	gl_glsl_gamma_able;
 extern	qboolean	gl_glsl_alias_able;
 // ericw --
 
+// ARB_instanced_arrays
+typedef void (APIENTRYP QS_PFNGLVERTEXATTRIBDIVISORPROC) (GLuint index, GLuint divisor);
+typedef void (APIENTRYP QS_PFNGLDRAWELEMENTSINSTANCEDPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei primcount);
+extern QS_PFNGLVERTEXATTRIBDIVISORPROC GL_VertexAttribDivisorFunc;
+extern QS_PFNGLDRAWELEMENTSINSTANCEDPROC GL_DrawElementsInstancedFunc;
+extern	qboolean	gl_instanced_arrays_able;
+
 //ericw -- NPOT texture support
 extern	qboolean	gl_texture_NPOT;
 
@@ -324,6 +318,7 @@ void R_NewGame (void);
 void R_AnimateLight (void);
 void R_MarkSurfaces (void);
 void R_CullSurfaces (void);
+void R_BuildLightmapChains (qmodel_t *model, texchain_t chain);
 qboolean R_CullBox (vec3_t emins, vec3_t emaxs);
 void R_StoreEfrags (efrag_t **ppefrag);
 qboolean R_CullModelForEntity (entity_t *e);
@@ -334,6 +329,7 @@ void R_InitParticles (void);
 void R_DrawParticles (void);
 void CL_RunParticles (void);
 void R_ClearParticles (void);
+void R_DeleteParticleBuffer (void);
 
 void R_TranslatePlayerSkin (int playernum);
 void R_TranslateNewPlayerSkin (int playernum); //johnfitz -- this handles cases when the actual texture changes
@@ -341,6 +337,9 @@ void R_UpdateWarpTextures (void);
 
 void R_DrawWorld (void);
 void R_DrawAliasModel (entity_t *e);
+qboolean R_BatchAliasModel (entity_t *e);
+void R_FlushAliasBatches (void);
+void R_DeleteAliasInstanceBuffer (void);
 void R_DrawBrushModel (entity_t *e);
 void R_DrawSpriteModel (entity_t *e);
 
@@ -355,6 +354,8 @@ void GLMesh_DeleteVertexBuffers (void);
 void R_RebuildAllLightmaps (void);
 
 int R_LightPoint (vec3_t p);
+void R_ClearLightCache (void);
+void R_LightPointTest_f (void);
 
 void GL_SubdivideSurface (msurface_t *fa);
 void R_BuildLightMap (msurface_t *surf, byte *dest, int stride);
@@ -371,6 +372,12 @@ GLuint GL_CreateProgram (const GLchar *vertSource, const GLchar *fragSource, int
 void R_DeleteShaders (void);
 
 void GLWorld_CreateShaders (void);
+void GLSky_CreateShaders (void);
+void GLWarp_CreateShaders (void);
+qboolean GLWarp_SubdivideAtLoad (void);
+qboolean GLWarp_UseShader (msurface_t *s);
+void GLWarp_BeginShader (float alpha);
+void GLWarp_EndShader (void);
 void GLAlias_CreateShaders (void);
 void GL_DrawAliasShadow (entity_t *e);
 void DrawGLTriangleFan (glpoly_t *p);
@@ -383,6 +390,7 @@ void Sky_DrawSky (void);
 void Sky_NewMap (void);
 void Sky_LoadTexture (texture_t *mt);
 void Sky_LoadSkyBox (const char *name);
+extern char skybox_name[32];
 
 void TexMgr_RecalcWarpImageSize (void);
 
@@ -50,6 +50,18 @@ int		host_framecount;
 
 int		host_hunklevel;
 
+qboolean	host_fixedtick;		// local server is stepped at host_tickrate
+static double	host_tickaccum;	// time not yet consumed by server ticks
+static float	host_tickfrac;	// host_tickaccum in ticks, as seen by the client
+
+static taskgroup_t	host_servertask;	// server frame running on a worker
+static int		host_serverticks;	// ticks for the server task to run
+static jmp_buf		host_serverabort;	// Host_Error on the server task
+static char		host_servererror[1024];
+static unsigned long	host_servertaskthread;	// SDL_threadID running Host_ServerTask
+
+static void Host_JoinServerFrame (void);
+
 int		minimum_memory;
 
 client_t	*host_client;			// current client
@@ -62,6 +74,8 @@ cvar_t	host_framerate = {"host_framerate","0",CVAR_NONE};	// set for slow motion
 cvar_t	host_speeds = {"host_speeds","0",CVAR_NONE};			// set for running times
 cvar_t	host_maxfps = {"host_maxfps", "72", CVAR_ARCHIVE}; //johnfitz
 cvar_t	host_timescale = {"host_timescale", "0", CVAR_NONE}; //johnfitz
+cvar_t	host_tickrate = {"host_tickrate", "72", CVAR_ARCHIVE}; // fixed server tick in VR, 0 = one tick per frame
+cvar_t	host_serverthread = {"host_serverthread", "0", CVAR_ARCHIVE}; // run the local server alongside rendering
 cvar_t	max_edicts = {"max_edicts", "8192", CVAR_NONE}; //johnfitz //ericw -- changed from 2048 to 8192, removed CVAR_ARCHIVE
 
 cvar_t	sys_ticrate = {"sys_ticrate","0.05",CVAR_NONE}; // dedicated server
@@ -125,6 +139,8 @@ void Host_EndGame (const char *message, ...)
 	va_end (argptr);
 	Con_DPrintf ("Host_EndGame: %s\n",string);
 
+	TexMgr_AbortBatch ();
+
 	if (sv.active)
 		Host_ShutdownServer (false);
 
@@ -152,11 +168,23 @@ void Host_Error (const char *error, ...)
 	char		string[1024];
 	static	qboolean inerror = false;
 
+	// on the server task, hand the error over to the main thread
+	if (Host_InServerTask ())
+	{
+		va_start (argptr,error);
+		q_vsnprintf (host_servererror, sizeof(host_servererror), error, argptr);
+		va_end (argptr);
+		longjmp (host_serverabort, 1);
+	}
+
 	if (inerror)
 		Sys_Error ("Host_Error: recursively entered");
 	inerror = true;
 
+	Host_JoinServerFrame ();
+
 	SCR_EndLoadingPlaque ();		// reenable screen updates
+	TexMgr_AbortBatch ();
 
 	va_start (argptr,error);
 	q_vsnprintf (string, sizeof(string), error, argptr);
@@ -190,10 +218,10 @@ void	Host_FindMaxClients (void)
 	svs.maxclients = 1;
 
 	i = COM_CheckParm ("-dedicated");
-	if (i)
+	if (i || isDedicated)	// the server build is dedicated without asking
 	{
 		cls.state = ca_dedicated;
-		if (i != (com_argc - 1))
+		if (i && i != (com_argc - 1))
 		{
 			svs.maxclients = Q_atoi (com_argv[i+1]);
 		}
@@ -259,6 +287,8 @@ void Host_InitLocal (void)
 	Cvar_RegisterVariable (&host_maxfps); //johnfitz
 	Cvar_SetCallback (&host_maxfps, Max_Fps_f);
 	Cvar_RegisterVariable (&host_timescale); //johnfitz
+	Cvar_RegisterVariable (&host_tickrate);
+	Cvar_RegisterVariable (&host_serverthread);
 
 	Cvar_RegisterVariable (&max_edicts); //johnfitz
 	Cvar_SetCallback (&max_edicts, Max_Edicts_f);
@@ -473,6 +503,8 @@ void Host_ShutdownServer(qboolean crash)
 	byte		message[4];
 	double	start;
 
+	Host_JoinServerFrame ();
+
 	if (!sv.active)
 		return;
 
@@ -614,6 +646,36 @@ void Host_GetConsoleCommands (void)
 	}
 }
 
+/*
+==================
+Host_TickRate
+
+Returns the fixed server tick rate, or 0 if the local server should run
+once per frame.  Only used in VR, where the frame rate follows the headset
+refresh rate instead of host_maxfps.
+==================
+*/
+static float Host_TickRate (void)
+{
+	if (!vr_enabled.value || host_tickrate.value <= 0)
+		return 0;
+	if (cls.timedemo || host_framerate.value > 0)
+		return 0;
+	return CLAMP (10.0, host_tickrate.value, 1000.0);
+}
+
+/*
+==================
+Host_TickFraction
+
+How far the client is between the last two fixed server ticks, 0..1
+==================
+*/
+float Host_TickFraction (void)
+{
+	return CLAMP (0.0, host_tickfrac, 1.0);
+}
+
 /*
 ==================
 Host_ServerFrame
@@ -624,8 +686,10 @@ void Host_ServerFrame (void)
 	int		i, active; //johnfitz
 	edict_t	*ent; //johnfitz
 
+	Prof_Begin ("server");
+
 // run the world state
-	pr_global_struct->frametime = host_frametime;
+	pr_global_struct->frametime = sv_frametime;
 
 // set the time and clear the general datagram
 	SV_ClearDatagram ();
@@ -634,12 +698,16 @@ void Host_ServerFrame (void)
 	SV_CheckForNewClients ();
 
 // read client messages
+	Prof_Begin ("sv_clients");
 	SV_RunClients ();
+	Prof_End ();
 
 // move things around and think
 // always pause in single player if in console or menus
+	Prof_Begin ("sv_physics");
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game) )
 		SV_Physics ();
+	Prof_End ();
 
 //johnfitz -- devstats
 	if (cls.signon == SIGNONS)
@@ -658,7 +726,187 @@ void Host_ServerFrame (void)
 //johnfitz
 
 // send all messages to the clients
+	Prof_Begin ("sv_send");
 	SV_SendClientMessages ();
+	Prof_End ();
+
+	Prof_End ();	// "server"
+}
+
+/*
+==================
+Host_ScheduleServerTicks
+
+Decides how many times the local server runs this frame: once per frame,
+or in VR at a fixed host_tickrate with an accumulator so physics doesn't
+depend on the headset refresh rate. Sets sv_frametime for the ticks. The
+client interpolates between ticks with Host_TickFraction.
+==================
+*/
+#define MAX_SERVER_TICKS	4	// per frame, before giving up on catching up
+
+static int Host_ScheduleServerTicks (qboolean threaded)
+{
+	float	tickrate = Host_TickRate ();
+	double	tick;
+	int		ticks;
+
+	SV_LatchVRInput ();
+
+	host_fixedtick = (tickrate > 0);
+	if (!host_fixedtick)
+	{
+		host_tickaccum = 0;
+		host_tickfrac = 1;
+		sv_frametime = host_frametime;
+		return 1;
+	}
+
+	// a threaded server delivers this frame's ticks to the client a
+	// frame late, so the client interpolates with last frame's leftover
+	if (threaded)
+		host_tickfrac = host_tickaccum * tickrate;
+
+	tick = 1.0 / tickrate;
+	host_tickaccum += host_frametime;
+	for (ticks = 0; host_tickaccum >= tick && ticks < MAX_SERVER_TICKS; ticks++)
+		host_tickaccum -= tick;
+	if (host_tickaccum >= tick)
+		host_tickaccum = 0;	// too far behind, drop the time instead of spiralling
+
+	if (!threaded)
+		host_tickfrac = host_tickaccum * tickrate;
+
+	sv_frametime = tick;
+	return ticks;
+}
+
+/*
+==================
+Host_ServerThreaded
+
+host_serverthread runs the local server on a worker while the main thread
+renders. Only while in game: loading, signon and map changes stay serial.
+==================
+*/
+static qboolean Host_ServerThreaded (void)
+{
+	extern cvar_t r_showbboxes;	// draws server edicts
+
+	return host_serverthread.value && Tasks_NumWorkers () > 0 &&
+		cls.signon == SIGNONS && !r_showbboxes.value;
+}
+
+/*
+==================
+Host_InServerTask
+
+True on the thread running Host_ServerTask, whether a worker or the
+main thread joining it. Console output, errors and QuakeC cvar sets are
+handed to the main thread from there.
+==================
+*/
+qboolean Host_InServerTask (void)
+{
+	return host_servertaskthread && host_servertaskthread == SDL_ThreadID ();
+}
+
+/*
+==================
+Host_ServerTask
+
+Task side of host_serverthread, usually on a worker but on the main thread
+if it joins before a worker took it. Console output is deferred by
+Con_Printf, and a Host_Error lands here to be raised again on the main
+thread by Host_WaitServerFrame.
+==================
+*/
+static void Host_ServerTask (void *unused)
+{
+	int	profdepth = Prof_Depth ();
+
+	host_servertaskthread = SDL_ThreadID ();
+	if (setjmp (host_serverabort))
+	{
+		Prof_Unwind (profdepth);
+		host_servertaskthread = 0;
+		return;
+	}
+
+	while (host_serverticks-- > 0)
+		Host_ServerFrame ();
+	host_servertaskthread = 0;
+}
+
+/*
+==================
+Host_JoinServerFrame
+
+Waits for a threaded server frame, if one is running. Main thread only.
+==================
+*/
+static void Host_JoinServerFrame (void)
+{
+	if (!host_servertask.pending)
+		return;
+	Task_Wait (&host_servertask);
+	Con_FlushDeferred ();
+	PR_ApplyLatchedCvars ();
+}
+
+/*
+==================
+Host_WaitServerFrame
+
+Joins the threaded server frame and raises any error it hit
+==================
+*/
+static void Host_WaitServerFrame (void)
+{
+	char	error[sizeof(host_servererror)];
+
+	Host_JoinServerFrame ();
+	if (!host_servererror[0])
+		return;
+	q_strlcpy (error, host_servererror, sizeof(error));
+	host_servererror[0] = 0;
+	Host_Error ("%s", error);
+}
+
+/*
+==================
+Host_RunServer
+
+Runs this frame's server ticks, or when threaded only schedules them for
+Host_StartServerFrame.
+==================
+*/
+static void Host_RunServer (qboolean threaded)
+{
+	int	ticks = Host_ScheduleServerTicks (threaded);
+
+	if (threaded)
+	{
+		host_serverticks = ticks;
+		return;
+	}
+	while (ticks-- > 0)
+		Host_ServerFrame ();
+}
+
+/*
+==================
+Host_StartServerFrame
+
+Starts the scheduled ticks on a worker, overlapping rendering. They are
+joined at the start of the next frame; until then the main thread must not
+touch server state or the loopback connection.
+==================
+*/
+static void Host_StartServerFrame (void)
+{
+	if (host_serverticks > 0)
+		Task_Add (&host_servertask, Host_ServerTask, NULL);
 }
 
 /*
@@ -670,10 +918,7 @@ Runs all active servers
 */
 void _Host_Frame (float time)
 {
-	static double		time1 = 0;
-	static double		time2 = 0;
-	static double		time3 = 0;
-	int			pass1, pass2, pass3;
+	qboolean		serverthread;
 
 	if (setjmp (host_abortserver) )
 		return;			// something bad happened, or the server disconnected
@@ -685,22 +930,35 @@ void _Host_Frame (float time)
 	if (!Host_FilterTime (time))
 		return;			// don't run too fast, or packets will flood out
 
+	Prof_BeginFrame ();
+
+// finish the server frame that ran alongside the last render
+	Prof_Begin ("server wait");
+	Host_WaitServerFrame ();
+	Prof_End ();
+
 // get new key events
+	Prof_Begin ("input");
 	Key_UpdateForDest ();
 	IN_UpdateInputMode ();
 	Sys_SendKeyEvents ();
 
 // allow mice or other external controllers to add commands
 	IN_Commands ();
+	Prof_End ();
 
 // process console commands
+	Prof_Begin ("commands");
 	Cbuf_Execute ();
+	Prof_End ();
 
+	Prof_Begin ("net");
 	NET_Poll();
 
 // if running the server locally, make intentions now
 	if (sv.active)
 		CL_SendCmd ();
+	Prof_End ();
 
 //-------------------
 //
@@ -711,8 +969,12 @@ void _Host_Frame (float time)
 // check for commands typed to the host
 	Host_GetConsoleCommands ();
 
+	serverthread = false;
 	if (sv.active)
-		Host_ServerFrame ();
+	{
+		serverthread = Host_ServerThreaded ();
+		Host_RunServer (serverthread);
+	}
 
 //-------------------
 //
@@ -722,25 +984,32 @@ void _Host_Frame (float time)
 
 // if running the server remotely, send intentions now after
 // the incoming messages have been read
+	Prof_Begin ("net");
 	if (!sv.active)
 		CL_SendCmd ();
+	Prof_End ();
 
 // fetch results from server
+	Prof_Begin ("client");
 	if (cls.state == ca_connected)
 		CL_ReadFromServer ();
+	Prof_End ();
 
-// update video
-	if (host_speeds.value)
-		time1 = Sys_DoubleTime ();
+// let the local server run while the frame renders
+	if (serverthread)
+		Host_StartServerFrame ();
 
+// update video
+	Prof_Begin ("render");
 	SCR_UpdateScreen ();
+	Prof_End ();
 
+	Prof_Begin ("particles");
 	CL_RunParticles (); //johnfitz -- seperated from rendering
-
-	if (host_speeds.value)
-		time2 = Sys_DoubleTime ();
+	Prof_End ();
 
 // update audio
+	Prof_Begin ("sound");
 	BGM_Update();	// adds music raw samples and/or advances midi driver
 	if (cls.signon == SIGNONS)
 	{
@@ -751,16 +1020,15 @@ void _Host_Frame (float time)
 		S_Update (vec3_origin, vec3_origin, vec3_origin, vec3_origin);
 
 	CDAudio_Update();
+	Prof_End ();
+
+	Prof_EndFrame ();
 
+	// host_speeds is a one line summary of the profiler scopes
 	if (host_speeds.value)
-	{
-		pass1 = (time1 - time3)*1000;
-		time3 = Sys_DoubleTime ();
-		pass2 = (time2 - time1)*1000;
-		pass3 = (time3 - time2)*1000;
-		Con_Printf ("%3i tot %3i server %3i gfx %3i snd\n",
-					pass1+pass2+pass3, pass1, pass2, pass3);
-	}
+		Con_Printf ("%5.1f tot %5.1f server %5.1f gfx %5.1f snd\n",
+					Prof_LastFrame ("frame"), Prof_LastFrame ("server"),
+					Prof_LastFrame ("render"), Prof_LastFrame ("sound"));
 
 	host_framecount++;
 
@@ -830,12 +1098,14 @@ void Host_Init (void)
 	COM_Init ();
 	COM_InitFilesystem ();
 	Host_InitLocal ();
-	W_LoadWadFile (); //johnfitz -- filename is now hard-coded for honesty
 	if (cls.state != ca_dedicated)
 	{
+		W_LoadWadFile (); //johnfitz -- filename is now hard-coded for honesty
 		Key_Init ();
 		Con_Init ();
 	}
+	Tasks_Init ();
+	Prof_Init ();
 	PR_Init ();
 	Mod_Init ();
 	NET_Init ();
@@ -881,6 +1151,7 @@ void Host_Init (void)
 	// johnfitz -- in case the vid mode was locked during vid_init, we can unlock it now.
 		// note: two leading newlines because the command buffer swallows one of them.
 		Cbuf_AddText ("\n\nvid_unlock\n");
+		CL_TimeDemoCmdline ();
 	}
 
 	if (cls.state == ca_dedicated)
@@ -913,6 +1184,13 @@ void Host_Shutdown(void)
 	}
 	isdown = true;
 
+	// Sys_Error on the server task: the main thread is still rendering, so
+	// leave the video and sound shutdown to the exit
+	if (Host_InServerTask ())
+		return;
+
+	Host_JoinServerFrame ();
+
 // keep Con_Printf from trying to update the screen
 	scr_disabled_for_loading = true;
 
@@ -932,6 +1210,8 @@ void Host_Shutdown(void)
 		VID_Shutdown();
 	}
 
+	Tasks_Shutdown ();
+
 	LOG_Close ();
 }
 
@@ -27,7 +27,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define STB_IMAGE_WRITE_STATIC
 #include "stb_image_write.h"
 
-#define LODEPNG_NO_COMPILE_DECODER
 #define LODEPNG_NO_COMPILE_CPP
 #define LODEPNG_NO_COMPILE_ANCILLARY_CHUNKS
 #define LODEPNG_NO_COMPILE_ERROR_TEXT
@@ -69,6 +68,32 @@ static inline int Buf_GetC(stdio_buffer_t *buf)
 	return buf->buffer[buf->pos++];
 }
 
+/* reads count bytes; past the end of the file the bytes read as EOF did from Buf_GetC */
+static void Buf_Read(stdio_buffer_t *buf, byte *dst, int count)
+{
+	int n;
+
+	while (count > 0)
+	{
+		if (buf->pos >= buf->size)
+		{
+			buf->size = fread(buf->buffer, 1, sizeof(buf->buffer), buf->f);
+			buf->pos = 0;
+
+			if (buf->size == 0)
+			{
+				memset(dst, (byte)EOF, count);
+				return;
+			}
+		}
+		n = q_min(count, buf->size - buf->pos);
+		memcpy(dst, buf->buffer + buf->pos, n);
+		buf->pos += n;
+		dst += n;
+		count -= n;
+	}
+}
+
 /*
 ============
 Image_LoadImage
@@ -101,6 +126,53 @@ byte *Image_LoadImage (const char *name, int *width, int *height)
 //
 //==============================================================================
 
+/*
+============
+Image_BGRAtoRGBA
+
+converts targa pixel order; bpp is 24 or 32. simd allows the SSE2 path,
+imagebench turns it off to get the reference output.
+============
+*/
+void Image_BGRAtoRGBA (byte *out, const byte *in, int pixels, int bpp, qboolean simd)
+{
+	int i = 0;
+
+	if (bpp == 24)
+	{
+		for ( ; i < pixels; i++, in += 3, out += 4)
+		{
+			out[0] = in[2];
+			out[1] = in[1];
+			out[2] = in[0];
+			out[3] = 255;
+		}
+		return;
+	}
+
+#ifdef USE_SSE2
+	if (simd && (host_parms->cpufeatures & CPU_SSE2))
+	{
+		const __m128i keep = _mm_set1_epi32 ((int)0xff00ff00);
+		const __m128i low = _mm_set1_epi32 (0xff);
+		for ( ; i + 4 <= pixels; i += 4, in += 16, out += 16)
+		{
+			__m128i p = _mm_loadu_si128 ((const __m128i *)in);
+			__m128i swapped = _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 (p, 16), low),
+							_mm_slli_epi32 (_mm_and_si128 (p, low), 16));
+			_mm_storeu_si128 ((__m128i *)out, _mm_or_si128 (_mm_and_si128 (p, keep), swapped));
+		}
+	}
+#endif
+	for ( ; i < pixels; i++, in += 4, out += 4)
+	{
+		out[0] = in[2];
+		out[1] = in[1];
+		out[2] = in[0];
+		out[3] = in[3];
+	}
+}
+
 typedef struct targaheader_s {
 	unsigned char 	id_length, colormap_type, image_type;
 	unsigned short	colormap_index, colormap_length;
@@ -232,39 +304,21 @@ byte *Image_LoadTGA (FILE *fin, int *width, int *height)
 
 	if (targa_header.image_type==2) // Uncompressed, RGB images
 	{
+		int	rowbytes = columns * (targa_header.pixel_size / 8);
+		byte	*rowbuf = (byte *) malloc (rowbytes);
+
+		if (!rowbuf)
+			Sys_Error ("Image_LoadTGA: out of memory");
 		for(row=rows-1; row>=0; row--)
 		{
 			//johnfitz -- fix for upside-down targas
 			realrow = upside_down ? row : rows - 1 - row;
 			pixbuf = targa_rgba + realrow*columns*4;
 			//johnfitz
-			for(column=0; column<columns; column++)
-			{
-				unsigned char red,green,blue,alphabyte;
-				switch (targa_header.pixel_size)
-				{
-				case 24:
-					blue = Buf_GetC(buf);
-					green = Buf_GetC(buf);
-					red = Buf_GetC(buf);
-					*pixbuf++ = red;
-					*pixbuf++ = green;
-					*pixbuf++ = blue;
-					*pixbuf++ = 255;
-					break;
-				case 32:
-					blue = Buf_GetC(buf);
-					green = Buf_GetC(buf);
-					red = Buf_GetC(buf);
-					alphabyte = Buf_GetC(buf);
-					*pixbuf++ = red;
-					*pixbuf++ = green;
-					*pixbuf++ = blue;
-					*pixbuf++ = alphabyte;
-					break;
-				}
-			}
+			Buf_Read(buf, rowbuf, rowbytes);
+			Image_BGRAtoRGBA (pixbuf, rowbuf, columns, targa_header.pixel_size, true);
 		}
+		free (rowbuf);
 	}
 	else if (targa_header.image_type==10) // Runlength encoded RGB images
 	{
@@ -409,6 +463,7 @@ byte *Image_LoadPCX (FILE *f, int *width, int *height)
 	int			x, y, w, h, readbyte, runlength, start;
 	byte		*p, *data;
 	byte		palette[768];
+	unsigned	palette32[256], *p32;
 	stdio_buffer_t  *buf;
 
 	start = ftell (f); //save start of file (since we might be inside a pak file, SEEK_SET might not be the start of the pcx)
@@ -438,6 +493,16 @@ byte *Image_LoadPCX (FILE *f, int *width, int *height)
 	fseek (f, start + com_filesize - 768, SEEK_SET);
 	fread (palette, 1, 768, f);
 
+	//expand it so every pixel is one 32 bit store
+	for (x = 0; x < 256; x++)
+	{
+		p = (byte *)&palette32[x];
+		p[0] = palette[x*3];
+		p[1] = palette[x*3+1];
+		p[2] = palette[x*3+2];
+		p[3] = 255;
+	}
+
 	//back to start of image data
 	fseek (f, start + sizeof(pcx), SEEK_SET);
 
@@ -445,7 +510,7 @@ byte *Image_LoadPCX (FILE *f, int *width, int *height)
 
 	for (y=0; y<h; y++)
 	{
-		p = data + y * w * 4;
+		p32 = (unsigned *) (data + y * w * 4);
 
 		for (x=0; x<(pcx.bytes_per_line); ) //read the extra padding byte if necessary
 		{
@@ -459,13 +524,11 @@ byte *Image_LoadPCX (FILE *f, int *width, int *height)
 			else
 				runlength = 1;
 
+			if (readbyte < 0) //truncated file, stay inside the palette
+				readbyte = 255;
 			while(runlength--)
 			{
-				p[0] = palette[readbyte*3];
-				p[1] = palette[readbyte*3+1];
-				p[2] = palette[readbyte*3+2];
-				p[3] = 255;
-				p += 4;
+				*p32++ = palette32[readbyte];
 				x++;
 			}
 		}
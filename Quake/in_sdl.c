@@ -354,7 +354,7 @@ void IN_Init (void)
 	else
 		SDL_StopTextInput();
 #endif
-	if (safemode || COM_CheckParm("-nomouse"))
+	if (safemode || isHeadless || COM_CheckParm("-nomouse"))
 	{
 		no_mouse = true;
 		/* discard all mouse events when input is deactivated */
@@ -88,6 +88,7 @@ static void Sys_InitSDL (void)
 }
 
 #define DEFAULT_MEMORY (256 * 1024 * 1024) // ericw -- was 72MB (64-bit) / 64MB (32-bit)
+#define DEFAULT_MEMORY_DEDICATED (64 * 1024 * 1024) // no textures, sounds or draw lists
 
 static quakeparms_t	parms;
 
@@ -112,13 +113,18 @@ int main(int argc, char *argv[])
 
 	COM_InitArgv(parms.argc, parms.argv);
 
+#ifdef SERVERONLY
+	isDedicated = true;	// nothing else is linked in
+#else
 	isDedicated = (COM_CheckParm("-dedicated") != 0);
+#endif
+	isHeadless = !isDedicated && (COM_CheckParm("-headless") != 0);
 
 	Sys_InitSDL ();
 
 	Sys_Init();
 
-	parms.memsize = DEFAULT_MEMORY;
+	parms.memsize = isDedicated ? DEFAULT_MEMORY_DEDICATED : DEFAULT_MEMORY;
 	if (COM_CheckParm("-heapsize"))
 	{
 		t = COM_CheckParm("-heapsize") + 1;
@@ -148,9 +154,11 @@ int main(int argc, char *argv[])
 			newtime = Sys_DoubleTime ();
 			time = newtime - oldtime;
 
-			while (time < sys_ticrate.value )
+			// sleep out the tic in one go rather than waking every
+			// millisecond, only the last one is polled
+			while (time < sys_ticrate.value)
 			{
-				SDL_Delay(1);
+				Sys_Sleep (q_max (1, (int)((sys_ticrate.value - time) * 1000.0) - 1));
 				newtime = Sys_DoubleTime ();
 				time = newtime - oldtime;
 			}
@@ -90,6 +90,11 @@ void	NET_Close (struct qsocket_s *sock);
 
 void	NET_Poll (void);
 
+void	NET_BatchSends (qboolean state);
+// While on, drivers may hold outgoing datagrams and send them together when
+// it's switched off. For the server's end of frame sends, never for
+// anything that waits on a reply.
+
 
 // Server list related globals:
 extern	qboolean	slistInProgress;
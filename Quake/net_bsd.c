@@ -43,7 +43,8 @@ net_driver_t net_drivers[] =
 		Loop_CanSendMessage,
 		Loop_CanSendUnreliableMessage,
 		Loop_Close,
-		Loop_Shutdown
+		Loop_Shutdown,
+		NULL
 	},
 
 	{	"Datagram",
@@ -59,7 +60,8 @@ net_driver_t net_drivers[] =
 		Datagram_CanSendMessage,
 		Datagram_CanSendUnreliableMessage,
 		Datagram_Close,
-		Datagram_Shutdown
+		Datagram_Shutdown,
+		Datagram_BatchSends
 	}
 };
 
@@ -89,7 +91,8 @@ net_landriver_t	net_landrivers[] =
 		UDP_GetAddrFromName,
 		UDP_AddrCompare,
 		UDP_GetSocketPort,
-		UDP_SetSocketPort
+		UDP_SetSocketPort,
+		UDP_BatchSends
 	}
 };
 
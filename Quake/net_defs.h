@@ -130,6 +130,7 @@ CCREP_RULE_INFO
 typedef struct qsocket_s
 {
 	struct qsocket_s	*next;
+	struct qsocket_s	*hashnext;	// datagram connections by address
 	double		connecttime;
 	double		lastMessageTime;
 	double		lastSendTime;
@@ -186,6 +187,7 @@ typedef struct
 	int		(*AddrCompare) (struct qsockaddr *addr1, struct qsockaddr *addr2);
 	int		(*GetSocketPort) (struct qsockaddr *addr);
 	int		(*SetSocketPort) (struct qsockaddr *addr, int port);
+	void		(*BatchSends) (qboolean state);	// optional
 } net_landriver_t;
 
 #define	MAX_NET_DRIVERS		8
@@ -208,6 +210,7 @@ typedef struct
 	qboolean	(*CanSendUnreliableMessage) (qsocket_t *sock);
 	void		(*Close) (qsocket_t *sock);
 	void		(*Shutdown) (void);
+	void		(*BatchSends) (qboolean state);	// optional
 } net_driver_t;
 
 extern net_driver_t	net_drivers[];
@@ -52,6 +52,34 @@ static struct
 
 static int myDriverLevel;
 
+/*
+Accepted connections are hashed by host, so a connection request finds a
+client's old connection without walking every socket, and connect and
+server info requests are rate limited per host with token buckets, so a
+flood of them can't keep the server busy answering. Up to CONN_MAXREQUESTS
+requests are read per check, so under a flood the accept queue doesn't go
+stale and it's the buckets that decide who gets an answer.
+*/
+#define	CONN_HASHSIZE		64
+#define	CONN_MAXREQUESTS	256	// control requests read per check
+#define	RATE_HASHSIZE		256
+#define	RATE_GLOBALSCALE	16	// all hosts together may do this many times one's rate
+
+static qsocket_t	*connhash[CONN_HASHSIZE];
+
+typedef struct
+{
+	struct qsockaddr	addr;
+	int		landriver;
+	float		tokens;
+	double		time;	// when tokens was last topped up
+} ratebucket_t;
+
+static ratebucket_t	ratebuckets[RATE_HASHSIZE];
+static ratebucket_t	rateglobal;
+
+static cvar_t	net_ratelimit = {"net_ratelimit", "4", CVAR_NONE};	// requests per second per host, 0 = off
+
 extern qboolean m_return_onerror;
 extern char m_return_reason[32];
 
@@ -790,6 +818,7 @@ int Datagram_Init (void)
 	myDriverLevel = net_driverlevel;
 
 	Cmd_AddCommand ("net_stats", NET_Stats_f);
+	Cvar_RegisterVariable (&net_ratelimit);
 
 	if (safemode || COM_CheckParm("-nolan"))
 		return -1;
@@ -836,12 +865,122 @@ void Datagram_Shutdown (void)
 }
 
 
+/*
+===================
+Datagram_HashAddr
+
+Hashes the host part of an address, the same host with another port has
+to land in the same chain
+===================
+*/
+static unsigned int Datagram_HashAddr (struct qsockaddr *addr)
+{
+	unsigned int	h;
+
+	if (addr->qsa_family != AF_INET)
+		return 0;
+	h = ((struct sockaddr_in *)addr)->sin_addr.s_addr;
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
+
+static void Datagram_LinkConnection (qsocket_t *sock)
+{
+	qsocket_t	**chain = &connhash[Datagram_HashAddr (&sock->addr) & (CONN_HASHSIZE - 1)];
+
+	sock->hashnext = *chain;
+	*chain = sock;
+}
+
+static void Datagram_UnlinkConnection (qsocket_t *sock)
+{
+	qsocket_t	**s;
+
+	for (s = &connhash[Datagram_HashAddr (&sock->addr) & (CONN_HASHSIZE - 1)]; *s; s = &(*s)->hashnext)
+	{
+		if (*s == sock)
+		{
+			*s = sock->hashnext;
+			break;
+		}
+	}
+	sock->hashnext = NULL;
+}
+
+/*
+===================
+Datagram_TakeToken
+
+Tops the bucket up for the time since its last request, then takes one
+token if there is one
+===================
+*/
+static qboolean Datagram_TakeToken (ratebucket_t *b, float rate)
+{
+	b->tokens = q_min (rate, b->tokens + (float)(net_time - b->time) * rate);
+	b->time = net_time;
+	if (b->tokens < 1)
+		return false;
+	b->tokens -= 1;
+	return true;
+}
+
+/*
+===================
+Datagram_RateLimit
+
+Takes a token from the host's bucket and then the global one, false if
+either is empty. A bucket holds a second's worth of requests. The host's
+bucket goes first so a host over its rate doesn't drain the global one
+for everybody else.
+===================
+*/
+static qboolean Datagram_RateLimit (struct qsockaddr *addr)
+{
+	ratebucket_t	*b;
+	float		rate = net_ratelimit.value;
+
+	if (rate <= 0)
+		return true;
+	rate = q_max (rate, 1);
+
+	b = &ratebuckets[Datagram_HashAddr (addr) & (RATE_HASHSIZE - 1)];
+	if (b->landriver != net_landriverlevel || dfunc.AddrCompare (addr, &b->addr) < 0)
+	{
+		// a host not seen lately takes the slot over with a full bucket
+		b->addr = *addr;
+		b->landriver = net_landriverlevel;
+		b->tokens = rate;
+		b->time = net_time;
+	}
+
+	if (!Datagram_TakeToken (b, rate))
+		return false;
+	return Datagram_TakeToken (&rateglobal, rate * RATE_GLOBALSCALE);
+}
+
+
 void Datagram_Close (qsocket_t *sock)
 {
+	Datagram_UnlinkConnection (sock);
 	sfunc.Close_Socket(sock->socket);
 }
 
 
+void Datagram_BatchSends (qboolean state)
+{
+	int i;
+
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (net_landrivers[i].initialized && net_landrivers[i].BatchSends)
+			net_landrivers[i].BatchSends (state);
+	}
+}
+
+
 void Datagram_Listen (qboolean state)
 {
 	int i;
@@ -854,12 +993,11 @@ void Datagram_Listen (qboolean state)
 }
 
 
-static qsocket_t *_Datagram_CheckNewConnections (void)
+static qsocket_t *_Datagram_CheckNewConnections (sys_socket_t acceptsock)
 {
 	struct qsockaddr clientaddr;
 	struct qsockaddr newaddr;
 	sys_socket_t		newsock;
-	sys_socket_t		acceptsock;
 	qsocket_t	*sock;
 	qsocket_t	*s;
 	int			len;
@@ -867,10 +1005,6 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	int			control;
 	int			ret;
 
-	acceptsock = dfunc.CheckNewConnections();
-	if (acceptsock == INVALID_SOCKET)
-		return NULL;
-
 	SZ_Clear(&net_message);
 
 	len = dfunc.Read (acceptsock, net_message.data, net_message.maxsize, &clientaddr);
@@ -889,6 +1023,9 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 		return NULL;
 
 	command = MSG_ReadByte();
+	if ((command == CCREQ_SERVER_INFO || command == CCREQ_CONNECT) && !Datagram_RateLimit (&clientaddr))
+		return NULL;
+
 	if (command == CCREQ_SERVER_INFO)
 	{
 		if (Q_strcmp(MSG_ReadString(), "QUAKE") != 0)
@@ -1018,9 +1155,9 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 #endif
 
 	// see if this guy is already connected
-	for (s = net_activeSockets; s; s = s->next)
+	for (s = connhash[Datagram_HashAddr (&clientaddr) & (CONN_HASHSIZE - 1)]; s; s = s->hashnext)
 	{
-		if (s->driver != net_driverlevel)
+		if (s->landriver != net_landriverlevel)
 			continue;
 		ret = dfunc.AddrCompare(&clientaddr, &s->addr);
 		if (ret >= 0)
@@ -1084,6 +1221,7 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	sock->landriver = net_landriverlevel;
 	sock->addr = clientaddr;
 	Q_strcpy(sock->address, dfunc.AddrToString(&clientaddr));
+	Datagram_LinkConnection (sock);
 
 	// send him back the info about the server connection he has been allocated
 	SZ_Clear(&net_message);
@@ -1102,17 +1240,24 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 
 qsocket_t *Datagram_CheckNewConnections (void)
 {
-	qsocket_t *ret = NULL;
+	qsocket_t *ret;
+	sys_socket_t acceptsock;
+	int i;
 
 	for (net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++)
 	{
-		if (net_landrivers[net_landriverlevel].initialized)
+		if (!net_landrivers[net_landriverlevel].initialized)
+			continue;
+		for (i = 0; i < CONN_MAXREQUESTS; i++)
 		{
-			if ((ret = _Datagram_CheckNewConnections ()) != NULL)
+			acceptsock = dfunc.CheckNewConnections();
+			if (acceptsock == INVALID_SOCKET)
 				break;
+			if ((ret = _Datagram_CheckNewConnections (acceptsock)) != NULL)
+				return ret;
 		}
 	}
-	return ret;
+	return NULL;
 }
 
 
@@ -110,6 +110,7 @@ qsocket_t *NET_NewQSocket (void)
 	sock->driver = net_driverlevel;
 	sock->socket = 0;
 	sock->driverdata = NULL;
+	sock->hashnext = NULL;
 	sock->canSend = true;
 	sock->sendNext = false;
 	sock->lastMessageTime = net_time;
@@ -863,6 +864,21 @@ void NET_Shutdown (void)
 }
 
 
+/*
+===================
+NET_BatchSends
+===================
+*/
+void NET_BatchSends (qboolean state)
+{
+	for (net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++)
+	{
+		if (net_drivers[net_driverlevel].initialized && dfunc.BatchSends)
+			dfunc.BatchSends (state);
+	}
+}
+
+
 static PollProcedure *pollProcedureList = NULL;
 
 void NET_Poll(void)
@@ -20,6 +20,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE	/* recvmmsg, sendmmsg */
+#endif
+
 #include "q_stdinc.h"
 #include "arch_def.h"
 #include "net_sys.h"
@@ -35,6 +39,45 @@ static in_addr_t	myAddr;
 
 #include "net_udp.h"
 
+/*
+Linux can move several datagrams per syscall. Every client has a socket
+of its own, so the batching is per socket: a read pulls everything queued
+on the socket at once, and while the server sends its frame (NET_BatchSends)
+writes are held and go out with one sendmmsg per socket.
+The accept and control sockets are left out of the read batching, since
+UDP_CheckNewConnections peeks at the kernel queue with FIONREAD.
+*/
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define UDP_MMSG
+#endif
+
+#ifdef UDP_MMSG
+#define	UDP_RECVBATCH	8
+#define	UDP_SENDPOOL	0x20000
+#define	UDP_MAXSENDS	128
+
+// one socket's read batch
+static sys_socket_t	udp_recvsock = INVALID_SOCKET;
+static int		udp_recvcount, udp_recvnext;
+static int		udp_recvdrainframe = -1;	// host frame whose batch emptied the socket
+static byte		udp_recvbuf[UDP_RECVBATCH][NET_DATAGRAMSIZE];
+static struct qsockaddr	udp_recvaddr[UDP_RECVBATCH];
+static struct iovec	udp_recviov[UDP_RECVBATCH];
+static struct mmsghdr	udp_recvmsgs[UDP_RECVBATCH];
+
+// held writes, in order
+static qboolean		udp_batching;
+static byte		udp_sendpool[UDP_SENDPOOL];
+static int		udp_sendpoolused;
+static int		udp_numsends;
+static sys_socket_t	udp_sendsock[UDP_MAXSENDS];
+static struct qsockaddr	udp_sendaddr[UDP_MAXSENDS];
+static struct iovec	udp_sendiov[UDP_MAXSENDS];
+static struct mmsghdr	udp_sendmsgs[UDP_MAXSENDS];
+
+static void UDP_FlushSends (sys_socket_t socketid);
+#endif	/* UDP_MMSG */
+
 //=============================================================================
 
 sys_socket_t UDP_Init (void)
@@ -110,6 +153,7 @@ sys_socket_t UDP_Init (void)
 
 void UDP_Shutdown (void)
 {
+	UDP_BatchSends (false);
 	UDP_Listen (false);
 	UDP_CloseSocket (net_controlsocket);
 }
@@ -172,6 +216,16 @@ ErrorReturn:
 
 int UDP_CloseSocket (sys_socket_t socketid)
 {
+#ifdef UDP_MMSG
+	// a dropped client's last message is still held
+	UDP_FlushSends (socketid);
+	if (socketid == udp_recvsock)
+	{
+		udp_recvsock = INVALID_SOCKET;
+		udp_recvcount = udp_recvnext = 0;
+		udp_recvdrainframe = -1;
+	}
+#endif
 	if (socketid == net_broadcastsocket)
 		net_broadcastsocket = 0;
 	return closesocket (socketid);
@@ -266,11 +320,79 @@ sys_socket_t UDP_CheckNewConnections (void)
 
 //=============================================================================
 
+#ifdef UDP_MMSG
+/*
+============
+UDP_ReadBatch
+
+Serves socketid's reads from one recvmmsg. Returns -2 when the read
+has to go through recvfrom instead: another socket's batch is still
+being read, or socketid is the accept or control socket.
+============
+*/
+static int UDP_ReadBatch (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	int	i, ret;
+
+	if (socketid == net_acceptsocket || socketid == net_controlsocket)
+		return -2;
+	if (udp_recvnext < udp_recvcount && socketid != udp_recvsock)
+		return -2;
+
+	if (udp_recvnext == udp_recvcount)
+	{
+		if (socketid == udp_recvsock && udp_recvdrainframe == host_framecount)
+		{
+			// this frame's poll already saw everything there was
+			udp_recvdrainframe = -1;
+			return 0;
+		}
+
+		for (i = 0; i < UDP_RECVBATCH; i++)
+		{
+			udp_recviov[i].iov_base = udp_recvbuf[i];
+			udp_recviov[i].iov_len = NET_DATAGRAMSIZE;
+			memset (&udp_recvmsgs[i], 0, sizeof(udp_recvmsgs[i]));
+			udp_recvmsgs[i].msg_hdr.msg_name = &udp_recvaddr[i];
+			udp_recvmsgs[i].msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+			udp_recvmsgs[i].msg_hdr.msg_iov = &udp_recviov[i];
+			udp_recvmsgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		udp_recvsock = socketid;
+		udp_recvcount = udp_recvnext = 0;
+		ret = recvmmsg (socketid, udp_recvmsgs, UDP_RECVBATCH, MSG_DONTWAIT, NULL);
+		if (ret == SOCKET_ERROR)
+		{
+			int err = SOCKETERRNO;
+			udp_recvdrainframe = -1;
+			if (err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+				return 0;
+			Con_SafePrintf ("UDP_Read, recvmmsg: %s\n", socketerror(err));
+			return -1;
+		}
+		udp_recvcount = ret;
+		udp_recvdrainframe = (ret < UDP_RECVBATCH) ? host_framecount : -1;
+	}
+
+	i = udp_recvnext++;
+	ret = q_min ((int)udp_recvmsgs[i].msg_len, len);
+	memcpy (buf, udp_recvbuf[i], ret);
+	memcpy (addr, &udp_recvaddr[i], sizeof(struct qsockaddr));
+	return ret;
+}
+#endif	/* UDP_MMSG */
+
 int UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
 	socklen_t addrlen = sizeof(struct qsockaddr);
 	int ret;
 
+#ifdef UDP_MMSG
+	ret = UDP_ReadBatch (socketid, buf, len, addr);
+	if (ret != -2)
+		return ret;
+#endif
+
 	ret = recvfrom (socketid, buf, len, 0, (struct sockaddr *)addr, &addrlen);
 	if (ret == SOCKET_ERROR)
 	{
@@ -324,10 +446,111 @@ int UDP_Broadcast (sys_socket_t socketid, byte *buf, int len)
 
 //=============================================================================
 
+#ifdef UDP_MMSG
+/*
+============
+UDP_FlushSends
+
+Sends the held writes, all of them or only socketid's. Consecutive writes
+to one socket go out in one sendmmsg.
+============
+*/
+static void UDP_FlushSends (sys_socket_t socketid)
+{
+	int	i, j, ret, count;
+
+	for (i = 0; i < udp_numsends; i = j)
+	{
+		for (j = i + 1; j < udp_numsends && udp_sendsock[j] == udp_sendsock[i]; j++)
+			;
+		if (udp_sendsock[i] == INVALID_SOCKET)
+			continue;	// already sent
+		if (socketid != INVALID_SOCKET && udp_sendsock[i] != socketid)
+			continue;
+
+		for (count = i; count < j; count += ret)
+		{
+			ret = sendmmsg (udp_sendsock[i], &udp_sendmsgs[count], j - count, 0);
+			if (ret == SOCKET_ERROR)
+			{
+				int err = SOCKETERRNO;
+				if (err != NET_EWOULDBLOCK)
+					Con_SafePrintf ("UDP_Write, sendmmsg: %s\n", socketerror(err));
+				break;	// dropped, as a failed sendto would have
+			}
+			if (ret == 0)
+				break;
+		}
+		for (count = i; count < j; count++)
+			udp_sendsock[count] = INVALID_SOCKET;
+	}
+
+	if (socketid == INVALID_SOCKET)
+	{
+		udp_numsends = 0;
+		udp_sendpoolused = 0;
+	}
+}
+
+/*
+============
+UDP_BatchSends
+============
+*/
+void UDP_BatchSends (qboolean state)
+{
+	if (!state)
+		UDP_FlushSends (INVALID_SOCKET);
+	udp_batching = state;
+}
+
+/*
+============
+UDP_QueueWrite
+
+Holds a write until the batch is flushed, false if it has to go now
+============
+*/
+static qboolean UDP_QueueWrite (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	struct mmsghdr	*msg;
+
+	if (!udp_batching || len > UDP_SENDPOOL)
+		return false;
+	if (udp_numsends == UDP_MAXSENDS || udp_sendpoolused + len > UDP_SENDPOOL)
+		UDP_FlushSends (INVALID_SOCKET);
+
+	udp_sendsock[udp_numsends] = socketid;
+	udp_sendaddr[udp_numsends] = *addr;
+	udp_sendiov[udp_numsends].iov_base = udp_sendpool + udp_sendpoolused;
+	udp_sendiov[udp_numsends].iov_len = len;
+	memcpy (udp_sendpool + udp_sendpoolused, buf, len);
+	udp_sendpoolused += len;
+
+	msg = &udp_sendmsgs[udp_numsends];
+	memset (msg, 0, sizeof(*msg));
+	msg->msg_hdr.msg_name = &udp_sendaddr[udp_numsends];
+	msg->msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+	msg->msg_hdr.msg_iov = &udp_sendiov[udp_numsends];
+	msg->msg_hdr.msg_iovlen = 1;
+	udp_numsends++;
+	return true;
+}
+#else
+void UDP_BatchSends (qboolean state)
+{
+}
+#endif	/* UDP_MMSG */
+
 int UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
 	int	ret;
 
+#ifdef UDP_MMSG
+	if (UDP_QueueWrite (socketid, buf, len, addr))
+		return len;
+#endif
+
 	ret = sendto (socketid, buf, len, 0, (struct sockaddr *)addr,
 							sizeof(struct qsockaddr));
 	if (ret == SOCKET_ERROR)
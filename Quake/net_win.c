@@ -43,7 +43,8 @@ net_driver_t net_drivers[] =
 		Loop_CanSendMessage,
 		Loop_CanSendUnreliableMessage,
 		Loop_Close,
-		Loop_Shutdown
+		Loop_Shutdown,
+		NULL
 	},
 
 	{	"Datagram",
@@ -59,7 +60,8 @@ net_driver_t net_drivers[] =
 		Datagram_CanSendMessage,
 		Datagram_CanSendUnreliableMessage,
 		Datagram_Close,
-		Datagram_Shutdown
+		Datagram_Shutdown,
+		Datagram_BatchSends
 	}
 };
 
@@ -91,7 +93,8 @@ net_landriver_t	net_landrivers[] =
 		WINS_GetAddrFromName,
 		WINS_AddrCompare,
 		WINS_GetSocketPort,
-		WINS_SetSocketPort
+		WINS_SetSocketPort,
+		NULL
 	},
 
 	{	"Winsock IPX",
@@ -114,7 +117,8 @@ net_landriver_t	net_landrivers[] =
 		WIPX_GetAddrFromName,
 		WIPX_AddrCompare,
 		WIPX_GetSocketPort,
-		WIPX_SetSocketPort
+		WIPX_SetSocketPort,
+		NULL
 	}
 };
 
@@ -735,17 +735,14 @@ static void PF_checkpos (void)
 
 //============================================================================
 
-static byte	*checkpvs;	//ericw -- changed to malloc
-static int	checkpvs_capacity;
+static pvsbuffer_t	checkpvs;	//ericw -- changed to malloc
 
 static int PF_newcheckclient (int check)
 {
 	int		i;
-	byte	*pvs;
 	edict_t	*ent;
 	mleaf_t	*leaf;
 	vec3_t	org;
-	int	pvsbytes;
 
 // cycle to the next one
 
@@ -783,17 +780,7 @@ static int PF_newcheckclient (int check)
 // get the PVS for the entity
 	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
 	leaf = Mod_PointInLeaf (org, sv.worldmodel);
-	pvs = Mod_LeafPVS (leaf, sv.worldmodel);
-	
-	pvsbytes = (sv.worldmodel->numleafs+7)>>3;
-	if (checkpvs == NULL || pvsbytes > checkpvs_capacity)
-	{
-		checkpvs_capacity = pvsbytes;
-		checkpvs = (byte *) realloc (checkpvs, checkpvs_capacity);
-		if (!checkpvs)
-			Sys_Error ("PF_newcheckclient: realloc() failed on %d bytes", checkpvs_capacity);
-	}
-	memcpy (checkpvs, pvs, pvsbytes);
+	Mod_LeafPVS (leaf, sv.worldmodel, &checkpvs);
 
 	return i;
 }
@@ -842,7 +829,7 @@ static void PF_checkclient (void)
 	VectorAdd (self->v.origin, self->v.view_ofs, view);
 	leaf = Mod_PointInLeaf (view, sv.worldmodel);
 	l = (leaf - sv.worldmodel->leafs) - 1;
-	if ( (l < 0) || !(checkpvs[l>>3] & (1 << (l & 7))) )
+	if ( (l < 0) || !(checkpvs.bits[l>>3] & (1 << (l & 7))) )
 	{
 		c_notvis++;
 		RETURN_EDICT(sv.edicts);
@@ -907,13 +894,64 @@ PF_cvar
 float cvar (string)
 =================
 */
+/*
+When the server frame runs on a worker (host_serverthread), cvar_set is
+latched here and applied on the main thread once the frame is joined:
+Cvar_Set swaps zone strings the renderer may be reading and runs
+callbacks that may touch GL state. The latched values are what cvar()
+returns until then. Only the worker adds to the list and only the main
+thread empties it, and the join orders the two.
+*/
+#define	MAX_LATCHEDCVARS	64
+
+typedef struct
+{
+	cvar_t	*var;
+	char	value[256];
+} latchedcvar_t;
+
+static latchedcvar_t	pr_latchedcvars[MAX_LATCHEDCVARS];
+static int		pr_numlatchedcvars;
+
+static latchedcvar_t *PR_FindLatchedCvar (cvar_t *var)
+{
+	int	i;
+
+	for (i = 0; i < pr_numlatchedcvars; i++)
+	{
+		if (pr_latchedcvars[i].var == var)
+			return &pr_latchedcvars[i];
+	}
+	return NULL;
+}
+
+/*
+=================
+PR_ApplyLatchedCvars
+
+Main thread, after the server frame is joined
+=================
+*/
+void PR_ApplyLatchedCvars (void)
+{
+	int	i;
+
+	for (i = 0; i < pr_numlatchedcvars; i++)
+		Cvar_SetQuick (pr_latchedcvars[i].var, pr_latchedcvars[i].value);
+	pr_numlatchedcvars = 0;
+}
+
 static void PF_cvar (void)
 {
 	const char	*str;
+	latchedcvar_t	*latched;
 
 	str = G_STRING(OFS_PARM0);
 
-	G_FLOAT(OFS_RETURN) = Cvar_VariableValue (str);
+	if (pr_numlatchedcvars && (latched = PR_FindLatchedCvar (Cvar_FindVar (str))))
+		G_FLOAT(OFS_RETURN) = Q_atof (latched->value);
+	else
+		G_FLOAT(OFS_RETURN) = Cvar_VariableValue (str);
 }
 
 /*
@@ -926,11 +964,35 @@ float cvar (string)
 static void PF_cvar_set (void)
 {
 	const char	*var, *val;
+	cvar_t		*cvar;
+	latchedcvar_t	*latched;
 
 	var = G_STRING(OFS_PARM0);
 	val = G_STRING(OFS_PARM1);
 
-	Cvar_Set (var, val);
+	if (!Host_InServerTask ())
+	{
+		Cvar_Set (var, val);
+		return;
+	}
+
+	cvar = Cvar_FindVar (var);
+	if (!cvar)
+	{
+		Con_Printf ("Cvar_Set: variable %s not found\n", var);
+		return;
+	}
+	if (!(latched = PR_FindLatchedCvar (cvar)))
+	{
+		if (pr_numlatchedcvars == MAX_LATCHEDCVARS)
+		{
+			Con_Printf ("PF_cvar_set: too many cvars set in one frame, %s dropped\n", var);
+			return;
+		}
+		latched = &pr_latchedcvars[pr_numlatchedcvars++];
+		latched->var = cvar;
+	}
+	q_strlcpy (latched->value, val, sizeof(latched->value));
 }
 
 /*
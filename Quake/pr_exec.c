@@ -379,6 +379,8 @@ void PR_ExecuteProgram (func_t fnum)
 	st = &pr_statements[PR_EnterFunction(f)];
 	startprofile = profile = 0;
 
+	Prof_Begin ("qc");
+
     while (1)
     {
 	st++;	/* next statement */
@@ -631,6 +633,7 @@ void PR_ExecuteProgram (func_t fnum)
 		st = &pr_statements[PR_LeaveFunction()];
 		if (pr_depth == exitdepth)
 		{ // Done
+			Prof_End ();
 			return;
 		}
 		break;
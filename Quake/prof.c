@@ -0,0 +1,477 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// prof.c -- per-frame scope profiler
+
+#include "quakedef.h"
+
+#define	MAX_PROFTHREADS		(1 + MAX_TASK_WORKERS)
+#define	MAX_PROFEVENTS		16384	// per thread, must be a power of two
+#define	MAX_PROFDEPTH		32
+#define	MAX_PROFSCOPES		48
+#define	PROF_HISTORY		128		// frames of history for the percentiles
+
+// the owner publishes head and done with a release store, the main thread
+// reads them with an acquire load before it looks at the event
+#if defined(USE_SDL2)
+typedef SDL_atomic_t	profatomic_t;
+#define	Prof_AtomicGet(a)	SDL_AtomicGet (a)
+#define	Prof_AtomicSet(a, v)	SDL_AtomicSet (a, v)
+#else	// no atomics in SDL 1.2
+typedef struct { volatile int value; } profatomic_t;
+#define	Prof_AtomicGet(a)	((a)->value)
+#define	Prof_AtomicSet(a, v)	((a)->value = (v))
+#endif
+
+typedef struct
+{
+	const char	*name;
+	double		start, end;
+	profatomic_t	done;				// end is set
+} profevent_t;
+
+typedef struct
+{
+	profevent_t	events[MAX_PROFEVENTS];
+	profatomic_t	head;			// events started, only the owner writes it
+	int		stack[MAX_PROFDEPTH];	// open events
+	int		depth;
+	int		session;			// prof_session the stack belongs to
+	int		read;				// main thread: next event to add to the frame stats
+} profthread_t;
+
+typedef struct
+{
+	const char	*name;
+	double		frame;				// seconds this frame
+	float		history[PROF_HISTORY];	// ms per frame
+} profscope_t;
+
+static profthread_t	*prof_threads[MAX_PROFTHREADS];
+static profscope_t	prof_scopes[MAX_PROFSCOPES];
+static int		prof_numscopes;
+static int		prof_frames;		// frames of history recorded
+static double		prof_basetime;
+static int		prof_session;		// bumped each time recording starts
+
+qboolean	prof_active;
+
+cvar_t	host_profile = {"host_profile","0",CVAR_NONE};
+
+/*
+================
+Prof_Thread
+
+Returns the calling thread's ring, allocating it on first use if create
+is set. Only the owning thread ever stores the pointer. Threads outside
+the pool, like the music decoder, aren't recorded.
+================
+*/
+static profthread_t *Prof_Thread (qboolean create)
+{
+	int		index = Tasks_ThreadIndex ();
+	profthread_t	*t;
+
+	if (index < 0)
+		return NULL;
+	t = prof_threads[index];
+	if (!t && create)
+	{
+		t = (profthread_t *) calloc (1, sizeof(profthread_t));
+		if (!t)
+			return NULL;
+#if defined(USE_SDL2)
+		SDL_AtomicSetPtr ((void **) &prof_threads[index], t);
+#else
+		prof_threads[index] = t;
+#endif
+	}
+	return t;
+}
+
+/*
+================
+Prof_GetThread
+
+A ring for the main thread to read, or NULL
+================
+*/
+static profthread_t *Prof_GetThread (int index)
+{
+#if defined(USE_SDL2)
+	return (profthread_t *) SDL_AtomicGetPtr ((void **) &prof_threads[index]);
+#else
+	return prof_threads[index];
+#endif
+}
+
+/*
+================
+Prof_Resync
+
+A worker can still be inside scopes when recording stops, and their ends
+are then skipped. Close them empty before the thread records again, so
+they neither nest the new scopes nor hold up the frame stats.
+================
+*/
+static void Prof_Resync (profthread_t *t)
+{
+	profevent_t	*ev;
+	int		head = Prof_AtomicGet (&t->head);
+
+	while (t->depth > 0)
+	{
+		t->depth--;
+		if (t->depth < MAX_PROFDEPTH && head - t->stack[t->depth] <= MAX_PROFEVENTS)
+		{
+			ev = &t->events[t->stack[t->depth] & (MAX_PROFEVENTS - 1)];
+			if (!Prof_AtomicGet (&ev->done))
+			{
+				ev->end = ev->start;
+				Prof_AtomicSet (&ev->done, 1);
+			}
+		}
+	}
+	t->session = prof_session;
+}
+
+/*
+================
+Prof_Begin
+================
+*/
+void Prof_Begin (const char *name)
+{
+	profthread_t	*t;
+	profevent_t	*ev;
+	int		head;
+
+	if (!prof_active || !(t = Prof_Thread (true)))
+		return;
+	if (t->session != prof_session)
+		Prof_Resync (t);
+
+	if (t->depth < MAX_PROFDEPTH)
+	{
+		head = Prof_AtomicGet (&t->head);
+		ev = &t->events[head & (MAX_PROFEVENTS - 1)];
+		ev->name = name;
+		Prof_AtomicSet (&ev->done, 0);
+		ev->start = Sys_ProfileTime ();
+		t->stack[t->depth] = head;
+		Prof_AtomicSet (&t->head, head + 1);
+	}
+	t->depth++;
+}
+
+/*
+================
+Prof_End
+================
+*/
+void Prof_End (void)
+{
+	profthread_t	*t;
+	profevent_t	*ev;
+	int		index;
+
+	if (!prof_active || !(t = Prof_Thread (false)))
+		return;
+	if (t->session != prof_session)
+		Prof_Resync (t);
+	if (t->depth <= 0)
+		return;	// profile was switched on inside a scope
+
+	t->depth--;
+	if (t->depth >= MAX_PROFDEPTH)
+		return;
+	index = t->stack[t->depth];
+	if (Prof_AtomicGet (&t->head) - index <= MAX_PROFEVENTS)	// not overwritten yet
+	{
+		ev = &t->events[index & (MAX_PROFEVENTS - 1)];
+		ev->end = Sys_ProfileTime ();
+		Prof_AtomicSet (&ev->done, 1);
+	}
+}
+
+/*
+================
+Prof_Depth / Prof_Unwind
+
+For code that longjmps out of open scopes: remember the depth before the
+setjmp and unwind back to it when the jump lands
+================
+*/
+int Prof_Depth (void)
+{
+	profthread_t	*t;
+
+	if (!prof_active || !(t = Prof_Thread (false)))
+		return 0;
+	return t->session == prof_session ? t->depth : 0;
+}
+
+void Prof_Unwind (int depth)
+{
+	profthread_t	*t;
+
+	if (!prof_active || !(t = Prof_Thread (false)))
+		return;
+	while (t->depth > depth && t->session == prof_session)
+		Prof_End ();
+}
+
+/*
+================
+Prof_FindScope
+================
+*/
+static profscope_t *Prof_FindScope (const char *name)
+{
+	profscope_t	*scope;
+	int		i;
+
+	for (i = 0, scope = prof_scopes; i < prof_numscopes; i++, scope++)
+	{
+		if (scope->name == name || !strcmp (scope->name, name))
+			return scope;
+	}
+	if (prof_numscopes == MAX_PROFSCOPES)
+		return NULL;
+	scope = &prof_scopes[prof_numscopes++];
+	memset (scope, 0, sizeof(*scope));
+	scope->name = name;
+	return scope;
+}
+
+/*
+================
+Prof_BeginFrame
+================
+*/
+void Prof_BeginFrame (void)
+{
+	extern cvar_t host_speeds;
+	qboolean	active;
+
+	Prof_Unwind (0);	// scopes left open by a Host_Error
+
+	// timedemo uses the scopes for its per-frame phases
+	active = (host_profile.value || host_speeds.value || cls.timedemo);
+	if (active && !prof_active)
+		prof_session++;
+	prof_active = active;
+	if (prof_active)
+		Prof_Begin ("frame");
+}
+
+/*
+================
+Prof_EndFrame
+
+Adds the events finished since last frame to the per-scope history.
+Events still open, like a server frame running on a worker, are picked up
+by a later frame.
+================
+*/
+void Prof_EndFrame (void)
+{
+	profthread_t	*t;
+	profevent_t	*ev;
+	profscope_t	*scope;
+	int		i, head;
+
+	if (!prof_active)
+		return;
+
+	Prof_End ();	// "frame"
+
+	for (i = 0; i < MAX_PROFTHREADS; i++)
+	{
+		if (!(t = Prof_GetThread (i)))
+			continue;
+		head = Prof_AtomicGet (&t->head);
+		if (head - t->read > MAX_PROFEVENTS)
+			t->read = head - MAX_PROFEVENTS;
+		for ( ; t->read != head; t->read++)
+		{
+			ev = &t->events[t->read & (MAX_PROFEVENTS - 1)];
+			if (!Prof_AtomicGet (&ev->done))
+				break;
+			if ((scope = Prof_FindScope (ev->name)))
+				scope->frame += ev->end - ev->start;
+		}
+	}
+
+	for (i = 0, scope = prof_scopes; i < prof_numscopes; i++, scope++)
+	{
+		scope->history[prof_frames % PROF_HISTORY] = scope->frame * 1000.0;
+		scope->frame = 0;
+	}
+	prof_frames++;
+}
+
+/*
+================
+Prof_GetStats
+
+Fills in the last frame and the rolling percentiles of every scope seen
+================
+*/
+static int Prof_CompareFloats (const void *a, const void *b)
+{
+	float	fa = *(const float *)a, fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+int Prof_GetStats (profstat_t *stats, int maxstats)
+{
+	float	sorted[PROF_HISTORY];
+	int	i, n;
+
+	n = q_min (prof_frames, PROF_HISTORY);
+	if (!n)
+		return 0;
+
+	for (i = 0; i < prof_numscopes && i < maxstats; i++)
+	{
+		memcpy (sorted, prof_scopes[i].history, n * sizeof(float));
+		qsort (sorted, n, sizeof(float), Prof_CompareFloats);
+		stats[i].name = prof_scopes[i].name;
+		stats[i].last = prof_scopes[i].history[(prof_frames - 1) % PROF_HISTORY];
+		stats[i].p50 = sorted[n * 50 / 100];
+		stats[i].p95 = sorted[n * 95 / 100];
+		stats[i].p99 = sorted[n * 99 / 100];
+	}
+	return i;
+}
+
+/*
+================
+Prof_LastFrame
+
+ms spent in the named scope last frame, for host_speeds
+================
+*/
+float Prof_LastFrame (const char *name)
+{
+	int	i;
+
+	if (!prof_frames)
+		return 0;
+	for (i = 0; i < prof_numscopes; i++)
+	{
+		if (!strcmp (prof_scopes[i].name, name))
+			return prof_scopes[i].history[(prof_frames - 1) % PROF_HISTORY];
+	}
+	return 0;
+}
+
+/*
+================
+Prof_Dump_f
+
+Writes every finished event still in the rings as Chrome trace JSON
+================
+*/
+static void Prof_WriteString (FILE *f, const char *s)
+{
+	fputc ('"', f);
+	for ( ; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fputc ('\\', f);
+		if ((unsigned char)*s >= ' ')
+			fputc (*s, f);
+	}
+	fputc ('"', f);
+}
+
+static void Prof_Dump_f (void)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	profthread_t	*t;
+	profevent_t	*ev;
+	int		i, j, head, start, count;
+	qboolean	first;
+
+	if (Cmd_Argc () > 2)
+	{
+		Con_Printf ("usage: profile_dump [file]\n");
+		return;
+	}
+
+	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argc () == 2 ? Cmd_Argv (1) : "profile.json");
+	COM_AddExtension (name, ".json", sizeof(name));
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("couldn't write %s\n", name);
+		return;
+	}
+
+	fprintf (f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	first = true;
+	count = 0;
+	for (i = 0; i < MAX_PROFTHREADS; i++)
+	{
+		if (!(t = Prof_GetThread (i)))
+			continue;
+
+		fprintf (f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s %i\"}}",
+			first ? "" : ",\n", i, i ? "worker" : "main", i);
+		first = false;
+
+		head = Prof_AtomicGet (&t->head);
+		start = q_max (0, head - MAX_PROFEVENTS);
+		for (j = start; j != head; j++)
+		{
+			ev = &t->events[j & (MAX_PROFEVENTS - 1)];
+			if (!Prof_AtomicGet (&ev->done))
+				continue;
+			fprintf (f, ",\n{\"name\":");
+			Prof_WriteString (f, ev->name);
+			fprintf (f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}",
+				i, (ev->start - prof_basetime) * 1000000.0, (ev->end - ev->start) * 1000000.0);
+			count++;
+		}
+	}
+	fprintf (f, "\n]}\n");
+	fclose (f);
+
+	if (!count)
+		Con_Printf ("no events recorded, set \"host_profile 1\" first\n");
+	else
+		Con_Printf ("wrote %i events to %s\n", count, name);
+}
+
+/*
+================
+Prof_Init
+================
+*/
+void Prof_Init (void)
+{
+	Cvar_RegisterVariable (&host_profile);
+	Cmd_AddCommand ("profile_dump", Prof_Dump_f);
+
+	prof_basetime = Sys_ProfileTime ();
+}
@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef __PROF_H
+#define __PROF_H
+
+// prof.h -- per-frame scope profiler
+
+/*
+Prof_Begin/Prof_End bracket a named scope; scopes nest, and the name must
+be a string that outlives the recording (normally a literal). Every thread
+records into its own event ring that only it writes, so scopes are cheap
+and safe on the worker pool. Nothing is recorded unless host_profile or
+host_speeds is set.
+
+"host_profile 1" draws rolling percentiles per scope name, "profile_dump
+[file]" writes the recorded events as Chrome trace JSON that loads in
+chrome://tracing or ui.perfetto.dev.
+*/
+
+extern qboolean	prof_active;
+
+void Prof_Init (void);
+void Prof_BeginFrame (void);
+void Prof_EndFrame (void);
+
+void Prof_Begin (const char *name);
+void Prof_End (void);
+int Prof_Depth (void);
+void Prof_Unwind (int depth);
+
+typedef struct
+{
+	const char	*name;
+	float		last, p50, p95, p99;	// ms per frame
+} profstat_t;
+
+int Prof_GetStats (profstat_t *stats, int maxstats);
+float Prof_LastFrame (const char *name);
+
+#endif	/* __PROF_H */
@@ -78,6 +78,7 @@ int PR_SetEngineString (const char *s);
 int PR_AllocString (int bufferlength, char **ptr);
 
 void PR_Profile_f (void);
+void PR_ApplyLatchedCvars (void);
 
 edict_t *ED_Alloc (void);
 void ED_Free (edict_t *ed);
@@ -46,6 +46,9 @@ typedef struct
 	int	speed;
 	int	width;
 	int	stereo;
+	int	srclength;	/* streamed sfx: samples at source rate, else 0	*/
+	int	srcspeed;
+	int	srcwidth;
 	byte	data[1];	/* variable sized	*/
 } sfxcache_t;
 
@@ -173,6 +176,7 @@ extern	cvar_t		snd_mixspeed;
 extern	cvar_t		snd_filterquality;
 extern	cvar_t		sfxvolume;
 extern	cvar_t		loadas8bit;
+extern	cvar_t		snd_streamsfx;
 
 #define	MAX_RAW_SAMPLES	8192
 extern	portable_samplepair_t	s_rawsamples[MAX_RAW_SAMPLES];
@@ -182,6 +186,10 @@ extern	cvar_t		bgmvolume;
 void S_LocalSound (const char *name);
 sfxcache_t *S_LoadSound (sfx_t *s);
 
+/* polyphase resampler: output samples [pos, pos+count) of a mono source */
+void S_ResampleChunk (const byte *src, int srcwidth, int srclength, float ratio,
+		      int pos, int count, short *out);
+
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
 void SND_InitScaletable (void);
@@ -238,6 +238,15 @@ typedef int	ssize_t;
 #define inline __inline
 #endif	/* _MSC_VER */
 
+/* SSE2 code paths: only compiled where the compiler targets SSE2 anyway
+ * (all x86_64, and i386 with -msse2 or /arch:SSE2), and used only when
+ * host_parms->cpufeatures says the CPU has it. */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+   (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define USE_SSE2	1
+#include <emmintrin.h>
+#endif
+
 /*==========================================================================*/
 
 
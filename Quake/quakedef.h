@@ -203,9 +203,12 @@ typedef struct
 	void	*membase;
 	int	memsize;
 	int	numcpus;
+	int	cpufeatures;	// CPU_* flags, cleared by -nosimd
 	int	errstate;
 } quakeparms_t;
 
+#define	CPU_SSE2	(1 << 0)
+
 #include "common.h"
 #include "bspfile.h"
 #include "sys.h"
@@ -218,6 +221,8 @@ typedef struct
 
 #include "cmd.h"
 #include "crc.h"
+#include "tasks.h"
+#include "prof.h"
 
 #include "progs.h"
 #include "server.h"
@@ -283,6 +288,7 @@ extern	cvar_t		max_edicts; //johnfitz
 
 extern	qboolean	host_initialized;	// true if into command execution
 extern	double		host_frametime;
+extern	qboolean	host_fixedtick;		// local server stepped at host_tickrate
 extern	byte		*host_colormap;
 extern	int		host_framecount;	// incremented every frame, never reset
 extern	double		realtime;		// not bounded in any way, changed at
@@ -300,6 +306,8 @@ extern filelist_item_t	*demolist;
 
 void Host_ClearMemory (void);
 void Host_ServerFrame (void);
+qboolean Host_InServerTask (void);
+float Host_TickFraction (void);
 void Host_InitCommands (void);
 void Host_Init (void);
 void Host_Shutdown(void);
@@ -327,6 +335,7 @@ extern int		current_skill;	// skill level for currently loaded level (in case
 					//  running, this reflects the level actually in use)
 
 extern qboolean		isDedicated;
+extern qboolean		isHeadless;	// -headless: no window, GL context, input or sound
 
 extern int		minimum_memory;
 
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 extern cvar_t r_drawflat, gl_overbright_models, gl_fullbrights, r_lerpmodels, r_lerpmove; //johnfitz
+extern cvar_t r_instancing;
 
 //up to 16 color translated skins
 gltexture_t *playertextures[MAX_SCOREBOARD]; //johnfitz -- changed to an array of pointers
@@ -86,6 +87,21 @@ static GLuint useAlphaTestLoc;
 #define pose2NormalAttrIndex 3
 #define texCoordsAttrIndex 4
 
+// instanced variant: the per-entity uniforms above become per-instance attributes
+static GLuint r_alias_instanced_program;
+
+static GLuint instTexLoc;
+static GLuint instFullbrightTexLoc;
+static GLuint instUseFullbrightTexLoc;
+static GLuint instUseOverbrightLoc;
+static GLuint instUseAlphaTestLoc;
+
+#define instanceRow0AttrIndex 5
+#define instanceRow1AttrIndex 6
+#define instanceRow2AttrIndex 7
+#define instanceLightAttrIndex 8
+#define instanceShadeAttrIndex 9
+
 /*
 =============
 GLARB_GetXYZOffset
@@ -114,6 +130,21 @@ static void *GLARB_GetNormalOffset (aliashdr_t *hdr, int pose)
 	return (void *)(currententity->model->vboxyzofs + (hdr->numverts_vbo * pose * sizeof (meshxyz_t)) + normaloffs);
 }
 
+/*
+=============
+GLARB_SetTexCoordPointer
+
+Points the texcoord attribute at the model's meshst_t or meshst16_t array.
+=============
+*/
+static void GLARB_SetTexCoordPointer (qmodel_t *m)
+{
+	if (m->vboshortst)
+		GL_VertexAttribPointerFunc (texCoordsAttrIndex, 2, GL_UNSIGNED_SHORT, GL_TRUE, 0, (void *)(intptr_t)m->vbostofs);
+	else
+		GL_VertexAttribPointerFunc (texCoordsAttrIndex, 2, GL_FLOAT, GL_FALSE, 0, (void *)(intptr_t)m->vbostofs);
+}
+
 /*
 =============
 GLAlias_CreateShaders
@@ -192,6 +223,56 @@ void GLAlias_CreateShaders (void)
 		"	gl_FragColor = result;\n"
 		"}\n";
 
+	const glsl_attrib_binding_t instancedBindings[] = {
+		{ "TexCoords", texCoordsAttrIndex },
+		{ "Pose1Vert", pose1VertexAttrIndex },
+		{ "Pose1Normal", pose1NormalAttrIndex },
+		{ "Pose2Vert", pose2VertexAttrIndex },
+		{ "Pose2Normal", pose2NormalAttrIndex },
+		{ "InstanceRow0", instanceRow0AttrIndex },
+		{ "InstanceRow1", instanceRow1AttrIndex },
+		{ "InstanceRow2", instanceRow2AttrIndex },
+		{ "InstanceLight", instanceLightAttrIndex },
+		{ "InstanceShade", instanceShadeAttrIndex }
+	};
+
+	const GLchar *instancedVertSource = \
+		"#version 110\n"
+		"\n"
+		"attribute vec4 TexCoords; // only xy are used \n"
+		"attribute vec4 Pose1Vert;\n"
+		"attribute vec3 Pose1Normal;\n"
+		"attribute vec4 Pose2Vert;\n"
+		"attribute vec3 Pose2Normal;\n"
+		"attribute vec4 InstanceRow0; // rows of the model to world matrix \n"
+		"attribute vec4 InstanceRow1;\n"
+		"attribute vec4 InstanceRow2;\n"
+		"attribute vec4 InstanceLight; // LightColor \n"
+		"attribute vec4 InstanceShade; // xyz = ShadeVector, w = Blend \n"
+		"\n"
+		"varying float FogFragCoord;\n"
+		"\n"
+		"float r_avertexnormal_dot(vec3 vertexnormal) // from MH \n"
+		"{\n"
+		"        float dot = dot(vertexnormal, InstanceShade.xyz);\n"
+		"        // wtf - this reproduces anorm_dots within as reasonable a degree of tolerance as the >= 0 case\n"
+		"        if (dot < 0.0)\n"
+		"            return 1.0 + dot * (13.0 / 44.0);\n"
+		"        else\n"
+		"            return 1.0 + dot;\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	gl_TexCoord[0] = TexCoords;\n"
+		"	vec4 lerpedVert = mix(vec4(Pose1Vert.xyz, 1.0), vec4(Pose2Vert.xyz, 1.0), InstanceShade.w);\n"
+		"	vec4 worldVert = vec4(dot(InstanceRow0, lerpedVert), dot(InstanceRow1, lerpedVert), dot(InstanceRow2, lerpedVert), 1.0);\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * worldVert;\n"
+		"	FogFragCoord = gl_Position.w;\n"
+		"	float dot1 = r_avertexnormal_dot(Pose1Normal);\n"
+		"	float dot2 = r_avertexnormal_dot(Pose2Normal);\n"
+		"	gl_FrontColor = InstanceLight * vec4(vec3(mix(dot1, dot2, InstanceShade.w)), 1.0);\n"
+		"}\n";
+
 	if (!gl_glsl_alias_able)
 		return;
 
@@ -209,6 +290,21 @@ void GLAlias_CreateShaders (void)
 		useOverbrightLoc = GL_GetUniformLocation (&r_alias_program, "UseOverbright");
 		useAlphaTestLoc = GL_GetUniformLocation (&r_alias_program, "UseAlphaTest");
 	}
+
+	r_alias_instanced_program = 0;
+	if (r_alias_program != 0 && gl_instanced_arrays_able)
+	{
+		r_alias_instanced_program = GL_CreateProgram (instancedVertSource, fragSource, sizeof(instancedBindings)/sizeof(instancedBindings[0]), instancedBindings);
+
+		if (r_alias_instanced_program != 0)
+		{
+			instTexLoc = GL_GetUniformLocation (&r_alias_instanced_program, "Tex");
+			instFullbrightTexLoc = GL_GetUniformLocation (&r_alias_instanced_program, "FullbrightTex");
+			instUseFullbrightTexLoc = GL_GetUniformLocation (&r_alias_instanced_program, "UseFullbrightTex");
+			instUseOverbrightLoc = GL_GetUniformLocation (&r_alias_instanced_program, "UseOverbright");
+			instUseAlphaTestLoc = GL_GetUniformLocation (&r_alias_instanced_program, "UseAlphaTest");
+		}
+	}
 }
 
 /*
@@ -249,7 +345,7 @@ void GL_DrawAliasFrame_GLSL (aliashdr_t *paliashdr, lerpdata_t lerpdata, gltextu
 	GL_EnableVertexAttribArrayFunc (pose1NormalAttrIndex);
 	GL_EnableVertexAttribArrayFunc (pose2NormalAttrIndex);
 
-	GL_VertexAttribPointerFunc (texCoordsAttrIndex, 2, GL_FLOAT, GL_FALSE, 0, (void *)(intptr_t)currententity->model->vbostofs);
+	GLARB_SetTexCoordPointer (currententity->model);
 	GL_VertexAttribPointerFunc (pose1VertexAttrIndex, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof (meshxyz_t), GLARB_GetXYZOffset (paliashdr, lerpdata.pose1));
 	GL_VertexAttribPointerFunc (pose2VertexAttrIndex, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof (meshxyz_t), GLARB_GetXYZOffset (paliashdr, lerpdata.pose2));
 // GL_TRUE to normalize the signed bytes to [-1 .. 1]
@@ -617,6 +713,36 @@ void R_SetupAliasLighting (entity_t	*e)
 	VectorScale (lightcolor, 1.0f / 200.0f, lightcolor);
 }
 
+/*
+=================
+R_SetupAliasSkin -- picks the skin and fullbright textures for this frame,
+including the player colormap
+=================
+*/
+static void R_SetupAliasSkin (entity_t *e, aliashdr_t *paliashdr, gltexture_t **tx, gltexture_t **fb)
+{
+	int			i, anim, skinnum;
+
+	anim = (int)(cl.time*10) & 3;
+	skinnum = e->skinnum;
+	if ((skinnum >= paliashdr->numskins) || (skinnum < 0))
+	{
+		Con_DPrintf ("R_DrawAliasModel: no such skin # %d for '%s'\n", skinnum, e->model->name);
+		// ericw -- display skin 0 for winquake compatibility
+		skinnum = 0;
+	}
+	*tx = paliashdr->gltextures[skinnum][anim];
+	*fb = paliashdr->fbtextures[skinnum][anim];
+	if (e->colormap != vid.colormap && !gl_nocolors.value)
+	{
+		i = e - cl_entities;
+		if (i >= 1 && i<=cl.maxclients /* && !strcmp (currententity->model->name, "progs/player.mdl") */)
+		    *tx = playertextures[i - 1];
+	}
+	if (!gl_fullbrights.value)
+		*fb = NULL;
+}
+
 /*
 =================
 R_DrawAliasModel -- johnfitz -- almost completely rewritten
@@ -625,7 +751,6 @@ R_DrawAliasModel -- johnfitz -- almost completely rewritten
 void R_DrawAliasModel (entity_t *e)
 {
 	aliashdr_t	*paliashdr;
-	int			i, anim, skinnum;
 	gltexture_t	*tx, *fb;
 	lerpdata_t	lerpdata;
 	qboolean	alphatest = !!(e->model->flags & MF_HOLEY);
@@ -689,24 +814,7 @@ void R_DrawAliasModel (entity_t *e)
 	// set up textures
 	//
 	GL_DisableMultitexture();
-	anim = (int)(cl.time*10) & 3;
-	skinnum = e->skinnum;
-	if ((skinnum >= paliashdr->numskins) || (skinnum < 0))
-	{
-		Con_DPrintf ("R_DrawAliasModel: no such skin # %d for '%s'\n", skinnum, e->model->name);
-		// ericw -- display skin 0 for winquake compatibility
-		skinnum = 0;
-	}
-	tx = paliashdr->gltextures[skinnum][anim];
-	fb = paliashdr->fbtextures[skinnum][anim];
-	if (e->colormap != vid.colormap && !gl_nocolors.value)
-	{
-		i = e - cl_entities;
-		if (i >= 1 && i<=cl.maxclients /* && !strcmp (currententity->model->name, "progs/player.mdl") */)
-		    tx = playertextures[i - 1];
-	}
-	if (!gl_fullbrights.value)
-		fb = NULL;
+	R_SetupAliasSkin (e, paliashdr, &tx, &fb);
 
 	//
 	// draw it
@@ -894,6 +1002,263 @@ cleanup:
 	glPopMatrix ();
 }
 
+//==============================================================================
+//
+//  INSTANCED ALIAS MODELS
+//
+//  Opaque alias entities are queued by R_BatchAliasModel instead of drawn,
+//  then R_FlushAliasBatches groups them by model, skin and pose pair and
+//  draws each group with one glDrawElementsInstanced. Transform, lerp blend
+//  and lighting go in a per-instance vertex buffer. Entities that need any
+//  of the other render paths (alpha, r_drawflat, r_fullbright, r_lightmap,
+//  no instancing support) still go through R_DrawAliasModel.
+//
+//==============================================================================
+
+typedef struct
+{
+	float		rows[3][4];	// model to world transform
+	float		light[4];	// lightcolor, entalpha
+	float		shade[4];	// shadevector, pose blend
+} aliasinstance_t;
+
+typedef struct
+{
+	entity_t	*entity;
+	aliashdr_t	*paliashdr;
+	gltexture_t	*tx, *fb;
+	short		pose1, pose2;
+	aliasinstance_t	instance;
+} aliasbatch_t;
+
+static aliasbatch_t		alias_batch[MAX_VISEDICTS];
+static aliasinstance_t	alias_instances[MAX_VISEDICTS];
+static int				alias_numbatched;
+static GLuint			alias_instance_vbo;
+
+/*
+=================
+R_BatchAliasModel
+
+Sets up frame, transform and lighting exactly like R_DrawAliasModel and
+queues the entity for R_FlushAliasBatches. Returns false if the entity has
+to be drawn with R_DrawAliasModel instead.
+=================
+*/
+qboolean R_BatchAliasModel (entity_t *e)
+{
+	aliashdr_t	*paliashdr;
+	lerpdata_t	lerpdata;
+	aliasbatch_t	*b;
+	vec3_t		angles, forward, right, up;
+	float		*row;
+	int			i;
+
+	if (!r_instancing.value || !r_alias_instanced_program)
+		return false;
+	if (r_drawflat_cheatsafe || r_fullbright_cheatsafe || r_lightmap_cheatsafe)
+		return false;
+	if (ENTALPHA_DECODE(e->alpha) != 1 || e == &cl.viewent)
+		return false;
+	if (alias_numbatched == MAX_VISEDICTS)
+		return false;
+
+	paliashdr = (aliashdr_t *)Mod_Extradata (e->model);
+	R_SetupAliasFrame (paliashdr, e->frame, &lerpdata);
+	R_SetupEntityTransform (e, &lerpdata);
+
+	if (R_CullModelForEntity(e))
+		return true;
+
+	overbright = gl_overbright_models.value;
+	rs_aliaspolys += paliashdr->numtris;
+	R_SetupAliasLighting (e);
+
+	b = &alias_batch[alias_numbatched++];
+	b->entity = e;
+	b->paliashdr = paliashdr;
+	R_SetupAliasSkin (e, paliashdr, &b->tx, &b->fb);
+	b->pose1 = lerpdata.pose1;
+	b->pose2 = lerpdata.pose2;
+
+	// R_RotateForEntity plus the scale_origin/scale from R_DrawAliasModel;
+	// its pitch goes the other way from AngleVectors
+	angles[0] = -lerpdata.angles[0];
+	angles[1] = lerpdata.angles[1];
+	angles[2] = lerpdata.angles[2];
+	AngleVectors (angles, forward, right, up);
+	for (i = 0; i < 3; i++)
+	{
+		row = b->instance.rows[i];
+		row[0] = forward[i] * paliashdr->scale[0];
+		row[1] = -right[i] * paliashdr->scale[1];
+		row[2] = up[i] * paliashdr->scale[2];
+		row[3] = lerpdata.origin[i] + forward[i] * paliashdr->scale_origin[0]
+			- right[i] * paliashdr->scale_origin[1] + up[i] * paliashdr->scale_origin[2];
+	}
+
+	b->instance.light[0] = lightcolor[0];
+	b->instance.light[1] = lightcolor[1];
+	b->instance.light[2] = lightcolor[2];
+	b->instance.light[3] = 1;
+	b->instance.shade[0] = shadevector[0];
+	b->instance.shade[1] = shadevector[1];
+	b->instance.shade[2] = shadevector[2];
+	b->instance.shade[3] = (lerpdata.pose1 != lerpdata.pose2) ? lerpdata.blend : 0;
+
+	return true;
+}
+
+/*
+=================
+R_AliasBatchCompare -- orders queued entities so instances sharing a draw are adjacent
+=================
+*/
+static int R_AliasBatchCompare (const void *a, const void *b)
+{
+	const aliasbatch_t *ba = (const aliasbatch_t *)a;
+	const aliasbatch_t *bb = (const aliasbatch_t *)b;
+
+	if (ba->entity->model != bb->entity->model)
+		return ((uintptr_t)ba->entity->model < (uintptr_t)bb->entity->model) ? -1 : 1;
+	if (ba->tx != bb->tx)
+		return ((uintptr_t)ba->tx < (uintptr_t)bb->tx) ? -1 : 1;
+	if (ba->fb != bb->fb)
+		return ((uintptr_t)ba->fb < (uintptr_t)bb->fb) ? -1 : 1;
+	if (ba->pose1 != bb->pose1)
+		return ba->pose1 - bb->pose1;
+	return ba->pose2 - bb->pose2;
+}
+
+/*
+=================
+GL_DrawAliasInstances -- draws count queued entities that share model, skin and poses
+=================
+*/
+static void GL_DrawAliasInstances (aliasbatch_t *b, int first, int count)
+{
+	aliashdr_t	*paliashdr = b->paliashdr;
+	intptr_t	base = first * sizeof(aliasinstance_t);
+
+	currententity = b->entity; // for GLARB_GetXYZOffset / GLARB_GetNormalOffset
+
+	GL_BindBuffer (GL_ARRAY_BUFFER, currententity->model->meshvbo);
+	GL_BindBuffer (GL_ELEMENT_ARRAY_BUFFER, currententity->model->meshindexesvbo);
+
+	GLARB_SetTexCoordPointer (currententity->model);
+	GL_VertexAttribPointerFunc (pose1VertexAttrIndex, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof (meshxyz_t), GLARB_GetXYZOffset (paliashdr, b->pose1));
+	GL_VertexAttribPointerFunc (pose2VertexAttrIndex, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof (meshxyz_t), GLARB_GetXYZOffset (paliashdr, b->pose2));
+	GL_VertexAttribPointerFunc (pose1NormalAttrIndex, 4, GL_BYTE, GL_TRUE, sizeof (meshxyz_t), GLARB_GetNormalOffset (paliashdr, b->pose1));
+	GL_VertexAttribPointerFunc (pose2NormalAttrIndex, 4, GL_BYTE, GL_TRUE, sizeof (meshxyz_t), GLARB_GetNormalOffset (paliashdr, b->pose2));
+
+	GL_BindBuffer (GL_ARRAY_BUFFER, alias_instance_vbo);
+	GL_VertexAttribPointerFunc (instanceRow0AttrIndex, 4, GL_FLOAT, GL_FALSE, sizeof (aliasinstance_t), (void *)(base + offsetof (aliasinstance_t, rows)));
+	GL_VertexAttribPointerFunc (instanceRow1AttrIndex, 4, GL_FLOAT, GL_FALSE, sizeof (aliasinstance_t), (void *)(base + offsetof (aliasinstance_t, rows) + 4 * sizeof(float)));
+	GL_VertexAttribPointerFunc (instanceRow2AttrIndex, 4, GL_FLOAT, GL_FALSE, sizeof (aliasinstance_t), (void *)(base + offsetof (aliasinstance_t, rows) + 8 * sizeof(float)));
+	GL_VertexAttribPointerFunc (instanceLightAttrIndex, 4, GL_FLOAT, GL_FALSE, sizeof (aliasinstance_t), (void *)(base + offsetof (aliasinstance_t, light)));
+	GL_VertexAttribPointerFunc (instanceShadeAttrIndex, 4, GL_FLOAT, GL_FALSE, sizeof (aliasinstance_t), (void *)(base + offsetof (aliasinstance_t, shade)));
+
+	GL_Uniform1iFunc (instUseFullbrightTexLoc, (b->fb != NULL) ? 1 : 0);
+	GL_Uniform1iFunc (instUseAlphaTestLoc, (currententity->model->flags & MF_HOLEY) ? 1 : 0);
+
+	GL_SelectTexture (GL_TEXTURE0);
+	GL_Bind (b->tx);
+
+	if (b->fb)
+	{
+		GL_SelectTexture (GL_TEXTURE1);
+		GL_Bind (b->fb);
+	}
+
+	GL_DrawElementsInstancedFunc (GL_TRIANGLES, paliashdr->numindexes, GL_UNSIGNED_SHORT, (void *)(intptr_t)currententity->model->vboindexofs, count);
+
+	rs_aliaspasses += paliashdr->numtris * count;
+}
+
+/*
+=================
+R_FlushAliasBatches -- draws everything queued by R_BatchAliasModel
+=================
+*/
+void R_FlushAliasBatches (void)
+{
+	int		i, first, count;
+
+	if (!alias_numbatched)
+		return;
+
+	qsort (alias_batch, alias_numbatched, sizeof(aliasbatch_t), R_AliasBatchCompare);
+	for (i = 0; i < alias_numbatched; i++)
+		alias_instances[i] = alias_batch[i].instance;
+
+	if (!alias_instance_vbo)
+		GL_GenBuffersFunc (1, &alias_instance_vbo);
+	GL_BindBuffer (GL_ARRAY_BUFFER, alias_instance_vbo);
+	GL_BufferDataFunc (GL_ARRAY_BUFFER, alias_numbatched * sizeof(aliasinstance_t), alias_instances, GL_STREAM_DRAW);
+
+	if (gl_smoothmodels.value && !r_drawflat_cheatsafe)
+		glShadeModel (GL_SMOOTH);
+	if (gl_affinemodels.value)
+		glHint (GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
+	GL_DisableMultitexture();
+
+	GL_UseProgramFunc (r_alias_instanced_program);
+
+	for (i = texCoordsAttrIndex; i >= pose1VertexAttrIndex; i--)
+		GL_EnableVertexAttribArrayFunc (i);
+	for (i = instanceRow0AttrIndex; i <= instanceShadeAttrIndex; i++)
+	{
+		GL_EnableVertexAttribArrayFunc (i);
+		GL_VertexAttribDivisorFunc (i, 1);
+	}
+
+	GL_Uniform1iFunc (instTexLoc, 0);
+	GL_Uniform1iFunc (instFullbrightTexLoc, 1);
+	GL_Uniform1fFunc (instUseOverbrightLoc, gl_overbright_models.value ? 1 : 0);
+
+	for (first = 0; first < alias_numbatched; first += count)
+	{
+		for (count = 1; first + count < alias_numbatched; count++)
+			if (R_AliasBatchCompare (&alias_batch[first], &alias_batch[first + count]))
+				break;
+		GL_DrawAliasInstances (&alias_batch[first], first, count);
+	}
+
+// clean up
+	for (i = instanceRow0AttrIndex; i <= instanceShadeAttrIndex; i++)
+	{
+		GL_VertexAttribDivisorFunc (i, 0);
+		GL_DisableVertexAttribArrayFunc (i);
+	}
+	for (i = texCoordsAttrIndex; i >= pose1VertexAttrIndex; i--)
+		GL_DisableVertexAttribArrayFunc (i);
+
+	GL_UseProgramFunc (0);
+	GL_SelectTexture (GL_TEXTURE0);
+
+	glHint (GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+	glShadeModel (GL_FLAT);
+
+	alias_numbatched = 0;
+}
+
+/*
+=================
+R_DeleteAliasInstanceBuffer -- the VBO doesn't survive a mode change
+=================
+*/
+void R_DeleteAliasInstanceBuffer (void)
+{
+	if (!alias_instance_vbo)
+		return;
+
+	GL_DeleteBuffersFunc (1, &alias_instance_vbo);
+	alias_instance_vbo = 0;
+	alias_numbatched = 0;
+
+	GL_ClearBufferBindings ();
+}
+
 //johnfitz -- values for shadow matrix
 #define SHADOW_SKEW_X -0.7 //skew along x axis. -0.7 to mimic glquake shadows
 #define SHADOW_SKEW_Y 0 //skew along y axis. 0 to mimic glquake shadows
@@ -768,6 +768,8 @@ int AllocBlock (int w, int h, int *x, int *y)
 }
 
 
+static void R_BuildLightMapInto (msurface_t *surf, byte *dest, int stride, unsigned *lights);
+
 mvertex_t	*r_pcurrentvertbase;
 qmodel_t	*currentmodel;
 
@@ -781,15 +783,49 @@ GL_CreateSurfaceLightmap
 void GL_CreateSurfaceLightmap (msurface_t *surf)
 {
 	int		smax, tmax;
-	byte	*base;
 
 	smax = (surf->extents[0]>>4)+1;
 	tmax = (surf->extents[1]>>4)+1;
 
 	surf->lightmaptexturenum = AllocBlock (smax, tmax, &surf->light_s, &surf->light_t);
-	base = lightmaps + surf->lightmaptexturenum*lightmap_bytes*BLOCK_WIDTH*BLOCK_HEIGHT;
-	base += (surf->light_t * BLOCK_WIDTH + surf->light_s) * lightmap_bytes;
-	R_BuildLightMap (surf, base, BLOCK_WIDTH*lightmap_bytes);
+}
+
+/*
+========================
+GL_FillLightmapsTask -- builds the lightmaps of a run of surfaces on a worker thread
+
+the blocks were already allocated, so every surface writes its own
+rectangle of lightmaps[] and only needs a private blocklights buffer
+========================
+*/
+#define	LIGHTMAP_SURFS_PER_TASK	512
+
+typedef struct
+{
+	msurface_t	*surfaces;
+	int			count;
+} lightmaptask_t;
+
+static void GL_FillLightmapsTask (void *data)
+{
+	lightmaptask_t	*task = (lightmaptask_t *) data;
+	unsigned		*lights;
+	msurface_t		*surf;
+	byte			*base;
+	int				i;
+
+	lights = (unsigned *) malloc (sizeof(blocklights));
+	if (!lights)
+		Sys_Error ("GL_FillLightmapsTask: out of memory");
+	for (i = 0, surf = task->surfaces; i < task->count; i++, surf++)
+	{
+		if (surf->flags & SURF_DRAWTILED)
+			continue;
+		base = lightmaps + surf->lightmaptexturenum*lightmap_bytes*BLOCK_WIDTH*BLOCK_HEIGHT;
+		base += (surf->light_t * BLOCK_WIDTH + surf->light_s) * lightmap_bytes;
+		R_BuildLightMapInto (surf, base, BLOCK_WIDTH*lightmap_bytes, lights);
+	}
+	free (lights);
 }
 
 /*
@@ -865,6 +901,369 @@ void BuildSurfaceDisplayList (msurface_t *fa)
 	poly->numverts = lnumverts;
 }
 
+/*
+=============================================================
+
+	LIGHTMAP CACHE
+
+The packed and built lightmaps only depend on the brush models, the
+.lit files and a few settings, so they are saved to
+<gamedir>/cache/<map>.lmc after the first load. Later loads of the same
+map check the key and copy the file back instead of rebuilding. The
+file is native-endian and flat, since it never leaves the machine.
+
+=============================================================
+*/
+
+cvar_t r_lightmapcache = {"r_lightmapcache", "1", CVAR_ARCHIVE};
+
+#define	LMCACHE_MAGIC	(('C'<<24)+('M'<<16)+('L'<<8)+'Q')	// "QLMC"
+#define	LMCACHE_VERSION	1
+
+typedef struct
+{
+	int		magic;
+	int		version;
+	int		blockwidth, blockheight;
+	int		lightmapbytes, format, overbright;
+	int		nummodels;		// lmcachemodel_t keys follow the header
+	int		numsurfaces;	// then one lmcachesurf_t per lightmapped surface
+	int		numlightmaps;	// then allocated[] and lightmaps[] for each lightmap
+} lmcacheheader_t;
+
+typedef struct
+{
+	unsigned int	filehash;
+	int				numsurfaces;
+} lmcachemodel_t;
+
+typedef struct
+{
+	int		texnum;
+	short	s, t;
+} lmcachesurf_t;
+
+static lmcachemodel_t	lmcache_models[MAX_MODELS];
+
+/*
+================
+GL_LightmapCacheKey -- fills in the header and model keys for the current precache list
+================
+*/
+static void GL_LightmapCacheKey (lmcacheheader_t *header)
+{
+	qmodel_t	*m;
+	int			i, j;
+
+	memset (header, 0, sizeof(*header));
+	header->magic = LMCACHE_MAGIC;
+	header->version = LMCACHE_VERSION;
+	header->blockwidth = BLOCK_WIDTH;
+	header->blockheight = BLOCK_HEIGHT;
+	header->lightmapbytes = lightmap_bytes;
+	header->format = gl_lightmap_format;
+	header->overbright = !!gl_overbright.value;
+
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		lmcache_models[header->nummodels].filehash = m->filehash;
+		lmcache_models[header->nummodels].numsurfaces = 0;
+		for (i=0 ; i<m->numsurfaces ; i++)
+		{
+			if (!(m->surfaces[i].flags & SURF_DRAWTILED))
+				lmcache_models[header->nummodels].numsurfaces++;
+		}
+		header->numsurfaces += lmcache_models[header->nummodels].numsurfaces;
+		header->nummodels++;
+	}
+}
+
+/*
+================
+GL_LightmapCachePath
+================
+*/
+static void GL_LightmapCachePath (char *path, size_t size)
+{
+	char	base[MAX_QPATH];
+
+	COM_FileBase (cl.worldmodel->name, base, sizeof(base));
+	q_snprintf (path, size, "%s/cache/%s.lmc", com_gamedir, base);
+}
+
+/*
+================
+GL_LightmapCacheFits
+
+The header only shows the cache was made for this map; a damaged body
+must not place a surface outside the lightmaps or its block
+================
+*/
+static qboolean GL_LightmapCacheFits (const lmcacheheader_t *header, const lmcachesurf_t *in)
+{
+	const int	*heights;
+	msurface_t	*surf;
+	qmodel_t	*m;
+	int			i, j, smax, tmax;
+
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
+		{
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+			smax = (surf->extents[0]>>4)+1;
+			tmax = (surf->extents[1]>>4)+1;
+			if (in->texnum < 0 || in->texnum >= header->numlightmaps ||
+			    in->s < 0 || in->s + smax > BLOCK_WIDTH ||
+			    in->t < 0 || in->t + tmax > BLOCK_HEIGHT)
+				return false;
+			in++;
+		}
+	}
+
+	heights = (const int *) in;
+	for (i = 0; i < header->numlightmaps * BLOCK_WIDTH; i++)
+	{
+		if (heights[i] < 0 || heights[i] > BLOCK_HEIGHT)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+================
+GL_LoadLightmapCache -- returns false if there is no usable cache for this map
+================
+*/
+static qboolean GL_LoadLightmapCache (void)
+{
+	char			path[MAX_OSPATH];
+	lmcacheheader_t	key, *header;
+	lmcachesurf_t	*in;
+	msurface_t		*surf;
+	qmodel_t		*m;
+	byte			*buf, *texels;
+	FILE			*f;
+	int				len, expected;
+	int				i, j, k, maps;
+
+	GL_LightmapCacheKey (&key);
+	GL_LightmapCachePath (path, sizeof(path));
+
+	f = fopen (path, "rb");
+	if (!f)
+		return false;
+	fseek (f, 0, SEEK_END);
+	len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+	if (len < (int) sizeof(key))
+	{
+		fclose (f);
+		return false;
+	}
+	buf = (byte *) malloc (len);
+	if (!buf)
+		Sys_Error ("GL_LoadLightmapCache: out of memory");
+	if (fread (buf, 1, len, f) != (size_t) len)
+	{
+		fclose (f);
+		free (buf);
+		return false;
+	}
+	fclose (f);
+
+	header = (lmcacheheader_t *) buf;
+	expected = sizeof(key) + key.nummodels * sizeof(lmcachemodel_t) + key.numsurfaces * sizeof(lmcachesurf_t);
+	if (memcmp (header, &key, offsetof(lmcacheheader_t, numlightmaps)) ||
+	    header->numlightmaps < 1 || header->numlightmaps > MAX_LIGHTMAPS ||
+	    len != expected + header->numlightmaps * (int) (BLOCK_WIDTH*sizeof(int) + BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes) ||
+	    memcmp (buf + sizeof(key), lmcache_models, key.nummodels * sizeof(lmcachemodel_t)))
+	{
+		free (buf);
+		return false;
+	}
+
+	// check every placement before touching the surfaces
+	in = (lmcachesurf_t *) (buf + sizeof(key) + key.nummodels * sizeof(lmcachemodel_t));
+	if (!GL_LightmapCacheFits (header, in))
+	{
+		free (buf);
+		return false;
+	}
+
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		r_pcurrentvertbase = m->vertexes;
+		currentmodel = m;
+		for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
+		{
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+			surf->lightmaptexturenum = in->texnum;
+			surf->light_s = in->s;
+			surf->light_t = in->t;
+			in++;
+
+			// what R_BuildLightMap would have left behind
+			surf->cached_dlight = false;
+			for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+				surf->cached_light[maps] = d_lightstylevalue[surf->styles[maps]];
+
+			BuildSurfaceDisplayList (surf);
+		}
+	}
+
+	k = header->numlightmaps;
+	memcpy (allocated, in, k * sizeof(allocated[0]));
+	texels = (byte *) in + k * sizeof(allocated[0]);
+	memcpy (lightmaps, texels, k * BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes);
+	last_lightmap_allocated = k - 1;
+
+	free (buf);
+	return true;
+}
+
+/*
+================
+GL_SaveLightmapCache
+================
+*/
+static void GL_SaveLightmapCache (void)
+{
+	char			path[MAX_OSPATH];
+	lmcacheheader_t	header;
+	lmcachesurf_t	*out, *surfs;
+	msurface_t		*surf;
+	qmodel_t		*m;
+	FILE			*f;
+	int				i, j;
+
+	GL_LightmapCacheKey (&header);
+	for (i = 0; i < MAX_LIGHTMAPS && allocated[i][0]; i++)
+		;
+	header.numlightmaps = i;
+	if (!header.numlightmaps)
+		return;
+
+	surfs = out = (lmcachesurf_t *) malloc (q_max(header.numsurfaces, 1) * sizeof(lmcachesurf_t));
+	if (!surfs)
+		Sys_Error ("GL_SaveLightmapCache: out of memory");
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
+		{
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+			out->texnum = surf->lightmaptexturenum;
+			out->s = surf->light_s;
+			out->t = surf->light_t;
+			out++;
+		}
+	}
+
+	GL_LightmapCachePath (path, sizeof(path));
+	COM_CreatePath (path);
+	f = fopen (path, "wb");
+	if (f)
+	{
+		fwrite (&header, sizeof(header), 1, f);
+		fwrite (lmcache_models, sizeof(lmcachemodel_t), header.nummodels, f);
+		fwrite (surfs, sizeof(lmcachesurf_t), header.numsurfaces, f);
+		fwrite (allocated, sizeof(allocated[0]), header.numlightmaps, f);
+		fwrite (lightmaps, BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes, header.numlightmaps, f);
+		fclose (f);
+	}
+	else
+		Con_DPrintf ("couldn't write %s\n", path);
+
+	free (surfs);
+}
+
+/*
+==================
+GL_CreateLightmaps -- packs every lightmapped surface and fills in the lightmaps
+==================
+*/
+static double GL_CreateLightmaps (double start)
+{
+	int		i, j, numtasks;
+	qmodel_t	*m;
+	taskgroup_t	group;
+	lightmaptask_t	*tasks;
+
+	numtasks = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		r_pcurrentvertbase = m->vertexes;
+		currentmodel = m;
+		for (i=0 ; i<m->numsurfaces ; i++)
+		{
+			//johnfitz -- rewritten to use SURF_DRAWTILED instead of the sky/water flags
+			if (m->surfaces[i].flags & SURF_DRAWTILED)
+				continue;
+			GL_CreateSurfaceLightmap (m->surfaces + i);
+			BuildSurfaceDisplayList (m->surfaces + i);
+			//johnfitz
+		}
+		numtasks += (m->numsurfaces + LIGHTMAP_SURFS_PER_TASK - 1) / LIGHTMAP_SURFS_PER_TASK;
+	}
+	start = Mod_AddLoadStage ("lm alloc", start);
+
+	//
+	// fill in the lightmaps on the worker threads
+	//
+	memset (&group, 0, sizeof(group));
+	tasks = (lightmaptask_t *) malloc (q_max(numtasks, 1) * sizeof(lightmaptask_t));
+	if (!tasks)
+		Sys_Error ("GL_CreateLightmaps: out of memory");
+	numtasks = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0 ; i<m->numsurfaces ; i += LIGHTMAP_SURFS_PER_TASK)
+		{
+			tasks[numtasks].surfaces = m->surfaces + i;
+			tasks[numtasks].count = q_min(LIGHTMAP_SURFS_PER_TASK, m->numsurfaces - i);
+			Task_Add (&group, GL_FillLightmapsTask, &tasks[numtasks]);
+			numtasks++;
+		}
+	}
+	Task_Wait (&group);
+	free (tasks);
+	return Mod_AddLoadStage ("lm build", start);
+}
+
 /*
 ==================
 GL_BuildLightmaps -- called at level load time
@@ -877,8 +1276,8 @@ void GL_BuildLightmaps (void)
 {
 	char	name[16];
 	byte	*data;
-	int		i, j;
-	qmodel_t	*m;
+	int		i;
+	double	start;
 
 	memset (allocated, 0, sizeof(allocated));
 	last_lightmap_allocated = 0;
@@ -904,23 +1303,16 @@ void GL_BuildLightmaps (void)
 		Sys_Error ("GL_BuildLightmaps: bad lightmap format");
 	}
 
-	for (j=1 ; j<MAX_MODELS ; j++)
+	start = Sys_ProfileTime ();
+	if (r_lightmapcache.value && GL_LoadLightmapCache ())
+		start = Mod_AddLoadStage ("lm cache", start);
+	else
 	{
-		m = cl.model_precache[j];
-		if (!m)
-			break;
-		if (m->name[0] == '*')
-			continue;
-		r_pcurrentvertbase = m->vertexes;
-		currentmodel = m;
-		for (i=0 ; i<m->numsurfaces ; i++)
+		start = GL_CreateLightmaps (start);
+		if (r_lightmapcache.value)
 		{
-			//johnfitz -- rewritten to use SURF_DRAWTILED instead of the sky/water flags
-			if (m->surfaces[i].flags & SURF_DRAWTILED)
-				continue;
-			GL_CreateSurfaceLightmap (m->surfaces + i);
-			BuildSurfaceDisplayList (m->surfaces + i);
-			//johnfitz
+			GL_SaveLightmapCache ();
+			start = Mod_AddLoadStage ("lm cache", start);
 		}
 	}
 
@@ -945,6 +1337,8 @@ void GL_BuildLightmaps (void)
 		//johnfitz
 	}
 
+	Mod_AddLoadStage ("lm upload", start);
+
 	//johnfitz -- warn about exceeding old limits
 	if (i >= 64)
 		Con_DWarning ("%i lightmaps exceeds standard limit of 64 (max = %d).\n", i, MAX_LIGHTMAPS);
@@ -1042,7 +1436,7 @@ void GL_BuildBModelVertexBuffer (void)
 R_AddDynamicLights
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+static void R_AddDynamicLights (msurface_t *surf, unsigned *lights)
 {
 	int			lnum;
 	int			sd, td;
@@ -1088,7 +1482,7 @@ void R_AddDynamicLights (msurface_t *surf)
 		local[1] -= surf->texturemins[1];
 
 		//johnfitz -- lit support via lordhavoc
-		bl = blocklights;
+		bl = lights;
 		cred = cl_dlights[lnum].color[0] * 256.0f;
 		cgreen = cl_dlights[lnum].color[1] * 256.0f;
 		cblue = cl_dlights[lnum].color[2] * 256.0f;
@@ -1127,10 +1521,11 @@ void R_AddDynamicLights (msurface_t *surf)
 ===============
 R_BuildLightMap -- johnfitz -- revised for lit support via lordhavoc
 
-Combine and scale multiple lightmaps into the 8.8 format in blocklights
+Combine and scale multiple lightmaps into the 8.8 format in lights,
+which must hold BLOCK_WIDTH*BLOCK_HEIGHT*3 values
 ===============
 */
-void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+static void R_BuildLightMapInto (msurface_t *surf, byte *dest, int stride, unsigned *lights)
 {
 	int			smax, tmax;
 	int			r,g,b;
@@ -1150,7 +1545,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	if (cl.worldmodel->lightdata)
 	{
 	// clear to no light
-		memset (&blocklights[0], 0, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
+		memset (lights, 0, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
 
 	// add all the lightmaps
 		if (lightmap)
@@ -1161,7 +1556,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 				scale = d_lightstylevalue[surf->styles[maps]];
 				surf->cached_light[maps] = scale;	// 8.8 fraction
 				//johnfitz -- lit support via lordhavoc
-				bl = blocklights;
+				bl = lights;
 				for (i=0 ; i<size ; i++)
 				{
 					*bl++ += *lightmap++ * scale;
@@ -1174,12 +1569,12 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 
 	// add all the dynamic lights
 		if (surf->dlightframe == r_framecount)
-			R_AddDynamicLights (surf);
+			R_AddDynamicLights (surf, lights);
 	}
 	else
 	{
 	// set to full bright if no light data
-		memset (&blocklights[0], 255, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
+		memset (lights, 255, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
 	}
 
 // bound, invert, and shift
@@ -1188,7 +1583,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	{
 	case GL_RGBA:
 		stride -= smax * 4;
-		bl = blocklights;
+		bl = lights;
 		for (i=0 ; i<tmax ; i++, dest += stride)
 		{
 			for (j=0 ; j<smax ; j++)
@@ -1214,7 +1609,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 		break;
 	case GL_BGRA:
 		stride -= smax * 4;
-		bl = blocklights;
+		bl = lights;
 		for (i=0 ; i<tmax ; i++, dest += stride)
 		{
 			for (j=0 ; j<smax ; j++)
@@ -1243,6 +1638,16 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	}
 }
 
+/*
+===============
+R_BuildLightMap -- main thread version, using the shared blocklights
+===============
+*/
+void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+{
+	R_BuildLightMapInto (surf, dest, stride, blocklights);
+}
+
 /*
 ===============
 R_UploadLightmap -- johnfitz -- uploads the modified lightmap to opengl if necessary
@@ -1315,6 +1720,9 @@ void R_RebuildAllLightmaps (void)
 		}
 	}
 
+	if (isHeadless)
+		return;
+
 	//for each lightmap, upload it
 	for (i=0; i<MAX_LIGHTMAPS; i++)
 	{
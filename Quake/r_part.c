@@ -32,11 +32,39 @@ int		ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int		ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int		ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-particle_t	*active_particles, *free_particles, *particles;
+/*
+particles are kept as a structure of arrays: live particles are always
+[0, r_activeparticles), dead ones are removed by moving the last one into
+their slot. the per-type behavior is a table of coefficients, so the update
+is the same arithmetic for every particle and runs four at a time.
+*/
+static float	*part_org[3], *part_vel[3];
+static float	*part_ramp, *part_die;
+static byte	*part_color, *part_type;
+
+int			r_numparticles;		// capacity
+int			r_activeparticles;
 
 vec3_t			r_pright, r_pup, r_ppn;
 
-int			r_numparticles;
+// vertex data, built once per frame and drawn for every view of it (both VR eyes)
+typedef struct
+{
+	float	xyz[3];
+	float	st[2];
+	byte	rgba[4];
+} partvert_t;
+
+static partvert_t	*part_verts;
+static int		part_numverts;
+static GLuint		part_vbo;
+static struct
+{
+	int	framecount;	// host_framecount, -1 if stale
+	vec3_t	vup, vright, vpn;
+	int	quads;
+	float	scalefactor;
+} part_vertcache;
 
 gltexture_t *particletexture, *particletexture1, *particletexture2, *particletexture3, *particletexture4; //johnfitz
 float texturescalefactor; //johnfitz -- compensate for apparent size of different particle textures
@@ -163,8 +191,18 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)
-			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	r_numparticles = (r_numparticles + 3) & ~3;	// SIMD update runs in blocks of four
+	for (i = 0; i < 3; i++)
+	{
+		part_org[i] = (float *) Hunk_AllocName (r_numparticles * sizeof(float), "particles");
+		part_vel[i] = (float *) Hunk_AllocName (r_numparticles * sizeof(float), "particles");
+	}
+	part_ramp = (float *) Hunk_AllocName (r_numparticles * sizeof(float), "particles");
+	part_die = (float *) Hunk_AllocName (r_numparticles * sizeof(float), "particles");
+	part_color = (byte *) Hunk_AllocName (r_numparticles, "particles");
+	part_type = (byte *) Hunk_AllocName (r_numparticles, "particles");
+	part_verts = (partvert_t *) Hunk_AllocName (r_numparticles * 4 * sizeof(partvert_t), "partverts");
+	part_vertcache.framecount = -1;
 
 	Cvar_RegisterVariable (&r_particles); //johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
@@ -173,6 +211,23 @@ void R_InitParticles (void)
 	R_InitParticleTextures (); //johnfitz
 }
 
+/*
+===============
+R_NewParticle -- returns the index of a fresh particle, or -1 if they are all in use
+===============
+*/
+static int R_NewParticle (void)
+{
+	int p;
+
+	if (r_activeparticles == r_numparticles)
+		return -1;
+	p = r_activeparticles++;
+	part_vel[0][p] = part_vel[1][p] = part_vel[2][p] = 0;
+	part_ramp[p] = 0;
+	return p;
+}
+
 /*
 ===============
 R_EntityParticles
@@ -189,7 +244,7 @@ float	timescale = 0.01;
 void R_EntityParticles (entity_t *ent)
 {
 	int		i;
-	particle_t	*p;
+	int			p;
 	float		angle;
 	float		sp, sy, cp, cy;
 //	float		sr, cr;
@@ -226,20 +281,16 @@ void R_EntityParticles (entity_t *ent)
 		forward[1] = cp*sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
-
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;
+
+		part_die[p] = cl.time + 0.01;
+		part_color[p] = 0x6f;
+		part_type[p] = pt_explode;
+
+		part_org[0][p] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;
+		part_org[1][p] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;
+		part_org[2][p] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;
 	}
 }
 
@@ -250,14 +301,8 @@ R_ClearParticles
 */
 void R_ClearParticles (void)
 {
-	int		i;
-
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i=0 ;i<r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	r_activeparticles = 0;
+	part_vertcache.framecount = -1;
 }
 
 /*
@@ -271,7 +316,7 @@ void R_ReadPointFile_f (void)
 	vec3_t	org;
 	int		r;
 	int		c;
-	particle_t	*p;
+	int			p;
 	char	name[MAX_QPATH];
 
 	if (cls.state != ca_connected)
@@ -296,21 +341,18 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = 99999;
-		p->color = (-c)&15;
-		p->type = pt_static;
-		VectorCopy (vec3_origin, p->vel);
-		VectorCopy (org, p->org);
+
+		part_die[p] = 99999;
+		part_color[p] = (-c)&15;
+		part_type[p] = pt_static;
+		part_org[0][p] = org[0];
+		part_org[1][p] = org[1];
+		part_org[2][p] = org[2];
 	}
 
 	fclose (f);
@@ -352,36 +394,32 @@ R_ParticleExplosion
 void R_ParticleExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	int			p;
 
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = rand()&3;
+
+		part_die[p] = cl.time + 5;
+		part_color[p] = ramp1[0];
+		part_ramp[p] = rand()&3;
 		if (i & 1)
 		{
-			p->type = pt_explode;
+			part_type[p] = pt_explode;
 			for (j=0 ; j<3 ; j++)
 			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
+				part_org[j][p] = org[j] + ((rand()%32)-16);
+				part_vel[j][p] = (rand()%512)-256;
 			}
 		}
 		else
 		{
-			p->type = pt_explode2;
+			part_type[p] = pt_explode2;
 			for (j=0 ; j<3 ; j++)
 			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
+				part_org[j][p] = org[j] + ((rand()%32)-16);
+				part_vel[j][p] = (rand()%512)-256;
 			}
 		}
 	}
@@ -395,27 +433,23 @@ R_ParticleExplosion2
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
 	int			i, j;
-	particle_t	*p;
+	int			p;
 	int			colorMod = 0;
 
 	for (i=0; i<512; i++)
 	{
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
+		part_die[p] = cl.time + 0.3;
+		part_color[p] = colorStart + (colorMod % colorLength);
 		colorMod++;
 
-		p->type = pt_blob;
+		part_type[p] = pt_blob;
 		for (j=0 ; j<3 ; j++)
 		{
-			p->org[j] = org[j] + ((rand()%32)-16);
-			p->vel[j] = (rand()%512)-256;
+			part_org[j][p] = org[j] + ((rand()%32)-16);
+			part_vel[j][p] = (rand()%512)-256;
 		}
 	}
 }
@@ -428,37 +462,33 @@ R_BlobExplosion
 void R_BlobExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	int			p;
 
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
-		p->die = cl.time + 1 + (rand()&8)*0.05;
+		part_die[p] = cl.time + 1 + (rand()&8)*0.05;
 
 		if (i & 1)
 		{
-			p->type = pt_blob;
-			p->color = 66 + rand()%6;
+			part_type[p] = pt_blob;
+			part_color[p] = 66 + rand()%6;
 			for (j=0 ; j<3 ; j++)
 			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
+				part_org[j][p] = org[j] + ((rand()%32)-16);
+				part_vel[j][p] = (rand()%512)-256;
 			}
 		}
 		else
 		{
-			p->type = pt_blob2;
-			p->color = 150 + rand()%6;
+			part_type[p] = pt_blob2;
+			part_color[p] = 150 + rand()%6;
 			for (j=0 ; j<3 ; j++)
 			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
+				part_org[j][p] = org[j] + ((rand()%32)-16);
+				part_vel[j][p] = (rand()%512)-256;
 			}
 		}
 	}
@@ -472,50 +502,46 @@ R_RunParticleEffect
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
 	int			i, j;
-	particle_t	*p;
+	int			p;
 
 	for (i=0 ; i<count ; i++)
 	{
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		if (count == 1024)
 		{	// rocket explosion
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = rand()&3;
+			part_die[p] = cl.time + 5;
+			part_color[p] = ramp1[0];
+			part_ramp[p] = rand()&3;
 			if (i & 1)
 			{
-				p->type = pt_explode;
+				part_type[p] = pt_explode;
 				for (j=0 ; j<3 ; j++)
 				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
+					part_org[j][p] = org[j] + ((rand()%32)-16);
+					part_vel[j][p] = (rand()%512)-256;
 				}
 			}
 			else
 			{
-				p->type = pt_explode2;
+				part_type[p] = pt_explode2;
 				for (j=0 ; j<3 ; j++)
 				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
+					part_org[j][p] = org[j] + ((rand()%32)-16);
+					part_vel[j][p] = (rand()%512)-256;
 				}
 			}
 		}
 		else
 		{
-			p->die = cl.time + 0.1*(rand()%5);
-			p->color = (color&~7) + (rand()&7);
-			p->type = pt_slowgrav;
+			part_die[p] = cl.time + 0.1*(rand()%5);
+			part_color[p] = (color&~7) + (rand()&7);
+			part_type[p] = pt_slowgrav;
 			for (j=0 ; j<3 ; j++)
 			{
-				p->org[j] = org[j] + ((rand()&15)-8);
-				p->vel[j] = dir[j]*15;// + (rand()%300)-150;
+				part_org[j][p] = org[j] + ((rand()&15)-8);
+				part_vel[j][p] = dir[j]*15;// + (rand()%300)-150;
 			}
 		}
 	}
@@ -529,7 +555,7 @@ R_LavaSplash
 void R_LavaSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
+	int			p;
 	float		vel;
 	vec3_t		dir;
 
@@ -537,28 +563,26 @@ void R_LavaSplash (vec3_t org)
 		for (j=-16 ; j<16 ; j++)
 			for (k=0 ; k<1 ; k++)
 			{
-				if (!free_particles)
+				if ((p = R_NewParticle ()) < 0)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
-				p->die = cl.time + 2 + (rand()&31) * 0.02;
-				p->color = 224 + (rand()&7);
-				p->type = pt_slowgrav;
+				part_die[p] = cl.time + 2 + (rand()&31) * 0.02;
+				part_color[p] = 224 + (rand()&7);
+				part_type[p] = pt_slowgrav;
 
 				dir[0] = j*8 + (rand()&7);
 				dir[1] = i*8 + (rand()&7);
 				dir[2] = 256;
 
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (rand()&63);
+				part_org[0][p] = org[0] + dir[0];
+				part_org[1][p] = org[1] + dir[1];
+				part_org[2][p] = org[2] + (rand()&63);
 
 				VectorNormalize (dir);
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				part_vel[0][p] = dir[0] * vel;
+				part_vel[1][p] = dir[1] * vel;
+				part_vel[2][p] = dir[2] * vel;
 			}
 }
 
@@ -570,7 +594,7 @@ R_TeleportSplash
 void R_TeleportSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
+	int			p;
 	float		vel;
 	vec3_t		dir;
 
@@ -578,28 +602,26 @@ void R_TeleportSplash (vec3_t org)
 		for (j=-16 ; j<16 ; j+=4)
 			for (k=-24 ; k<32 ; k+=4)
 			{
-				if (!free_particles)
+				if ((p = R_NewParticle ()) < 0)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
-				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
-				p->color = 7 + (rand()&7);
-				p->type = pt_slowgrav;
+				part_die[p] = cl.time + 0.2 + (rand()&7) * 0.02;
+				part_color[p] = 7 + (rand()&7);
+				part_type[p] = pt_slowgrav;
 
 				dir[0] = j*8;
 				dir[1] = i*8;
 				dir[2] = k*8;
 
-				p->org[0] = org[0] + i + (rand()&3);
-				p->org[1] = org[1] + j + (rand()&3);
-				p->org[2] = org[2] + k + (rand()&3);
+				part_org[0][p] = org[0] + i + (rand()&3);
+				part_org[1][p] = org[1] + j + (rand()&3);
+				part_org[2][p] = org[2] + k + (rand()&3);
 
 				VectorNormalize (dir);
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				part_vel[0][p] = dir[0] * vel;
+				part_vel[1][p] = dir[1] * vel;
+				part_vel[2][p] = dir[2] * vel;
 			}
 }
 
@@ -615,7 +637,7 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	vec3_t		vec;
 	float		len;
 	int			j;
-	particle_t	*p;
+	int			p;
 	int			dec;
 	static int	tracercount;
 
@@ -633,79 +655,76 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if ((p = R_NewParticle ()) < 0)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
-		VectorCopy (vec3_origin, p->vel);
-		p->die = cl.time + 2;
+		part_die[p] = cl.time + 2;
 
 		switch (type)
 		{
 			case 0:	// rocket trail
-				p->ramp = (rand()&3);
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				part_ramp[p] = (rand()&3);
+				part_color[p] = ramp3[(int)part_ramp[p]];
+				part_type[p] = pt_fire;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					part_org[j][p] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 1:	// smoke smoke
-				p->ramp = (rand()&3) + 2;
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				part_ramp[p] = (rand()&3) + 2;
+				part_color[p] = ramp3[(int)part_ramp[p]];
+				part_type[p] = pt_fire;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					part_org[j][p] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 2:	// blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
+				part_type[p] = pt_grav;
+				part_color[p] = 67 + (rand()&3);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					part_org[j][p] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 3:
 			case 5:	// tracer
-				p->die = cl.time + 0.5;
-				p->type = pt_static;
+				part_die[p] = cl.time + 0.5;
+				part_type[p] = pt_static;
 				if (type == 3)
-					p->color = 52 + ((tracercount&4)<<1);
+					part_color[p] = 52 + ((tracercount&4)<<1);
 				else
-					p->color = 230 + ((tracercount&4)<<1);
+					part_color[p] = 230 + ((tracercount&4)<<1);
 
 				tracercount++;
 
-				VectorCopy (start, p->org);
+				part_org[0][p] = start[0];
+				part_org[1][p] = start[1];
+				part_org[2][p] = start[2];
 				if (tracercount & 1)
 				{
-					p->vel[0] = 30*vec[1];
-					p->vel[1] = 30*-vec[0];
+					part_vel[0][p] = 30*vec[1];
+					part_vel[1][p] = 30*-vec[0];
 				}
 				else
 				{
-					p->vel[0] = 30*-vec[1];
-					p->vel[1] = 30*vec[0];
+					part_vel[0][p] = 30*-vec[1];
+					part_vel[1][p] = 30*vec[0];
 				}
 				break;
 
 			case 4:	// slight blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
+				part_type[p] = pt_grav;
+				part_color[p] = 67 + (rand()&3);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					part_org[j][p] = start[j] + ((rand()%6)-3);
 				len -= 3;
 				break;
 
 			case 6:	// voor trail
-				p->color = 9*16 + 8 + (rand()&3);
-				p->type = pt_static;
-				p->die = cl.time + 0.3;
+				part_color[p] = 9*16 + 8 + (rand()&3);
+				part_type[p] = pt_static;
+				part_die[p] = cl.time + 0.3;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()&15)-8);
+					part_org[j][p] = start[j] + ((rand()&15)-8);
 				break;
 		}
 
@@ -718,11 +737,79 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
 ===============
 */
+typedef struct
+{
+	float	velxy, velz;	// velocity scale
+	float	accelz;		// added to vertical velocity
+	float	ramp;		// added to ramp
+} partphys_t;
+
+static const int	*part_ramptable[8];	// color ramp per type, NULL if none
+static float		part_rampmax[8];
+
+static void CL_MoveParticles_C (const partphys_t *phys, int count, float frametime)
+{
+	int	i;
+	const partphys_t *ph;
+
+	for (i = 0; i < count; i++)
+	{
+		ph = &phys[part_type[i] & 7];
+
+		part_org[0][i] += part_vel[0][i] * frametime;
+		part_org[1][i] += part_vel[1][i] * frametime;
+		part_org[2][i] += part_vel[2][i] * frametime;
+
+		part_vel[0][i] *= ph->velxy;
+		part_vel[1][i] *= ph->velxy;
+		part_vel[2][i] = part_vel[2][i] * ph->velz + ph->accelz;
+		part_ramp[i] += ph->ramp;
+	}
+}
+
+#ifdef USE_SSE2
+static void CL_MoveParticles_SSE2 (const partphys_t *phys, int count, float frametime)
+{
+	int	i;
+	const partphys_t *a, *b, *c, *d;
+	__m128	ft = _mm_set1_ps (frametime);
+	__m128	vx, vy, vz, velxy, velz, accelz, ramp;
+
+	// r_numparticles is a multiple of four, so the last block may run into
+	// dead slots; their results are never looked at. The arrays are only
+	// as aligned as the hunk, so the loads and stores are unaligned.
+	for (i = 0; i < count; i += 4)
+	{
+		a = &phys[part_type[i+0] & 7];
+		b = &phys[part_type[i+1] & 7];
+		c = &phys[part_type[i+2] & 7];
+		d = &phys[part_type[i+3] & 7];
+		velxy = _mm_set_ps (d->velxy, c->velxy, b->velxy, a->velxy);
+		velz = _mm_set_ps (d->velz, c->velz, b->velz, a->velz);
+		accelz = _mm_set_ps (d->accelz, c->accelz, b->accelz, a->accelz);
+		ramp = _mm_set_ps (d->ramp, c->ramp, b->ramp, a->ramp);
+
+		vx = _mm_loadu_ps (part_vel[0] + i);
+		vy = _mm_loadu_ps (part_vel[1] + i);
+		vz = _mm_loadu_ps (part_vel[2] + i);
+
+		_mm_storeu_ps (part_org[0] + i, _mm_add_ps (_mm_loadu_ps (part_org[0] + i), _mm_mul_ps (vx, ft)));
+		_mm_storeu_ps (part_org[1] + i, _mm_add_ps (_mm_loadu_ps (part_org[1] + i), _mm_mul_ps (vy, ft)));
+		_mm_storeu_ps (part_org[2] + i, _mm_add_ps (_mm_loadu_ps (part_org[2] + i), _mm_mul_ps (vz, ft)));
+
+		_mm_storeu_ps (part_vel[0] + i, _mm_mul_ps (vx, velxy));
+		_mm_storeu_ps (part_vel[1] + i, _mm_mul_ps (vy, velxy));
+		_mm_storeu_ps (part_vel[2] + i, _mm_add_ps (_mm_mul_ps (vz, velz), accelz));
+		_mm_storeu_ps (part_ramp + i, _mm_add_ps (_mm_loadu_ps (part_ramp + i), ramp));
+	}
+}
+#endif
+
 void CL_RunParticles (void)
 {
-	particle_t		*p, *kill;
-	int				i;
+	int				i, j, last, t;
 	float			time1, time2, time3, dvel, frametime, grav;
+	partphys_t		phys[8];
 	extern	cvar_t	sv_gravity;
 
 	frametime = cl.time - cl.oldtime;
@@ -732,294 +819,289 @@ void CL_RunParticles (void)
 	grav = frametime * sv_gravity.value * 0.05;
 	dvel = 4*frametime;
 
-	for ( ;; )
+	// remove the dead, filling each hole with the last live particle
+	for (i = 0; i < r_activeparticles; )
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
+		if (part_die[i] >= cl.time)
 		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
+			i++;
 			continue;
 		}
-		break;
-	}
-
-	for (p=active_particles ; p ; p=p->next)
-	{
-		for ( ;; )
+		last = --r_activeparticles;
+		for (j = 0; j < 3; j++)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
+			part_org[j][i] = part_org[j][last];
+			part_vel[j][i] = part_vel[j][last];
 		}
+		part_ramp[i] = part_ramp[last];
+		part_die[i] = part_die[last];
+		part_color[i] = part_color[last];
+		part_type[i] = part_type[last];
+	}
 
-		p->org[0] += p->vel[0]*frametime;
-		p->org[1] += p->vel[1]*frametime;
-		p->org[2] += p->vel[2]*frametime;
-
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
-
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] -= p->vel[i]*frametime;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_blob:
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	if (!r_activeparticles)
+		return;
 
-		case pt_blob2:
-			for (i=0 ; i<2 ; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	// per-type behavior for this frame
+	for (i = 0; i < 8; i++)
+	{
+		phys[i].velxy = phys[i].velz = 1;
+		phys[i].accelz = -grav;
+		phys[i].ramp = 0;
+		part_ramptable[i] = NULL;
+	}
+	phys[pt_static].accelz = 0;
+	phys[pt_fire].accelz = grav;
+	phys[pt_fire].ramp = time1;
+	part_ramptable[pt_fire] = ramp3;
+	part_rampmax[pt_fire] = 6;
+	phys[pt_explode].velxy = phys[pt_explode].velz = 1 + dvel;
+	phys[pt_explode].ramp = time2;
+	part_ramptable[pt_explode] = ramp1;
+	part_rampmax[pt_explode] = 8;
+	phys[pt_explode2].velxy = phys[pt_explode2].velz = 1 - frametime;
+	phys[pt_explode2].ramp = time3;
+	part_ramptable[pt_explode2] = ramp2;
+	part_rampmax[pt_explode2] = 8;
+	phys[pt_blob].velxy = phys[pt_blob].velz = 1 + dvel;
+	phys[pt_blob2].velxy = 1 - dvel;
+
+#ifdef USE_SSE2
+	if (host_parms->cpufeatures & CPU_SSE2)
+		CL_MoveParticles_SSE2 (phys, r_activeparticles, frametime);
+	else
+#endif
+	CL_MoveParticles_C (phys, r_activeparticles, frametime);
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
-		}
+	// color ramps
+	for (i = 0; i < r_activeparticles; i++)
+	{
+		t = part_type[i] & 7;
+		if (!part_ramptable[t])
+			continue;
+		if (part_ramp[i] >= part_rampmax[t])
+			part_die[i] = -1;
+		else
+			part_color[i] = part_ramptable[t][(int)part_ramp[i]];
 	}
 }
 
 /*
 ===============
-R_DrawParticles -- johnfitz -- moved all non-drawing code to CL_RunParticles
+R_BuildParticleVerts
+
+fills part_verts for the current view. the result only depends on the view
+orientation, which both VR eyes share, so a second call in the same frame
+with the same orientation keeps the first one's vertices.
 ===============
 */
-void R_DrawParticles (void)
+static void R_BuildParticleVerts (void)
 {
-	particle_t		*p;
-	float			scale;
-	vec3_t			up, right, p_up, p_right, p_upright; //johnfitz -- p_ vectors
-	GLubyte			color[4], *c; //johnfitz -- particle transparency
-	extern	cvar_t	r_particles; //johnfitz
-	//float			alpha; //johnfitz -- particle transparency
-
-	if (!r_particles.value)
+	int			i;
+	float		scale, x, y, z, s1;
+	vec3_t		up, right;
+	partvert_t	*v;
+	byte		*c;
+	qboolean	quads;
+
+	quads = (r_quadparticles.value != 0);
+	if (part_vertcache.framecount == host_framecount &&
+		VectorCompare (part_vertcache.vup, vup) &&
+		VectorCompare (part_vertcache.vright, vright) &&
+		VectorCompare (part_vertcache.vpn, vpn) &&
+		part_vertcache.quads == quads &&
+		part_vertcache.scalefactor == texturescalefactor)
 		return;
 
-	//ericw -- avoid empty glBegin(),glEnd() pair below; causes issues on AMD
-	if (!active_particles)
-		return;
+	part_vertcache.framecount = host_framecount;
+	VectorCopy (vup, part_vertcache.vup);
+	VectorCopy (vright, part_vertcache.vright);
+	VectorCopy (vpn, part_vertcache.vpn);
+	part_vertcache.quads = quads;
+	part_vertcache.scalefactor = texturescalefactor;
 
 	VectorScale (vup, 1.5, up);
 	VectorScale (vright, 1.5, right);
+	s1 = quads ? 0.5 : 1; //quad is half the size of triangle, and uses half the texture
 
-	GL_Bind(particletexture);
-	glEnable (GL_BLEND);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	glDepthMask (GL_FALSE); //johnfitz -- fix for particle z-buffer bug
-
-	if (r_quadparticles.value) //johnitz -- quads save fillrate
+	v = part_verts;
+	for (i = 0; i < r_activeparticles; i++)
 	{
-		glBegin (GL_QUADS);
-		for (p=active_particles ; p ; p=p->next)
-		{
-			// hack a scale up to keep particles from disapearing
-			scale = (p->org[0] - r_origin[0]) * vpn[0]
-				  + (p->org[1] - r_origin[1]) * vpn[1]
-				  + (p->org[2] - r_origin[2]) * vpn[2];
-			if (scale < 20)
-				scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
-			else
-				scale = 1 + scale * 0.004;
-
-			scale /= 2.0; //quad is half the size of triangle
+		x = part_org[0][i];
+		y = part_org[1][i];
+		z = part_org[2][i];
+
+		// hack a scale up to keep particles from disapearing
+		scale = (x - r_origin[0]) * vpn[0]
+			  + (y - r_origin[1]) * vpn[1]
+			  + (z - r_origin[2]) * vpn[2];
+		if (scale < 20)
+			scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
+		else
+			scale = 1 + scale * 0.004;
 
-			scale *= texturescalefactor; //johnfitz -- compensate for apparent size of different particle textures
+		scale *= s1 * texturescalefactor; //johnfitz -- compensate for apparent size of different particle textures
 
-			//johnfitz -- particle transparency and fade out
-			c = (GLubyte *) &d_8to24table[(int)p->color];
-			color[0] = c[0];
-			color[1] = c[1];
-			color[2] = c[2];
-			//alpha = CLAMP(0, p->die + 0.5 - cl.time, 1);
-			color[3] = 255; //(int)(alpha * 255);
-			glColor4ubv(color);
-			//johnfitz
+		//johnfitz -- particle transparency and fade out
+		c = (byte *) &d_8to24table[part_color[i]];
 
-			glTexCoord2f (0,0);
-			glVertex3fv (p->org);
+		v[0].xyz[0] = x;
+		v[0].xyz[1] = y;
+		v[0].xyz[2] = z;
+		v[0].st[0] = 0;
+		v[0].st[1] = 0;
 
-			glTexCoord2f (0.5,0);
-			VectorMA (p->org, scale, up, p_up);
-			glVertex3fv (p_up);
+		v[1].xyz[0] = x + up[0] * scale;
+		v[1].xyz[1] = y + up[1] * scale;
+		v[1].xyz[2] = z + up[2] * scale;
+		v[1].st[0] = s1;
+		v[1].st[1] = 0;
 
-			glTexCoord2f (0.5,0.5);
-			VectorMA (p_up, scale, right, p_upright);
-			glVertex3fv (p_upright);
+		if (quads)
+		{
+			v[2].xyz[0] = v[1].xyz[0] + right[0] * scale;
+			v[2].xyz[1] = v[1].xyz[1] + right[1] * scale;
+			v[2].xyz[2] = v[1].xyz[2] + right[2] * scale;
+			v[2].st[0] = s1;
+			v[2].st[1] = s1;
+
+			v[3].xyz[0] = x + right[0] * scale;
+			v[3].xyz[1] = y + right[1] * scale;
+			v[3].xyz[2] = z + right[2] * scale;
+			v[3].st[0] = 0;
+			v[3].st[1] = s1;
+		}
+		else
+		{
+			v[2].xyz[0] = x + right[0] * scale;
+			v[2].xyz[1] = y + right[1] * scale;
+			v[2].xyz[2] = z + right[2] * scale;
+			v[2].st[0] = 0;
+			v[2].st[1] = s1;
+		}
 
-			glTexCoord2f (0,0.5);
-			VectorMA (p->org, scale, right, p_right);
-			glVertex3fv (p_right);
+		v[0].rgba[0] = v[1].rgba[0] = v[2].rgba[0] = v[3].rgba[0] = c[0];
+		v[0].rgba[1] = v[1].rgba[1] = v[2].rgba[1] = v[3].rgba[1] = c[1];
+		v[0].rgba[2] = v[1].rgba[2] = v[2].rgba[2] = v[3].rgba[2] = c[2];
+		v[0].rgba[3] = v[1].rgba[3] = v[2].rgba[3] = v[3].rgba[3] = 255;
 
-			rs_particles++; //johnfitz //FIXME: just use r_numparticles
-		}
-		glEnd ();
+		v += quads ? 4 : 3;
 	}
-	else //johnitz --  triangles save verts
-	{
-		glBegin (GL_TRIANGLES);
-		for (p=active_particles ; p ; p=p->next)
-		{
-			// hack a scale up to keep particles from disapearing
-			scale = (p->org[0] - r_origin[0]) * vpn[0]
-				  + (p->org[1] - r_origin[1]) * vpn[1]
-				  + (p->org[2] - r_origin[2]) * vpn[2];
-			if (scale < 20)
-				scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
-			else
-				scale = 1 + scale * 0.004;
+	part_numverts = v - part_verts;
 
-			scale *= texturescalefactor; //johnfitz -- compensate for apparent size of different particle textures
+	// one upload per frame, the eyes draw from the same buffer
+	if (gl_vbo_able)
+	{
+		if (!part_vbo)
+			GL_GenBuffersFunc (1, &part_vbo);
+		GL_BindBuffer (GL_ARRAY_BUFFER, part_vbo);
+		GL_BufferDataFunc (GL_ARRAY_BUFFER, part_numverts * sizeof(partvert_t), part_verts, GL_STREAM_DRAW);
+	}
+}
 
-			//johnfitz -- particle transparency and fade out
-			c = (GLubyte *) &d_8to24table[(int)p->color];
-			color[0] = c[0];
-			color[1] = c[1];
-			color[2] = c[2];
-			//alpha = CLAMP(0, p->die + 0.5 - cl.time, 1);
-			color[3] = 255; //(int)(alpha * 255);
-			glColor4ubv(color);
-			//johnfitz
+/*
+===============
+R_DeleteParticleBuffer -- the VBO doesn't survive a mode change
+===============
+*/
+void R_DeleteParticleBuffer (void)
+{
+	if (!gl_vbo_able || !part_vbo)
+		return;
 
-			glTexCoord2f (0,0);
-			glVertex3fv (p->org);
+	GL_DeleteBuffersFunc (1, &part_vbo);
+	part_vbo = 0;
+	part_vertcache.framecount = -1;
 
-			glTexCoord2f (1,0);
-			VectorMA (p->org, scale, up, p_up);
-			glVertex3fv (p_up);
+	GL_ClearBufferBindings ();
+}
 
-			glTexCoord2f (0,1);
-			VectorMA (p->org, scale, right, p_right);
-			glVertex3fv (p_right);
+/*
+===============
+R_SetParticleArrays -- points the vertex arrays at part_verts, or its VBO
+===============
+*/
+static void R_SetParticleArrays (qboolean textured)
+{
+	const byte *base;
 
-			rs_particles++; //johnfitz //FIXME: just use r_numparticles
-		}
-		glEnd ();
+	if (part_vbo)
+	{
+		GL_BindBuffer (GL_ARRAY_BUFFER, part_vbo);
+		base = NULL;
+	}
+	else
+	{
+		GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+		base = (const byte *) part_verts;
 	}
 
-	glDepthMask (GL_TRUE); //johnfitz -- fix for particle z-buffer bug
-	glDisable (GL_BLEND);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-	glColor3f(1,1,1);
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glVertexPointer (3, GL_FLOAT, sizeof(partvert_t), base + offsetof(partvert_t, xyz));
+	if (textured)
+	{
+		glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer (2, GL_FLOAT, sizeof(partvert_t), base + offsetof(partvert_t, st));
+		glEnableClientState (GL_COLOR_ARRAY);
+		glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(partvert_t), base + offsetof(partvert_t, rgba));
+	}
 }
 
+static void R_ClearParticleArrays (void)
+{
+	glDisableClientState (GL_VERTEX_ARRAY);
+	glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState (GL_COLOR_ARRAY);
+	GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+}
 
 /*
 ===============
-R_DrawParticles_ShowTris -- johnfitz
+R_DrawParticles -- johnfitz -- moved all non-drawing code to CL_RunParticles
 ===============
 */
-void R_DrawParticles_ShowTris (void)
+void R_DrawParticles (void)
 {
-	particle_t		*p;
-	float			scale;
-	vec3_t			up, right, p_up, p_right, p_upright;
-	extern	cvar_t	r_particles;
-
 	if (!r_particles.value)
 		return;
 
-	VectorScale (vup, 1.5, up);
-	VectorScale (vright, 1.5, right);
-
-	if (r_quadparticles.value)
-	{
-		for (p=active_particles ; p ; p=p->next)
-		{
-			glBegin (GL_TRIANGLE_FAN);
-
-			// hack a scale up to keep particles from disapearing
-			scale = (p->org[0] - r_origin[0]) * vpn[0]
-				  + (p->org[1] - r_origin[1]) * vpn[1]
-				  + (p->org[2] - r_origin[2]) * vpn[2];
-			if (scale < 20)
-				scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
-			else
-				scale = 1 + scale * 0.004;
-
-			scale /= 2.0; //quad is half the size of triangle
-
-			scale *= texturescalefactor; //compensate for apparent size of different particle textures
+	//ericw -- avoid empty glBegin(),glEnd() pair below; causes issues on AMD
+	if (!r_activeparticles)
+		return;
 
-			glVertex3fv (p->org);
+	R_BuildParticleVerts ();
 
-			VectorMA (p->org, scale, up, p_up);
-			glVertex3fv (p_up);
+	GL_Bind(particletexture);
+	glEnable (GL_BLEND);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glDepthMask (GL_FALSE); //johnfitz -- fix for particle z-buffer bug
 
-			VectorMA (p_up, scale, right, p_upright);
-			glVertex3fv (p_upright);
+	R_SetParticleArrays (true);
+	glDrawArrays (part_vertcache.quads ? GL_QUADS : GL_TRIANGLES, 0, part_numverts); //johnitz -- quads save fillrate, triangles save verts
+	R_ClearParticleArrays ();
 
-			VectorMA (p->org, scale, right, p_right);
-			glVertex3fv (p_right);
+	rs_particles += r_activeparticles;
 
-			glEnd ();
-		}
-	}
-	else
-	{
-		glBegin (GL_TRIANGLES);
-		for (p=active_particles ; p ; p=p->next)
-		{
-			// hack a scale up to keep particles from disapearing
-			scale = (p->org[0] - r_origin[0]) * vpn[0]
-				  + (p->org[1] - r_origin[1]) * vpn[1]
-				  + (p->org[2] - r_origin[2]) * vpn[2];
-			if (scale < 20)
-				scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
-			else
-				scale = 1 + scale * 0.004;
+	glDepthMask (GL_TRUE); //johnfitz -- fix for particle z-buffer bug
+	glDisable (GL_BLEND);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glColor3f(1,1,1);
+}
 
-			scale *= texturescalefactor; //compensate for apparent size of different particle textures
 
-			glVertex3fv (p->org);
+/*
+===============
+R_DrawParticles_ShowTris -- johnfitz
+===============
+*/
+void R_DrawParticles_ShowTris (void)
+{
+	if (!r_particles.value || !r_activeparticles)
+		return;
 
-			VectorMA (p->org, scale, up, p_up);
-			glVertex3fv (p_up);
+	R_BuildParticleVerts ();
 
-			VectorMA (p->org, scale, right, p_right);
-			glVertex3fv (p_right);
-		}
-		glEnd ();
-	}
+	R_SetParticleArrays (false);
+	glDrawArrays (part_vertcache.quads ? GL_QUADS : GL_TRIANGLES, 0, part_numverts);
+	R_ClearParticleArrays ();
 }
-
@@ -28,7 +28,9 @@ extern cvar_t gl_fullbrights, r_drawflat, gl_overbright, r_oldwater, r_oldskylea
 
 extern glpoly_t	*lightmap_polys[MAX_LIGHTMAPS];
 
-byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel);
+byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel, pvsbuffer_t *fat, pvsbuffer_t *leafpvs);
+
+static pvsbuffer_t	r_fatpvs, r_leafpvs;	// not the server's, which may be busy on a worker
 
 int vis_changed; //if true, force pvs to be refreshed
 
@@ -96,11 +98,11 @@ void R_MarkSurfaces (void)
 
 	// choose vis data
 	if (r_novis.value || r_viewleaf->contents == CONTENTS_SOLID || r_viewleaf->contents == CONTENTS_SKY)
-		vis = Mod_NoVisPVS (cl.worldmodel);
+		vis = Mod_NoVisPVS (cl.worldmodel, &r_leafpvs);
 	else if (nearwaterportal)
-		vis = SV_FatPVS (r_origin, cl.worldmodel);
+		vis = SV_FatPVS (r_origin, cl.worldmodel, &r_fatpvs, &r_leafpvs);
 	else
-		vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
+		vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel, &r_leafpvs);
 
 	// if surface chains don't need regenerating, just add static entities and return
 	if (r_oldviewleaf == r_viewleaf && !vis_changed && !nearwaterportal)
@@ -226,7 +228,7 @@ void R_CullSurfaces (void)
 			{
 				s->culled = false;
 				rs_brushpolys++; //count wpolys here
-				if (s->texinfo->texture->warpimage)
+				if (s->texinfo->texture->warpimage && !GLWarp_UseShader (s))
 					s->texinfo->texture->update_warp = true;
 			}
 		}
@@ -320,7 +322,7 @@ void R_DrawTextureChains_ShowTris (qmodel_t *model, texchain_t chain)
 		if (!t)
 			continue;
 
-		if (r_oldwater.value && t->texturechains[chain] && (t->texturechains[chain]->flags & SURF_DRAWTURB))
+		if (r_oldwater.value && t->texturechains[chain] && (t->texturechains[chain]->flags & SURF_DRAWTURB) && !GLWarp_UseShader (t->texturechains[chain]))
 		{
 			for (s = t->texturechains[chain]; s; s = s->texturechain)
 				if (!s->culled)
@@ -358,7 +360,7 @@ void R_DrawTextureChains_Drawflat (qmodel_t *model, texchain_t chain)
 		if (!t)
 			continue;
 
-		if (r_oldwater.value && t->texturechains[chain] && (t->texturechains[chain]->flags & SURF_DRAWTURB))
+		if (r_oldwater.value && t->texturechains[chain] && (t->texturechains[chain]->flags & SURF_DRAWTURB) && !GLWarp_UseShader (t->texturechains[chain]))
 		{
 			for (s = t->texturechains[chain]; s; s = s->texturechain)
 				if (!s->culled)
@@ -670,15 +672,34 @@ void R_DrawTextureChains_Water (qmodel_t *model, entity_t *ent, texchain_t chain
 	if (r_drawflat_cheatsafe || r_lightmap_cheatsafe) // ericw -- !r_drawworld_cheatsafe check moved to R_DrawWorld_Water ()
 		return;
 
-	if (r_oldwater.value)
+	for (i=0 ; i<model->numtextures ; i++)
 	{
-		for (i=0 ; i<model->numtextures ; i++)
+		t = model->textures[i];
+		if (!t || !t->texturechains[chain] || !(t->texturechains[chain]->flags & SURF_DRAWTURB))
+			continue;
+		bound = false;
+		entalpha = 1.0f;
+		if (GLWarp_UseShader (t->texturechains[chain]))
+		{
+			for (s = t->texturechains[chain]; s; s = s->texturechain)
+				if (!s->culled)
+				{
+					if (!bound) //only bind once we are sure we need this texture
+					{
+						entalpha = GL_WaterAlphaForEntitySurface (ent, s);
+						R_BeginTransparentDrawing (entalpha);
+						GLWarp_BeginShader (entalpha);
+						GL_Bind (t->gltexture);
+						bound = true;
+					}
+					DrawGLPoly (s->polys);
+					rs_brushpasses++;
+				}
+			if (bound)
+				GLWarp_EndShader ();
+		}
+		else if (r_oldwater.value)
 		{
-			t = model->textures[i];
-			if (!t || !t->texturechains[chain] || !(t->texturechains[chain]->flags & SURF_DRAWTURB))
-				continue;
-			bound = false;
-			entalpha = 1.0f;
 			for (s = t->texturechains[chain]; s; s = s->texturechain)
 				if (!s->culled)
 				{
@@ -695,18 +716,9 @@ void R_DrawTextureChains_Water (qmodel_t *model, entity_t *ent, texchain_t chain
 						rs_brushpasses++;
 					}
 				}
-			R_EndTransparentDrawing (entalpha);
 		}
-	}
-	else
-	{
-		for (i=0 ; i<model->numtextures ; i++)
+		else
 		{
-			t = model->textures[i];
-			if (!t || !t->texturechains[chain] || !(t->texturechains[chain]->flags & SURF_DRAWTURB))
-				continue;
-			bound = false;
-			entalpha = 1.0f;
 			for (s = t->texturechains[chain]; s; s = s->texturechain)
 				if (!s->culled)
 				{
@@ -729,8 +741,8 @@ void R_DrawTextureChains_Water (qmodel_t *model, entity_t *ent, texchain_t chain
 					DrawGLPoly (s->polys);
 					rs_brushpasses++;
 				}
-			R_EndTransparentDrawing (entalpha);
 		}
+		R_EndTransparentDrawing (entalpha);
 	}
 }
 
@@ -281,10 +281,12 @@ Sbar_DrawPicAlpha -- johnfitz
 */
 void Sbar_DrawPicAlpha (int x, int y, qpic_t *pic, float alpha)
 {
+	Draw_Flush ();
 	glDisable (GL_ALPHA_TEST);
 	glEnable (GL_BLEND);
 	glColor4f(1,1,1,alpha);
 	Draw_Pic (x, y + 24, pic);
+	Draw_Flush ();
 	glColor4f(1,1,1,1); // ericw -- changed from glColor3f to work around intel 855 bug with "r_oldwater 0" and "scr_sbaralpha 0"
 	glDisable (GL_BLEND);
 	glEnable (GL_ALPHA_TEST);
@@ -327,6 +329,7 @@ void Sbar_DrawScrollString (int x, int y, int width, const char *str)
 	if (cl.gametype != GAME_DEATHMATCH)
 		left += (((float)glwidth - 320.0 * scale) / 2);
 
+	Draw_Flush ();
 	glEnable (GL_SCISSOR_TEST);
 	glScissor (left, 0, width * scale, glheight);
 
@@ -338,6 +341,7 @@ void Sbar_DrawScrollString (int x, int y, int width, const char *str)
 	Sbar_DrawCharacter (x - ofs + len - 16, y, '/');
 	Sbar_DrawString (x - ofs + len, y, str);
 
+	Draw_Flush ();
 	glDisable (GL_SCISSOR_TEST);
 }
 
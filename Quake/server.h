@@ -189,6 +189,8 @@ extern	client_t	*host_client;
 
 extern	edict_t		*sv_player;
 
+extern	double		sv_frametime;		// length of the current server tick
+
 //===========================================================
 
 void SV_Init (void);
@@ -215,6 +217,8 @@ void SV_ClientPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
+void SV_LatchVRInput (void);
+void SV_ClearVRInput (void);
 
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
@@ -75,6 +75,7 @@ cvar_t		sfxvolume = {"volume", "0.7", CVAR_ARCHIVE};
 
 cvar_t		precache = {"precache", "1", CVAR_NONE};
 cvar_t		loadas8bit = {"loadas8bit", "0", CVAR_NONE};
+cvar_t		snd_streamsfx = {"snd_streamsfx", "0", CVAR_ARCHIVE};	// seconds, 0 = never stream
 
 cvar_t		sndspeed = {"sndspeed", "11025", CVAR_NONE};
 cvar_t		snd_mixspeed = {"snd_mixspeed", "44100", CVAR_NONE};
@@ -173,6 +174,7 @@ void S_Init (void)
 	Cvar_RegisterVariable(&sfxvolume);
 	Cvar_RegisterVariable(&precache);
 	Cvar_RegisterVariable(&loadas8bit);
+	Cvar_RegisterVariable(&snd_streamsfx);
 	Cvar_RegisterVariable(&bgmvolume);
 	Cvar_RegisterVariable(&ambient_level);
 	Cvar_RegisterVariable(&ambient_fade);
@@ -183,7 +185,7 @@ void S_Init (void)
 	Cvar_RegisterVariable(&snd_mixspeed);
 	Cvar_RegisterVariable(&snd_filterquality);
 	
-	if (safemode || COM_CheckParm("-nosound"))
+	if (safemode || isHeadless || COM_CheckParm("-nosound"))
 		return;
 
 	Con_Printf("\nSound Initialization\n");
@@ -1015,23 +1017,40 @@ static void S_SoundList (void)
 	int		i;
 	sfx_t	*sfx;
 	sfxcache_t	*sc;
-	int		size, total;
+	int		size, width, total, saved;
 
-	total = 0;
+	total = saved = 0;
 	for (sfx = known_sfx, i = 0; i < num_sfx; i++, sfx++)
 	{
 		sc = (sfxcache_t *) Cache_Check (&sfx->cache);
 		if (!sc)
 			continue;
-		size = sc->length*sc->width*(sc->stereo + 1);
+		if (sc->srclength)
+		{	// streamed: only the source samples are resident, against a
+			// resampled copy at the width ResampleSfx would have used
+			width = sc->srcwidth;
+			size = sc->srclength*width;
+			saved += sc->length*(loadas8bit.value ? 1 : width) - size;
+		}
+		else
+		{
+			width = sc->width;
+			size = sc->length*width*(sc->stereo + 1);
+		}
 		total += size;
 		if (sc->loopstart >= 0)
 			Con_SafePrintf ("L"); //johnfitz -- was Con_Printf
 		else
 			Con_SafePrintf (" "); //johnfitz -- was Con_Printf
-		Con_SafePrintf("(%2db) %6i : %s\n", sc->width*8, size, sfx->name); //johnfitz -- was Con_Printf
+		if (sc->srclength)
+			Con_SafePrintf ("S");
+		else
+			Con_SafePrintf (" ");
+		Con_SafePrintf("(%2db) %6i : %s\n", width*8, size, sfx->name); //johnfitz -- was Con_Printf
 	}
 	Con_Printf ("%i sounds, %i bytes\n", num_sfx, total); //johnfitz -- added count
+	if (saved > 0)
+		Con_Printf ("%i bytes saved by streaming\n", saved);
 }
 
 
@@ -22,6 +22,173 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+/*
+===============================================================================
+
+POLYPHASE RESAMPLING
+
+A windowed-sinc filter is precomputed for SND_POLYPHASE_PHASES fractional
+positions between two source samples. Each output sample is then the dot
+product of SND_POLYPHASE_TAPS contiguous source samples with one phase of
+the kernel, which keeps the inner loop branch-free and easy to vectorize.
+
+===============================================================================
+*/
+
+#define SND_POLYPHASE_TAPS	16	/* must be a multiple of 4 */
+#define SND_POLYPHASE_PHASES	64
+#define SND_POLYPHASE_KERNELS	4	/* distinct rate ratios kept around */
+
+typedef struct
+{
+	float	ratio;		/* source rate / output rate, 0 = unused */
+	float	kernel[SND_POLYPHASE_PHASES][SND_POLYPHASE_TAPS];
+} polyphase_t;
+
+static polyphase_t	snd_polyphase[SND_POLYPHASE_KERNELS];
+static int		snd_polyphase_next;
+
+static float	*snd_resample_in;	/* source samples converted to float */
+static int	snd_resample_insize;
+
+/*
+================
+S_MakePolyphaseKernel
+
+Blackman windowed sinc. When downsampling, the cutoff is lowered to the
+output Nyquist frequency so that decimation does not alias.
+================
+*/
+static void S_MakePolyphaseKernel (polyphase_t *pf, float ratio)
+{
+	int	phase, k;
+	double	f_c, d, x, w, sum;
+
+	pf->ratio = ratio;
+	f_c = (ratio > 1) ? 1.0 / ratio : 1.0;
+	f_c *= 0.9;	// leave some room for the transition band
+
+	for (phase = 0; phase < SND_POLYPHASE_PHASES; phase++)
+	{
+		sum = 0;
+		for (k = 0; k < SND_POLYPHASE_TAPS; k++)
+		{
+		// distance of this tap from the exact source position
+			d = (k - (SND_POLYPHASE_TAPS/2 - 1)) - (double)phase / SND_POLYPHASE_PHASES;
+			x = M_PI * f_c * d;
+			w = 0.42 + 0.5 * cos(2 * M_PI * d / SND_POLYPHASE_TAPS)
+				+ 0.08 * cos(4 * M_PI * d / SND_POLYPHASE_TAPS);
+			pf->kernel[phase][k] = (float)(((x == 0) ? 1.0 : sin(x) / x) * w);
+			sum += pf->kernel[phase][k];
+		}
+	// normalize each phase for unity gain at DC
+		for (k = 0; k < SND_POLYPHASE_TAPS; k++)
+			pf->kernel[phase][k] /= sum;
+	}
+}
+
+static const polyphase_t *S_GetPolyphaseKernel (float ratio)
+{
+	polyphase_t	*pf;
+	int	i;
+
+	for (i = 0; i < SND_POLYPHASE_KERNELS; i++)
+	{
+		if (snd_polyphase[i].ratio == ratio)
+			return &snd_polyphase[i];
+	}
+
+	pf = &snd_polyphase[snd_polyphase_next];
+	snd_polyphase_next = (snd_polyphase_next + 1) % SND_POLYPHASE_KERNELS;
+	S_MakePolyphaseKernel (pf, ratio);
+	return pf;
+}
+
+/*
+================
+S_ResampleChunk
+
+Produces output samples [pos, pos+count) of a mono sound stored at
+srcwidth bytes per sample (unsigned 8 bit or little endian 16 bit) and
+resampled by ratio = srcrate / outrate. Samples outside the source are
+treated as silence.
+================
+*/
+void S_ResampleChunk (const byte *src, int srcwidth, int srclength, float ratio,
+		      int pos, int count, short *out)
+{
+	const polyphase_t *pf;
+	int	i, j, k;
+	int	first, last, need;
+	int	ipos, phase;
+	double	spos;
+	float	val[4];
+	const float	*in, *kern;
+
+	if (count <= 0)
+		return;
+
+	if (ratio == 1)
+	{	// no resampling needed, just convert
+		for (i = 0; i < count; i++, pos++)
+		{
+			if (pos >= srclength)
+				out[i] = 0;
+			else if (srcwidth == 2)
+				out[i] = LittleShort (((const short *)src)[pos]);
+			else
+				out[i] = (int)(src[pos] - 128) << 8;
+		}
+		return;
+	}
+
+	pf = S_GetPolyphaseKernel (ratio);
+
+// convert the source window feeding this chunk to float once
+	first = (int)floor(pos * (double)ratio) - (SND_POLYPHASE_TAPS/2 - 1);
+	last = (int)floor((pos + count - 1) * (double)ratio) + SND_POLYPHASE_TAPS/2;
+	need = last - first + 1;
+	if (need > snd_resample_insize)
+	{
+		free (snd_resample_in);
+		snd_resample_insize = need;
+		snd_resample_in = (float *) malloc (need * sizeof(float));
+		if (!snd_resample_in)
+			Sys_Error ("S_ResampleChunk: out of memory");
+	}
+
+	for (i = 0, j = first; i < need; i++, j++)
+	{
+		if (j < 0 || j >= srclength)
+			snd_resample_in[i] = 0;
+		else if (srcwidth == 2)
+			snd_resample_in[i] = LittleShort (((const short *)src)[j]);
+		else
+			snd_resample_in[i] = (int)(src[j] - 128) << 8;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		spos = (pos + i) * (double)ratio;
+		ipos = (int)floor(spos);
+		phase = (int)((spos - ipos) * SND_POLYPHASE_PHASES);
+		in = snd_resample_in + (ipos - (SND_POLYPHASE_TAPS/2 - 1) - first);
+		kern = pf->kernel[phase];
+
+		val[0] = val[1] = val[2] = val[3] = 0;
+		for (k = 0; k < SND_POLYPHASE_TAPS; k += 4)
+		{
+			val[0] += kern[k] * in[k];
+			val[1] += kern[k+1] * in[k+1];
+			val[2] += kern[k+2] * in[k+2];
+			val[3] += kern[k+3] * in[k+3];
+		}
+
+		j = (int)floor(val[0] + val[1] + val[2] + val[3] + 0.5f);
+		out[i] = CLAMP(-32768, j, 32767);
+	}
+}
+
 /*
 ================
 ResampleSfx
@@ -29,11 +196,10 @@ ResampleSfx
 */
 static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 {
-	int		outcount;
-	int		srcsample;
+	int		outcount, srclength;
 	float	stepscale;
-	int		i;
-	int		sample, samplefrac, fracstep;
+	int		i, j, count;
+	short	chunk[1024];
 	sfxcache_t	*sc;
 
 	sc = (sfxcache_t *) Cache_Check (&sfx->cache);
@@ -42,6 +208,7 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 	stepscale = (float)inrate / shm->speed;	// this is usually 0.5, 1, or 2
 
+	srclength = sc->length;
 	outcount = sc->length / stepscale;
 	sc->length = outcount;
 	if (sc->loopstart != -1)
@@ -53,6 +220,7 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	else
 		sc->width = inwidth;
 	sc->stereo = 0;
+	sc->srclength = 0;
 
 // resample / decimate to the current source rate
 
@@ -65,24 +233,55 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	else
 	{
 // general case
-		samplefrac = 0;
-		fracstep = stepscale*256;
-		for (i = 0; i < outcount; i++)
+		for (i = 0; i < outcount; i += count)
 		{
-			srcsample = samplefrac >> 8;
-			samplefrac += fracstep;
-			if (inwidth == 2)
-				sample = LittleShort ( ((short *)data)[srcsample] );
-			else
-				sample = (int)( (unsigned char)(data[srcsample]) - 128) << 8;
+			count = q_min(outcount - i, (int)(sizeof(chunk)/sizeof(chunk[0])));
+			S_ResampleChunk (data, inwidth, srclength, stepscale, i, count, chunk);
 			if (sc->width == 2)
-				((short *)sc->data)[i] = sample;
+				memcpy ((short *)sc->data + i, chunk, count * sizeof(short));
 			else
-				((signed char *)sc->data)[i] = sample >> 8;
+			{
+				for (j = 0; j < count; j++)
+					((signed char *)sc->data)[i + j] = chunk[j] >> 8;
+			}
 		}
 	}
 }
 
+/*
+================
+S_SetupStreamedSfx
+
+Long sounds are kept at their source rate and width. The mixer resamples
+them on demand into a small per-channel ring (see S_PaintChannels), which
+saves the memory a fully resampled copy would take.
+================
+*/
+static void S_SetupStreamedSfx (sfxcache_t *sc, wavinfo_t *info, byte *data)
+{
+	float	stepscale;
+	int		i;
+
+	stepscale = (float)info->rate / shm->speed;
+
+	sc->srclength = info->samples;
+	sc->srcspeed = info->rate;
+	sc->srcwidth = info->width;
+	sc->length = info->samples / stepscale;
+	sc->loopstart = (info->loopstart == -1) ? -1 : (int)(info->loopstart / stepscale);
+	sc->speed = shm->speed;
+	sc->width = 2;
+	sc->stereo = 0;
+
+	if (info->width == 2)
+	{
+		for (i = 0; i < info->samples; i++)
+			((short *)sc->data)[i] = LittleShort (((short *)data)[i]);
+	}
+	else
+		memcpy (sc->data, data, info->samples);
+}
+
 //=============================================================================
 
 /*
@@ -145,6 +344,18 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		return NULL;
 	}
 
+// long sounds which would grow when resampled can be streamed instead
+	if (snd_streamsfx.value > 0 && stepscale != 1 &&
+	    info.samples >= snd_streamsfx.value * info.rate &&
+	    info.samples * info.width < len)
+	{
+		sc = (sfxcache_t *) Cache_Alloc ( &s->cache, info.samples * info.width + sizeof(sfxcache_t), s->name);
+		if (!sc)
+			return NULL;
+		S_SetupStreamedSfx (sc, &info, data + info.dataofs);
+		return sc;
+	}
+
 	sc = (sfxcache_t *) Cache_Alloc ( &s->cache, len + sizeof(sfxcache_t), s->name);
 	if (!sc)
 		return NULL;
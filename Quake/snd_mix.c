@@ -332,6 +332,7 @@ CHANNEL MIXING
 
 static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static void SND_PaintChannelFromStream (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 
 void S_PaintChannels (int endtime)
 {
@@ -377,7 +378,9 @@ void S_PaintChannels (int endtime)
 				{
 					// the last param to SND_PaintChannelFrom is the index
 					// to start painting to in the paintbuffer, usually 0.
-					if (sc->width == 1)
+					if (sc->srclength)
+						SND_PaintChannelFromStream(ch, sc, count, ltime - paintedtime);
+					else if (sc->width == 1)
 						SND_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
 					else
 						SND_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
@@ -495,19 +498,17 @@ static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int
 	ch->pos += count;
 }
 
-static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+static void SND_PaintSamples16 (channel_t *ch, const signed short *sfx, int count, int paintbufferstart)
 {
 	int	data;
 	int	left, right;
 	int	leftvol, rightvol;
-	signed short	*sfx;
 	int	i;
 
 	leftvol = ch->leftvol * snd_vol;
 	rightvol = ch->rightvol * snd_vol;
 	leftvol /= 256;
 	rightvol /= 256;
-	sfx = (signed short *)sc->data + ch->pos;
 
 	for (i = 0; i < count; i++)
 	{
@@ -525,3 +526,95 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 	ch->pos += count;
 }
 
+static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	SND_PaintSamples16 (ch, (signed short *)sc->data + ch->pos, count, paintbufferstart);
+}
+
+/*
+===============================================================================
+
+STREAMED SFX
+
+Streamed sounds keep only their source samples in the cache. Each playing
+channel borrows a small ring which holds the next few thousand resampled
+output samples, refilled by S_ResampleChunk as the channel advances.
+Rings are shared round-robin, a channel which lost its ring simply
+refills a new one.
+
+===============================================================================
+*/
+
+#define	MAX_SFX_STREAMS		32
+#define	SFX_STREAM_SAMPLES	4096	/* > PAINTBUFFER_SIZE */
+
+typedef struct
+{
+	channel_t	*owner;
+	sfxcache_t	*sc;
+	int		start;		/* first output sample held */
+	int		count;
+	short		samples[SFX_STREAM_SAMPLES];
+} sfxstream_t;
+
+static sfxstream_t	sfx_streams[MAX_SFX_STREAMS];
+static int		sfx_streams_next;
+
+static sfxstream_t *SND_GetStream (channel_t *ch, sfxcache_t *sc)
+{
+	sfxstream_t	*st;
+	int		i;
+
+	for (i = 0, st = sfx_streams; i < MAX_SFX_STREAMS; i++, st++)
+	{
+		if (st->owner == ch && st->sc == sc)
+			return st;
+	}
+
+// prefer a ring whose channel moved on to something else
+	for (i = 0, st = sfx_streams; i < MAX_SFX_STREAMS; i++, st++)
+	{
+		if (!st->owner || !st->owner->sfx || st->owner->sfx->cache.data != st->sc)
+			break;
+	}
+	if (i == MAX_SFX_STREAMS)
+	{
+		st = &sfx_streams[sfx_streams_next];
+		sfx_streams_next = (sfx_streams_next + 1) % MAX_SFX_STREAMS;
+	}
+
+	st->owner = ch;
+	st->sc = sc;
+	st->start = st->count = 0;
+	return st;
+}
+
+static void SND_PaintChannelFromStream (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	sfxstream_t	*st;
+	int		n;
+
+	st = SND_GetStream (ch, sc);
+
+	while (count > 0)
+	{
+		if (ch->pos < st->start || ch->pos >= st->start + st->count)
+		{	// refill the ring from the current position
+			st->start = ch->pos;
+			st->count = q_min(SFX_STREAM_SAMPLES, sc->length - ch->pos);
+			if (st->count <= 0)
+			{
+				st->count = 0;
+				return;
+			}
+			S_ResampleChunk (sc->data, sc->srcwidth, sc->srclength,
+					 (float)sc->srcspeed / sc->speed, st->start, st->count, st->samples);
+		}
+
+		n = q_min(count, st->start + st->count - ch->pos);
+		SND_PaintSamples16 (ch, st->samples + (ch->pos - st->start), n, paintbufferstart);
+		paintbufferstart += n;
+		count -= n;
+	}
+}
+
@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_null.c -- sound and music stubs for the dedicated server build
+
+#include "quakedef.h"
+
+void S_Init (void)
+{
+}
+
+void S_Shutdown (void)
+{
+}
+
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+}
+
+void S_LocalSound (const char *name)
+{
+}
+
+qboolean BGM_Init (void)
+{
+	return false;
+}
+
+void BGM_Shutdown (void)
+{
+}
+
+void BGM_Update (void)
+{
+}
+
+void BGM_PrefetchCDtrack (byte track)
+{
+}
@@ -23,9 +23,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "vr.h"
+#include "bgmusic.h"
 
 server_t	sv;
 server_static_t	svs;
+double		sv_frametime;
 
 static char	localmodels[MAX_MODELS][8];	// inline model names for precache
 
@@ -461,13 +463,11 @@ crosses a waterline.
 =============================================================================
 */
 
-static int	fatbytes;
-static byte	*fatpvs;
-static int	fatpvs_capacity;
+static pvsbuffer_t	sv_fatpvs, sv_leafpvs;	// the renderer has its own
 
-void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
+static void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel, byte *fatpvs, pvsbuffer_t *leafpvs) //johnfitz -- added worldmodel as a parameter
 {
-	int		i;
+	int		i, fatbytes;
 	byte	*pvs;
 	mplane_t	*plane;
 	float	d;
@@ -479,7 +479,8 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, worldmodel); //johnfitz -- worldmodel as a parameter
+				pvs = Mod_LeafPVS ( (mleaf_t *)node, worldmodel, leafpvs); //johnfitz -- worldmodel as a parameter
+				fatbytes = (worldmodel->numleafs+7)>>3;
 				for (i=0 ; i<fatbytes ; i++)
 					fatpvs[i] |= pvs[i];
 			}
@@ -494,7 +495,7 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0], worldmodel); //johnfitz -- worldmodel as a parameter
+			SV_AddToFatPVS (org, node->children[0], worldmodel, fatpvs, leafpvs); //johnfitz -- worldmodel as a parameter
 			node = node->children[1];
 		}
 	}
@@ -505,22 +506,15 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point. The result goes in fat, leafpvs is scratch space for the leafs.
 =============
 */
-byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
+byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel, pvsbuffer_t *fat, pvsbuffer_t *leafpvs) //johnfitz -- added worldmodel as a parameter
 {
-	fatbytes = (worldmodel->numleafs+7)>>3; // ericw -- was +31, assumed to be a bug/typo
-	if (fatpvs == NULL || fatbytes > fatpvs_capacity)
-	{
-		fatpvs_capacity = fatbytes;
-		fatpvs = (byte *) realloc (fatpvs, fatpvs_capacity);
-		if (!fatpvs)
-			Sys_Error ("SV_FatPVS: realloc() failed on %d bytes", fatpvs_capacity);
-	}
-	
-	Q_memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, worldmodel->nodes, worldmodel); //johnfitz -- worldmodel as a parameter
+	byte	*fatpvs = Mod_PVSBuffer (fat, worldmodel);
+
+	Q_memset (fatpvs, 0, (worldmodel->numleafs+7)>>3); // ericw -- was +31, assumed to be a bug/typo
+	SV_AddToFatPVS (org, worldmodel->nodes, worldmodel, fatpvs, leafpvs); //johnfitz -- worldmodel as a parameter
 	return fatpvs;
 }
 
@@ -538,7 +532,7 @@ qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmode
 	int		i;
 
 	VectorAdd (client->v.origin, client->v.view_ofs, org);
-	pvs = SV_FatPVS (org, worldmodel);
+	pvs = SV_FatPVS (org, worldmodel, &sv_fatpvs, &sv_leafpvs);
 
 	for (i=0 ; i < test->num_leafs ; i++)
 		if (pvs[test->leafnums[i] >> 3] & (1 << (test->leafnums[i]&7) ))
@@ -566,7 +560,7 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 
 // find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, sv.worldmodel);
+	pvs = SV_FatPVS (org, sv.worldmodel, &sv_fatpvs, &sv_leafpvs);
 
 // send over all entities (excpet the client) that touch the pvs
 	ent = NEXT_EDICT(sv.edicts);
@@ -1063,6 +1057,9 @@ void SV_SendClientMessages (void)
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
+// send them all together where the driver can
+	NET_BatchSends (true);
+
 // build individual updates
 	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
 	{
@@ -1121,6 +1118,7 @@ void SV_SendClientMessages (void)
 		}
 	}
 
+	NET_BatchSends (false);
 
 // clear muzzle flashes
 	SV_CleanupEnts ();
@@ -1406,6 +1404,7 @@ void SV_SpawnServer (const char *server)
 
 	sv.state = ss_loading;
 	sv.paused = false;
+	SV_ClearVRInput ();
 
 	sv.time = 1.0;
 
@@ -1457,13 +1456,17 @@ void SV_SpawnServer (const char *server)
 
 	ED_LoadFromFile (sv.worldmodel->entities);
 
+// start decoding the map's music while the client is still loading
+	if (cls.state != ca_dedicated)
+		BGM_PrefetchCDtrack ((byte)sv.edicts->v.sounds);
+
 	sv.active = true;
 
 // all setup is completed, any further precache statements are errors
 	sv.state = ss_active;
 
 // run two frames to allow everything to settle
-	host_frametime = 0.1;
+	sv_frametime = 0.1;
 	SV_Physics ();
 	SV_Physics ();
 
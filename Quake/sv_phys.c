@@ -49,6 +49,46 @@ cvar_t	sv_maxvelocity = {"sv_maxvelocity","2000",CVAR_NONE};
 cvar_t	sv_nostep = {"sv_nostep","0",CVAR_NONE};
 cvar_t	sv_freezenonclients = {"sv_freezenonclients","0",CVAR_NONE};
 
+// VR input latched from the client before each server frame, so the server
+// never reads client state that the renderer is updating
+static vec3_t	sv_roomscalemove;	// head movement not yet applied to the player
+static vec3_t	sv_handpos;
+
+/*
+================
+SV_ClearVRInput
+
+Drops room scale movement that hasn't been applied, on map changes
+================
+*/
+void SV_ClearVRInput (void)
+{
+	VectorCopy (vec3_origin, sv_roomscalemove);
+}
+
+/*
+================
+SV_LatchVRInput
+
+Main thread, once per host frame before any server ticks. Room scale
+movement is accumulated and applied by the next tick, however many ticks
+the frame runs. Nothing applies it while physics is paused, so it isn't
+kept for then either.
+================
+*/
+void SV_LatchVRInput (void)
+{
+	extern vec3_t vr_room_scale_move;
+
+	if (!vr_enabled.value || sv.paused || (svs.maxclients == 1 && key_dest != key_game))
+	{
+		SV_ClearVRInput ();
+		return;
+	}
+	VectorAdd (sv_roomscalemove, vr_room_scale_move, sv_roomscalemove);
+	VectorCopy (cl.handpos[1], sv_handpos);
+}
+
 
 #define	MOVE_EPSILON	0.01
 
@@ -128,7 +168,7 @@ qboolean SV_RunThink (edict_t *ent)
 	int		i; //johnfitz
 
 	thinktime = ent->v.nextthink;
-	if (thinktime <= 0 || thinktime > sv.time + host_frametime)
+	if (thinktime <= 0 || thinktime > sv.time + sv_frametime)
 		return true;
 
 	if (thinktime < sv.time)
@@ -395,7 +435,7 @@ void SV_AddGravity (edict_t *ent)
 	else
 		ent_gravity = 1.0;
 
-	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
+	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * sv_frametime;
 }
 
 
@@ -584,14 +624,14 @@ void SV_Physics_Pusher (edict_t *ent)
 	oldltime = ent->v.ltime;
 
 	thinktime = ent->v.nextthink;
-	if (thinktime < ent->v.ltime + host_frametime)
+	if (thinktime < ent->v.ltime + sv_frametime)
 	{
 		movetime = thinktime - ent->v.ltime;
 		if (movetime < 0)
 			movetime = 0;
 	}
 	else
-		movetime = host_frametime;
+		movetime = sv_frametime;
 
 	if (movetime)
 	{
@@ -820,7 +860,7 @@ void SV_WalkMove (edict_t *ent)
 	VectorCopy (ent->v.origin, oldorg);
 	VectorCopy (ent->v.velocity, oldvel);
 
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
+	clip = SV_FlyMove (ent, sv_frametime, &steptrace);
 
 	if ( !(clip & 2) )
 		return;		// move didn't block on a step
@@ -848,7 +888,7 @@ void SV_WalkMove (edict_t *ent)
 	VectorCopy (vec3_origin, upmove);
 	VectorCopy (vec3_origin, downmove);
 	upmove[2] = STEPSIZE;
-	downmove[2] = -STEPSIZE + oldvel[2]*host_frametime;
+	downmove[2] = -STEPSIZE + oldvel[2]*sv_frametime;
 
 // move up
 	SV_PushEntity (ent, upmove);	// FIXME: don't link?
@@ -857,7 +897,7 @@ void SV_WalkMove (edict_t *ent)
 	ent->v.velocity[0] = oldvel[0];
 	ent->v. velocity[1] = oldvel[1];
 	ent->v. velocity[2] = 0;
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
+	clip = SV_FlyMove (ent, sv_frametime, &steptrace);
 
 // check for stuckness, possibly due to the limited precision of floats
 // in the clipping hulls
@@ -948,13 +988,13 @@ void SV_Physics_Client (edict_t	*ent, int num)
 	case MOVETYPE_FLY:
 		if (!SV_RunThink(ent))
 			return;
-		SV_FlyMove(ent, host_frametime, NULL);
+		SV_FlyMove(ent, sv_frametime, NULL);
 		break;
 
 	case MOVETYPE_NOCLIP:
 		if (!SV_RunThink(ent))
 			return;
-		VectorMA(ent->v.origin, host_frametime, ent->v.velocity, ent->v.origin);
+		VectorMA(ent->v.origin, sv_frametime, ent->v.velocity, ent->v.origin);
 		break;
 
 	default:
@@ -965,8 +1005,8 @@ void SV_Physics_Client (edict_t	*ent, int num)
 	{
 		vec3_t restoreVel;
 		_VectorCopy(ent->v.velocity, restoreVel);
-		extern vec3_t vr_room_scale_move;
-		VectorScale(vr_room_scale_move, 1.0f / host_frametime, ent->v.velocity);
+		VectorScale(sv_roomscalemove, 1.0f / sv_frametime, ent->v.velocity);
+		VectorCopy(vec3_origin, sv_roomscalemove);
 
 		switch ((int)ent->v.movetype)
 		{
@@ -985,11 +1025,11 @@ void SV_Physics_Client (edict_t	*ent, int num)
 			break;
 		
 		case MOVETYPE_FLY:
-			SV_FlyMove(ent, host_frametime, NULL);
+			SV_FlyMove(ent, sv_frametime, NULL);
 			break;
 
 		case MOVETYPE_NOCLIP:
-			VectorMA(ent->v.origin, host_frametime, ent->v.velocity, ent->v.origin);
+			VectorMA(ent->v.origin, sv_frametime, ent->v.velocity, ent->v.origin);
 			break;
 
 		default:
@@ -1011,7 +1051,7 @@ void SV_Physics_Client (edict_t	*ent, int num)
 	if (vr_enabled.value)
 	{
 		_VectorCopy(ent->v.origin, restoreOrigin);
-		_VectorCopy(cl.handpos[1], ent->v.origin);
+		_VectorCopy(sv_handpos, ent->v.origin);
 		ent->v.origin[2] -= 16; //quakec assumes 16 offset
 	}
 	pr_global_struct->self = EDICT_TO_PROG(ent);
@@ -1052,8 +1092,8 @@ void SV_Physics_Noclip (edict_t *ent)
 	if (!SV_RunThink (ent))
 		return;
 
-	VectorMA (ent->v.angles, host_frametime, ent->v.avelocity, ent->v.angles);
-	VectorMA (ent->v.origin, host_frametime, ent->v.velocity, ent->v.origin);
+	VectorMA (ent->v.angles, sv_frametime, ent->v.avelocity, ent->v.angles);
+	VectorMA (ent->v.origin, sv_frametime, ent->v.velocity, ent->v.origin);
 
 	SV_LinkEdict (ent, false);
 }
@@ -1134,10 +1174,10 @@ void SV_Physics_Toss (edict_t *ent)
 		SV_AddGravity (ent);
 
 // move angles
-	VectorMA (ent->v.angles, host_frametime, ent->v.avelocity, ent->v.angles);
+	VectorMA (ent->v.angles, sv_frametime, ent->v.avelocity, ent->v.angles);
 
 // move origin
-	VectorScale (ent->v.velocity, host_frametime, move);
+	VectorScale (ent->v.velocity, sv_frametime, move);
 	trace = SV_PushEntity (ent, move);
 	if (trace.fraction == 1)
 		return;
@@ -1200,7 +1240,7 @@ void SV_Physics_Step (edict_t *ent)
 
 		SV_AddGravity (ent);
 		SV_CheckVelocity (ent);
-		SV_FlyMove (ent, host_frametime, NULL);
+		SV_FlyMove (ent, sv_frametime, NULL);
 		SV_LinkEdict (ent, true);
 
 		if ( (int)ent->v.flags & FL_ONGROUND )	// just hit ground
@@ -1283,5 +1323,5 @@ void SV_Physics (void)
 		pr_global_struct->force_retouch--;
 
 	if (!sv_freezenonclients.value) 
-	  sv.time += host_frametime;
+	  sv.time += sv_frametime;
 }
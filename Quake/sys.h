@@ -58,6 +58,9 @@ void Sys_Printf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 double Sys_DoubleTime (void);
 
+double Sys_ProfileTime (void);
+// high resolution timer, seconds. only meaningful as a difference.
+
 const char *Sys_ConsoleInput (void);
 
 void Sys_Sleep (unsigned long msecs);
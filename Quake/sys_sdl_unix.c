@@ -50,6 +50,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 qboolean		isDedicated;
+qboolean		isHeadless;
 cvar_t		sys_throttle = {"sys_throttle", "0.02", CVAR_ARCHIVE};
 
 #define	MAX_HANDLES		32	/* johnfitz -- was 10 */
@@ -349,6 +350,12 @@ void Sys_Init (void)
 #endif
 	host_parms->numcpus = Sys_NumCPUs ();
 	Sys_Printf("Detected %d CPUs.\n", host_parms->numcpus);
+
+	host_parms->cpufeatures = 0;
+	if (SDL_HasSSE2 ())
+		host_parms->cpufeatures |= CPU_SSE2;
+	if (COM_CheckParm ("-nosimd"))
+		host_parms->cpufeatures = 0;
 }
 
 void Sys_mkdir (const char *path)
@@ -386,7 +393,7 @@ void Sys_Error (const char *error, ...)
 	fputs (errortxt2, stderr);
 	fputs (text, stderr);
 	fputs ("\n\n", stderr);
-	if (!isDedicated)
+	if (!isDedicated && !isHeadless)
 		PL_ErrorDialog(text);
 
 	exit (1);
@@ -413,6 +420,19 @@ double Sys_DoubleTime (void)
 	return SDL_GetTicks() / 1000.0;
 }
 
+double Sys_ProfileTime (void)
+{
+#if defined(USE_SDL2)
+	static double	freq;
+
+	if (!freq)
+		freq = (double) SDL_GetPerformanceFrequency();
+	return SDL_GetPerformanceCounter() / freq;
+#else
+	return SDL_GetTicks() / 1000.0;
+#endif
+}
+
 const char *Sys_ConsoleInput (void)
 {
 	static char	con_text[256];
@@ -46,6 +46,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 qboolean		isDedicated;
+qboolean		isHeadless;
 qboolean	Win95, Win95old, WinNT, WinVista;
 cvar_t		sys_throttle = {"sys_throttle", "0.02", CVAR_ARCHIVE};
 
@@ -268,6 +269,12 @@ void Sys_Init (void)
 	}
 	Sys_Printf("Detected %d CPUs.\n", host_parms->numcpus);
 
+	host_parms->cpufeatures = 0;
+	if (SDL_HasSSE2 ())
+		host_parms->cpufeatures |= CPU_SSE2;
+	if (COM_CheckParm ("-nosimd"))
+		host_parms->cpufeatures = 0;
+
 	if (isDedicated)
 	{
 		if (!AllocConsole ())
@@ -313,7 +320,7 @@ void Sys_Error (const char *error, ...)
 	fputs (errortxt2, stderr);
 	fputs (text, stderr);
 	fputs ("\n\n", stderr);
-	if (!isDedicated)
+	if (!isDedicated && !isHeadless)
 		PL_ErrorDialog(text);
 	else
 	{
@@ -363,6 +370,19 @@ double Sys_DoubleTime (void)
 	return SDL_GetTicks() / 1000.0;
 }
 
+double Sys_ProfileTime (void)
+{
+#if defined(USE_SDL2)
+	static double	freq;
+
+	if (!freq)
+		freq = (double) SDL_GetPerformanceFrequency();
+	return SDL_GetPerformanceCounter() / freq;
+#else
+	return SDL_GetTicks() / 1000.0;
+#endif
+}
+
 const char *Sys_ConsoleInput (void)
 {
 	static char	con_text[256];
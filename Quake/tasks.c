@@ -0,0 +1,296 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// tasks.c -- worker thread pool for load-time work
+
+#include "quakedef.h"
+
+#define	MAX_TASKS		4096	// must be a power of two
+
+typedef struct
+{
+	taskfunc_t	func;
+	void		*data;
+	taskgroup_t	*group;
+} task_t;
+
+static task_t		tasks[MAX_TASKS];
+static int		task_head, task_tail;	// queue is empty when equal
+
+static SDL_Thread	*task_workers[MAX_TASK_WORKERS];
+static int		task_numworkers;
+static SDL_mutex	*task_mutex;
+static SDL_cond		*task_added;	// signalled when a task is queued
+static SDL_cond		*task_done;	// broadcast when a group finishes
+static qboolean		task_quit;
+static unsigned long	task_mainthread;	// SDL_threadID, Uint32 in SDL 1.2
+static unsigned long	task_workerids[MAX_TASK_WORKERS];
+
+/*
+================
+Task_Pop -- task_mutex must be held
+================
+*/
+static qboolean Task_Pop (task_t *task)
+{
+	if (task_head == task_tail)
+		return false;
+	*task = tasks[task_tail];
+	task_tail = (task_tail + 1) & (MAX_TASKS - 1);
+	return true;
+}
+
+/*
+================
+Task_PopGroup -- task_mutex must be held
+
+Takes the oldest queued task of one group, leaving the others in order
+================
+*/
+static qboolean Task_PopGroup (taskgroup_t *group, task_t *task)
+{
+	int	i, prev;
+
+	for (i = task_tail; i != task_head; i = (i + 1) & (MAX_TASKS - 1))
+	{
+		if (tasks[i].group == group)
+			break;
+	}
+	if (i == task_head)
+		return false;
+	*task = tasks[i];
+	for ( ; i != task_tail; i = prev)
+	{
+		prev = (i - 1) & (MAX_TASKS - 1);
+		tasks[i] = tasks[prev];
+	}
+	task_tail = (task_tail + 1) & (MAX_TASKS - 1);
+	return true;
+}
+
+/*
+================
+Task_Finish -- task_mutex must be held
+================
+*/
+static void Task_Finish (task_t *task)
+{
+	if (--task->group->pending == 0)
+		SDL_CondBroadcast (task_done);
+}
+
+static int Task_Worker (void *unused)
+{
+	task_t	task;
+
+	SDL_LockMutex (task_mutex);
+	while (!task_quit)
+	{
+		if (!Task_Pop (&task))
+		{
+			SDL_CondWait (task_added, task_mutex);
+			continue;
+		}
+		SDL_UnlockMutex (task_mutex);
+		task.func (task.data);
+		SDL_LockMutex (task_mutex);
+		Task_Finish (&task);
+	}
+	SDL_UnlockMutex (task_mutex);
+
+	return 0;
+}
+
+/*
+================
+Tasks_Init
+================
+*/
+void Tasks_Init (void)
+{
+	int	i, n;
+
+	i = COM_CheckParm ("-threads");
+	if (i && i < com_argc-1)
+		n = Q_atoi (com_argv[i+1]);
+	else
+	{
+#if defined(USE_SDL2)
+		n = SDL_GetCPUCount () - 1;	// leave a core for the main thread
+#else
+		n = 1;
+#endif
+	}
+	n = CLAMP (0, n, MAX_TASK_WORKERS);
+
+	task_mainthread = SDL_ThreadID ();
+
+	task_mutex = SDL_CreateMutex ();
+	task_added = SDL_CreateCond ();
+	task_done = SDL_CreateCond ();
+	if (!task_mutex || !task_added || !task_done)
+		Sys_Error ("Tasks_Init: %s", SDL_GetError());
+
+	task_quit = false;
+	for (task_numworkers = 0; task_numworkers < n; task_numworkers++)
+	{
+#if defined(USE_SDL2)
+		task_workers[task_numworkers] = SDL_CreateThread (Task_Worker, "worker", NULL);
+#else
+		task_workers[task_numworkers] = SDL_CreateThread (Task_Worker, NULL);
+#endif
+		if (!task_workers[task_numworkers])
+			break;
+		task_workerids[task_numworkers] = SDL_GetThreadID (task_workers[task_numworkers]);
+	}
+
+	Con_Printf ("%i worker threads\n", task_numworkers);
+}
+
+/*
+================
+Tasks_Shutdown
+================
+*/
+void Tasks_Shutdown (void)
+{
+	int	i;
+
+	if (!task_mutex)
+		return;
+
+	SDL_LockMutex (task_mutex);
+	task_quit = true;
+	SDL_CondBroadcast (task_added);
+	SDL_UnlockMutex (task_mutex);
+
+	for (i = 0; i < task_numworkers; i++)
+		SDL_WaitThread (task_workers[i], NULL);
+	task_numworkers = 0;
+
+	SDL_DestroyCond (task_done);
+	SDL_DestroyCond (task_added);
+	SDL_DestroyMutex (task_mutex);
+	task_mutex = NULL;
+}
+
+int Tasks_NumWorkers (void)
+{
+	return task_numworkers;
+}
+
+/*
+================
+Tasks_ThreadIndex
+
+0 on the main thread, 1 + worker number on a worker thread, -1 on any
+other thread (the music decoder, say)
+================
+*/
+int Tasks_ThreadIndex (void)
+{
+	unsigned long	id;
+	int		i;
+
+	id = SDL_ThreadID ();
+	if (id == task_mainthread)
+		return 0;
+	for (i = 0; i < task_numworkers; i++)
+	{
+		if (task_workerids[i] == id)
+			return 1 + i;
+	}
+	return -1;
+}
+
+/*
+================
+Tasks_IsWorker
+
+True when called from a worker thread rather than the main thread
+================
+*/
+qboolean Tasks_IsWorker (void)
+{
+	return Tasks_ThreadIndex () > 0;
+}
+
+/*
+================
+Task_Add
+================
+*/
+void Task_Add (taskgroup_t *group, taskfunc_t func, void *data)
+{
+	int	next;
+
+	if (!task_numworkers)
+	{
+		func (data);
+		return;
+	}
+
+	SDL_LockMutex (task_mutex);
+	next = (task_head + 1) & (MAX_TASKS - 1);
+	if (next == task_tail)
+	{	// queue is full, don't wait for room
+		SDL_UnlockMutex (task_mutex);
+		func (data);
+		return;
+	}
+	tasks[task_head].func = func;
+	tasks[task_head].data = data;
+	tasks[task_head].group = group;
+	task_head = next;
+	group->pending++;
+	SDL_CondSignal (task_added);
+	SDL_UnlockMutex (task_mutex);
+}
+
+/*
+================
+Task_Wait
+
+runs this group's queued tasks on the calling thread until every task
+of the group has finished. Other groups' tasks are left to the workers,
+so a wait never runs, say, the server frame on the main thread.
+================
+*/
+void Task_Wait (taskgroup_t *group)
+{
+	task_t	task;
+
+	if (!task_numworkers)
+		return;
+
+	SDL_LockMutex (task_mutex);
+	while (group->pending)
+	{
+		if (Task_PopGroup (group, &task))
+		{
+			SDL_UnlockMutex (task_mutex);
+			task.func (task.data);
+			SDL_LockMutex (task_mutex);
+			Task_Finish (&task);
+		}
+		else
+			SDL_CondWait (task_done, task_mutex);
+	}
+	SDL_UnlockMutex (task_mutex);
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef __TASKS_H
+#define __TASKS_H
+
+// tasks.h -- worker thread pool for load-time work
+
+/*
+Tasks are plain function calls run on a small pool of worker threads.
+They must not touch the hunk, zone, cache, console or GL state: only
+memory handed to them, malloc'd memory, and data nothing else writes
+while they run. Each task belongs to a group, and Task_Wait blocks
+until every task of that group has run, helping out with the group's
+queued tasks meanwhile. With -threads 0, or when the queue is full, tasks run
+immediately on the calling thread.
+
+The one exception to these rules is the local server frame (see
+host_serverthread), which runs while the main thread only renders and
+defers its console output, errors and QuakeC cvar sets to the main
+thread. The zone is locked for it, and it keeps its own PVS buffers.
+*/
+
+#define	MAX_TASK_WORKERS	16
+
+typedef void (*taskfunc_t) (void *data);
+
+typedef struct
+{
+	int	pending;	// tasks added but not yet finished
+} taskgroup_t;
+
+void Tasks_Init (void);
+void Tasks_Shutdown (void);
+int Tasks_NumWorkers (void);
+qboolean Tasks_IsWorker (void);
+int Tasks_ThreadIndex (void);
+
+void Task_Add (taskgroup_t *group, taskfunc_t func, void *data);
+void Task_Wait (taskgroup_t *group);
+
+#endif	/* __TASKS_H */
@@ -0,0 +1,252 @@
+/*
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// vid_null.c -- video, input and renderer stubs for the dedicated server
+// build. The server loads brush and alias models for collision only, so
+// everything that would turn them into textures or meshes does nothing.
+
+#include "quakedef.h"
+
+viddef_t	vid;
+modestate_t	modestate = MS_UNINIT;
+int		glx, gly, glwidth, glheight;
+
+vec3_t		r_origin, vpn, vright, vup;
+unsigned int	d_8to24table[256];
+int		gl_warpimagesize;
+qpic_t		*pic_ovr, *pic_ins;
+
+float		scr_centertime_off;
+int		clearnotify;
+int		scr_tileclear_updates;
+qboolean	scr_disabled_for_loading;
+qboolean	scr_skipupdate;
+
+// read by the model loader and the server, never registered
+cvar_t	gl_subdivide_size = {"gl_subdivide_size", "128", CVAR_ARCHIVE};
+cvar_t	r_showbboxes = {"r_showbboxes", "0", CVAR_NONE};
+cvar_t	r_nolerp_list = {"r_nolerp_list", "", CVAR_NONE};
+cvar_t	r_noshadow_list = {"r_noshadow_list", "", CVAR_NONE};
+cvar_t	vr_enabled = {"vr_enabled", "0", CVAR_NONE};
+vec3_t	vr_room_scale_move;
+
+/*
+==============================================================================
+
+VIDEO AND INPUT
+
+==============================================================================
+*/
+
+void VID_Init (void)
+{
+}
+
+void VID_Shutdown (void)
+{
+}
+
+void VID_Lock (void)
+{
+}
+
+qboolean VID_HasMouseOrInputFocus (void)
+{
+	return false;
+}
+
+qboolean VID_IsMinimized (void)
+{
+	return true;
+}
+
+void *VID_GetWindow (void)
+{
+	return NULL;
+}
+
+void VID_VR_Shutdown (void)
+{
+}
+
+void VR_InitGame (void)
+{
+}
+
+void IN_Init (void)
+{
+}
+
+void IN_Shutdown (void)
+{
+}
+
+void IN_Commands (void)
+{
+}
+
+void IN_SendKeyEvents (void)
+{
+}
+
+void IN_UpdateInputMode (void)
+{
+}
+
+void IN_Activate (void)
+{
+}
+
+void IN_Deactivate (qboolean free_cursor)
+{
+}
+
+/*
+==============================================================================
+
+RENDERER
+
+==============================================================================
+*/
+
+void R_Init (void)
+{
+}
+
+void R_NewGame (void)
+{
+}
+
+void D_FlushCaches (void)
+{
+}
+
+void V_Init (void)
+{
+}
+
+float V_CalcRoll (vec3_t angles, vec3_t velocity)
+{
+	return 0;
+}
+
+void SCR_Init (void)
+{
+}
+
+void SCR_UpdateScreen (void)
+{
+}
+
+void SCR_BeginLoadingPlaque (void)
+{
+}
+
+void SCR_EndLoadingPlaque (void)
+{
+}
+
+void Draw_Init (void)
+{
+}
+
+void Draw_NewGame (void)
+{
+}
+
+void Draw_Character (int x, int y, int num)
+{
+}
+
+void Draw_String (int x, int y, const char *str)
+{
+}
+
+void Draw_Pic (int x, int y, qpic_t *pic)
+{
+}
+
+void Draw_ConsoleBackground (void)
+{
+}
+
+void GL_SetCanvas (canvastype newcanvas)
+{
+}
+
+void TexMgr_Init (void)
+{
+}
+
+void TexMgr_NewGame (void)
+{
+}
+
+gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int height, enum srcformat format,
+			       byte *data, const char *source_file, src_offset_t source_offset, unsigned flags)
+{
+	return NULL;
+}
+
+void TexMgr_FreeTexturesForOwner (qmodel_t *owner)
+{
+}
+
+void TexMgr_BeginBatch (void)
+{
+}
+
+void TexMgr_EndBatch (void)
+{
+}
+
+void TexMgr_AbortBatch (void)
+{
+}
+
+int TexMgr_PadConditional (int s)
+{
+	return s;
+}
+
+byte *Image_LoadImage (const char *name, int *width, int *height)
+{
+	return NULL;
+}
+
+void Sky_LoadTexture (texture_t *mt)
+{
+}
+
+qboolean GLWarp_SubdivideAtLoad (void)
+{
+	return false;
+}
+
+void GL_SubdivideSurface (msurface_t *fa)
+{
+}
+
+void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *hdr)
+{
+}
+
+void GLMesh_DeleteVertexBuffers (void)
+{
+}
@@ -951,7 +951,8 @@ void V_RenderView (void)
 
 	R_RenderView ();
 
-	V_PolyBlend (); //johnfitz -- moved here from R_Renderview ();
+	if (!isHeadless)
+		V_PolyBlend (); //johnfitz -- moved here from R_Renderview ();
 }
 
 /*
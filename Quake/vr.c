@@ -61,6 +61,7 @@ static PFNGLGENFRAMEBUFFERSEXTPROC glGenFramebuffersEXT;
 static PFNGLFRAMEBUFFERTEXTURE2DEXTPROC glFramebufferTexture2DEXT;
 static PFNGLFRAMEBUFFERRENDERBUFFEREXTPROC glFramebufferRenderbufferEXT;
 static PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT;
+static PFNGLBLENDFUNCSEPARATEPROC glBlendFuncSeparateEXT;
 static PFNGLTEXIMAGE2DMULTISAMPLEPROC glTexImage2DMultisampleEXT;
 
 struct {
@@ -75,6 +76,7 @@ struct {
     { &glFramebufferRenderbufferEXT, "glFramebufferRenderbufferEXT" },
 	{ &glCheckFramebufferStatusEXT, "glCheckFramebufferStatusEXT"},
 	{ &wglSwapIntervalEXT, "wglSwapIntervalEXT" },
+	{ &glBlendFuncSeparateEXT, "glBlendFuncSeparate" },
 { NULL, NULL },
 };
 
@@ -92,6 +94,7 @@ extern void SCR_DrawTurtle(void);
 extern void SCR_DrawPause(void);
 extern void SCR_DrawDevStats(void);
 extern void SCR_DrawFPS(void);
+extern void SCR_DrawProfile(void);
 extern void SCR_DrawClock(void);
 extern void SCR_DrawConsole(void);
 
@@ -152,6 +155,7 @@ cvar_t vr_snap_turn = { "vr_snap_turn", "0", CVAR_ARCHIVE };
 cvar_t vr_turn_speed = { "vr_turn_speed", "1", CVAR_ARCHIVE };
 cvar_t vr_msaa = { "vr_msaa", "4", CVAR_ARCHIVE };
 cvar_t vr_movement_mode = { "vr_movement_mode", "0", CVAR_ARCHIVE };
+cvar_t vr_hudlayer_scale = { "vr_hudlayer_scale", "4", CVAR_ARCHIVE };
 
 static qboolean InitOpenGLExtensions()
 {
@@ -387,6 +391,12 @@ static void VR_Enabled_f(cvar_t *var)
     if (!vr_enabled.value)
         return;
 
+    // No window to mirror to and no GL context to render with
+    if (isHeadless) {
+        Cvar_SetValueQuick(&vr_enabled, 0);
+        return;
+    }
+
     if (!VR_Enable())
         Cvar_SetValueQuick(&vr_enabled, 0);
 }
@@ -521,6 +531,7 @@ void VID_VR_Init()
 	Cvar_RegisterVariable(&vr_turn_speed);
 	Cvar_RegisterVariable(&vr_msaa);
 	Cvar_RegisterVariable(&vr_movement_mode);
+	Cvar_RegisterVariable(&vr_hudlayer_scale);
 	Cvar_SetCallback(&vr_deadzone, VR_Deadzone_f);
 
 	InitAllWeaponCVars();
@@ -534,6 +545,7 @@ void VID_VR_Init()
     {
         //int i = COM_CheckParm("-vr");
         //if (i && i < com_argc - 1) {
+        if (!isHeadless)
             Cvar_SetQuick(&vr_enabled, "1");
         //}
     }
@@ -597,6 +609,8 @@ void VID_VR_Shutdown() {
     VID_VR_Disable();
 }
 
+static void VR_DeleteHudLayers();
+
 void VID_VR_Disable()
 {
     int i;
@@ -610,6 +624,7 @@ void VID_VR_Disable()
     cl.viewheight = DEFAULT_VIEWHEIGHT;
 
     // TODO: Cleanup frame buffers
+    VR_DeleteHudLayers();
 
     vr_initialized = false;
 }
@@ -667,7 +682,9 @@ static void RenderScreenForCurrentEye_OVR()
 	}
 
     Texture_t eyeTexture = { (void*)current_eye->fbo.texture, TextureType_OpenGL, ColorSpace_Gamma };
+    Prof_Begin("vr submit");
     IVRCompositor_Submit(VRCompositor(), current_eye->eye, &eyeTexture);
+    Prof_End();
     
     // Reset
     glwidth = oldglwidth;
@@ -690,6 +707,7 @@ void SetHandPos(int index, entity_t *player)
 }
 
 void IdentifyAxes(int device);
+static void VR_UpdateHudLayers();
 
 void VR_UpdateScreenContent()
 {
@@ -710,7 +728,9 @@ void VR_UpdateScreenContent()
 	entity_t *player = &cl_entities[cl.viewentity];
 
     // Update poses
+    Prof_Begin("vr wait poses");
     IVRCompositor_WaitGetPoses(VRCompositor(), ovr_DevicePose, k_unMaxTrackedDeviceCount, NULL, 0);
+    Prof_End();
 
     // Get the VR devices' orientation and position
     for (int iDevice = 0; iDevice < k_unMaxTrackedDeviceCount; iDevice++)
@@ -892,6 +912,8 @@ void VR_UpdateScreenContent()
     VectorCopy(cl.viewangles, r_refdef.viewangles);
     VectorCopy(cl.aimangles, r_refdef.aimangles);
 
+    VR_UpdateHudLayers();
+
 	// Render the scene for each eye into their FBOs
     for (i = 0; i < 2; i++) {
         current_eye = &eyes[i];
@@ -906,7 +928,9 @@ void VR_UpdateScreenContent()
 		Vec3RotateZ(temp, (r_refdef.viewangles[YAW] - orientation[YAW])*M_PI_DIV_180, vr_viewOffset);
 		vr_viewOffset[2] += vr_floor_offset.value;
 
+        Prof_Begin(i ? "right eye" : "left eye");
         RenderScreenForCurrentEye_OVR();
+        Prof_End();
     }
     
     // Blit mirror texture to backbuffer
@@ -938,13 +962,44 @@ void VR_AddOrientationToViewAngles(vec3_t angles)
     angles[ROLL] = orientation[ROLL];
 }
 
+// The aim ray and what it hits, traced at most once per host frame no matter
+// how many eyes or consumers (crosshair, laser, pointers) ask for it.
+static vr_aimray_t aimray = { -1 };
+
+const vr_aimray_t *VR_GetAimRay()
+{
+    vec3_t right, up;
+
+    if (aimray.framecount == host_framecount)
+        return &aimray;
+    aimray.framecount = host_framecount;
+
+    // TODO: Make the laser align correctly
+    if (vr_aimmode.value == VR_AIMMODE_CONTROLLER)
+    {
+        VectorCopy(cl.handpos[1], aimray.start);
+        AngleVectors(cl.handrot[1], aimray.forward, right, up);
+    }
+    else
+    {
+        VectorCopy(cl.viewent.origin, aimray.start);
+        aimray.start[2] -= cl.viewheight - 10;
+        AngleVectors(cl.aimangles, aimray.forward, right, up);
+    }
+
+    VectorMA(aimray.start, 4096, aimray.forward, aimray.end);
+    aimray.entity = CL_TraceLine(aimray.start, aimray.end, aimray.impact, cl.viewentity);
+
+    return &aimray;
+}
+
 void VR_ShowCrosshair()
 {
-    vec3_t forward, up, right;
-    vec3_t start, end, impact;
+    const vr_aimray_t *ray;
+    vec3_t impact;
     float size, alpha;
 
-    if ((sv_player && (int)(sv_player->v.weapon) == IT_AXE))
+    if (cl.stats[STAT_ACTIVEWEAPON] == IT_AXE)
         return;
 
     size = CLAMP(0.0, vr_crosshair_size.value, 32.0);
@@ -963,32 +1018,19 @@ void VR_ShowCrosshair()
     glDisable(GL_CULL_FACE);
 
     // calc the line and draw
-    // TODO: Make the laser align correctly
-	if (vr_aimmode.value == VR_AIMMODE_CONTROLLER)
-	{
-		VectorCopy(cl.handpos[1], start)
-		AngleVectors(cl.handrot[1], forward, right, up);
-	}
-    else
-    {
-        VectorCopy(cl.viewent.origin, start);
-        start[2] -= cl.viewheight - 10;
-		AngleVectors(cl.aimangles, forward, right, up);
-	}
-
+    ray = VR_GetAimRay();
 
     switch ((int)vr_crosshair.value)
     {
     default:
     case VR_CROSSHAIR_POINT:
         if (vr_crosshair_depth.value <= 0) {
-            // trace to first wall
-            VectorMA(start, 4096, forward, end);
-            TraceLine(start, end, impact);
+            // first thing the ray hits
+            VectorCopy(ray->impact, impact);
         }
         else {
             // fix crosshair to specific depth
-            VectorMA(start, vr_crosshair_depth.value * meters_to_units, forward, impact);
+            VectorMA(ray->start, vr_crosshair_depth.value * meters_to_units, ray->forward, impact);
         }
 
         glEnable(GL_POINT_SMOOTH);
@@ -1002,15 +1044,11 @@ void VR_ShowCrosshair()
         break;
 
     case VR_CROSSHAIR_LINE:
-        // trace to first entity
-        VectorMA(start, 4096, forward, end);
-        TraceLineToEntity(start, end, impact, sv_player);
-
         glColor4f(1, 0, 0, alpha);
         glLineWidth(size * glwidth / vid.width);
         glBegin(GL_LINES);
-        glVertex3f(start[0], start[1], start[2]);
-        glVertex3f(impact[0], impact[1], impact[2]);
+        glVertex3f(ray->start[0], ray->start[1], ray->start[2]);
+        glVertex3f(ray->impact[0], ray->impact[1], ray->impact[2]);
         glEnd();
         break;
     }
@@ -1025,57 +1063,84 @@ void VR_ShowCrosshair()
     glEnable(GL_DEPTH_TEST);
 }
 
-void VR_Draw2D()
-{
-    qboolean draw_sbar = false;
-    vec3_t menu_angles, forward, right, up, target;
-    float scale_hud = 0.13;
-
-    int oldglwidth = glwidth,
-        oldglheight = glheight,
-        oldconwidth = vid.conwidth,
-        oldconheight = vid.conheight;
-
-    glwidth = 320;
-    glheight = 200;
+// The 2D screen and the status bar are drawn once per frame into offscreen
+// layer textures; each eye then composites them as a single textured quad
+// instead of re-issuing every glyph and pic.
+typedef struct {
+    fbo_t fbo;
+    qboolean visible;
+} vr_hudlayer_t;
 
-    vid.conwidth = 320;
-    vid.conheight = 200;
+static vr_hudlayer_t hud_layer, sbar_layer;
 
-    // draw 2d elements 1m from the users face, centered
-    glPushMatrix();
-    glDisable(GL_DEPTH_TEST); // prevents drawing sprites on sprites from interferring with one another
-    glEnable(GL_BLEND);
-
-	if (vr_aimmode.value == VR_AIMMODE_CONTROLLER)
-	{
-		AngleVectors(cl.handrot[1], forward, right, up);
+static void VR_BeginHudLayer(vr_hudlayer_t *layer)
+{
+    int scale = CLAMP(1, (int)vr_hudlayer_scale.value, 8);
+    int width = 320 * scale;
+    int height = 200 * scale;
 
-		VectorCopy(cl.handrot[1], menu_angles)
+    if (!layer->fbo.framebuffer)
+    {
+        layer->fbo = CreateFBO(width, height);
+        GL_ClearBindings();
+    }
+    else if (layer->fbo.size.width != width || layer->fbo.size.height != height)
+    {
+        RecreateTextures(&layer->fbo, width, height);
+        GL_ClearBindings();
+    }
 
-		AngleVectors(menu_angles, forward, right, up);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, layer->fbo.framebuffer);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-		VectorMA(cl.handpos[1], 48, forward, target);
-	}
-	else
-	{
-		// TODO: Make the menus' position sperate from the right hand. Centered on last view dir?
-		VectorCopy(r_refdef.aimangles, menu_angles)
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, 320, 200, 0, -99999, 99999);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+}
 
-		if (vr_aimmode.value == VR_AIMMODE_HEAD_MYAW || vr_aimmode.value == VR_AIMMODE_HEAD_MYAW_MPITCH)
-			menu_angles[PITCH] = 0;
+static void VR_EndHudLayer(vr_hudlayer_t *layer)
+{
+    Draw_Flush();
+    layer->visible = true;
+}
 
-		AngleVectors(menu_angles, forward, right, up);
+static void VR_DeleteHudLayer(vr_hudlayer_t *layer)
+{
+    if (layer->fbo.framebuffer)
+        DeleteFBO(layer->fbo);
+    memset(layer, 0, sizeof(*layer));
+}
 
-		VectorMA(r_refdef.vieworg, 48, forward, target);
-	}
+static void VR_DeleteHudLayers()
+{
+    VR_DeleteHudLayer(&hud_layer);
+    VR_DeleteHudLayer(&sbar_layer);
+}
 
-    glTranslatef(target[0], target[1], target[2]);
-    glRotatef(menu_angles[YAW] - 90, 0, 0, 1); // rotate around z
-    glRotatef(90 + menu_angles[PITCH], -1, 0, 0); // keep bar at constant angled pitch towards user
-    glTranslatef(-(320.0 * scale_hud / 2), -(200.0 * scale_hud / 2), 0); // center the status bar
-    glScalef(scale_hud, scale_hud, scale_hud);
+// Draws one layer over the 320x200 area of the current modelview
+static void VR_DrawHudLayer(vr_hudlayer_t *layer)
+{
+    glBindTexture(GL_TEXTURE_2D, layer->fbo.texture);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 1);
+    glVertex2f(0, 0);
+    glTexCoord2f(1, 1);
+    glVertex2f(320, 0);
+    glTexCoord2f(1, 0);
+    glVertex2f(320, 200);
+    glTexCoord2f(0, 0);
+    glVertex2f(0, 200);
+    glEnd();
+    GL_ClearBindings();
+}
 
+// Returns true if the status bar should be drawn as well
+static qboolean VR_Draw2DContent()
+{
+    qboolean draw_sbar = false;
 
     if (scr_drawdialog) //new game confirm
     {
@@ -1110,18 +1175,64 @@ void VR_Draw2D()
         SCR_CheckDrawCenterString();
         draw_sbar = true; //Sbar_Draw ();
         SCR_DrawDevStats(); //johnfitz
+        SCR_DrawProfile();
         SCR_DrawFPS(); //johnfitz
         SCR_DrawClock(); //johnfitz
         SCR_DrawConsole();
         M_Draw();
     }
 
+    return draw_sbar;
+}
+
+// Renders the 2D screen and status bar into their layers, once for both eyes
+static void VR_UpdateHudLayers()
+{
+    GLfloat clearcolor[4];
+    int oldglwidth = glwidth,
+        oldglheight = glheight,
+        oldconwidth = vid.conwidth,
+        oldconheight = vid.conheight;
+
+    hud_layer.visible = sbar_layer.visible = false;
+
+    // with the console forced up each eye draws the regular 2D screen
+    if (con_forcedup)
+        return;
+
+    glwidth = 320;
+    glheight = 200;
+
+    vid.conwidth = 320;
+    vid.conheight = 200;
+
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearcolor);
+    glClearColor(0, 0, 0, 0);
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glEnable(GL_ALPHA_TEST);
+    glColor4f(1, 1, 1, 1);
+    // accumulate coverage in alpha so the layer comes out premultiplied
+    glBlendFuncSeparateEXT(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    VR_BeginHudLayer(&hud_layer);
+    if (VR_Draw2DContent())
+    {
+        VR_EndHudLayer(&hud_layer);
+        VR_BeginHudLayer(&sbar_layer);
+        Sbar_Draw();
+        VR_EndHudLayer(&sbar_layer);
+    }
+    else
+        VR_EndHudLayer(&hud_layer);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
-    glPopMatrix();
-
-    if (draw_sbar)
-        VR_DrawSbar();
+    glClearColor(clearcolor[0], clearcolor[1], clearcolor[2], clearcolor[3]);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
 
     glwidth = oldglwidth;
     glheight = oldglheight;
@@ -1129,6 +1240,61 @@ void VR_Draw2D()
     vid.conheight = oldconheight;
 }
 
+void VR_Draw2D()
+{
+    vec3_t menu_angles, forward, right, up, target;
+    float scale_hud = 0.13;
+
+    // draw 2d elements 1m from the users face, centered
+    glPushMatrix();
+    glDisable(GL_DEPTH_TEST); // prevents drawing sprites on sprites from interferring with one another
+    glDisable(GL_ALPHA_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // layers are premultiplied
+
+	if (vr_aimmode.value == VR_AIMMODE_CONTROLLER)
+	{
+		AngleVectors(cl.handrot[1], forward, right, up);
+
+		VectorCopy(cl.handrot[1], menu_angles)
+
+		AngleVectors(menu_angles, forward, right, up);
+
+		VectorMA(cl.handpos[1], 48, forward, target);
+	}
+	else
+	{
+		// TODO: Make the menus' position sperate from the right hand. Centered on last view dir?
+		VectorCopy(r_refdef.aimangles, menu_angles)
+
+		if (vr_aimmode.value == VR_AIMMODE_HEAD_MYAW || vr_aimmode.value == VR_AIMMODE_HEAD_MYAW_MPITCH)
+			menu_angles[PITCH] = 0;
+
+		AngleVectors(menu_angles, forward, right, up);
+
+		VectorMA(r_refdef.vieworg, 48, forward, target);
+	}
+
+    glTranslatef(target[0], target[1], target[2]);
+    glRotatef(menu_angles[YAW] - 90, 0, 0, 1); // rotate around z
+    glRotatef(90 + menu_angles[PITCH], -1, 0, 0); // keep bar at constant angled pitch towards user
+    glTranslatef(-(320.0 * scale_hud / 2), -(200.0 * scale_hud / 2), 0); // center the status bar
+    glScalef(scale_hud, scale_hud, scale_hud);
+
+    if (hud_layer.visible)
+        VR_DrawHudLayer(&hud_layer);
+
+    glPopMatrix();
+
+    if (sbar_layer.visible)
+        VR_DrawSbar();
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_BLEND);
+    glEnable(GL_ALPHA_TEST);
+    glEnable(GL_DEPTH_TEST);
+}
+
 void VR_DrawSbar()
 {
     vec3_t sbar_angles, forward, right, up, target;
@@ -1167,7 +1333,7 @@ void VR_DrawSbar()
     glTranslatef(0, 0, 10); // move hud down a bit
     glScalef(scale_hud, scale_hud, scale_hud);
 
-    Sbar_Draw();
+    VR_DrawHudLayer(&sbar_layer);
 
     glEnable(GL_DEPTH_TEST);
     glPopMatrix();
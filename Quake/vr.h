@@ -21,6 +21,13 @@
 #define VR_MOVEMENT_MODE_RAW_INPUT 1
 #define VR_MAX_MOVEMENT_MODE VR_MOVEMENT_MODE_RAW_INPUT
 
+typedef struct {
+    int framecount;     // host_framecount of the trace
+    vec3_t start, forward, end;
+    vec3_t impact;      // first thing hit between start and end
+    int entity;         // cl_entities index hit, 0 for the world
+} vr_aimray_t;
+
 void VID_VR_Init();
 void VID_VR_Shutdown();
 qboolean VR_Enable();
@@ -28,6 +35,7 @@ void VID_VR_Disable();
 
 void VR_UpdateScreenContent();
 void VR_ShowCrosshair();
+const vr_aimray_t *VR_GetAimRay();
 void VR_Draw2D();
 void VR_DrawSbar();
 void VR_AddOrientationToViewAngles(vec3_t angles);
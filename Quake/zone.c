@@ -22,26 +22,63 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // zone.c
 
 #include "quakedef.h"
-
 #define	DYNAMIC_SIZE	(4 * 1024 * 1024) // ericw -- was 512KB (64-bit) / 384KB (32-bit)
 
-#define	ZONEID	0x1d4a11
-#define MINFRAGMENT	64
+#define	ZONEID		0x1d4a11
+#define	ZONE_PAGESHIFT	13
+#define	ZONE_PAGESIZE	(1 << ZONE_PAGESHIFT)
+#define	ZONE_GRAIN	16		// class size step; the data starts ZBLOCK_HEADER (8) bytes in, so it is only 8 aligned
+#define	ZONE_MAXCLASS	2048		// bigger blocks get pages of their own
+
+#define	ZPAGE_FREE	-1
+#define	ZPAGE_SPAN	-2		// first page of a multi-page block
+#define	ZPAGE_TAIL	-3		// the rest of its pages
 
 typedef struct memblock_s
 {
-	int	size;		// including the header and possibly tiny fragments
-	int	tag;		// a tag of 0 is a free block
-	int	id;		// should be ZONEID
-	int	pad;		// pad to 64 bit boundary
-	struct	memblock_s	*next, *prev;
+	int	size;		// bytes asked for
+	int	id;		// ZONEID while allocated, 0 on a free list
+	struct	memblock_s	*next;	// free list only, the data starts here
 } memblock_t;
 
+#define	ZBLOCK_HEADER	((int)offsetof(memblock_t, next))
+
+typedef struct mempage_s
+{
+	int		sizeclass;	// index into zone classes or ZPAGE_*
+	int		used;		// blocks handed out from a class page
+	int		span;		// pages in the block, on a ZPAGE_SPAN page
+	memblock_t	*freelist;
+	struct	mempage_s	*prev, *next;	// class pages with free blocks
+} mempage_t;
+
+typedef struct
+{
+	int		size;		// block size including the header
+	int		perpage;
+	mempage_t	*partial;	// pages with free blocks
+	int		pages;
+	int		inuse, peak;	// blocks
+	int		requested;	// bytes asked for by the blocks in use
+} memclass_t;
+
+static const int zone_classsizes[] =
+{
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+#define	NUM_ZONECLASSES	((int)(sizeof(zone_classsizes) / sizeof(zone_classsizes[0])))
+
 typedef struct
 {
 	int		size;		// total bytes malloced, including header
-	memblock_t	blocklist;	// start / end cap for linked list
-	memblock_t	*rover;
+	byte		*base;		// first page
+	int		numpages, freepages;
+	int		rover;		// page searches start here
+	mempage_t	*pages;
+	memclass_t	classes[NUM_ZONECLASSES];
+	byte		classfor[ZONE_MAXCLASS / ZONE_GRAIN + 1];	// block size / ZONE_GRAIN -> class
+	int		spans, spanpages, spanrequested;
 } memzone_t;
 
 void Cache_FreeLow (int new_low_hunk);
@@ -53,140 +90,271 @@ void Cache_FreeHigh (int new_high_hunk);
 
 						ZONE MEMORY ALLOCATION
 
-There is never any space between memblocks, and there will never be two
-contiguous free memblocks.
+The zone is cut into pages.  Blocks up to ZONE_MAXCLASS bytes are rounded up
+to one of a few size classes, and each class hands out blocks from its own
+pages through a free list, so allocating and freeing them never searches.
+A class page goes back to the pool once its last block is freed, unless it
+is the only page the class has left.
 
-The rover can be left pointing at a non-empty block
+Bigger blocks take a run of whole pages, found first-fit from a rover over
+the page map.  Those are rare: the zone calls are pretty much only used for
+small strings and structures, all big things are allocated on the hunk.
 
-The zone calls are pretty much only used for small strings and structures,
-all big things are allocated on the hunk.
+The zone is locked, as the local server frame can run on a worker while
+the main thread renders (host_serverthread).
 ==============================================================================
 */
 
 static memzone_t	*mainzone;
+static SDL_mutex	*zone_mutex;
 
 
 /*
 ========================
-Z_Free
+Z_AllocPages
+
+Returns the first of count free pages in a row, or -1
 ========================
 */
-void Z_Free (void *ptr)
+static int Z_AllocPages (int count)
 {
-	memblock_t	*block, *other;
+	int	i, n, run;
 
-	if (!ptr)
-		Sys_Error ("Z_Free: NULL pointer");
+	if (count > mainzone->freepages)
+		return -1;
 
-	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID)
-		Sys_Error ("Z_Free: freed a pointer without ZONEID");
-	if (block->tag == 0)
-		Sys_Error ("Z_Free: freed a freed pointer");
+	for (i = mainzone->rover, n = 0, run = 0; n < mainzone->numpages + count; i++, n++)
+	{
+		if (i == mainzone->numpages)
+		{	// runs don't wrap around
+			i = 0;
+			run = 0;
+		}
+		if (mainzone->pages[i].sizeclass != ZPAGE_FREE)
+		{
+			run = 0;
+			continue;
+		}
+		if (++run < count)
+			continue;
+
+		mainzone->rover = (i + 1) % mainzone->numpages;
+		mainzone->freepages -= count;
+		for (n = i - count + 1; n <= i; n++)
+			mainzone->pages[n].sizeclass = ZPAGE_TAIL;
+		return i - count + 1;
+	}
 
-	block->tag = 0;		// mark as free
+	return -1;
+}
 
-	other = block->prev;
-	if (!other->tag)
-	{	// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == mainzone->rover)
-			mainzone->rover = other;
-		block = other;
-	}
+static void Z_FreePages (int first, int count)
+{
+	int	i;
 
-	other = block->next;
-	if (!other->tag)
-	{	// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if (other == mainzone->rover)
-			mainzone->rover = block;
-	}
+	for (i = first; i < first + count; i++)
+		mainzone->pages[i].sizeclass = ZPAGE_FREE;
+	mainzone->freepages += count;
 }
 
+static void Z_LinkPage (memclass_t *c, mempage_t *page)
+{
+	page->prev = NULL;
+	page->next = c->partial;
+	if (c->partial)
+		c->partial->prev = page;
+	c->partial = page;
+}
 
-static void *Z_TagMalloc (int size, int tag)
+static void Z_UnlinkPage (memclass_t *c, mempage_t *page)
 {
-	int		extra;
-	memblock_t	*start, *rover, *newblock, *base;
+	if (page->prev)
+		page->prev->next = page->next;
+	else
+		c->partial = page->next;
+	if (page->next)
+		page->next->prev = page->prev;
+	page->prev = page->next = NULL;
+}
 
-	if (!tag)
-		Sys_Error ("Z_TagMalloc: tried to use a 0 tag");
+/*
+========================
+Z_ClassAlloc
+========================
+*/
+static memblock_t *Z_ClassAlloc (int sizeclass)
+{
+	memclass_t	*c = &mainzone->classes[sizeclass];
+	mempage_t	*page = c->partial;
+	memblock_t	*block;
+	byte		*p;
+	int		i;
+
+	if (!page)
+	{	// carve a fresh page into blocks
+		if ((i = Z_AllocPages (1)) < 0)
+			return NULL;
+		page = &mainzone->pages[i];
+		page->sizeclass = sizeclass;
+		page->used = 0;
+		page->freelist = NULL;
+		p = mainzone->base + (i << ZONE_PAGESHIFT);
+		for (i = c->perpage - 1; i >= 0; i--)
+		{
+			block = (memblock_t *) (p + i * c->size);
+			block->id = 0;
+			block->next = page->freelist;
+			page->freelist = block;
+		}
+		Z_LinkPage (c, page);
+		c->pages++;
+	}
 
-//
-// scan through the block list looking for the first free block
-// of sufficient size
-//
-	size += sizeof(memblock_t);	// account for size of block header
-	size += 4;					// space for memory trash tester
-	size = (size + 7) & ~7;		// align to 8-byte boundary
+	block = page->freelist;
+	page->freelist = block->next;
+	if (++page->used == c->perpage)
+		Z_UnlinkPage (c, page);
 
-	base = rover = mainzone->rover;
-	start = base->prev;
+	if (++c->inuse > c->peak)
+		c->peak = c->inuse;
+	return block;
+}
 
-	do
+static void Z_ClassFree (mempage_t *page, memblock_t *block)
+{
+	memclass_t	*c = &mainzone->classes[page->sizeclass];
+
+	c->inuse--;
+	c->requested -= block->size;
+
+	block->id = 0;
+	block->next = page->freelist;
+	page->freelist = block;
+	if (page->used-- == c->perpage)
+		Z_LinkPage (c, page);
+
+	if (!page->used && (page->prev || page->next))
+	{	// empty, and not the last page the class has
+		Z_UnlinkPage (c, page);
+		Z_FreePages (page - mainzone->pages, 1);
+		c->pages--;
+	}
+}
+
+/*
+========================
+Z_TagMalloc
+========================
+*/
+static void *Z_TagMalloc (int size)
+{
+	memblock_t	*block;
+	mempage_t	*page;
+	int		total, sizeclass, count, i;
+
+	if (size < 0)
+		return NULL;
+
+	total = size + ZBLOCK_HEADER;
+	if (total <= ZONE_MAXCLASS)
 	{
-		if (rover == start)	// scaned all the way around the list
+		sizeclass = mainzone->classfor[(total + ZONE_GRAIN - 1) / ZONE_GRAIN];
+		if (!(block = Z_ClassAlloc (sizeclass)))
 			return NULL;
-		if (rover->tag)
-			base = rover = rover->next;
-		else
-			rover = rover->next;
-	} while (base->tag || base->size < size);
-
-//
-// found a block big enough
-//
-	extra = base->size - size;
-	if (extra >  MINFRAGMENT)
-	{	// there will be a free fragment after the allocated block
-		newblock = (memblock_t *) ((byte *)base + size );
-		newblock->size = extra;
-		newblock->tag = 0;			// free block
-		newblock->prev = base;
-		newblock->id = ZONEID;
-		newblock->next = base->next;
-		newblock->next->prev = newblock;
-		base->next = newblock;
-		base->size = size;
+		mainzone->classes[sizeclass].requested += size;
+	}
+	else
+	{
+		count = (total + ZONE_PAGESIZE - 1) >> ZONE_PAGESHIFT;
+		if ((i = Z_AllocPages (count)) < 0)
+			return NULL;
+		page = &mainzone->pages[i];
+		page->sizeclass = ZPAGE_SPAN;
+		page->span = count;
+		block = (memblock_t *) (mainzone->base + (i << ZONE_PAGESHIFT));
+		mainzone->spans++;
+		mainzone->spanpages += count;
+		mainzone->spanrequested += size;
 	}
 
-	base->tag = tag;				// no longer a free block
+	block->size = size;
+	block->id = ZONEID;
 
-	mainzone->rover = base->next;	// next allocation will start looking here
+	return (void *) ((byte *)block + ZBLOCK_HEADER);
+}
+
+/*
+========================
+Z_GetBlock
+
+Finds the block and page of an allocated pointer, or errors out
+========================
+*/
+static memblock_t *Z_GetBlock (void *ptr, mempage_t **page, const char *func)
+{
+	memblock_t	*block;
+	mempage_t	*p;
+	int		ofs;
+
+	block = (memblock_t *) ((byte *)ptr - ZBLOCK_HEADER);
+	ofs = (byte *)block - mainzone->base;
+	if ((byte *)block < mainzone->base || ofs >= mainzone->numpages * ZONE_PAGESIZE)
+		Sys_Error ("%s: pointer outside of the zone", func);
 
-	base->id = ZONEID;
+	p = &mainzone->pages[ofs >> ZONE_PAGESHIFT];
+	ofs &= ZONE_PAGESIZE - 1;
+	if (p->sizeclass >= 0)
+	{
+		if (ofs % mainzone->classes[p->sizeclass].size)
+			Sys_Error ("%s: pointer is not the start of a block", func);
+	}
+	else if (p->sizeclass != ZPAGE_SPAN || ofs)
+		Sys_Error ("%s: pointer is not the start of a block", func);
 
-// marker for memory trash testing
-	*(int *)((byte *)base + base->size - 4) = ZONEID;
+	if (block->id != ZONEID)
+		Sys_Error ("%s: pointer is not allocated", func);
 
-	return (void *) ((byte *)base + sizeof(memblock_t));
+	*page = p;
+	return block;
 }
 
 /*
 ========================
-Z_CheckHeap
+Z_FreeBlock -- zone_mutex must be held
 ========================
 */
-static void Z_CheckHeap (void)
+static void Z_FreeBlock (void *ptr)
 {
 	memblock_t	*block;
+	mempage_t	*page;
 
-	for (block = mainzone->blocklist.next ; ; block = block->next)
+	block = Z_GetBlock (ptr, &page, "Z_Free");
+	if (page->sizeclass >= 0)
 	{
-		if (block->next == &mainzone->blocklist)
-			break;			// all blocks have been hit
-		if ( (byte *)block + block->size != (byte *)block->next)
-			Sys_Error ("Z_CheckHeap: block size does not touch the next block\n");
-		if ( block->next->prev != block)
-			Sys_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
-		if (!block->tag && !block->next->tag)
-			Sys_Error ("Z_CheckHeap: two consecutive free blocks\n");
+		Z_ClassFree (page, block);
+		return;
 	}
+
+	block->id = 0;
+	mainzone->spans--;
+	mainzone->spanpages -= page->span;
+	mainzone->spanrequested -= block->size;
+	Z_FreePages (page - mainzone->pages, page->span);
+}
+
+/*
+========================
+Z_Free
+========================
+*/
+void Z_Free (void *ptr)
+{
+	if (!ptr)
+		Sys_Error ("Z_Free: NULL pointer");
+
+	SDL_LockMutex (zone_mutex);
+	Z_FreeBlock (ptr);
+	SDL_UnlockMutex (zone_mutex);
 }
 
 
@@ -199,8 +367,9 @@ void *Z_Malloc (int size)
 {
 	void	*buf;
 
-	Z_CheckHeap ();	// DEBUG
-	buf = Z_TagMalloc (size, 1);
+	SDL_LockMutex (zone_mutex);
+	buf = Z_TagMalloc (size);
+	SDL_UnlockMutex (zone_mutex);
 	if (!buf)
 		Sys_Error ("Z_Malloc: failed on allocation of %i bytes",size);
 	Q_memset (buf, 0, size);
@@ -211,38 +380,62 @@ void *Z_Malloc (int size)
 /*
 ========================
 Z_Realloc
+
+Stays in place while the new size still fits the block
 ========================
 */
 void *Z_Realloc(void *ptr, int size)
 {
-	int old_size;
-	void *old_ptr;
+	int old_size, total;
+	qboolean inplace;
+	void *new_ptr;
 	memblock_t *block;
+	mempage_t *page;
 
 	if (!ptr)
 		return Z_Malloc (size);
 
-	block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
-	if (block->id != ZONEID)
-		Sys_Error ("Z_Realloc: realloced a pointer without ZONEID");
-	if (block->tag == 0)
-		Sys_Error ("Z_Realloc: realloced a freed pointer");
-
+	SDL_LockMutex (zone_mutex);
+	block = Z_GetBlock (ptr, &page, "Z_Realloc");
 	old_size = block->size;
-	old_size -= (4 + (int)sizeof(memblock_t));	/* see Z_TagMalloc() */
-	old_ptr = ptr;
 
-	Z_Free (ptr);
-	ptr = Z_TagMalloc (size, 1);
-	if (!ptr)
+	total = size + ZBLOCK_HEADER;
+	if (size < 0)
+		inplace = false;
+	else if (page->sizeclass >= 0)
+		inplace = (total <= ZONE_MAXCLASS &&
+			mainzone->classfor[(total + ZONE_GRAIN - 1) / ZONE_GRAIN] == page->sizeclass);
+	else
+		inplace = (total > ZONE_MAXCLASS &&
+			((total + ZONE_PAGESIZE - 1) >> ZONE_PAGESHIFT) == page->span);
+
+	if (inplace)
+	{	// same class or page count, no need to move
+		if (page->sizeclass >= 0)
+			mainzone->classes[page->sizeclass].requested += size - old_size;
+		else
+			mainzone->spanrequested += size - old_size;
+		block->size = size;
+		SDL_UnlockMutex (zone_mutex);
+		if (old_size < size)
+			memset ((byte *)ptr + old_size, 0, size - old_size);
+		return ptr;
+	}
+
+	new_ptr = Z_TagMalloc (size);
+	if (!new_ptr)
+	{
+		SDL_UnlockMutex (zone_mutex);
 		Sys_Error ("Z_Realloc: failed on allocation of %i bytes", size);
+	}
 
-	if (ptr != old_ptr)
-		memmove (ptr, old_ptr, q_min(old_size, size));
+	memcpy (new_ptr, ptr, q_min(old_size, size));
 	if (old_size < size)
-		memset ((byte *)ptr + old_size, 0, size - old_size);
+		memset ((byte *)new_ptr + old_size, 0, size - old_size);
+	Z_FreeBlock (ptr);
+	SDL_UnlockMutex (zone_mutex);
 
-	return ptr;
+	return new_ptr;
 }
 
 char *Z_Strdup (const char *s)
@@ -257,31 +450,201 @@ char *Z_Strdup (const char *s)
 /*
 ========================
 Z_Print
+
+Per-class usage; waste is what rounding up to the class size costs
 ========================
 */
-void Z_Print (memzone_t *zone)
+static void Z_Print (void)
 {
-	memblock_t	*block;
+	memclass_t	*c;
+	int		i, run, largest, blocks;
 
-	Con_Printf ("zone size: %i  location: %p\n",mainzone->size,mainzone);
+	SDL_LockMutex (zone_mutex);
 
-	for (block = zone->blocklist.next ; ; block = block->next)
+	for (i = 0, run = 0, largest = 0; i < mainzone->numpages; i++)
 	{
-		Con_Printf ("block:%p    size:%7i    tag:%3i\n",
-			block, block->size, block->tag);
+		if (mainzone->pages[i].sizeclass == ZPAGE_FREE)
+			largest = q_max (largest, ++run);
+		else
+			run = 0;
+	}
 
-		if (block->next == &zone->blocklist)
-			break;			// all blocks have been hit
-		if ( (byte *)block + block->size != (byte *)block->next)
-			Con_Printf ("ERROR: block size does not touch the next block\n");
-		if ( block->next->prev != block)
-			Con_Printf ("ERROR: next block doesn't have proper back link\n");
-		if (!block->tag && !block->next->tag)
-			Con_Printf ("ERROR: two consecutive free blocks\n");
+	Con_Printf ("zone size: %iK  pages: %i of %iK  free: %i  largest free run: %i\n",
+		mainzone->size / 1024, mainzone->numpages, ZONE_PAGESIZE / 1024,
+		mainzone->freepages, largest);
+	Con_Printf ("class pages  inuse   peak  requested  waste\n");
+	Con_Printf ("----- ----- ------ ------ ---------- -----\n");
+	for (i = 0, c = mainzone->classes; i < NUM_ZONECLASSES; i++, c++)
+	{
+		if (!c->pages && !c->peak)
+			continue;
+		blocks = c->inuse * c->size;
+		Con_Printf ("%5i %5i %6i %6i %10i %4i%%\n", c->size, c->pages, c->inuse, c->peak,
+			c->requested, blocks ? (blocks - c->requested) * 100 / blocks : 0);
 	}
+	Con_Printf ("%i large blocks in %i pages, %i bytes requested\n",
+		mainzone->spans, mainzone->spanpages, mainzone->spanrequested);
+
+	SDL_UnlockMutex (zone_mutex);
 }
 
+/*
+========================
+Z_Stress_f
 
+zone_stress [ops] [blocks]
+
+Keeps a set of live blocks of mixed sizes and churns through them: mostly
+freeing one and allocating another of a new size, sometimes growing one
+with Z_Realloc.  Then half of them are freed and the zone is filled up
+with more mixed blocks, to show how much of the freed space can be used
+again.  The sizes come from a fixed seed, so runs are comparable.
+========================
+*/
+static unsigned int zone_stressseed;
+
+static int Z_StressRand (void)
+{
+	zone_stressseed = zone_stressseed * 1103515245 + 12345;
+	return zone_stressseed >> 8;
+}
+
+static int Z_StressSize (void)
+{
+	int	r = Z_StressRand () % 100;
+
+	if (r < 60)
+		return 8 + Z_StressRand () % 56;	// strings and small structures
+	if (r < 90)
+		return 64 + Z_StressRand () % 448;
+	if (r < 98)
+		return 512 + Z_StressRand () % 1536;
+	return 2048 + Z_StressRand () % 6144;	// takes pages of its own
+}
+
+// like Z_Malloc, but a full zone isn't an error here
+static void *Z_StressAlloc (int size)
+{
+	void	*buf;
+
+	SDL_LockMutex (zone_mutex);
+	buf = Z_TagMalloc (size);
+	SDL_UnlockMutex (zone_mutex);
+	return buf;
+}
+
+static void Z_Stress_f (void)
+{
+	void		**blocks, *buf;
+	int		*sizes, ops, numblocks, i, n, grown, filled;
+	void		**extra;
+	int		numextra;
+	double		start, time;
+	mempage_t	*page;
+
+	ops = (Cmd_Argc () > 1) ? Q_atoi (Cmd_Argv (1)) : 1000000;
+	numblocks = (Cmd_Argc () > 2) ? Q_atoi (Cmd_Argv (2)) : 2000;
+	if (ops < 1 || numblocks < 2 || numblocks > 65536)
+	{
+		Con_Printf ("usage: zone_stress [ops] [blocks (2-65536)]\n");
+		return;
+	}
+
+	blocks = (void **) calloc (numblocks, sizeof(*blocks));
+	sizes = (int *) calloc (numblocks, sizeof(*sizes));
+	extra = NULL;
+	numextra = 0;
+	if (!blocks || !sizes)
+	{
+		Con_Printf ("zone_stress: out of memory\n");
+		goto done;
+	}
+
+	zone_stressseed = 12345;
+	for (i = 0; i < numblocks; i++)
+	{
+		sizes[i] = Z_StressSize ();
+		if (!(blocks[i] = Z_StressAlloc (sizes[i])))
+		{
+			Con_Printf ("zone_stress: zone full with %i blocks, try fewer or a bigger -zone\n", i);
+			goto done;
+		}
+	}
+
+	grown = 0;
+	start = Sys_ProfileTime ();
+	for (n = 0; n < ops; n++)
+	{
+		i = Z_StressRand () % numblocks;
+		if (Z_StressRand () % 8 == 0)
+		{
+			// grow it in place or move it, but never into the large
+			// blocks, which could fail on a fragmented zone
+			SDL_LockMutex (zone_mutex);
+			Z_GetBlock (blocks[i], &page, "zone_stress");
+			if (page->sizeclass >= 0 && mainzone->freepages > 0 &&
+				sizes[i] + 64 + ZBLOCK_HEADER <= ZONE_MAXCLASS)
+			{
+				sizes[i] += Z_StressRand () % 64;
+				blocks[i] = Z_Realloc (blocks[i], sizes[i]);
+				grown++;
+			}
+			SDL_UnlockMutex (zone_mutex);
+			continue;
+		}
+
+		Z_Free (blocks[i]);
+		sizes[i] = Z_StressSize ();
+		if (!(blocks[i] = Z_StressAlloc (sizes[i])))
+		{
+			Con_Printf ("zone_stress: zone full after %i ops\n", n);
+			goto done;
+		}
+	}
+	time = Sys_ProfileTime () - start;
+	Con_Printf ("%i ops (%i reallocs) on %i live blocks: %.0f ns/op\n",
+		ops, grown, numblocks, time * 1e9 / ops);
+
+	for (i = 0; i < numblocks; i += 2)
+	{
+		Z_Free (blocks[i]);
+		blocks[i] = NULL;
+	}
+
+	// the zone stays locked while it is full, so nothing else can fail on it
+	SDL_LockMutex (zone_mutex);
+	filled = 0;
+	for (;;)
+	{
+		if (!(numextra & 1023))
+		{
+			void **newextra = (void **) realloc (extra, (numextra + 1024) * sizeof(*extra));
+			if (!newextra)
+				break;
+			extra = newextra;
+		}
+		n = Z_StressSize ();
+		if (!(buf = Z_TagMalloc (n)))
+			break;
+		extra[numextra++] = buf;
+		filled += n;
+	}
+	for (i = 0; i < numextra; i++)
+		Z_FreeBlock (extra[i]);
+	SDL_UnlockMutex (zone_mutex);
+	Con_Printf ("after freeing half: %iK more in %i mixed blocks\n", filled / 1024, numextra);
+
+done:
+	if (blocks)
+	{
+		for (i = 0; i < numblocks; i++)
+			if (blocks[i])
+				Z_Free (blocks[i]);
+	}
+	free (blocks);
+	free (sizes);
+	free (extra);
+}
 //============================================================================
 
 #define	HUNK_SENTINAL	0x1df001ed
@@ -940,21 +1303,33 @@ void *Cache_Alloc (cache_user_t *c, int size, const char *name)
 
 static void Memory_InitZone (memzone_t *zone, int size)
 {
-	memblock_t	*block;
-
-// set the entire zone to one free block
-
-	zone->blocklist.next = zone->blocklist.prev = block =
-		(memblock_t *)( (byte *)zone + sizeof(memzone_t) );
-	zone->blocklist.tag = 1;	// in use block
-	zone->blocklist.id = 0;
-	zone->blocklist.size = 0;
-	zone->rover = block;
-
-	block->prev = block->next = &zone->blocklist;
-	block->tag = 0;			// free block
-	block->id = ZONEID;
-	block->size = size - sizeof(memzone_t);
+	memclass_t	*c;
+	byte		*end = (byte *)zone + size;
+	int		i, j;
+
+	memset (zone, 0, sizeof(memzone_t));
+	zone->size = size;
+
+// the page map goes first, then as many pages as fit after it
+	zone->pages = (mempage_t *) ((byte *)zone + sizeof(memzone_t));
+	zone->numpages = (size - (int)sizeof(memzone_t)) / (ZONE_PAGESIZE + (int)sizeof(mempage_t));
+	zone->base = (byte *) (((uintptr_t)(zone->pages + zone->numpages) + ZONE_GRAIN - 1) & ~(uintptr_t)(ZONE_GRAIN - 1));
+	while (zone->numpages > 0 && zone->base + zone->numpages * ZONE_PAGESIZE > end)
+		zone->numpages--;
+	if (zone->numpages < NUM_ZONECLASSES)
+		Sys_Error ("Memory_InitZone: zone is too small (%i bytes)", size);
+
+	zone->freepages = zone->numpages;
+	for (i = 0; i < zone->numpages; i++)
+		zone->pages[i].sizeclass = ZPAGE_FREE;
+
+	for (i = 0, j = 0, c = zone->classes; i < NUM_ZONECLASSES; i++, c++)
+	{
+		c->size = zone_classsizes[i];
+		c->perpage = ZONE_PAGESIZE / c->size;
+		for ( ; j <= c->size / ZONE_GRAIN; j++)
+			zone->classfor[j] = i;
+	}
 }
 
 /*
@@ -981,9 +1356,12 @@ void Memory_Init (void *buf, int size)
 		else
 			Sys_Error ("Memory_Init: you must specify a size in KB after -zone");
 	}
+	zone_mutex = SDL_CreateMutex ();
 	mainzone = (memzone_t *) Hunk_AllocName (zonesize, "zone" );
 	Memory_InitZone (mainzone, zonesize);
 
 	Cmd_AddCommand ("hunk_print", Hunk_Print_f); //johnfitz
+	Cmd_AddCommand ("zone_print", Z_Print);
+	Cmd_AddCommand ("zone_stress", Z_Stress_f);
 }
 